@@ -20,3 +20,100 @@
 //! @param[in]      pBuffer         ピクセルデータです.
 //-------------------------------------------------------------------------------------------------
 bool SaveToBitmap( const char16* filename, u32 width, u32 height, const u8* pBuffer );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      32bit のピクセルの R と B を入れ替えます.
+//!
+//! @details    RGBA と BMP の並びの BGRA の相互変換に使います. pSrc と pDst は同じでも構いません.
+//!
+//! @param[in]      pSrc            変換元のピクセルデータです.
+//! @param[out]     pDst            変換先のピクセルデータです.
+//! @param[in]      pixelCount      ピクセル数です.
+//-------------------------------------------------------------------------------------------------
+void SwapRedBlue( const u8* pSrc, u8* pDst, u32 pixelCount );
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// MappedBitmap class
+///////////////////////////////////////////////////////////////////////////////////////////////////
+class MappedBitmap : private NonCopyable
+{
+    //=============================================================================================
+    // list of friend classes and methods.
+    //=============================================================================================
+    /* NOTHING */
+
+public:
+    //=============================================================================================
+    // public variables.
+    //=============================================================================================
+    /* NOTHING */
+
+    //=============================================================================================
+    // public methods.
+    //=============================================================================================
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //---------------------------------------------------------------------------------------------
+    MappedBitmap();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //---------------------------------------------------------------------------------------------
+    ~MappedBitmap();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      最終的なサイズの BMP ファイルを作成し, 読み書き可能でメモリにマップします.
+    //!
+    //! @details    ヘッダは作成時に書き込みます. ピクセルデータは 32bit の BGRA で,
+    //!             行の間に隙間はなく, 先頭の行が画像の下端です.
+    //!             ピクセルデータに書き込んだ内容は, 複製せずにそのままファイルの内容になります.
+    //!
+    //! @param[in]      filename        ファイル名です.
+    //! @param[in]      width           画像の横幅です.
+    //! @param[in]      height          画像の縦幅です.
+    //! @retval true    作成に成功.
+    //! @retval false   作成に失敗.
+    //---------------------------------------------------------------------------------------------
+    bool Create( const char16* filename, u32 width, u32 height );
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      マップを解除してファイルを閉じます.
+    //!
+    //! @details    書き込んだ内容はページキャッシュからファイルに書き出されます.
+    //---------------------------------------------------------------------------------------------
+    void Close();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      マップされたピクセルデータの先頭を取得します.
+    //!
+    //! @return     ピクセルデータの先頭を返却します. 作成していない場合は nullptr を返却します.
+    //---------------------------------------------------------------------------------------------
+    u8* GetPixels() const;
+
+protected:
+    //=============================================================================================
+    // protected variables.
+    //=============================================================================================
+    /* NOTHING */
+
+    //=============================================================================================
+    // protected methods.
+    //=============================================================================================
+    /* NOTHING */
+
+private:
+    //=============================================================================================
+    // private variables.
+    //=============================================================================================
+    void*   m_pHandle;      //!< ファイルハンドルです.
+    void*   m_pMapping;     //!< ファイルマッピングハンドルです.
+    u8*     m_pData;        //!< マップされたファイルの先頭です.
+    u64     m_Size;         //!< ファイルサイズです.
+
+    //=============================================================================================
+    // private methods.
+    //=============================================================================================
+    /* NOTHING */
+};
@@ -0,0 +1,89 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : Bounds.h
+// Desc : Bounding Volume Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <asdxMath.h>
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// BoundingBox structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct BoundingBox
+{
+    asdx::Vector3   Mini;       //!< 最小値です.
+    asdx::Vector3   Maxi;       //!< 最大値です.
+};
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      空のバウンディングボックスを生成します.
+//!
+//! @return     最小値に F32_MAX, 最大値に -F32_MAX を設定したボックスを返却します.
+//-------------------------------------------------------------------------------------------------
+BoundingBox CreateEmptyBox();
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      バウンディングボックスが空かどうかチェックします.
+//!
+//! @param[in]      box         チェックするボックスです.
+//! @retval true    空です.
+//! @retval false   空ではありません.
+//-------------------------------------------------------------------------------------------------
+bool IsEmpty( const BoundingBox& box );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      バウンディングボックスを点を含むように拡張します.
+//!
+//! @param[in,out]  box         拡張するボックスです.
+//! @param[in]      point       含める点です.
+//-------------------------------------------------------------------------------------------------
+void Merge( BoundingBox& box, const asdx::Vector3& point );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      バウンディングボックスを別のボックスを含むように拡張します.
+//!
+//! @param[in,out]  box         拡張するボックスです.
+//! @param[in]      value       含めるボックスです.
+//-------------------------------------------------------------------------------------------------
+void Merge( BoundingBox& box, const BoundingBox& value );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      バウンディングボックスを行列で変換します.
+//!
+//! @param[in]      box         変換するボックスです.
+//! @param[in]      matrix      変換行列です.
+//! @return     変換後のボックスを包含する軸平行ボックスを返却します.
+//-------------------------------------------------------------------------------------------------
+BoundingBox TransformBox( const BoundingBox& box, const asdx::Matrix& matrix );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      可視なバウンディングボックスに合わせてニアクリップ・ファークリップ平面を求めます.
+//!
+//! @details    ビュー空間の視錐台側面でカリングした後, 残ったボックスの深度範囲を返却します.
+//!             ファー/ニア比が大きくなりすぎないように, ニアクリップは farClip * minNearRatio 以上に制限します.
+//!
+//! @param[in]      view            ビュー行列です.
+//! @param[in]      fieldOfView     垂直画角です.
+//! @param[in]      aspectRatio     アスペクト比です.
+//! @param[in]      pBoxes          ワールド空間のバウンディングボックスです.
+//! @param[in]      count           ボックス数です.
+//! @param[in]      minNearRatio    ファークリップに対するニアクリップの最小比率です.
+//! @param[out]     nearClip        ニアクリップ平面までの距離です.
+//! @param[out]     farClip         ファークリップ平面までの距離です.
+//! @retval true    可視なボックスが存在し, 結果を書き込みました.
+//! @retval false   可視なボックスが存在しないため, 結果を書き込みませんでした.
+//-------------------------------------------------------------------------------------------------
+bool FitClipPlanes(
+    const asdx::Matrix& view,
+    f32                 fieldOfView,
+    f32                 aspectRatio,
+    const BoundingBox*  pBoxes,
+    u32                 count,
+    f32                 minNearRatio,
+    f32&                nearClip,
+    f32&                farClip );
@@ -0,0 +1,60 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : DepthPyramid.h
+// Desc : Hierarchical Depth Pyramid Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <asdxMath.h>
+#include <Bounds.h>
+#include <Renderer.h>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// DepthPyramidLevel structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct DepthPyramidLevel
+{
+    u32     Width;      //!< 横幅です.
+    u32     Height;     //!< 縦幅です.
+    u32     Offset;     //!< DepthPyramid::MaxDepth 内の先頭位置です.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// DepthPyramid structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct DepthPyramid
+{
+    u32                             Width;      //!< 元の深度バッファの横幅です.
+    u32                             Height;     //!< 元の深度バッファの縦幅です.
+    std::vector<DepthPyramidLevel>  Levels;     //!< ミップレベルです. 先頭が元の半分の解像度です.
+    std::vector<f32>                MaxDepth;   //!< 全レベルの最大深度です.
+};
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      レンダーターゲットの深度から最大深度のミップピラミッドを構築します.
+//!
+//! @details    各レベルのテクセルは, 1 つ上のレベルの 2x2 テクセルの最大値です.
+//!             奇数サイズの端は切り上げるので, 元のピクセルは必ずいずれかのテクセルに含まれます.
+//!
+//! @param[in]      target      レンダーターゲットです.
+//! @param[out]     pyramid     構築したピラミッドの格納先です.
+//-------------------------------------------------------------------------------------------------
+void BuildDepthPyramid( const RenderTarget& target, DepthPyramid& pyramid );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      バウンディングボックスが描画済みの深度に完全に隠れているか判定します.
+//!
+//! @details    スクリーン上の範囲が 2x2 テクセル以内に収まるレベルを選んで判定します.
+//!
+//! @param[in]      pyramid         深度ピラミッドです.
+//! @param[in]      worldViewProj   ボックスの空間からのワールドビュー射影行列です.
+//! @param[in]      box             判定するボックスです.
+//! @retval true    完全に隠れています.
+//! @retval false   可視の可能性があります.
+//-------------------------------------------------------------------------------------------------
+bool IsOccluded( const DepthPyramid& pyramid, const asdx::Matrix& worldViewProj, const BoundingBox& box );
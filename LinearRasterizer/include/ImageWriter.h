@@ -0,0 +1,165 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : ImageWriter.h
+// Desc : Asynchronous Image Writer Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <asdxTypedef.h>
+#include <VideoStream.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+//-------------------------------------------------------------------------------------------------
+// Constant Values
+//-------------------------------------------------------------------------------------------------
+static constexpr u32 IMAGE_WRITER_BUFFER_COUNT = 3;     //!< 既定のカラーバッファ数です. 描画中の 1 枚と書き込み待ちの 2 枚です.
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// ImageWriter class
+///////////////////////////////////////////////////////////////////////////////////////////////////
+class ImageWriter : private NonCopyable
+{
+    //=============================================================================================
+    // list of friend classes and methods.
+    //=============================================================================================
+    /* NOTHING */
+
+public:
+    //=============================================================================================
+    // public variables.
+    //=============================================================================================
+    /* NOTHING */
+
+    //=============================================================================================
+    // public methods.
+    //=============================================================================================
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //---------------------------------------------------------------------------------------------
+    ImageWriter();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //---------------------------------------------------------------------------------------------
+    ~ImageWriter();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      カラーバッファを確保して書き込みスレッドを開始します.
+    //!
+    //! @param[in]      width           画像の横幅です.
+    //! @param[in]      height          画像の縦幅です.
+    //! @param[in]      bufferCount     カラーバッファ数です. 2 以上で描画と書き込みが重なります.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //---------------------------------------------------------------------------------------------
+    bool Init( u32 width, u32 height, u32 bufferCount = IMAGE_WRITER_BUFFER_COUNT );
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      書き込み待ちの画像を全て書き込んでからスレッドを終了し, バッファを解放します.
+    //---------------------------------------------------------------------------------------------
+    void Term();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      フレームを連続して書き込む動画ストリームを開きます.
+    //!
+    //! @details    開いている間は, Submit() したフレームを画像ファイルではなくストリームに要求順で書き込みます.
+    //!             ストリームは Term() で閉じます. Init() の後に呼び出す必要があります.
+    //!
+    //! @param[in]      filename        出力先のファイル名です. 名前付きパイプや "-" (標準出力) も指定できます.
+    //! @param[in]      format          出力形式です.
+    //! @param[in]      frameRate       フレームレートです.
+    //! @retval true    オープンに成功.
+    //! @retval false   オープンに失敗.
+    //---------------------------------------------------------------------------------------------
+    bool OpenStream( const char16* filename, VIDEO_FORMAT format, u32 frameRate );
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      描画に使う空きカラーバッファを取得します.
+    //!
+    //! @details    全てのバッファが書き込み待ちの場合は, 1 枚書き込まれるまで待機します.
+    //!
+    //! @return     RGBA8 のカラーバッファを返却します. 初期化されていない場合は nullptr を返却します.
+    //---------------------------------------------------------------------------------------------
+    u8* Acquire();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      描画を終えたカラーバッファの書き込みを要求します.
+    //!
+    //! @details    拡張子が png, qoi の場合はその形式で, それ以外は BMP で保存します.
+    //!             バッファは書き込みが終わると空きバッファに戻ります. 要求後に内容を変更してはいけません.
+    //!
+    //! @param[in]      pBuffer         Acquire() で取得したカラーバッファです.
+    //! @param[in]      filename        出力ファイル名です. ストリームを開いている場合は使いません.
+    //---------------------------------------------------------------------------------------------
+    void Submit( u8* pBuffer, const char16* filename );
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      書き込み待ちの画像が全て書き込まれるまで待機します.
+    //---------------------------------------------------------------------------------------------
+    void Flush();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      書き込みに失敗した画像の数を取得します.
+    //!
+    //! @return     書き込みに失敗した画像の数を返却します.
+    //---------------------------------------------------------------------------------------------
+    u32 GetErrorCount() const;
+
+protected:
+    //=============================================================================================
+    // protected variables.
+    //=============================================================================================
+    /* NOTHING */
+
+    //=============================================================================================
+    // protected methods.
+    //=============================================================================================
+    /* NOTHING */
+
+private:
+    ///////////////////////////////////////////////////////////////////////////////////////////////
+    // Request structure
+    ///////////////////////////////////////////////////////////////////////////////////////////////
+    struct Request
+    {
+        u8*                         pBuffer;    //!< 書き込むカラーバッファです.
+        std::basic_string<char16>   Filename;   //!< 出力ファイル名です.
+    };
+
+    //=============================================================================================
+    // private variables.
+    //=============================================================================================
+    u32                             m_Width;        //!< 画像の横幅です.
+    u32                             m_Height;       //!< 画像の縦幅です.
+    std::vector<std::vector<u8>>    m_Buffers;      //!< カラーバッファです.
+    std::vector<u8*>                m_FreeBuffers;  //!< 空きカラーバッファです.
+    std::deque<Request>             m_Requests;     //!< 書き込み待ちの要求です.
+    u32                             m_Writing;      //!< 書き込み中の要求数です.
+    u32                             m_ErrorCount;   //!< 書き込みに失敗した画像の数です.
+    VideoStream                     m_Stream;       //!< 動画ストリームです. 書き込みスレッドのみが使います.
+    bool                            m_Exit;         //!< スレッドの終了要求です.
+    mutable std::mutex              m_Mutex;        //!< 上記のメンバーを保護するミューテックスです.
+    std::condition_variable         m_RequestCV;    //!< 要求が追加された時に通知します.
+    std::condition_variable         m_FreeCV;       //!< バッファが空いた時に通知します.
+    std::thread                     m_Thread;       //!< 書き込みスレッドです.
+
+    //=============================================================================================
+    // private methods.
+    //=============================================================================================
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      書き込みスレッドの処理です.
+    //---------------------------------------------------------------------------------------------
+    void Run();
+};
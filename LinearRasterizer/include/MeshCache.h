@@ -0,0 +1,336 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : MeshCache.h
+// Desc : Binary Mesh Cache Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <asdxMath.h>
+#include <Bounds.h>
+#include <MappedFile.h>
+#include <string_view>
+#include <vector>
+
+
+//-------------------------------------------------------------------------------------------------
+// Forward Declarations
+//-------------------------------------------------------------------------------------------------
+struct ResOBJ;
+struct ResLOD;
+
+
+//-------------------------------------------------------------------------------------------------
+// Constant Values
+//-------------------------------------------------------------------------------------------------
+static constexpr u32 MESH_CACHE_MAGIC     = 0x4348534D;     //!< マジック ('MSHC').
+static constexpr u32 MESH_CACHE_VERSION   = 5;              //!< フォーマットバージョン.
+static constexpr u32 MESH_CACHE_ALIGNMENT = 16;             //!< 各ストリームのアライメント.
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// MeshCacheHeader structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct MeshCacheHeader
+{
+    u32     Magic;              //!< マジック.
+    u32     Version;            //!< フォーマットバージョン.
+    u64     SourceSize;         //!< 変換元ファイルのサイズ.
+    u64     SourceTime;         //!< 変換元ファイルの更新日時.
+    u64     SourceHash;         //!< 変換元ファイルパスのハッシュ値.
+    u32     VertexCount;        //!< 頂点数.
+    u32     IndexCount;         //!< インデックス数.
+    u32     SubsetCount;        //!< サブセット数.
+    u32     MaterialCount;      //!< マテリアル数.
+    u32     TexCoordCount;      //!< テクスチャ座標数 (0 または頂点数).
+    u32     NormalCount;        //!< 法線ベクトル数 (0 または頂点数).
+    u32     LodCount;           //!< LOD 数 (全サブセットの合計).
+    u32     LodIndexCount;      //!< IndexCount に続けて格納する LOD のインデックス数.
+    u32     DependencyCount;    //!< 変換時に参照したファイル (MTL) の数.
+    u32     Reserved;           //!< 予約領域.
+    u64     PositionOffset;     //!< 位置座標ストリームへのオフセット.
+    u64     NormalOffset;       //!< 法線ベクトルストリームへのオフセット.
+    u64     TexCoordOffset;     //!< テクスチャ座標ストリームへのオフセット.
+    u64     IndexOffset;        //!< インデックスバッファへのオフセット.
+    u64     SubsetOffset;       //!< サブセットテーブルへのオフセット.
+    u64     MaterialOffset;     //!< マテリアルテーブルへのオフセット.
+    u64     LodOffset;          //!< LOD テーブルへのオフセット.
+    u64     DependencyOffset;   //!< 参照ファイルテーブルへのオフセット.
+    u64     StringOffset;       //!< 文字列テーブルへのオフセット.
+    u64     StringSize;         //!< 文字列テーブルのサイズ.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// MeshCacheString structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct MeshCacheString
+{
+    u32     Offset;             //!< 文字列テーブル先頭からのオフセット.
+    u32     Length;             //!< 文字数.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// MeshCacheSubset structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct MeshCacheSubset
+{
+    MeshCacheString Name;       //!< 適用マテリアル名.
+    u32             Offset;     //!< オフセット.
+    u32             Count;      //!< カウント.
+    u32             MaterialId; //!< マテリアル番号.
+    BoundingBox     Bounds;     //!< バウンディングボックス.
+    u32             LodOffset;  //!< LOD テーブルの先頭番号.
+    u32             LodCount;   //!< LOD 数 (LOD0 を含む).
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// MeshCacheLod structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct MeshCacheLod
+{
+    u32     Offset;             //!< インデックスオフセット.
+    u32     Count;              //!< インデックス数.
+    f32     Error;              //!< 元のメッシュからの誤差 (オブジェクト空間の距離).
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// MeshCacheMaterial structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct MeshCacheMaterial
+{
+    MeshCacheString Name;           //!< マテリアル名.
+    asdx::Vector3   Ambient;        //!< 環境遮蔽.
+    asdx::Vector3   Diffuse;        //!< 拡散反射.
+    asdx::Vector3   Specular;       //!< 鏡面反射.
+    f32             Alpha;          //!< 透過度.
+    f32             Power;          //!< 鏡面反射強度.
+    MeshCacheString AmbientMap;     //!< アンビエントマップ名.
+    MeshCacheString DiffuseMap;     //!< ディフューズマップ名.
+    MeshCacheString SpecularMap;    //!< スペキュラーマップ名.
+    MeshCacheString BumpMap;        //!< バンプマップ名.
+};
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// MeshCacheDependency structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct MeshCacheDependency
+{
+    MeshCacheString Path;           //!< ファイルパス.
+    u64             Size;           //!< ファイルサイズ (見つからなかった場合は U64_MAX).
+    u64             Time;           //!< 更新日時.
+};
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// MeshCache class
+///////////////////////////////////////////////////////////////////////////////////////////////////
+class MeshCache : private NonCopyable
+{
+    //=============================================================================================
+    // list of friend classes and methods.
+    //=============================================================================================
+    /* NOTHING */
+
+public:
+    //=============================================================================================
+    // public variables.
+    //=============================================================================================
+    /* NOTHING */
+
+    //=============================================================================================
+    // public methods.
+    //=============================================================================================
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //---------------------------------------------------------------------------------------------
+    MeshCache();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //---------------------------------------------------------------------------------------------
+    ~MeshCache();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      OBJファイルに対応するキャッシュを読み込みます.
+    //!
+    //! @details    キャッシュは "<filename>.mesh" に置かれます. 存在しないか, 変換元のパス・サイズ・
+    //!             更新日時, または参照している MTL ファイルのサイズ・更新日時が一致しない場合は
+    //!             OBJ を頂点を結合して読み込み, 最適化と LOD の生成を行ってからキャッシュを作り直します.
+    //!             中身が壊れているキャッシュも作り直します.
+    //!             読み込んだデータはマップしたメモリをそのまま参照します.
+    //!             読み取り専用のディレクトリなどでキャッシュを書き出せない場合は, 最適化済みのメッシュをメモリ上に保持して使います.
+    //!
+    //! @param[in]      filename        OBJファイル名です.
+    //! @retval true    読み込みに成功.
+    //! @retval false   読み込みに失敗.
+    //---------------------------------------------------------------------------------------------
+    bool Load( const char* filename );
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      キャッシュファイルをメモリにマップします.
+    //!
+    //! @details    ヘッダと各セクション, サブセット・LOD の範囲を検証し, 不正な場合は失敗します.
+    //!             ストリームの内容は読まないので, 開くまでの時間はメッシュの大きさによりません.
+    //!
+    //! @param[in]      filename        キャッシュファイル名です.
+    //! @retval true    マップに成功.
+    //! @retval false   マップに失敗.
+    //---------------------------------------------------------------------------------------------
+    bool Open( const char* filename );
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      キャッシュを閉じます.
+    //---------------------------------------------------------------------------------------------
+    void Close();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      頂点数を取得します.
+    //---------------------------------------------------------------------------------------------
+    u32 GetVertexCount() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      インデックス数を取得します.
+    //---------------------------------------------------------------------------------------------
+    u32 GetIndexCount() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      LOD のインデックス数を取得します.
+    //!
+    //! @details    LOD のインデックスは GetIndexCount() 個のインデックスに続けて格納されています.
+    //---------------------------------------------------------------------------------------------
+    u32 GetLodIndexCount() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      サブセット数を取得します.
+    //---------------------------------------------------------------------------------------------
+    u32 GetSubsetCount() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      マテリアル数を取得します.
+    //---------------------------------------------------------------------------------------------
+    u32 GetMaterialCount() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      位置座標を取得します.
+    //---------------------------------------------------------------------------------------------
+    const asdx::Vector3* GetPositions() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      法線ベクトルを取得します.
+    //!
+    //! @return     法線ベクトルを持たない場合は nullptr を返却します.
+    //---------------------------------------------------------------------------------------------
+    const asdx::Vector3* GetNormals() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      テクスチャ座標を取得します.
+    //!
+    //! @return     テクスチャ座標を持たない場合は nullptr を返却します.
+    //---------------------------------------------------------------------------------------------
+    const asdx::Vector2* GetTexCoords() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      インデックスバッファを取得します.
+    //---------------------------------------------------------------------------------------------
+    const u32* GetIndices() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      サブセットを取得します.
+    //---------------------------------------------------------------------------------------------
+    const MeshCacheSubset& GetSubset( u32 index ) const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      マテリアルを取得します.
+    //---------------------------------------------------------------------------------------------
+    const MeshCacheMaterial& GetMaterial( u32 index ) const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      LOD 数 (全サブセットの合計) を取得します.
+    //---------------------------------------------------------------------------------------------
+    u32 GetLodCount() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      LOD を取得します.
+    //!
+    //! @details    サブセットの LOD は GetLod( subset.LodOffset + level ) で参照します.
+    //---------------------------------------------------------------------------------------------
+    const MeshCacheLod& GetLod( u32 index ) const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      文字列テーブルから文字列を取得します.
+    //---------------------------------------------------------------------------------------------
+    std::string_view GetString( const MeshCacheString& value ) const;
+
+protected:
+    //=============================================================================================
+    // protected variables.
+    //=============================================================================================
+    /* NOTHING */
+
+    //=============================================================================================
+    // protected methods.
+    //=============================================================================================
+    /* NOTHING */
+
+private:
+    //=============================================================================================
+    // private variables.
+    //=============================================================================================
+    MappedFile                  m_File;         //!< マップしたキャッシュファイルです.
+    const MeshCacheHeader*      m_pHeader;      //!< ヘッダです.
+    const asdx::Vector3*        m_pPositions;   //!< 位置座標です.
+    const asdx::Vector3*        m_pNormals;     //!< 法線ベクトルです.
+    const asdx::Vector2*        m_pTexCoords;   //!< テクスチャ座標です.
+    const u32*                  m_pIndices;     //!< インデックスです.
+    const MeshCacheSubset*      m_pSubsets;     //!< サブセットです.
+    const MeshCacheMaterial*    m_pMaterials;   //!< マテリアルです.
+    const MeshCacheLod*         m_pLods;        //!< LOD です.
+    const char*                 m_pStrings;     //!< 文字列テーブルです.
+    std::vector<char>           m_Memory;       //!< キャッシュを書き出せなかった場合のメモリ上のキャッシュです.
+
+    //=============================================================================================
+    // private methods.
+    //=============================================================================================
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      キャッシュのデータを検証して参照します.
+    //!
+    //! @details    ヘッダ, 各セクションの範囲, テーブルだけを検証し, 頂点やインデックスのストリームには触れません.
+    //!             インデックスの値は書き出し時に検証し, デバッグビルドでのみ読み込み時にも確認します.
+    //---------------------------------------------------------------------------------------------
+    bool Attach( const char* pData, u64 size, const char* filename );
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      参照ファイルが変換時から変更されていないかチェックします.
+    //---------------------------------------------------------------------------------------------
+    bool IsDependencyValid() const;
+};
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      メッシュをキャッシュファイルに書き出します.
+//!
+//! @details    同じディレクトリの一時ファイルに書き出してから置き換えるので, 他のプロセスが
+//!             マップしている古いキャッシュが書き換わることはありません.
+//!
+//! @param[in]      filename        出力ファイル名です.
+//! @param[in]      mesh            書き出すメッシュです. 頂点を結合して読み込んだものを想定します.
+//! @param[in]      pLods           BuildLODs() で生成した LOD です. nullptr の場合は LOD0 のみを書き出します.
+//! @param[in]      lodCount        LOD 数です.
+//! @param[in]      sourceSize      変換元ファイルのサイズです.
+//! @param[in]      sourceTime      変換元ファイルの更新日時です.
+//! @param[in]      sourceHash      変換元ファイルパスのハッシュ値です.
+//! @retval true    書き出しに成功.
+//! @retval false   書き出しに失敗.
+//-------------------------------------------------------------------------------------------------
+bool SaveMeshCache(
+    const char*     filename,
+    const ResOBJ&   mesh,
+    const ResLOD*   pLods,
+    u32             lodCount,
+    u64             sourceSize,
+    u64             sourceTime,
+    u64             sourceHash );
@@ -0,0 +1,143 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : Meshlet.h
+// Desc : Meshlet Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <asdxMath.h>
+#include <Bounds.h>
+#include <Renderer.h>
+#include <vector>
+
+
+//-------------------------------------------------------------------------------------------------
+// Constant Values
+//-------------------------------------------------------------------------------------------------
+static constexpr u32 MESHLET_MAX_VERTICES  = 64;       //!< メッシュレットあたりの最大頂点数です.
+static constexpr u32 MESHLET_MAX_TRIANGLES = 124;      //!< メッシュレットあたりの最大三角形数です.
+static constexpr u32 COARSE_TILE_SIZE      = 16;       //!< 粗い深度バッファのタイルサイズです.
+static constexpr u32 COARSE_UPDATE_INTERVAL = 64;      //!< 粗い深度バッファを更新するメッシュレットの間隔です.
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// FrustumTest enum
+///////////////////////////////////////////////////////////////////////////////////////////////////
+enum class FrustumTest : u32
+{
+    Outside = 0,        //!< 視錐台の外側.
+    Intersect,          //!< 視錐台と交差.
+    Inside,             //!< 視錐台の内側.
+};
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Meshlet structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct Meshlet
+{
+    u32             Offset;         //!< ローカルインデックスのオフセットです.
+    u32             Count;          //!< インデックス数です.
+    u32             VertexOffset;   //!< 頂点番号リストのオフセットです.
+    u32             VertexCount;    //!< 頂点数です. MESHLET_MAX_VERTICES 以下です.
+    u32             MaterialId;     //!< マテリアル番号です.
+    asdx::Vector3   Center;         //!< バウンディングスフィアの中心です.
+    f32             Radius;         //!< バウンディングスフィアの半径です.
+    asdx::Vector3   ConeAxis;       //!< 法線コーンの軸です.
+    f32             ConeCutoff;     //!< 法線コーンの判定値です. 1 の場合は背面カリングしません.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// CullingView structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct CullingView
+{
+    asdx::Matrix    WorldViewProj;  //!< ワールドビュー射影行列です.
+    asdx::Vector4   Planes[6];      //!< オブジェクト空間の視錐台平面です. 内側が正になります.
+    asdx::Vector3   CameraPos;      //!< オブジェクト空間のカメラ位置です.
+    f32             DepthScale;     //!< 位置の移動量に対する深度の最大変化量です.
+    f32             ProjScale;      //!< 射影行列の縦方向の拡大率 (1 / tan(fovY / 2)) です.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// CoarseDepth structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct CoarseDepth
+{
+    u32                 Width;          //!< 横幅です.
+    u32                 Height;         //!< 縦幅です.
+    u32                 TileX;          //!< 横方向のタイル数です.
+    u32                 TileY;          //!< 縦方向のタイル数です.
+    std::vector<f32>    MaxDepth;       //!< タイルごとの最大深度です.
+};
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      三角形リストをメッシュレットに分割します.
+//!
+//! @details    インデックスの並びを保ったまま, 頂点数か三角形数が上限に達する位置で区切ります.
+//!             頂点キャッシュ最適化済みのインデックスであれば空間的にまとまったクラスタになり,
+//!             1 つのメッシュレットが参照する頂点数が少なくなります.
+//!             メッシュレットごとに参照する頂点番号を初出順に並べたリストと, そのリスト内の番号で表した
+//!             三角形リストを追加します. 描画時はリストの頂点を 1 回ずつ変換すれば済みます.
+//!
+//! @param[in]      pPositions      位置座標です.
+//! @param[in]      pIndices        インデックスです.
+//! @param[in]      offset          分割を開始するインデックス番号です.
+//! @param[in]      count           分割するインデックス数です.
+//! @param[in]      materialId      マテリアル番号です.
+//! @param[out]     meshlets        生成したメッシュレットの追加先です.
+//! @param[out]     vertices        メッシュレットごとの頂点番号の追加先です.
+//! @param[out]     indices         メッシュレット内の番号で表したインデックスの追加先です.
+//-------------------------------------------------------------------------------------------------
+void BuildMeshlets(
+    const asdx::Vector3*    pPositions,
+    const u32*              pIndices,
+    u32                     offset,
+    u32                     count,
+    u32                     materialId,
+    std::vector<Meshlet>&   meshlets,
+    std::vector<u32>&       vertices,
+    std::vector<u8>&        indices );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      カリングに使うビュー情報を生成します.
+//!
+//! @param[in]      world       ワールド行列です.
+//! @param[in]      view        ビュー行列です.
+//! @param[in]      proj        射影行列です.
+//! @return     生成したビュー情報を返却します.
+//-------------------------------------------------------------------------------------------------
+CullingView CreateCullingView( const asdx::Matrix& world, const asdx::Matrix& view, const asdx::Matrix& proj );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      バウンディングボックスと視錐台の関係を判定します.
+//!
+//! @param[in]      view        カリングに使うビュー情報です.
+//! @param[in]      box         ビュー情報と同じ空間のボックスです.
+//! @return     判定結果を返却します.
+//-------------------------------------------------------------------------------------------------
+FrustumTest TestFrustum( const CullingView& view, const BoundingBox& box );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      粗い深度バッファをレンダーターゲットの深度から更新します.
+//!
+//! @param[in]      target      レンダーターゲットです.
+//! @param[in,out]  coarse      更新する粗い深度バッファです.
+//-------------------------------------------------------------------------------------------------
+void UpdateCoarseDepth( const RenderTarget& target, CoarseDepth& coarse );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      メッシュレットが可視かどうか判定します.
+//!
+//! @details    視錐台, 法線コーンによる背面, 粗い深度バッファによる遮蔽の順に判定します.
+//!
+//! @param[in]      view        カリングに使うビュー情報です.
+//! @param[in]      pDepth      粗い深度バッファです. nullptr の場合は遮蔽判定を行いません.
+//! @param[in]      meshlet     判定するメッシュレットです.
+//! @retval true    可視です.
+//! @retval false   カリングされました.
+//-------------------------------------------------------------------------------------------------
+bool IsMeshletVisible( const CullingView& view, const CoarseDepth* pDepth, const Meshlet& meshlet );
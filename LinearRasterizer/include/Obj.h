@@ -9,6 +9,7 @@
 // Includes
 //-------------------------------------------------------------------------------------------------
 #include <asdxMath.h>
+#include <Bounds.h>
 #include <vector>
 #include <string>
 
@@ -38,6 +39,8 @@ struct ResSubset
     std::string     Name;       //!< Kp}eA.
     u32             Offset;     //!< ItZbg.
     u32             Count;      //!< JEg.
+    u32             MaterialId; //!< }eAԍ (ResOBJ::Materials ̃CfbNX).
+    BoundingBox     Bounds;     //!< oEfBO{bNX.
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -51,15 +54,47 @@ struct ResOBJ
     std::vector<u32>            Indices;        //!< _CfbNXł.
     std::vector<ResSubset>      Subsets;        //!< TuZbgł.
     std::vector<ResMTL>         Materials;      //!< }eAł.
+    std::vector<std::string>    Libraries;      //!< QƂ MTL t@C̃pXł.
 };
 
 //-------------------------------------------------------------------------------------------------
 //! @brief      OBJt@Cǂݍ݂܂.
 //!
+//! @details    weldVertices  false ̏ꍇ͖ʂ̒_ƂɓWJ, Indices  0 ̘AԂɂȂ܂.
+//!             true ̏ꍇ (ʒu, eNX`W, @) ̑g_1ɂ܂Ƃ, Indices ŎQƂ܂.
+//!             ̂Ƃ TexCoords  Normals ͋ Positions ƓvfɂȂ܂.
+//!
 //! @param[in]      filename        t@C.
 //! @param[out]     pResult         i[.
+//! @param[in]      weldVertices    d钸_܂Ƃ߂ꍇ true.
+//! @retval true    ǂݍ݂ɐ.
+//! @retval false   ǂݍ݂Ɏs.
+//-------------------------------------------------------------------------------------------------
+bool LoadFromOBJ( const char* filename, ResOBJ* pResult, bool weldVertices = false );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      MTLt@Cǂݍ݂܂.
+//!
+//! @param[in]      filename        t@C.
+//! @param[out]     pResult         }eA̒ǉ.
 //! @retval true    ǂݍ݂ɐ.
 //! @retval false   ǂݍ݂Ɏs.
 //-------------------------------------------------------------------------------------------------
-bool LoadFromOBJ( const char* filename, ResOBJ* pResult );
+bool LoadFromMTL( const char* filename, ResOBJ* pResult );
 
+//-------------------------------------------------------------------------------------------------
+//! @brief      TuZbg̃}eA}eAԍɉ܂.
+//!
+//! @details    `Ȃ}eA͊l Materials ɒǉ̂,
+//!             MaterialId ͏ɗLȔԍɂȂ܂.
+//!
+//! @param[in,out]  pResult         Ώ.
+//-------------------------------------------------------------------------------------------------
+void ResolveMaterials( ResOBJ* pResult );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      TuZbg̃oEfBO{bNXvZ܂.
+//!
+//! @param[in,out]  pResult         vZΏ.
+//-------------------------------------------------------------------------------------------------
+void ComputeSubsetBounds( ResOBJ* pResult );
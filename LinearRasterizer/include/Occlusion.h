@@ -0,0 +1,89 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : Occlusion.h
+// Desc : Software Occlusion Culling Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <asdxMath.h>
+#include <Bounds.h>
+#include <Renderer.h>
+#include <vector>
+
+
+//-------------------------------------------------------------------------------------------------
+// Constant Values
+//-------------------------------------------------------------------------------------------------
+static constexpr u32 OCCLUSION_WIDTH            = 320;      //!< 遮蔽バッファの横幅です.
+static constexpr u32 OCCLUSION_HEIGHT           = 180;      //!< 遮蔽バッファの縦幅です.
+static constexpr u32 OCCLUDER_MAX_INSTANCES     = 16;       //!< 遮蔽物として描画する最大インスタンス数です.
+static constexpr f32 OCCLUDER_MIN_SCREEN_SIZE   = 0.05f;    //!< 遮蔽物とする投影半径の下限です (画面の高さに対する割合).
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// OcclusionBuffer structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct OcclusionBuffer
+{
+    u32                 Width;      //!< 横幅です.
+    u32                 Height;     //!< 縦幅です.
+    std::vector<f32>    Depth;      //!< ピクセルごとの遮蔽物の深度 (正規化デバイス座標系の z) です.
+};
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      遮蔽バッファをクリアします.
+//!
+//! @param[in,out]  buffer      クリアする遮蔽バッファです.
+//! @param[in]      width       横幅です.
+//! @param[in]      height      縦幅です.
+//-------------------------------------------------------------------------------------------------
+void ClearOcclusionBuffer( OcclusionBuffer& buffer, u32 width, u32 height );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      遮蔽物の三角形リストを深度のみ描画します.
+//!
+//! @details    ピクセル中心で深度を書き込みます. 全ての遮蔽物を描画した後に
+//!             ResolveOcclusionBuffer() を呼び出して保守的な値に変換する必要があります.
+//!
+//! @param[in,out]  buffer          遮蔽バッファです.
+//! @param[in]      worldViewProj   ワールドビュー射影行列です.
+//! @param[in]      pPositions      位置座標です.
+//! @param[in]      pVertices       参照する頂点番号のリストです. 各頂点は 1 回だけ変換します.
+//! @param[in]      vertexCount     頂点番号の数です. MESHLET_MAX_VERTICES 以下にします.
+//! @param[in]      pIndices        pVertices 内の番号で表した三角形リストのインデックスです.
+//! @param[in]      count           インデックス数です.
+//! @param[in]      clipOffset      射影空間で各頂点に加えるオフセットです. 簡略化した遮蔽物を奥へずらすのに使います.
+//-------------------------------------------------------------------------------------------------
+void RasterizeOccluder(
+    OcclusionBuffer&        buffer,
+    const asdx::Matrix&     worldViewProj,
+    const asdx::Vector3*    pPositions,
+    const u32*              pVertices,
+    u32                     vertexCount,
+    const u8*               pIndices,
+    u32                     count,
+    const asdx::Vector4&    clipOffset );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      遮蔽バッファを保守的な値に変換します.
+//!
+//! @details    3x3 ピクセルの最大値を取り, 遮蔽物が完全に覆っていないピクセルを取り除きます.
+//!             残るピクセルの深度は, ピクセル内で遮蔽物が取り得る最も奥の値以上になります.
+//!
+//! @param[in,out]  buffer      変換する遮蔽バッファです.
+//-------------------------------------------------------------------------------------------------
+void ResolveOcclusionBuffer( OcclusionBuffer& buffer );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      バウンディングボックスが遮蔽物に完全に隠れているか判定します.
+//!
+//! @param[in]      buffer          遮蔽バッファです.
+//! @param[in]      worldViewProj   ボックスの空間からのワールドビュー射影行列です.
+//! @param[in]      box             判定するボックスです.
+//! @retval true    完全に隠れています.
+//! @retval false   可視の可能性があります.
+//-------------------------------------------------------------------------------------------------
+bool IsOccluded( const OcclusionBuffer& buffer, const asdx::Matrix& worldViewProj, const BoundingBox& box );
@@ -0,0 +1,66 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : Parallel.h
+// Desc : Parallel Processing Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <asdxMath.h>
+#include <thread>
+#include <vector>
+
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      並列処理に使うスレッド数を取得します.
+//!
+//! @return     ハードウェアスレッド数を返却します. 取得できない場合は 1 を返却します.
+//-------------------------------------------------------------------------------------------------
+inline u32 GetThreadCount()
+{ return asdx::Max( std::thread::hardware_concurrency(), 1u ); }
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      処理量からチャンクの分割数を求めます.
+//!
+//! @details    1 チャンクあたりの処理量が minSize 以上になり, スレッド数を超えないように分割します.
+//!             小さな処理はスレッドを起こすより 1 スレッドで処理する方が速いためです.
+//!
+//! @param[in]      size        全体の処理量です.
+//! @param[in]      minSize     1 チャンクあたりの最小の処理量です.
+//! @return     1 以上, スレッド数以下の分割数を返却します.
+//-------------------------------------------------------------------------------------------------
+inline u32 GetChunkCount( u64 size, u64 minSize )
+{ return u32( asdx::Clamp<u64>( size / asdx::Max<u64>( minSize, 1 ), 1, GetThreadCount() ) ); }
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      チャンク単位で並列に処理を実行します.
+//!
+//! @details    先頭のチャンクは呼び出しスレッドで処理し, 全てのチャンクが終わるまで待ちます.
+//!
+//! @param[in]      count       チャンク数です.
+//! @param[in]      func        チャンク番号を受け取る関数です.
+//-------------------------------------------------------------------------------------------------
+template<typename Func>
+void ParallelFor( u32 count, Func func )
+{
+    if ( count <= 1 )
+    {
+        if ( count == 1 )
+        { func( 0 ); }
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve( count - 1 );
+
+    for( u32 i=1; i<count; ++i )
+    { threads.emplace_back( func, i ); }
+
+    // 先頭のチャンクは呼び出しスレッドで処理する.
+    func( 0 );
+
+    for( auto& thread : threads )
+    { thread.join(); }
+}
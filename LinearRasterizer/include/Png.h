@@ -0,0 +1,122 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : Png.h
+// Desc : PNG Image Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <asdxTypedef.h>
+#include <cstdio>
+#include <vector>
+
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      PNGファイルに保存します.
+//!
+//! @details    画像を行単位のストリップに分け, ストリップごとに別スレッドでフィルタと圧縮を行います.
+//!             各ストリップの圧縮データはバイト境界で終わるように同期フラッシュし, 連結して 1 つの
+//!             zlib ストリームにします. ストリップ間で辞書を共有しない分だけ圧縮率は僅かに下がります.
+//!             SaveToBitmap() と同じく, ピクセルデータの先頭行を画像の下端として扱います.
+//!
+//! @param[in]      filename        ファイル名です.
+//! @param[in]      width           画像の横幅です.
+//! @param[in]      height          画像の縦幅です.
+//! @param[in]      pBuffer         ピクセルデータ (RGBA8) です.
+//-------------------------------------------------------------------------------------------------
+bool SaveToPng( const char16* filename, u32 width, u32 height, const u8* pBuffer );
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// PngWriter class
+///////////////////////////////////////////////////////////////////////////////////////////////////
+class PngWriter : private NonCopyable
+{
+    //=============================================================================================
+    // list of friend classes and methods.
+    //=============================================================================================
+    /* NOTHING */
+
+public:
+    //=============================================================================================
+    // public variables.
+    //=============================================================================================
+    /* NOTHING */
+
+    //=============================================================================================
+    // public methods.
+    //=============================================================================================
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //---------------------------------------------------------------------------------------------
+    PngWriter();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //---------------------------------------------------------------------------------------------
+    ~PngWriter();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      PNGファイルを開いてヘッダを書き込みます.
+    //!
+    //! @param[in]      filename        ファイル名です.
+    //! @param[in]      width           画像の横幅です.
+    //! @param[in]      height          画像の縦幅です.
+    //! @retval true    オープンに成功.
+    //! @retval false   オープンに失敗.
+    //---------------------------------------------------------------------------------------------
+    bool Open( const char16* filename, u32 width, u32 height );
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      帯状の行を圧縮して書き込みます.
+    //!
+    //! @details    画像の上端の帯から順に呼び出します. 帯の中は SaveToPng() と同じく
+    //!             先頭行が下端です. 帯ごとに 1 つの IDAT チャンクとして書き込むので,
+    //!             保持するのは直前の帯の下端の 1 行だけです.
+    //!
+    //! @param[in]      pBuffer         ピクセルデータ (RGBA8) です.
+    //! @param[in]      rowCount        行数です.
+    //! @retval true    書き込みに成功.
+    //! @retval false   書き込みに失敗.
+    //---------------------------------------------------------------------------------------------
+    bool WriteRows( const u8* pBuffer, u32 rowCount );
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      ストリームを終端してファイルを閉じます.
+    //!
+    //! @retval true    全ての行を正常に書き込みました.
+    //! @retval false   書き込みに失敗したか, 行が足りません.
+    //---------------------------------------------------------------------------------------------
+    bool Close();
+
+protected:
+    //=============================================================================================
+    // protected variables.
+    //=============================================================================================
+    /* NOTHING */
+
+    //=============================================================================================
+    // protected methods.
+    //=============================================================================================
+    /* NOTHING */
+
+private:
+    //=============================================================================================
+    // private variables.
+    //=============================================================================================
+    FILE*           m_pFile;        //!< 出力先のファイルです.
+    u32             m_Width;        //!< 画像の横幅です.
+    u32             m_Height;       //!< 画像の縦幅です.
+    u32             m_RowCount;     //!< 書き込んだ行数です.
+    u32             m_Adler;        //!< 書き込んだフィルタ後のデータの Adler-32 です.
+    bool            m_Failed;       //!< 書き込みに失敗した場合は true です.
+    std::vector<u8> m_PrevRow;      //!< 直前に書き込んだ行です. 次の帯のフィルタに使います.
+
+    //=============================================================================================
+    // private methods.
+    //=============================================================================================
+    /* NOTHING */
+};
@@ -0,0 +1,25 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : Qoi.h
+// Desc : QOI Image Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <asdxTypedef.h>
+
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      QOIファイルに保存します.
+//!
+//! @details    可逆圧縮で, 圧縮率よりもエンコード速度を優先する形式です.
+//!             SaveToBitmap() と同じく, ピクセルデータの先頭行を画像の下端として扱います.
+//!
+//! @param[in]      filename        ファイル名です.
+//! @param[in]      width           画像の横幅です.
+//! @param[in]      height          画像の縦幅です.
+//! @param[in]      pBuffer         ピクセルデータ (RGBA8) です.
+//-------------------------------------------------------------------------------------------------
+bool SaveToQoi( const char16* filename, u32 width, u32 height, const u8* pBuffer );
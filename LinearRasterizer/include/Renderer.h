@@ -0,0 +1,259 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : Renderer.h
+// Desc : Software Renderer Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <asdxMath.h>
+#include <Bounds.h>
+#include <Sampler.h>
+#include <vector>
+
+
+//-------------------------------------------------------------------------------------------------
+// Forward Declarations
+//-------------------------------------------------------------------------------------------------
+struct Meshlet;
+struct CullingView;
+struct CoarseDepth;
+struct OcclusionBuffer;
+
+
+//-------------------------------------------------------------------------------------------------
+// Constant Values
+//-------------------------------------------------------------------------------------------------
+static constexpr f32 LOD_PIXEL_ERROR      = 1.0f;     //!< LOD の選択で許容する画面上の誤差 (ピクセル) です.
+static constexpr u32 TRIANGLE_BIN_CAPACITY = 65536;    //!< ソートしてから描画するまでに溜める三角形の最大数です.
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// COLOR_ORDER enum
+///////////////////////////////////////////////////////////////////////////////////////////////////
+enum COLOR_ORDER
+{
+    COLOR_ORDER_RGBA = 0,   //!< R, G, B, A の順に並べます.
+    COLOR_ORDER_BGRA,       //!< B, G, R, A の順に並べます (BMP のピクセルの並び).
+};
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// RenderTarget structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct RenderTarget
+{
+    u32             Width;          //!< 横幅です.
+    u32             Height;         //!< 縦幅です. 帯単位で描画する場合は帯の縦幅です.
+    u8*             pColor;         //!< カラーバッファ (8bit x 4) です. 行の間に隙間はなく, 先頭の行が画像の下端です. nullptr の場合は深度と仮想テクスチャのページの要求だけを書き込みます.
+    f32*            pDepth;         //!< 深度バッファです.
+    COLOR_ORDER     ColorOrder;     //!< カラーバッファのチャンネルの並びです.
+    u32             OffsetY;        //!< バッファの先頭行に対応する画像上の行です.
+    u32             ImageHeight;    //!< 画像全体の縦幅です. 0 の場合は Height と同じです.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// DrawBatch structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct DrawBatch
+{
+    u32     MaterialId;     //!< マテリアル番号です.
+    u32     Offset;         //!< インデックスオフセットです.
+    u32     Count;          //!< インデックス数です.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// DrawLod structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct DrawLod
+{
+    u32     MeshletOffset;      //!< 先頭のメッシュレット番号です.
+    u32     MeshletCount;       //!< メッシュレット数です.
+    f32     Error;              //!< 元のメッシュからの誤差 (オブジェクト空間の距離) です.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// DrawMesh structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct DrawMesh
+{
+    const asdx::Vector3*    pPositions;         //!< 位置座標です. インスタンス間で共有します.
+    const asdx::Vector3*    pNormals;           //!< 法線ベクトルです. nullptr の場合は (0, 0, 1) として扱います.
+    const asdx::Vector2*    pTexCoords;         //!< テクスチャ座標です. nullptr の場合は (0, 0) として扱います.
+    const asdx::Vector4*    pColors;            //!< 頂点カラーです. nullptr の場合は法線を色として可視化します.
+    const u32*              pMeshletVertices;   //!< メッシュレットごとの頂点番号です.
+    const u8*               pMeshletIndices;    //!< メッシュレット内の番号で表したインデックスです.
+    const Meshlet*          pMeshlets;          //!< メッシュレットです.
+    u32                     MeshletCount;       //!< メッシュレット数です.
+    const asdx::Vector4*    pMaterials;         //!< マテリアルごとの拡散反射色です.
+    u32                     MaterialCount;      //!< マテリアル数です.
+    const TiledTexture*     pTextures;          //!< マテリアルごとのディフューズマップです. nullptr または空の場合はテクスチャを使いません.
+    SamplerState            Sampler;            //!< ディフューズマップのサンプラーステートです.
+    const DrawLod*          pLods;              //!< 詳細な順に並べた LOD です. nullptr の場合は全メッシュレットを描画します.
+    u32                     LodCount;           //!< LOD 数です.
+    BoundingBox             Bounds;             //!< オブジェクト空間のバウンディングボックスです.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// DrawStats structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct DrawStats
+{
+    u32     Instances;          //!< 判定したインスタンス数です.
+    u32     VisibleInstances;   //!< 可視なインスタンス数です.
+    u32     Meshlets;           //!< 判定したメッシュレット数です.
+    u32     VisibleMeshlets;    //!< 描画したメッシュレット数です.
+    u32     Triangles;          //!< 描画した三角形数です.
+    u32     Vertices;           //!< 変換した頂点数です.
+    u32     OccludedInstances;  //!< 遮蔽バッファでカリングしたインスタンス数です.
+    u32     OccludedMeshlets;   //!< 遮蔽バッファでカリングしたメッシュレット数です.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// BinTriangle structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct BinTriangle
+{
+    asdx::Vector4       Position[3];    //!< 射影空間の位置座標です.
+    asdx::Vector4       Diffuse;        //!< マテリアルの拡散反射色です.
+    const TiledTexture* pTexture;       //!< ディフューズマップです. nullptr の場合はテクスチャを使いません.
+    SamplerState        Sampler;        //!< ディフューズマップのサンプラーステートです.
+    const DrawMesh*     pMesh;          //!< 頂点属性を参照するメッシュです.
+    u32                 Vertices[3];    //!< 頂点番号です.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// TriangleBin structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct TriangleBin
+{
+    std::vector<BinTriangle>    Triangles;      //!< 描画を遅延した三角形です.
+    std::vector<u32>            Keys;           //!< 三角形ごとのソートキーです.
+    std::vector<u32>            Order;          //!< ソート後の描画順です.
+    std::vector<u32>            TempKeys;       //!< ソート用の作業領域です.
+    std::vector<u32>            TempOrder;      //!< ソート用の作業領域です.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// StripBin structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct StripBin
+{
+    TriangleBin                     Bin;            //!< 変換済みの全ての三角形です.
+    u32                             StripHeight;    //!< 帯の縦幅です.
+    std::vector<std::vector<u32>>   Strips;         //!< 帯ごとに手前から並べた三角形番号です. 先頭が画像の下端の帯です.
+};
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      レンダーターゲットをクリアします.
+//!
+//! @details    カラーバッファが nullptr の場合は深度バッファだけをクリアします.
+//!
+//! @param[in,out]  target      クリアするレンダーターゲットです.
+//-------------------------------------------------------------------------------------------------
+void ClearRenderTarget( RenderTarget& target );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      メッシュをインスタンスごとのワールド行列で描画します.
+//!
+//! @details    メッシュのデータは全インスタンスで共有し, 複製しません.
+//!             インスタンスは変換後のバウンディングボックスで, メッシュレットはワールド空間に
+//!             変換したバウンディングスフィアと法線コーンでカリングします.
+//!             頂点はメッシュレットが参照する頂点ごとに 1 回だけワールドビュー射影行列で変換し,
+//!             三角形はその結果をインデックスで参照します.
+//!             LOD はバウンディングスフィアまでの距離から, 画面上の誤差が LOD_PIXEL_ERROR 以下になる
+//!             最も粗いものを選択します.
+//!
+//! @param[in]      view            ワールド行列に単位行列を指定して生成したカリング用ビュー情報です.
+//! @param[in,out]  target          レンダーターゲットです.
+//! @param[in]      mesh            描画するメッシュです.
+//! @param[in]      pInstances      インスタンスごとのワールド行列です.
+//! @param[in]      instanceCount   インスタンス数です.
+//! @param[in,out]  pDepth          遮蔽判定に使う粗い深度バッファです. nullptr の場合は遮蔽判定を行いません.
+//! @param[in]      pOcclusion      DrawOccluders() で描画した遮蔽バッファです. nullptr の場合は遮蔽物による判定を行いません.
+//! @param[in,out]  pBin            三角形を手前から順に描画するための作業領域です. nullptr の場合は送信順に描画します.
+//! @return     カリングの統計を返却します.
+//!
+//! @note       pBin を指定すると, 三角形を TRIANGLE_BIN_CAPACITY 個まで溜めて最も手前の深度で
+//!             基数ソートしてから描画します. 不透明な面しか扱わないので描画順を入れ替えても結果は変わらず,
+//!             奥の面のピクセルはシェーディング前の深度テストで棄却されます.
+//!             深度が等しい三角形の間では送信順を保ちます.
+//-------------------------------------------------------------------------------------------------
+DrawStats DrawInstanced(
+    const CullingView&      view,
+    RenderTarget&           target,
+    const DrawMesh&         mesh,
+    const asdx::Matrix*     pInstances,
+    u32                     instanceCount,
+    CoarseDepth*            pDepth,
+    const OcclusionBuffer*  pOcclusion,
+    TriangleBin*            pBin );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      メッシュを 1 回だけ変換して, 画像を分割した帯ごとに三角形を振り分けます.
+//!
+//! @details    カリングと LOD の選択は DrawInstanced() と同じです. 変換した三角形を全て溜めて
+//!             最も手前の深度でソートし, 画面上で重なる帯に振り分けます.
+//!             帯の縦幅は target の Height, 画像全体の縦幅は ImageHeight です.
+//!             その後 DrawStrip() で帯ごとに描画すれば, 画像全体の深度バッファとカラーバッファを
+//!             持たずに済みます. 帯をまたぐ三角形は両方の帯で描画します.
+//!
+//! @param[in]      view            ワールド行列に単位行列を指定して生成したカリング用ビュー情報です.
+//! @param[in]      target          帯のサイズと画像全体の縦幅を設定したレンダーターゲットです. バッファには触れません.
+//! @param[in]      mesh            描画するメッシュです.
+//! @param[in]      pInstances      インスタンスごとのワールド行列です.
+//! @param[in]      instanceCount   インスタンス数です.
+//! @param[in]      pOcclusion      DrawOccluders() で描画した遮蔽バッファです. nullptr の場合は遮蔽物による判定を行いません.
+//! @param[out]     bin             振り分けた三角形の格納先です.
+//! @return     カリングの統計を返却します.
+//-------------------------------------------------------------------------------------------------
+DrawStats BinInstanced(
+    const CullingView&      view,
+    const RenderTarget&     target,
+    const DrawMesh&         mesh,
+    const asdx::Matrix*     pInstances,
+    u32                     instanceCount,
+    const OcclusionBuffer*  pOcclusion,
+    StripBin&               bin );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      BinInstanced() で振り分けた三角形のうち, 描画先の帯に含まれるものを描画します.
+//!
+//! @param[in,out]  target      OffsetY に帯の先頭行を設定したレンダーターゲットです. StripHeight の倍数にします.
+//! @param[in]      bin         BinInstanced() で振り分けた三角形です.
+//-------------------------------------------------------------------------------------------------
+void DrawStrip( RenderTarget& target, const StripBin& bin );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      画面上で大きなインスタンスを遮蔽物として遮蔽バッファに描画します.
+//!
+//! @details    投影半径が OCCLUDER_MIN_SCREEN_SIZE 以上のインスタンスを大きい順に
+//!             OCCLUDER_MAX_INSTANCES 個まで選びます. 形状は遮蔽バッファ上の誤差が 1 ピクセル以下の
+//!             最も粗い LOD を使い, 誤差の分だけ奥にずらして描画します.
+//!             描画後に ResolveOcclusionBuffer() で保守的な値に変換します.
+//!
+//! @param[in]      view            ワールド行列に単位行列を指定して生成したカリング用ビュー情報です.
+//! @param[in,out]  buffer          ClearOcclusionBuffer() でクリアした遮蔽バッファです.
+//! @param[in]      mesh            遮蔽物のメッシュです.
+//! @param[in]      pInstances      インスタンスごとのワールド行列です.
+//! @param[in]      instanceCount   インスタンス数です.
+//! @return     遮蔽物として描画したインスタンス数を返却します.
+//-------------------------------------------------------------------------------------------------
+u32 DrawOccluders(
+    const CullingView&      view,
+    OcclusionBuffer&        buffer,
+    const DrawMesh&         mesh,
+    const asdx::Matrix*     pInstances,
+    u32                     instanceCount );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      描画バッチをマテリアルごとにまとめます.
+//!
+//! @details    マテリアル番号で安定ソートし, 同じマテリアルで範囲が連続するバッチを結合します.
+//!             描画ステートの設定はマテリアルが切り替わる時だけ行えば済むようになります.
+//!
+//! @param[in,out]  batches     まとめる描画バッチです.
+//-------------------------------------------------------------------------------------------------
+void SortDrawBatches( std::vector<DrawBatch>& batches );
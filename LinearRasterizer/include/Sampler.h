@@ -0,0 +1,326 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : Sampler.h
+// Desc : Texture Sampler Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <asdxMath.h>
+#include <MappedFile.h>
+#include <vector>
+
+
+//-------------------------------------------------------------------------------------------------
+// Forward Declarations
+//-------------------------------------------------------------------------------------------------
+class Texture;
+class PageCache;
+
+
+//-------------------------------------------------------------------------------------------------
+// Constant Values
+//-------------------------------------------------------------------------------------------------
+static constexpr u32 TEXTURE_TILE_SIZE = 4;     //!< タイルの横幅と縦幅です. 1 タイルが RGBA8 で 64 バイトになります.
+static constexpr u32 TEXTURE_PAGE_SIZE = 128;   //!< 仮想テクスチャのページの横幅と縦幅です.
+static constexpr u32 TEXTURE_PAGE_TILE = TEXTURE_PAGE_SIZE / TEXTURE_TILE_SIZE;     //!< ページの 1 辺のタイル数です.
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// TEXTURE_FORMAT enum
+///////////////////////////////////////////////////////////////////////////////////////////////////
+enum TEXTURE_FORMAT
+{
+    TEXTURE_FORMAT_RGBA8 = 0,       //!< 非圧縮の RGBA8 です. 1 タイルが 64 バイトです.
+    TEXTURE_FORMAT_BC1,             //!< BC1 (DXT1) です. 1 タイルが 8 バイトで, アルファは常に 1 です.
+    TEXTURE_FORMAT_BC3,             //!< BC3 (DXT5) です. 1 タイルが 16 バイトです.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// TEXTURE_FILTER enum
+///////////////////////////////////////////////////////////////////////////////////////////////////
+enum TEXTURE_FILTER
+{
+    TEXTURE_FILTER_BILINEAR = 0,    //!< 最も近いミップレベルでバイリニア補間します.
+    TEXTURE_FILTER_TRILINEAR,       //!< 隣り合う 2 つのミップレベルのバイリニア補間の結果を補間します.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// TEXTURE_ADDRESS enum
+///////////////////////////////////////////////////////////////////////////////////////////////////
+enum TEXTURE_ADDRESS
+{
+    TEXTURE_ADDRESS_WRAP = 0,       //!< [0, 1] の範囲外は繰り返します.
+    TEXTURE_ADDRESS_CLAMP,          //!< [0, 1] の範囲外は端のテクセルを使います.
+};
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// SamplerState structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct SamplerState
+{
+    TEXTURE_FILTER      Filter;     //!< フィルタです.
+    TEXTURE_ADDRESS     AddressU;   //!< U 方向のアドレスモードです.
+    TEXTURE_ADDRESS     AddressV;   //!< V 方向のアドレスモードです.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// TiledLevel structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct TiledLevel
+{
+    u32     Width;          //!< 横幅です.
+    u32     Height;         //!< 縦幅です.
+    u32     TileCountX;     //!< 横方向のタイル数です.
+    u32     PageCountX;     //!< 横方向のページ数です. 常駐するレベルでは 0 です.
+    u32     FirstPage;      //!< 先頭のページ番号です. 常駐するレベルでは U32_MAX です.
+    size_t  Offset;         //!< テクセルデータの先頭からのオフセット (バイト) です. タイルのサイズの倍数です.
+};
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// TiledTexture class
+///////////////////////////////////////////////////////////////////////////////////////////////////
+class TiledTexture : private NonCopyable
+{
+    //=============================================================================================
+    // list of friend classes and methods.
+    //=============================================================================================
+    friend class PageCache;
+
+public:
+    //=============================================================================================
+    // public variables.
+    //=============================================================================================
+    /* NOTHING */
+
+    //=============================================================================================
+    // public methods.
+    //=============================================================================================
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //---------------------------------------------------------------------------------------------
+    TiledTexture();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //---------------------------------------------------------------------------------------------
+    ~TiledTexture();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      テクスチャの全てのミップレベルをタイル単位の並びに変換して初期化します.
+    //!
+    //! @details    各レベルを TEXTURE_TILE_SIZE 四方のタイルに分け, タイル内のテクセルを連続して
+    //!             並べます. バイリニア補間の 4 テクセルが同じキャッシュラインに収まりやすくなり,
+    //!             回転した面を描画しても行をまたぐアクセスが増えません.
+    //!             BC1 と BC3 ではタイルを 1 ブロックとして圧縮します. ブロック内のテクセルの行は
+    //!             タイルと同じく下端から並びます. 圧縮はタイルの行単位で分割して並列に行います.
+    //!
+    //! @param[in]      source      変換元のテクスチャです.
+    //! @param[in]      format      格納するフォーマットです.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //---------------------------------------------------------------------------------------------
+    bool Init( const Texture& source, TEXTURE_FORMAT format = TEXTURE_FORMAT_RGBA8 );
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      ページファイルを開いて仮想テクスチャとして初期化します.
+    //!
+    //! @details    TEXTURE_PAGE_SIZE より大きいレベルはページに分割されたままファイルに残し,
+    //!             PageCache に登録して必要なページだけを読み込みます. 1 ページに収まる下位の
+    //!             レベル (ミップテール) だけを常駐させるので, 読み込まれていないページを参照した
+    //!             場合も粗いレベルで代用できます.
+    //!
+    //! @param[in]      filename    SavePageFile() で書き出したファイル名です.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //---------------------------------------------------------------------------------------------
+    bool Open( const char* filename );
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      テクセルデータを解放します.
+    //!
+    //! @details    仮想テクスチャの場合は, 登録した PageCache の Update() を呼び出す前に解放しないでください.
+    //---------------------------------------------------------------------------------------------
+    void Term();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      初期化されているかどうかを取得します.
+    //!
+    //! @retval true    初期化されていない.
+    //! @retval false   初期化されている.
+    //---------------------------------------------------------------------------------------------
+    bool IsEmpty() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      フォーマットを取得します.
+    //!
+    //! @return     フォーマットを返却します.
+    //---------------------------------------------------------------------------------------------
+    TEXTURE_FORMAT GetFormat() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      識別子を取得します.
+    //!
+    //! @details    初期化するたびに全てのテクスチャの間で異なる値になります. 展開したブロックの
+    //!             キャッシュで, 解放されたテクスチャのブロックを誤って使わないために使います.
+    //!
+    //! @return     識別子を返却します.
+    //---------------------------------------------------------------------------------------------
+    u32 GetId() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      全てのミップレベルのテクセルデータのサイズを取得します.
+    //!
+    //! @return     サイズをバイト単位で返却します.
+    //---------------------------------------------------------------------------------------------
+    size_t GetSize() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      1 タイルのサイズを取得します.
+    //!
+    //! @return     サイズをバイト単位で返却します.
+    //---------------------------------------------------------------------------------------------
+    u32 GetTileSize() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      仮想テクスチャかどうかを取得します.
+    //!
+    //! @retval true    仮想テクスチャ.
+    //! @retval false   全てのレベルが常駐するテクスチャ.
+    //---------------------------------------------------------------------------------------------
+    bool IsVirtual() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      仮想テクスチャのページ数を取得します.
+    //!
+    //! @return     ページ数を返却します.
+    //---------------------------------------------------------------------------------------------
+    u32 GetPageCount() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      1 ページのサイズを取得します.
+    //!
+    //! @return     サイズをバイト単位で返却します. 仮想テクスチャでない場合は 0 を返却します.
+    //---------------------------------------------------------------------------------------------
+    u32 GetPageSize() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      読み込まれたページのテクセルデータを取得します.
+    //!
+    //! @details    ページ内のタイルは TEXTURE_PAGE_TILE 個ずつ下の行から並びます.
+    //!
+    //! @param[in]      page        ページ番号です.
+    //! @return     テクセルデータの先頭を返却します. 読み込まれていない場合は nullptr を返却します.
+    //---------------------------------------------------------------------------------------------
+    const u8* GetPage( u32 page ) const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      ページの読み込みを要求します.
+    //!
+    //! @details    要求は PageCache::Update() でまとめて処理されます. 描画は 1 スレッドで行う前提です.
+    //!
+    //! @param[in]      page        ページ番号です.
+    //---------------------------------------------------------------------------------------------
+    void RequestPage( u32 page ) const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      ミップレベル数を取得します.
+    //!
+    //! @return     ミップレベル数を返却します.
+    //---------------------------------------------------------------------------------------------
+    u32 GetLevelCount() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      ミップレベルの情報を取得します.
+    //!
+    //! @param[in]      level       ミップレベルです.
+    //! @return     ミップレベルの情報を返却します.
+    //---------------------------------------------------------------------------------------------
+    const TiledLevel& GetLevel( u32 level ) const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      ミップレベルのテクセルデータを取得します.
+    //!
+    //! @details    BC1 と BC3 では圧縮したブロックの並びです. 仮想テクスチャではページに分割された
+    //!             レベルのテクセルデータはありません.
+    //!
+    //! @param[in]      level       ミップレベルです.
+    //! @return     テクセルデータの先頭を返却します.
+    //---------------------------------------------------------------------------------------------
+    const u8* GetTexels( u32 level ) const;
+
+protected:
+    //=============================================================================================
+    // protected variables.
+    //=============================================================================================
+    /* NOTHING */
+
+    //=============================================================================================
+    // protected methods.
+    //=============================================================================================
+    /* NOTHING */
+
+private:
+    //=============================================================================================
+    // private variables.
+    //=============================================================================================
+    u8*                     m_pTexels;      //!< 常駐する全てのミップレベルのテクセルデータです.
+    size_t                  m_Size;         //!< テクセルデータのサイズです.
+    TEXTURE_FORMAT          m_Format;       //!< フォーマットです.
+    u32                     m_Id;           //!< 識別子です.
+    std::vector<TiledLevel> m_Levels;       //!< ミップレベルです.
+    MappedFile              m_File;         //!< メモリにマップしたページファイルです.
+    const u8*               m_pPageData;    //!< ファイル上の先頭のページです.
+    u32                     m_PageSize;     //!< 1 ページのサイズです.
+    std::vector<const u8*>  m_Pages;        //!< ページごとの読み込み先です. 読み込まれていないページは nullptr です.
+    mutable std::vector<u8> m_Requests;     //!< ページごとの要求フラグです. RequestPage() が設定し, PageCache が消去します.
+
+    //=============================================================================================
+    // private methods.
+    //=============================================================================================
+    /* NOTHING */
+};
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      2x2 ピクセルのクアッドの 4 ピクセルをまとめてサンプリングします.
+//!
+//! @details    ミップレベルはクアッド内のテクスチャ座標の差分から求め, 4 ピクセルで共有します.
+//!             テクセルは 8bit の値をそのまま [0, 1] に変換し, 色空間の変換は行いません.
+//!             圧縮されたテクスチャのブロックは, スレッドごとのキャッシュに展開してから読み込みます.
+//!             仮想テクスチャで読み込まれていないページは, 読み込まれている粗いレベルで代用します.
+//!
+//! @param[in]      texture     サンプリングするテクスチャです.
+//! @param[in]      sampler     サンプラーステートです.
+//! @param[in]      pU          4 ピクセルのテクスチャ座標の U です. (x, y), (x+1, y), (x, y+1), (x+1, y+1) の順です.
+//! @param[in]      pV          4 ピクセルのテクスチャ座標の V です. 並びは pU と同じです.
+//! @param[out]     pResult     4 ピクセルの色の格納先です.
+//-------------------------------------------------------------------------------------------------
+void SampleQuad(
+    const TiledTexture&     texture,
+    const SamplerState&     sampler,
+    const f32*              pU,
+    const f32*              pV,
+    asdx::Vector4*          pResult );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      2x2 ピクセルのクアッドがサンプリングするページを要求します.
+//!
+//! @details    SampleQuad() と同じミップレベルとテクセルを求め, 仮想テクスチャのページの要求フラグを
+//!             立てます. テクセルは読み込みません. 常駐するテクスチャでは何もしません.
+//!             要求フラグは PageCache::Update() で処理されます.
+//!
+//! @param[in]      texture     サンプリングするテクスチャです.
+//! @param[in]      sampler     サンプラーステートです.
+//! @param[in]      pU          4 ピクセルのテクスチャ座標の U です. 並びは SampleQuad() と同じです.
+//! @param[in]      pV          4 ピクセルのテクスチャ座標の V です. 並びは pU と同じです.
+//-------------------------------------------------------------------------------------------------
+void RequestQuad(
+    const TiledTexture&     texture,
+    const SamplerState&     sampler,
+    const f32*              pU,
+    const f32*              pV );
@@ -0,0 +1,175 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : Scene.h
+// Desc : Scene Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <asdxMath.h>
+#include <Bounds.h>
+#include <Meshlet.h>
+#include <vector>
+
+
+//-------------------------------------------------------------------------------------------------
+// Constant Values
+//-------------------------------------------------------------------------------------------------
+static constexpr u32 BVH_BIN_COUNT      = 16;       //!< SAH の評価に使うビン数です.
+static constexpr u32 BVH_MAX_LEAF_SIZE  = 4;        //!< リーフに格納するインスタンスの最大数です.
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// SceneInstance structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct SceneInstance
+{
+    u32             MeshId;     //!< メッシュ番号です.
+    asdx::Matrix    World;      //!< ワールド行列です.
+    BoundingBox     Bounds;     //!< ワールド空間のバウンディングボックスです.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// BvhNode structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct BvhNode
+{
+    BoundingBox     Bounds;     //!< バウンディングボックスです.
+    u32             Index;      //!< リーフの場合はインスタンスリストの先頭, 内部ノードの場合は左の子ノード番号です.
+    u32             Count;      //!< リーフのインスタンス数です. 内部ノードの場合は 0 です.
+};
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Scene class
+///////////////////////////////////////////////////////////////////////////////////////////////////
+class Scene : private NonCopyable
+{
+    //=============================================================================================
+    // list of friend classes and methods.
+    //=============================================================================================
+    /* NOTHING */
+
+public:
+    //=============================================================================================
+    // public variables.
+    //=============================================================================================
+    /* NOTHING */
+
+    //=============================================================================================
+    // public methods.
+    //=============================================================================================
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //---------------------------------------------------------------------------------------------
+    Scene();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //---------------------------------------------------------------------------------------------
+    ~Scene();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      メッシュを登録します.
+    //!
+    //! @param[in]      bounds      オブジェクト空間のバウンディングボックスです.
+    //! @return     メッシュ番号を返却します.
+    //---------------------------------------------------------------------------------------------
+    u32 AddMesh( const BoundingBox& bounds );
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      インスタンスを追加します.
+    //!
+    //! @details    追加後は Update() か Build() で BVH を構築し直す必要があります.
+    //!
+    //! @param[in]      meshId      AddMesh() で追加したメッシュ番号です.
+    //! @param[in]      world       ワールド行列です.
+    //! @return     インスタンス番号を返却します. メッシュ番号が範囲外の場合は追加せずに U32_MAX を返却します.
+    //---------------------------------------------------------------------------------------------
+    u32 AddInstance( u32 meshId, const asdx::Matrix& world );
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      インスタンスのワールド行列を設定します.
+    //!
+    //! @details    BVH は Update() を呼び出した時に再適合されます.
+    //!
+    //! @param[in]      index       インスタンス番号です.
+    //! @param[in]      world       ワールド行列です.
+    //---------------------------------------------------------------------------------------------
+    void SetWorld( u32 index, const asdx::Matrix& world );
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      BVH を構築します.
+    //!
+    //! @details    ビン分割による SAH で分割し, 大きな部分木は別スレッドで構築します.
+    //---------------------------------------------------------------------------------------------
+    void Build();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      BVH を更新します.
+    //!
+    //! @details    インスタンスが追加されていれば構築し直し, 移動しただけであれば
+    //!             移動したインスタンスからルートまでのノードを再適合します.
+    //---------------------------------------------------------------------------------------------
+    void Update();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      視錐台と交差するインスタンスを列挙します.
+    //!
+    //! @param[in]      view        ワールド行列に単位行列を指定して生成したカリング用ビュー情報です.
+    //! @param[out]     result      可視なインスタンス番号の格納先です.
+    //---------------------------------------------------------------------------------------------
+    void Cull( const CullingView& view, std::vector<u32>& result ) const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      シーン全体のバウンディングボックスを取得します.
+    //---------------------------------------------------------------------------------------------
+    BoundingBox GetBounds() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      インスタンス数を取得します.
+    //---------------------------------------------------------------------------------------------
+    u32 GetInstanceCount() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      インスタンスを取得します.
+    //---------------------------------------------------------------------------------------------
+    const SceneInstance& GetInstance( u32 index ) const;
+
+protected:
+    //=============================================================================================
+    // protected variables.
+    //=============================================================================================
+    /* NOTHING */
+
+    //=============================================================================================
+    // protected methods.
+    //=============================================================================================
+    /* NOTHING */
+
+private:
+    //=============================================================================================
+    // private variables.
+    //=============================================================================================
+    std::vector<BoundingBox>    m_MeshBounds;       //!< メッシュごとのバウンディングボックスです.
+    std::vector<SceneInstance>  m_Instances;        //!< インスタンスです.
+    std::vector<BvhNode>        m_Nodes;            //!< BVH ノードです. 先頭がルートです.
+    std::vector<u32>            m_Parents;          //!< ノードごとの親ノード番号です.
+    std::vector<u32>            m_Indices;          //!< リーフが参照するインスタンス番号です.
+    std::vector<u32>            m_Leaves;           //!< インスタンスごとの所属リーフ番号です.
+    std::vector<u32>            m_Moved;            //!< 移動したインスタンス番号です.
+    std::vector<bool>           m_MovedFlags;       //!< インスタンスごとの移動フラグです.
+    bool                        m_Dirty;            //!< 構築し直す必要があれば true です.
+
+    //=============================================================================================
+    // private methods.
+    //=============================================================================================
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      移動したインスタンスを含むノードを再適合します.
+    //---------------------------------------------------------------------------------------------
+    void Refit();
+};
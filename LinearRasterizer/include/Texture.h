@@ -0,0 +1,180 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : Texture.h
+// Desc : Texture Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <asdxTypedef.h>
+#include <cstddef>
+#include <vector>
+
+
+//-------------------------------------------------------------------------------------------------
+// Constant Values
+//-------------------------------------------------------------------------------------------------
+static constexpr u32 TEXTURE_ALIGNMENT  = 64;       //!< 各ミップレベルの先頭のアラインメント (バイト) です.
+static constexpr u32 TEXTURE_MAX_SIZE   = 16384;    //!< テクスチャの最大の横幅と縦幅です.
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// TextureLevel structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct TextureLevel
+{
+    u32     Width;      //!< 横幅です.
+    u32     Height;     //!< 縦幅です.
+    size_t  Offset;     //!< ピクセルデータの先頭からのオフセット (バイト) です. TEXTURE_ALIGNMENT の倍数です.
+};
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Texture class
+///////////////////////////////////////////////////////////////////////////////////////////////////
+class Texture : private NonCopyable
+{
+    //=============================================================================================
+    // list of friend classes and methods.
+    //=============================================================================================
+    /* NOTHING */
+
+public:
+    //=============================================================================================
+    // public variables.
+    //=============================================================================================
+    /* NOTHING */
+
+    //=============================================================================================
+    // public methods.
+    //=============================================================================================
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //---------------------------------------------------------------------------------------------
+    Texture();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //---------------------------------------------------------------------------------------------
+    ~Texture();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      BMP または TGA ファイルから読み込みます.
+    //!
+    //! @details    ファイルをメモリにマップし, 最上位のミップレベルへ直接デコードします.
+    //!             BMP は 8bit パレット, 24bit, 32bit (BI_RGB, BI_BITFIELDS) に,
+    //!             TGA はフルカラーとグレースケール (RLE 圧縮を含む) に対応します.
+    //!
+    //! @param[in]      filename        ファイル名です.
+    //! @param[in]      mipmaps         全てのミップレベルを生成する場合は true です.
+    //! @retval true    読み込みに成功.
+    //! @retval false   読み込みに失敗.
+    //---------------------------------------------------------------------------------------------
+    bool Load( const char* filename, bool mipmaps = true );
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      ピクセルデータの格納先を確保します.
+    //!
+    //! @param[in]      width           横幅です.
+    //! @param[in]      height          縦幅です.
+    //! @param[in]      levelCount      ミップレベル数です. 0 の場合は 1x1 までの全てのレベルを確保します.
+    //! @retval true    確保に成功.
+    //! @retval false   確保に失敗.
+    //---------------------------------------------------------------------------------------------
+    bool Init( u32 width, u32 height, u32 levelCount );
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      ピクセルデータを解放します.
+    //---------------------------------------------------------------------------------------------
+    void Term();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      最上位のレベルから下位のミップレベルを生成します.
+    //!
+    //! @details    2x2 ピクセルのボックスフィルタで縮小します. 奇数サイズの端の行と列は切り捨てます.
+    //!             各レベルは行単位で分割して並列に処理します.
+    //---------------------------------------------------------------------------------------------
+    void GenerateMips();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      最上位のレベルの横幅を取得します.
+    //!
+    //! @return     横幅を返却します.
+    //---------------------------------------------------------------------------------------------
+    u32 GetWidth() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      最上位のレベルの縦幅を取得します.
+    //!
+    //! @return     縦幅を返却します.
+    //---------------------------------------------------------------------------------------------
+    u32 GetHeight() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      最上位のレベルの全てのピクセルが不透明かどうかを判定します.
+    //!
+    //! @retval true    全てのピクセルのアルファが 255.
+    //! @retval false   アルファが 255 未満のピクセルがある.
+    //---------------------------------------------------------------------------------------------
+    bool IsOpaque() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      ミップレベル数を取得します.
+    //!
+    //! @return     ミップレベル数を返却します.
+    //---------------------------------------------------------------------------------------------
+    u32 GetLevelCount() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      ミップレベルの情報を取得します.
+    //!
+    //! @param[in]      level       ミップレベルです.
+    //! @return     ミップレベルの情報を返却します.
+    //---------------------------------------------------------------------------------------------
+    const TextureLevel& GetLevel( u32 level ) const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      ミップレベルのピクセルデータを取得します.
+    //!
+    //! @details    ピクセルは RGBA8 で, 行の間に隙間はなく, 先頭の行が画像の下端 (v = 0) です.
+    //!
+    //! @param[in]      level       ミップレベルです.
+    //! @return     ピクセルデータの先頭を返却します.
+    //---------------------------------------------------------------------------------------------
+    u8* GetPixels( u32 level );
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      ミップレベルのピクセルデータを取得します.
+    //!
+    //! @param[in]      level       ミップレベルです.
+    //! @return     ピクセルデータの先頭を返却します.
+    //---------------------------------------------------------------------------------------------
+    const u8* GetPixels( u32 level ) const;
+
+protected:
+    //=============================================================================================
+    // protected variables.
+    //=============================================================================================
+    /* NOTHING */
+
+    //=============================================================================================
+    // protected methods.
+    //=============================================================================================
+    /* NOTHING */
+
+private:
+    //=============================================================================================
+    // private variables.
+    //=============================================================================================
+    u8*                         m_pPixels;      //!< 全てのミップレベルのピクセルデータです.
+    size_t                      m_Size;         //!< ピクセルデータのサイズです.
+    std::vector<TextureLevel>   m_Levels;       //!< ミップレベルです.
+
+    //=============================================================================================
+    // private methods.
+    //=============================================================================================
+    /* NOTHING */
+};
@@ -0,0 +1,141 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : VideoStream.h
+// Desc : Raw Video Stream Output Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <asdxTypedef.h>
+#include <cstdio>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// VIDEO_FORMAT enum
+///////////////////////////////////////////////////////////////////////////////////////////////////
+enum VIDEO_FORMAT
+{
+    VIDEO_FORMAT_Y4M    = 0,    //!< YUV4MPEG2 (YUV 4:2:0, BT.601 リミテッドレンジ) です.
+    VIDEO_FORMAT_RGBA,          //!< ヘッダ無しの RGBA8 です.
+};
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// VideoStream class
+///////////////////////////////////////////////////////////////////////////////////////////////////
+class VideoStream : private NonCopyable
+{
+    //=============================================================================================
+    // list of friend classes and methods.
+    //=============================================================================================
+    /* NOTHING */
+
+public:
+    //=============================================================================================
+    // public variables.
+    //=============================================================================================
+    /* NOTHING */
+
+    //=============================================================================================
+    // public methods.
+    //=============================================================================================
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //---------------------------------------------------------------------------------------------
+    VideoStream();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //---------------------------------------------------------------------------------------------
+    ~VideoStream();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      出力先のファイルを開きます.
+    //!
+    //! @details    名前付きパイプを指定すると, エンコーダがフレームを生成順に受け取れます.
+    //!             ファイル名に "-" を指定すると標準出力に書き込みます. この場合, ログと混ざらないように
+    //!             ログの出力先を標準出力以外にする必要があります.
+    //!
+    //! @param[in]      filename        ファイル名です.
+    //! @param[in]      width           フレームの横幅です.
+    //! @param[in]      height          フレームの縦幅です.
+    //! @param[in]      format          出力形式です.
+    //! @param[in]      frameRate       フレームレートです. VIDEO_FORMAT_Y4M のヘッダにのみ使います.
+    //! @retval true    オープンに成功.
+    //! @retval false   オープンに失敗.
+    //---------------------------------------------------------------------------------------------
+    bool Open( const char16* filename, u32 width, u32 height, VIDEO_FORMAT format, u32 frameRate );
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      開いているファイル記述子を出力先にします.
+    //!
+    //! @param[in]      fd              ファイル記述子です. Close() で閉じます.
+    //! @param[in]      width           フレームの横幅です.
+    //! @param[in]      height          フレームの縦幅です.
+    //! @param[in]      format          出力形式です.
+    //! @param[in]      frameRate       フレームレートです. VIDEO_FORMAT_Y4M のヘッダにのみ使います.
+    //! @retval true    オープンに成功.
+    //! @retval false   オープンに失敗.
+    //---------------------------------------------------------------------------------------------
+    bool OpenDescriptor( s32 fd, u32 width, u32 height, VIDEO_FORMAT format, u32 frameRate );
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      出力先を閉じます.
+    //---------------------------------------------------------------------------------------------
+    void Close();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      1 フレームを変換して書き込みます.
+    //!
+    //! @details    SaveToBitmap() と同じく, ピクセルデータの先頭行を画像の下端として扱います.
+    //!             変換したフレームは 1 回の書き込みで出力します.
+    //!
+    //! @param[in]      pBuffer         ピクセルデータ (RGBA8) です.
+    //! @retval true    書き込みに成功.
+    //! @retval false   書き込みに失敗.
+    //---------------------------------------------------------------------------------------------
+    bool WriteFrame( const u8* pBuffer );
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      出力先が開いているかどうかを取得します.
+    //!
+    //! @retval true    開いています.
+    //! @retval false   開いていません.
+    //---------------------------------------------------------------------------------------------
+    bool IsOpen() const;
+
+protected:
+    //=============================================================================================
+    // protected variables.
+    //=============================================================================================
+    /* NOTHING */
+
+    //=============================================================================================
+    // protected methods.
+    //=============================================================================================
+    /* NOTHING */
+
+private:
+    //=============================================================================================
+    // private variables.
+    //=============================================================================================
+    FILE*               m_pFile;        //!< 出力先です.
+    bool                m_Owned;        //!< 出力先を閉じる必要があるかどうかです.
+    u32                 m_Width;        //!< フレームの横幅です.
+    u32                 m_Height;       //!< フレームの縦幅です.
+    VIDEO_FORMAT        m_Format;       //!< 出力形式です.
+    std::vector<u8>     m_Frame;        //!< 変換したフレームです.
+
+    //=============================================================================================
+    // private methods.
+    //=============================================================================================
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      ストリームヘッダを書き込みます.
+    //---------------------------------------------------------------------------------------------
+    bool WriteHeader( u32 frameRate );
+};
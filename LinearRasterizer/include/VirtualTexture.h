@@ -0,0 +1,245 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : VirtualTexture.h
+// Desc : Virtual Texture Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <Sampler.h>
+#include <vector>
+
+
+//-------------------------------------------------------------------------------------------------
+// Constant Values
+//-------------------------------------------------------------------------------------------------
+static constexpr u32 PAGE_FILE_MAGIC     = 0x58455456;     //!< マジック ('VTEX').
+static constexpr u32 PAGE_FILE_VERSION   = 1;              //!< フォーマットバージョン.
+static constexpr u32 PAGE_FILE_ALIGNMENT = 4096;           //!< ページの先頭のアライメント. メモリのページ境界に揃えます.
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// PageFileHeader structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct PageFileHeader
+{
+    u32     Magic;              //!< マジック.
+    u32     Version;            //!< フォーマットバージョン.
+    u64     SourceSize;         //!< 変換元ファイルのサイズ.
+    u64     SourceTime;         //!< 変換元ファイルの更新日時.
+    u32     Format;             //!< テクセルのフォーマット (TEXTURE_FORMAT).
+    u32     Width;              //!< 最上位のレベルの横幅.
+    u32     Height;             //!< 最上位のレベルの縦幅.
+    u32     LevelCount;         //!< ミップレベル数.
+    u32     PageCount;          //!< ページ数.
+    u32     PageSize;           //!< 1 ページのサイズ (バイト).
+    u64     LevelOffset;        //!< レベルテーブルへのオフセット.
+    u64     TailOffset;         //!< 常駐するレベル (ミップテール) のテクセルデータへのオフセット.
+    u64     TailSize;           //!< 常駐するレベルのテクセルデータのサイズ.
+    u64     PageOffset;         //!< 先頭のページへのオフセット.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// PageFileLevel structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct PageFileLevel
+{
+    u32     Width;              //!< 横幅.
+    u32     Height;             //!< 縦幅.
+    u32     PageCountX;         //!< 横方向のページ数. 常駐するレベルでは 0.
+    u32     FirstPage;          //!< 先頭のページ番号. 常駐するレベルでは U32_MAX.
+    u64     Offset;             //!< 常駐するレベルのミップテール先頭からのオフセット.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// PageCacheStats structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct PageCacheStats
+{
+    u32     Requested;          //!< 要求されたページ数です.
+    u32     Loaded;             //!< 読み込んだページ数です.
+    u32     Evicted;            //!< 読み込むために追い出したページ数です.
+    u32     Dropped;            //!< スロットが足りずに読み込めなかったページ数です.
+    u32     Resident;           //!< 読み込まれているページ数です.
+};
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// PageCache class
+///////////////////////////////////////////////////////////////////////////////////////////////////
+class PageCache : private NonCopyable
+{
+    //=============================================================================================
+    // list of friend classes and methods.
+    //=============================================================================================
+    /* NOTHING */
+
+public:
+    //=============================================================================================
+    // public variables.
+    //=============================================================================================
+    /* NOTHING */
+
+    //=============================================================================================
+    // public methods.
+    //=============================================================================================
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //---------------------------------------------------------------------------------------------
+    PageCache();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //---------------------------------------------------------------------------------------------
+    ~PageCache();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      物理ページの格納先を確保します.
+    //!
+    //! @details    budget に収まるだけのスロットを一度だけ確保し, 以降は確保し直しません.
+    //!             テクスチャが増えてもテクスチャのメモリ使用量は budget とミップテールの合計で決まります.
+    //!
+    //! @param[in]      budget      格納先の合計サイズの上限 (バイト) です.
+    //! @param[in]      pageSize    1 スロットのサイズ (バイト) です. 登録するテクスチャの最大のページサイズにします.
+    //! @retval true    確保に成功.
+    //! @retval false   確保に失敗.
+    //---------------------------------------------------------------------------------------------
+    bool Init( size_t budget, u32 pageSize );
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      格納先を解放します. 登録したテクスチャのページは全て読み込まれていない状態になります.
+    //---------------------------------------------------------------------------------------------
+    void Term();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      仮想テクスチャを登録します.
+    //!
+    //! @param[in]      pTexture    TiledTexture::Open() で初期化したテクスチャです.
+    //! @retval true    登録に成功.
+    //! @retval false   登録に失敗.
+    //---------------------------------------------------------------------------------------------
+    bool Register( TiledTexture* pTexture );
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      登録したテクスチャで要求されたページを読み込みます.
+    //!
+    //! @details    読み込み済みのページは最近使ったものとして扱い, 読み込まれていないページは粗い
+    //!             レベルから順に, 最も長く使われていないスロットを追い出して読み込みます.
+    //!             今回要求されたページは追い出さないので, スロットが足りない場合は細かいレベルの
+    //!             ページから読み込みを諦めます. ページはメモリにマップしたファイルからコピーします.
+    //!
+    //! @return     読み込みの統計を返却します.
+    //---------------------------------------------------------------------------------------------
+    PageCacheStats Update();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      スロット数を取得します.
+    //!
+    //! @return     スロット数を返却します.
+    //---------------------------------------------------------------------------------------------
+    u32 GetSlotCount() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      登録したテクスチャの数を取得します.
+    //!
+    //! @return     テクスチャの数を返却します.
+    //---------------------------------------------------------------------------------------------
+    u32 GetTextureCount() const;
+
+protected:
+    //=============================================================================================
+    // protected variables.
+    //=============================================================================================
+    /* NOTHING */
+
+    //=============================================================================================
+    // protected methods.
+    //=============================================================================================
+    /* NOTHING */
+
+private:
+    ///////////////////////////////////////////////////////////////////////////////////////////////
+    // Slot structure
+    ///////////////////////////////////////////////////////////////////////////////////////////////
+    struct Slot
+    {
+        TiledTexture*   pOwner;     //!< 読み込んだページのテクスチャです. 空きスロットは nullptr です.
+        u32             Page;       //!< 読み込んだページ番号です.
+        u32             Prev;       //!< LRU リストで 1 つ新しいスロットです.
+        u32             Next;       //!< LRU リストで 1 つ古いスロットです.
+        u32             LastUsed;   //!< 最後に要求された更新番号です.
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////
+    // Request structure
+    ///////////////////////////////////////////////////////////////////////////////////////////////
+    struct Request
+    {
+        TiledTexture*   pTexture;   //!< 要求したテクスチャです.
+        u32             Page;       //!< ページ番号です.
+        u32             Level;      //!< ページのミップレベルです.
+    };
+
+    //=============================================================================================
+    // private variables.
+    //=============================================================================================
+    u8*                         m_pMemory;      //!< 全てのスロットの格納先です.
+    u32                         m_SlotSize;     //!< 1 スロットのサイズです.
+    std::vector<Slot>           m_Slots;        //!< スロットです.
+    u32                         m_Head;         //!< LRU リストの最も新しいスロットです.
+    u32                         m_Tail;         //!< LRU リストの最も古いスロットです.
+    u32                         m_Frame;        //!< 更新番号です.
+    std::vector<TiledTexture*>  m_Textures;     //!< 登録したテクスチャです.
+    std::vector<Request>        m_Requests;     //!< 読み込み待ちのページです.
+
+    //=============================================================================================
+    // private methods.
+    //=============================================================================================
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      スロットを LRU リストの先頭に移動します.
+    //!
+    //! @param[in]      index       スロット番号です.
+    //---------------------------------------------------------------------------------------------
+    void Touch( u32 index );
+};
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      タイル単位に並べたテクスチャをページファイルに書き出します.
+//!
+//! @details    TEXTURE_PAGE_SIZE より大きいレベルを TEXTURE_PAGE_SIZE 四方のページに分け,
+//!             ページごとに固定サイズで並べます. 1 ページに収まる下位のレベル (ミップテール) と
+//!             最下位のレベルはまとめて格納し, 常駐させます.
+//!             同じディレクトリの一時ファイルに書き出してから置き換えるので, 他のプロセスがマップしている
+//!             古いページファイルが書き換わることはありません.
+//!
+//! @param[in]      filename        出力ファイル名です.
+//! @param[in]      texture         TiledTexture::Init() で初期化したテクスチャです.
+//! @param[in]      sourceSize      変換元ファイルのサイズです.
+//! @param[in]      sourceTime      変換元ファイルの更新日時です.
+//! @retval true    書き出しに成功.
+//! @retval false   書き出しに失敗.
+//-------------------------------------------------------------------------------------------------
+bool SavePageFile(
+    const char*         filename,
+    const TiledTexture& texture,
+    u64                 sourceSize,
+    u64                 sourceTime );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      画像ファイルに対応するページファイルを開いて仮想テクスチャとして初期化します.
+//!
+//! @details    ページファイルは画像ファイル名に ".vtex" を付けた名前です. 存在しないか画像ファイルより
+//!             古い場合は, 画像を読み込んでブロック圧縮してから作り直します. アルファが不要な画像は
+//!             BC1, それ以外は BC3 で格納します. ページファイルを書き出せない場合は, ブロック圧縮した
+//!             テクスチャを常駐させたまま成功を返します (GetPageCount() は 0 になります).
+//!
+//! @param[in]      filename        BMP または TGA の画像ファイル名です.
+//! @param[out]     pTexture        初期化するテクスチャです.
+//! @retval true    初期化に成功.
+//! @retval false   初期化に失敗.
+//-------------------------------------------------------------------------------------------------
+bool LoadVirtualTexture( const char* filename, TiledTexture* pTexture );
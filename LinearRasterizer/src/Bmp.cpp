@@ -8,9 +8,34 @@
 // Includes
 //-------------------------------------------------------------------------------------------------
 #include <Bmp.h>
-#include <cstdio>
+#include <ImageFile.h>
+#include <vector>
+#include <cstring>
+#include <asdxMath.h>
 #include <asdxLogger.h>
 
+#if ASDX_IS_WIN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <cstdint>
+#endif
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+    #include <emmintrin.h>
+    #define BMP_USE_SSE2    (1)
+#endif
+
+
+namespace /* anonymous */ {
+
+//-------------------------------------------------------------------------------------------------
+// Constant Values
+//-------------------------------------------------------------------------------------------------
+static constexpr u32 BMP_WRITE_CHUNK_SIZE = 4 * 1024 * 1024;    //!< ピクセルデータを書き込む単位 (バイト) です. 4 の倍数にします.
+
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // BMP_FILE_HEADER structure
@@ -48,35 +73,89 @@ struct BMP_INFO_HEADER
 #pragma pack(pop)
 
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// BMP_HEADER structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma pack(push, 1)
+struct BMP_HEADER
+{
+    BMP_FILE_HEADER File;
+    BMP_INFO_HEADER Info;
+};
+#pragma pack(pop)
+
+static_assert( sizeof(BMP_FILE_HEADER) == 14, "Invalid BMP_FILE_HEADER size." );
+static_assert( sizeof(BMP_INFO_HEADER) == 40, "Invalid BMP_INFO_HEADER size." );
+static_assert( sizeof(BMP_HEADER)      == 54, "Invalid BMP_HEADER size." );
+
+
 //-------------------------------------------------------------------------------------------------
-//      BMPファイルヘッダを書き込みます.
+//      32bit の BGRA で下端の行から並べる BMP のヘッダを作成します.
 //-------------------------------------------------------------------------------------------------
-void WriteBmpFileHeader( BMP_FILE_HEADER& header, FILE* pFile )
+BMP_HEADER CreateHeader( u32 width, u32 height )
 {
-    fwrite( &header.Type,       sizeof(unsigned short), 1, pFile );
-    fwrite( &header.Size,       sizeof(unsigned int),   1, pFile );
-    fwrite( &header.Reserved1,  sizeof(unsigned short), 1, pFile );
-    fwrite( &header.Reserved2,  sizeof(unsigned short), 1, pFile );
-    fwrite( &header.OffBits,    sizeof(unsigned int),   1, pFile );
+    auto imageSize = u32( u64(width) * u64(height) * 4 );
+
+    BMP_HEADER header = {};
+
+    header.File.Type      = 0x4d42;   // 'B', 'M'
+    header.File.Size      = u32( sizeof(BMP_HEADER) + imageSize );
+    header.File.Reserved1 = 0;
+    header.File.Reserved2 = 0;
+    header.File.OffBits   = sizeof(BMP_HEADER);
+
+    header.Info.Size            = sizeof(BMP_INFO_HEADER);
+    header.Info.Width           = static_cast<s32>(width);
+    header.Info.Height          = static_cast<s32>(height);
+    header.Info.Planes          = 1;
+    header.Info.BitCount        = 32;
+    header.Info.Compression     = 0;
+    header.Info.ImageSize       = imageSize;
+    header.Info.XPixPerMeter    = 0;
+    header.Info.YPixPerMeter    = 0;
+    header.Info.ColorUsed       = 0;
+    header.Info.ColorImportant  = 0;
+
+    return header;
 }
 
+} // namespace /* anonymous */
+
 
 //-------------------------------------------------------------------------------------------------
-//      BMP情報ヘッダを書き込みます.
+//      32bit のピクセルの R と B を入れ替えます.
 //-------------------------------------------------------------------------------------------------
-void WriteBmpInfoHeader( BMP_INFO_HEADER& header, FILE* pFile )
+void SwapRedBlue( const u8* pSrc, u8* pDst, u32 pixelCount )
 {
-    fwrite( &header.Size,           sizeof(unsigned int),   1, pFile );
-    fwrite( &header.Width,          sizeof(long),           1, pFile );
-    fwrite( &header.Height,         sizeof(long),           1, pFile );
-    fwrite( &header.Planes,         sizeof(unsigned short), 1, pFile );
-    fwrite( &header.BitCount,       sizeof(unsigned short), 1, pFile );
-    fwrite( &header.Compression,    sizeof(unsigned int),   1, pFile );
-    fwrite( &header.ImageSize,      sizeof(unsigned int),   1, pFile );
-    fwrite( &header.XPixPerMeter,   sizeof(long),           1, pFile );
-    fwrite( &header.YPixPerMeter,   sizeof(long),           1, pFile );
-    fwrite( &header.ColorUsed,      sizeof(unsigned int),   1, pFile );
-    fwrite( &header.ColorImportant, sizeof(unsigned int),   1, pFile );
+    u32 i = 0;
+
+#if defined(BMP_USE_SSE2)
+    // リトルエンディアンで R と B は 32bit 値の最下位と 3 バイト目なので, シフトで入れ替える.
+    auto maskGA = _mm_set1_epi32( s32(0xff00ff00) );
+    auto maskRB = _mm_set1_epi32( 0x000000ff );
+
+    for( ; i + 4 <= pixelCount; i += 4 )
+    {
+        auto v  = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSrc + i * 4 ) );
+        auto ga = _mm_and_si128( v, maskGA );
+        auto r  = _mm_slli_epi32( _mm_and_si128( v, maskRB ), 16 );
+        auto b  = _mm_and_si128( _mm_srli_epi32( v, 16 ), maskRB );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( pDst + i * 4 ), _mm_or_si128( ga, _mm_or_si128( r, b ) ) );
+    }
+#endif
+
+    // 同じバッファで入れ替えられるように, 先に読み出してから書き込む.
+    for( ; i<pixelCount; ++i )
+    {
+        auto r = pSrc[i * 4 + 0];
+        auto g = pSrc[i * 4 + 1];
+        auto b = pSrc[i * 4 + 2];
+        auto a = pSrc[i * 4 + 3];
+        pDst[i * 4 + 0] = b;
+        pDst[i * 4 + 1] = g;
+        pDst[i * 4 + 2] = r;
+        pDst[i * 4 + 3] = a;
+    }
 }
 
 
@@ -91,62 +170,195 @@ bool SaveToBitmap( const char16* filename, u32 width, u32 height, const u8* pBuf
         return false;
     }
 
-    FILE* pFile;
+    auto imageSize = u64(width) * u64(height) * 4;
+    if ( imageSize + sizeof(BMP_HEADER) > U32_MAX )
+    {
+        ELOG( "Error : Image Too Large. width = %u, height = %u", width, height );
+        return false;
+    }
 
-    auto err = _wfopen_s( &pFile, filename, L"wb" );
-    if ( err != 0 )
+    auto pFile = OpenImageFile( filename );
+    if ( pFile == nullptr )
     {
         ELOG( "Error : File Open Failed." );
         return false;
     }
 
-    // ファイルヘッダ書き込み.
+    // ヘッダは 1 回で書き込む.
+    auto header = CreateHeader( width, height );
+
+    auto result = ( fwrite( &header, sizeof(header), 1, pFile ) == 1 );
+
+    // ピクセルデータは BGRA に並べ替えながら, 一定サイズごとにまとめて書き込む.
+    if ( result )
+    {
+        std::vector<u8> chunk( size_t( asdx::Min<u64>( imageSize, BMP_WRITE_CHUNK_SIZE ) ) );
+
+        for( u64 offset=0; offset<imageSize; offset += chunk.size() )
+        {
+            auto size = size_t( asdx::Min<u64>( imageSize - offset, chunk.size() ) );
+            SwapRedBlue( pBuffer + offset, chunk.data(), u32( size / 4 ) );
+
+            if ( fwrite( chunk.data(), 1, size, pFile ) != size )
+            {
+                result = false;
+                break;
+            }
+        }
+    }
+
+    if ( fclose( pFile ) != 0 )
+    { result = false; }
+
+    if ( !result )
+    {
+        ELOG( "Error : File Write Failed." );
+        return false;
+    }
+
+    // 正常終了.
+    return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// MappedBitmap class
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------------------------------
+//      コンストラクタです.
+//-------------------------------------------------------------------------------------------------
+MappedBitmap::MappedBitmap()
+: m_pHandle ( nullptr )
+, m_pMapping( nullptr )
+, m_pData   ( nullptr )
+, m_Size    ( 0 )
+{ /* DO_NOTHING */ }
+
+//-------------------------------------------------------------------------------------------------
+//      デストラクタです.
+//-------------------------------------------------------------------------------------------------
+MappedBitmap::~MappedBitmap()
+{ Close(); }
+
+//-------------------------------------------------------------------------------------------------
+//      最終的なサイズの BMP ファイルを作成し, 読み書き可能でメモリにマップします.
+//-------------------------------------------------------------------------------------------------
+bool MappedBitmap::Create( const char16* filename, u32 width, u32 height )
+{
+    if ( filename == nullptr || width == 0 || height == 0 )
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    auto imageSize = u64(width) * u64(height) * 4;
+    if ( imageSize + sizeof(BMP_HEADER) > U32_MAX )
     {
-        BMP_FILE_HEADER header;
+        ELOG( "Error : Image Too Large. width = %u, height = %u", width, height );
+        return false;
+    }
+
+    Close();
 
-        header.Type      = 'MB';
-        header.Size      = sizeof(BMP_FILE_HEADER) + sizeof(BMP_INFO_HEADER) + (width * height * 4);
-        header.Reserved1 = 0;
-        header.Reserved2 = 0;
-        header.OffBits   = sizeof(BMP_FILE_HEADER) + sizeof(BMP_INFO_HEADER);
+    auto size = u64( sizeof(BMP_HEADER) ) + imageSize;
 
-        WriteBmpFileHeader( header, pFile );
+#if ASDX_IS_WIN
+    auto handle = CreateFileW( filename, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr );
+    if ( handle == INVALID_HANDLE_VALUE )
+    {
+        ELOG( "Error : File Open Failed." );
+        return false;
     }
+    m_pHandle = handle;
+    m_Size    = size;
 
-    // 情報ヘッダ書き込み.
+    // マッピングの作成時にファイルが最終的なサイズまで拡張される.
+    m_pMapping = CreateFileMappingW( handle, nullptr, PAGE_READWRITE, DWORD( size >> 32 ), DWORD( size & 0xffffffff ), nullptr );
+    if ( m_pMapping == nullptr )
     {
-        BMP_INFO_HEADER header;
+        ELOG( "Error : CreateFileMapping() Failed." );
+        Close();
+        return false;
+    }
 
-        header.Size             = 40;
-        header.Width            = static_cast<s32>(width);
-        header.Height           = static_cast<s32>(height);
-        header.Planes           = 1;
-        header.BitCount         = 32;
-        header.Compression      = 0;
-        header.ImageSize        = width * height * 4;
-        header.XPixPerMeter     = 0;
-        header.YPixPerMeter     = 0;
-        header.ColorUsed        = 0;
-        header.ColorImportant   = 0;
+    m_pData = static_cast<u8*>( MapViewOfFile( m_pMapping, FILE_MAP_WRITE, 0, 0, 0 ) );
+    if ( m_pData == nullptr )
+    {
+        ELOG( "Error : MapViewOfFile() Failed." );
+        Close();
+        return false;
+    }
+#else
+    std::vector<char> path;
+    if ( !ConvertToMultiByte( filename, path ) )
+    {
+        ELOG( "Error : Invalid Filename." );
+        return false;
+    }
 
-        WriteBmpInfoHeader( header, pFile );
+    auto fd = open( path.data(), O_RDWR | O_CREAT | O_TRUNC, 0644 );
+    if ( fd < 0 )
+    {
+        ELOG( "Error : File Open Failed. filename = %s", path.data() );
+        return false;
     }
+    m_pHandle = reinterpret_cast<void*>( intptr_t( fd ) + 1 );
 
-    for( u32 i=0; i<height; ++i )
+    if ( ftruncate( fd, off_t( size ) ) != 0 )
     {
-        for( u32 j=0; j<width; ++j )
-        {
-            auto idx = ( i * width * 4 ) + ( j * 4 );
+        ELOG( "Error : ftruncate() Failed. filename = %s", path.data() );
+        Close();
+        return false;
+    }
+    m_Size = size;
 
-            fwrite( &pBuffer[idx+0], sizeof(u8), 1, pFile );
-            fwrite( &pBuffer[idx+1], sizeof(u8), 1, pFile );
-            fwrite( &pBuffer[idx+2], sizeof(u8), 1, pFile );
-            fwrite( &pBuffer[idx+3], sizeof(u8), 1, pFile );
-        }
+    auto ptr = mmap( nullptr, size_t( size ), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    if ( ptr == MAP_FAILED )
+    {
+        ELOG( "Error : mmap() Failed. filename = %s", path.data() );
+        Close();
+        return false;
     }
+    m_pData = static_cast<u8*>( ptr );
+#endif
 
-    fclose( pFile );
+    auto header = CreateHeader( width, height );
+    memcpy( m_pData, &header, sizeof(header) );
 
-    // 正常終了.
     return true;
 }
+
+//-------------------------------------------------------------------------------------------------
+//      マップを解除してファイルを閉じます.
+//-------------------------------------------------------------------------------------------------
+void MappedBitmap::Close()
+{
+#if ASDX_IS_WIN
+    if ( m_pData != nullptr )
+    { UnmapViewOfFile( m_pData ); }
+
+    if ( m_pMapping != nullptr )
+    { CloseHandle( m_pMapping ); }
+
+    if ( m_pHandle != nullptr )
+    { CloseHandle( m_pHandle ); }
+#else
+    if ( m_pData != nullptr )
+    { munmap( m_pData, size_t( m_Size ) ); }
+
+    if ( m_pHandle != nullptr )
+    { close( int( reinterpret_cast<intptr_t>( m_pHandle ) - 1 ) ); }
+#endif
+
+    m_pHandle  = nullptr;
+    m_pMapping = nullptr;
+    m_pData    = nullptr;
+    m_Size     = 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      マップされたピクセルデータの先頭を取得します.
+//-------------------------------------------------------------------------------------------------
+u8* MappedBitmap::GetPixels() const
+{ return ( m_pData != nullptr ) ? m_pData + sizeof(BMP_HEADER) : nullptr; }
@@ -0,0 +1,176 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : Bounds.cpp
+// Desc : Bounding Volume Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <Bounds.h>
+
+
+//-------------------------------------------------------------------------------------------------
+// Using Statements
+//-------------------------------------------------------------------------------------------------
+using namespace asdx;
+
+
+namespace /* anonymous */ {
+
+//-------------------------------------------------------------------------------------------------
+// Constant Values.
+//-------------------------------------------------------------------------------------------------
+static constexpr f32 CLIP_MARGIN = 0.01f;      //!< クリップ平面に持たせる余裕の割合です.
+
+} // namespace /* anonymous */
+
+
+//-------------------------------------------------------------------------------------------------
+//      空のバウンディングボックスを生成します.
+//-------------------------------------------------------------------------------------------------
+BoundingBox CreateEmptyBox()
+{
+    BoundingBox result;
+    result.Mini = Vector3( F32_MAX, F32_MAX, F32_MAX );
+    result.Maxi = Vector3(-F32_MAX,-F32_MAX,-F32_MAX );
+    return result;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      バウンディングボックスが空かどうかチェックします.
+//-------------------------------------------------------------------------------------------------
+bool IsEmpty( const BoundingBox& box )
+{ return box.Mini.x > box.Maxi.x || box.Mini.y > box.Maxi.y || box.Mini.z > box.Maxi.z; }
+
+//-------------------------------------------------------------------------------------------------
+//      バウンディングボックスを点を含むように拡張します.
+//-------------------------------------------------------------------------------------------------
+void Merge( BoundingBox& box, const Vector3& point )
+{
+    box.Mini = Vector3::Min( box.Mini, point );
+    box.Maxi = Vector3::Max( box.Maxi, point );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      バウンディングボックスを別のボックスを含むように拡張します.
+//-------------------------------------------------------------------------------------------------
+void Merge( BoundingBox& box, const BoundingBox& value )
+{
+    if ( IsEmpty( value ) )
+    { return; }
+
+    box.Mini = Vector3::Min( box.Mini, value.Mini );
+    box.Maxi = Vector3::Max( box.Maxi, value.Maxi );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      バウンディングボックスを行列で変換します.
+//-------------------------------------------------------------------------------------------------
+BoundingBox TransformBox( const BoundingBox& box, const Matrix& matrix )
+{
+    if ( IsEmpty( box ) )
+    { return box; }
+
+    // 平行移動から始めて, 各軸の寄与の小さい方と大きい方を足し込む (Arvo の方法).
+    f32 mini[3] = { matrix._41, matrix._42, matrix._43 };
+    f32 maxi[3] = { matrix._41, matrix._42, matrix._43 };
+
+    const f32 boxMini[3] = { box.Mini.x, box.Mini.y, box.Mini.z };
+    const f32 boxMaxi[3] = { box.Maxi.x, box.Maxi.y, box.Maxi.z };
+
+    for( auto i=0; i<3; ++i )
+    {
+        for( auto j=0; j<3; ++j )
+        {
+            auto a = matrix.m[i][j] * boxMini[i];
+            auto b = matrix.m[i][j] * boxMaxi[i];
+            mini[j] += Min( a, b );
+            maxi[j] += Max( a, b );
+        }
+    }
+
+    BoundingBox result;
+    result.Mini = Vector3( mini[0], mini[1], mini[2] );
+    result.Maxi = Vector3( maxi[0], maxi[1], maxi[2] );
+    return result;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      可視なバウンディングボックスに合わせてニアクリップ・ファークリップ平面を求めます.
+//-------------------------------------------------------------------------------------------------
+bool FitClipPlanes
+(
+    const Matrix&       view,
+    f32                 fieldOfView,
+    f32                 aspectRatio,
+    const BoundingBox*  pBoxes,
+    u32                 count,
+    f32                 minNearRatio,
+    f32&                nearClip,
+    f32&                farClip
+)
+{
+    if ( pBoxes == nullptr || count == 0 )
+    { return false; }
+
+    auto tanY = tanf( fieldOfView * 0.5f );
+    auto tanX = tanY * aspectRatio;
+
+    auto minDepth = F32_MAX;
+    auto maxDepth = 0.0f;
+    auto visible  = false;
+
+    for( u32 i=0; i<count; ++i )
+    {
+        auto& box = pBoxes[i];
+        if ( IsEmpty( box ) )
+        { continue; }
+
+        // ビュー空間に変換.
+        Vector3 corners[8];
+        for( auto j=0; j<8; ++j )
+        {
+            auto p = Vector3(
+                ( j & 1 ) ? box.Maxi.x : box.Mini.x,
+                ( j & 2 ) ? box.Maxi.y : box.Mini.y,
+                ( j & 4 ) ? box.Maxi.z : box.Mini.z );
+            corners[j] = Vector3::Transform( p, view );
+        }
+
+        // 全ての角が同じ平面の外側にあればカリング. (右手系なので視線方向は -Z).
+        u32 outside[5] = {};
+        for( auto& p : corners )
+        {
+            auto depth = -p.z;
+            if (  p.x > tanX * depth ) { outside[0]++; }
+            if ( -p.x > tanX * depth ) { outside[1]++; }
+            if (  p.y > tanY * depth ) { outside[2]++; }
+            if ( -p.y > tanY * depth ) { outside[3]++; }
+            if ( depth <= 0.0f )       { outside[4]++; }
+        }
+
+        auto culled = false;
+        for( auto c : outside )
+        { culled |= ( c == 8 ); }
+
+        if ( culled )
+        { continue; }
+
+        for( auto& p : corners )
+        {
+            minDepth = Min( minDepth, -p.z );
+            maxDepth = Max( maxDepth, -p.z );
+        }
+
+        visible = true;
+    }
+
+    if ( !visible || maxDepth <= 0.0f )
+    { return false; }
+
+    farClip  = maxDepth * ( 1.0f + CLIP_MARGIN );
+    nearClip = Max( minDepth * ( 1.0f - CLIP_MARGIN ), farClip * minNearRatio );
+
+    return true;
+}
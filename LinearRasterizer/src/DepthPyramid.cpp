@@ -0,0 +1,149 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : DepthPyramid.cpp
+// Desc : Hierarchical Depth Pyramid Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <DepthPyramid.h>
+#include <cmath>
+
+
+//-------------------------------------------------------------------------------------------------
+// Using Statements
+//-------------------------------------------------------------------------------------------------
+using namespace asdx;
+
+
+namespace /* anonymous */ {
+
+//-------------------------------------------------------------------------------------------------
+//      2x2 の最大値を取って半分の解像度に縮小します.
+//-------------------------------------------------------------------------------------------------
+void Downsample( const f32* pSrc, u32 srcW, u32 srcH, f32* pDst, u32 dstW, u32 dstH )
+{
+    for( u32 y=0; y<dstH; ++y )
+    {
+        auto pRow0 = pSrc + ( y * 2 ) * srcW;
+        auto pRow1 = pSrc + Min( y * 2 + 1, srcH - 1 ) * srcW;
+        auto pOut  = pDst + y * dstW;
+
+        for( u32 x=0; x<dstW; ++x )
+        {
+            auto x0 = x * 2;
+            auto x1 = Min( x0 + 1, srcW - 1 );
+            pOut[x] = Max( Max( pRow0[x0], pRow0[x1] ), Max( pRow1[x0], pRow1[x1] ) );
+        }
+    }
+}
+
+} // namespace /* anonymous */
+
+
+//-------------------------------------------------------------------------------------------------
+//      レンダーターゲットの深度から最大深度のミップピラミッドを構築します.
+//-------------------------------------------------------------------------------------------------
+void BuildDepthPyramid( const RenderTarget& target, DepthPyramid& pyramid )
+{
+    pyramid.Width  = target.Width;
+    pyramid.Height = target.Height;
+    pyramid.Levels.clear();
+
+    if ( target.pDepth == nullptr || target.Width == 0 || target.Height == 0 )
+    {
+        pyramid.MaxDepth.clear();
+        return;
+    }
+
+    // レベルの配置を決める.
+    u32 total = 0;
+    {
+        auto w = target.Width;
+        auto h = target.Height;
+        do
+        {
+            w = ( w + 1 ) / 2;
+            h = ( h + 1 ) / 2;
+            pyramid.Levels.push_back( { w, h, total } );
+            total += w * h;
+        }
+        while( w > 1 || h > 1 );
+    }
+
+    pyramid.MaxDepth.resize( total );
+
+    auto pData = pyramid.MaxDepth.data();
+    Downsample( target.pDepth, target.Width, target.Height,
+        pData, pyramid.Levels[0].Width, pyramid.Levels[0].Height );
+
+    for( size_t i=1; i<pyramid.Levels.size(); ++i )
+    {
+        auto& src = pyramid.Levels[i - 1];
+        auto& dst = pyramid.Levels[i];
+        Downsample( pData + src.Offset, src.Width, src.Height, pData + dst.Offset, dst.Width, dst.Height );
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      バウンディングボックスが描画済みの深度に完全に隠れているか判定します.
+//-------------------------------------------------------------------------------------------------
+bool IsOccluded( const DepthPyramid& pyramid, const Matrix& worldViewProj, const BoundingBox& box )
+{
+    if ( pyramid.Levels.empty() )
+    { return false; }
+
+    auto w = f32( pyramid.Width );
+    auto h = f32( pyramid.Height );
+
+    // 射影後の z は位置に対して線形なので, 最も手前の深度は角のどれかで得られる.
+    auto nearDepth = F32_MAX;
+    auto mini = Vector2( F32_MAX, F32_MAX );
+    auto maxi = Vector2(-F32_MAX,-F32_MAX );
+    for( auto i=0; i<8; ++i )
+    {
+        auto p = Vector3(
+            ( i & 1 ) ? box.Maxi.x : box.Mini.x,
+            ( i & 2 ) ? box.Maxi.y : box.Mini.y,
+            ( i & 4 ) ? box.Maxi.z : box.Mini.z );
+
+        auto clip = Vector4::Transform( Vector4( p, 1.0f ), worldViewProj );
+        if ( clip.w <= 0.0f )
+        { return false; }
+
+        nearDepth = Min( nearDepth, clip.z );
+        mini = Vector2::Min( mini, Vector2( clip.x / clip.w, clip.y / clip.w ) );
+        maxi = Vector2::Max( maxi, Vector2( clip.x / clip.w, clip.y / clip.w ) );
+    }
+
+    auto x0 = Max( s32( floorf( ( mini.x * 0.5f + 0.5f ) * w ) ), 0 );
+    auto y0 = Max( s32( floorf( ( mini.y * 0.5f + 0.5f ) * h ) ), 0 );
+    auto x1 = Min( s32( ceilf ( ( maxi.x * 0.5f + 0.5f ) * w ) ), s32( pyramid.Width  ) ) - 1;
+    auto y1 = Min( s32( ceilf ( ( maxi.y * 0.5f + 0.5f ) * h ) ), s32( pyramid.Height ) ) - 1;
+
+    // 画面外は視錐台カリングに任せる.
+    if ( x0 > x1 || y0 > y1 )
+    { return false; }
+
+    // 範囲が 2x2 テクセル以内に収まるレベルを選ぶ. レベル L のテクセルは 2^(L+1) ピクセル四方.
+    auto size  = u32( Max( x1 - x0, y1 - y0 ) + 1 );
+    u32  level = 0;
+    while( ( 2u << level ) < size && level + 1 < u32( pyramid.Levels.size() ) )
+    { level++; }
+
+    auto& info  = pyramid.Levels[level];
+    auto  shift = level + 1;
+    auto  pData = pyramid.MaxDepth.data() + info.Offset;
+
+    for( auto y = u32( y0 ) >> shift; y <= ( u32( y1 ) >> shift ); ++y )
+    {
+        for( auto x = u32( x0 ) >> shift; x <= ( u32( x1 ) >> shift ); ++x )
+        {
+            if ( pData[y * info.Width + x] >= nearDepth )
+            { return false; }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,234 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : ImageWriter.cpp
+// Desc : Asynchronous Image Writer Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <ImageWriter.h>
+#include <Bmp.h>
+#include <Png.h>
+#include <Qoi.h>
+#include <asdxLogger.h>
+#include <cwctype>
+
+
+namespace /* anonymous */ {
+
+//-------------------------------------------------------------------------------------------------
+//      ファイル名の拡張子が一致するか判定します. 大文字と小文字は区別しません.
+//-------------------------------------------------------------------------------------------------
+bool HasExtension( const std::basic_string<char16>& filename, const char16* extension )
+{
+    auto pos = filename.rfind( L'.' );
+    if ( pos == std::basic_string<char16>::npos )
+    { return false; }
+
+    auto pExt = filename.c_str() + pos + 1;
+    for( ; *pExt != L'\0' && *extension != L'\0'; ++pExt, ++extension )
+    {
+        if ( towlower( *pExt ) != wint_t( *extension ) )
+        { return false; }
+    }
+
+    return *pExt == L'\0' && *extension == L'\0';
+}
+
+//-------------------------------------------------------------------------------------------------
+//      拡張子に合わせた形式で画像を保存します. 不明な拡張子は BMP で保存します.
+//-------------------------------------------------------------------------------------------------
+bool SaveImage( const std::basic_string<char16>& filename, u32 width, u32 height, const u8* pBuffer )
+{
+    if ( HasExtension( filename, L"png" ) )
+    { return SaveToPng( filename.c_str(), width, height, pBuffer ); }
+
+    if ( HasExtension( filename, L"qoi" ) )
+    { return SaveToQoi( filename.c_str(), width, height, pBuffer ); }
+
+    return SaveToBitmap( filename.c_str(), width, height, pBuffer );
+}
+
+} // namespace /* anonymous */
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// ImageWriter class
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------------------------------
+//      コンストラクタです.
+//-------------------------------------------------------------------------------------------------
+ImageWriter::ImageWriter()
+: m_Width       ( 0 )
+, m_Height      ( 0 )
+, m_Writing     ( 0 )
+, m_ErrorCount  ( 0 )
+, m_Exit        ( false )
+{ /* DO_NOTHING */ }
+
+//-------------------------------------------------------------------------------------------------
+//      デストラクタです.
+//-------------------------------------------------------------------------------------------------
+ImageWriter::~ImageWriter()
+{ Term(); }
+
+//-------------------------------------------------------------------------------------------------
+//      カラーバッファを確保して書き込みスレッドを開始します.
+//-------------------------------------------------------------------------------------------------
+bool ImageWriter::Init( u32 width, u32 height, u32 bufferCount )
+{
+    if ( width == 0 || height == 0 || bufferCount == 0 )
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    Term();
+
+    m_Width      = width;
+    m_Height     = height;
+    m_ErrorCount = 0;
+    m_Exit       = false;
+
+    m_Buffers.resize( bufferCount );
+    for( auto& buffer : m_Buffers )
+    {
+        buffer.resize( size_t( width ) * height * 4 );
+        m_FreeBuffers.push_back( buffer.data() );
+    }
+
+    m_Thread = std::thread( [this]() { Run(); } );
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      書き込み待ちの画像を全て書き込んでからスレッドを終了し, バッファを解放します.
+//-------------------------------------------------------------------------------------------------
+void ImageWriter::Term()
+{
+    if ( m_Thread.joinable() )
+    {
+        {
+            std::lock_guard<std::mutex> locker( m_Mutex );
+            m_Exit = true;
+        }
+        m_RequestCV.notify_one();
+        m_Thread.join();
+    }
+
+    m_Stream.Close();
+
+    m_Buffers    .clear();
+    m_FreeBuffers.clear();
+    m_Requests   .clear();
+    m_Width   = 0;
+    m_Height  = 0;
+    m_Writing = 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      フレームを連続して書き込む動画ストリームを開きます.
+//-------------------------------------------------------------------------------------------------
+bool ImageWriter::OpenStream( const char16* filename, VIDEO_FORMAT format, u32 frameRate )
+{
+    // 書き込みスレッドがストリームを使い始める前に開く.
+    std::lock_guard<std::mutex> locker( m_Mutex );
+    if ( m_Buffers.empty() || !m_Requests.empty() || m_Writing > 0 )
+    {
+        ELOG( "Error : Invalid Call." );
+        return false;
+    }
+
+    return m_Stream.Open( filename, m_Width, m_Height, format, frameRate );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      描画に使う空きカラーバッファを取得します.
+//-------------------------------------------------------------------------------------------------
+u8* ImageWriter::Acquire()
+{
+    std::unique_lock<std::mutex> locker( m_Mutex );
+    if ( m_Buffers.empty() )
+    { return nullptr; }
+
+    // 書き込みが追いつくまで描画側を待たせる.
+    m_FreeCV.wait( locker, [this]() { return !m_FreeBuffers.empty(); } );
+
+    auto pBuffer = m_FreeBuffers.back();
+    m_FreeBuffers.pop_back();
+    return pBuffer;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      描画を終えたカラーバッファの書き込みを要求します.
+//-------------------------------------------------------------------------------------------------
+void ImageWriter::Submit( u8* pBuffer, const char16* filename )
+{
+    if ( pBuffer == nullptr || filename == nullptr )
+    {
+        ELOG( "Error : Invalid Argument." );
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> locker( m_Mutex );
+        m_Requests.push_back( { pBuffer, filename } );
+    }
+    m_RequestCV.notify_one();
+}
+
+//-------------------------------------------------------------------------------------------------
+//      書き込み待ちの画像が全て書き込まれるまで待機します.
+//-------------------------------------------------------------------------------------------------
+void ImageWriter::Flush()
+{
+    std::unique_lock<std::mutex> locker( m_Mutex );
+    m_FreeCV.wait( locker, [this]() { return m_Requests.empty() && m_Writing == 0; } );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      書き込みに失敗した画像の数を取得します.
+//-------------------------------------------------------------------------------------------------
+u32 ImageWriter::GetErrorCount() const
+{
+    std::lock_guard<std::mutex> locker( m_Mutex );
+    return m_ErrorCount;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      書き込みスレッドの処理です.
+//-------------------------------------------------------------------------------------------------
+void ImageWriter::Run()
+{
+    std::unique_lock<std::mutex> locker( m_Mutex );
+
+    for(;;)
+    {
+        m_RequestCV.wait( locker, [this]() { return m_Exit || !m_Requests.empty(); } );
+
+        // 終了要求があっても, 残っている要求は全て書き込む.
+        if ( m_Requests.empty() )
+        { break; }
+
+        auto request = std::move( m_Requests.front() );
+        m_Requests.pop_front();
+        m_Writing++;
+
+        // 書き込み中は描画側がバッファの取得と要求の追加を行えるようにロックを外す.
+        locker.unlock();
+        auto result = m_Stream.IsOpen()
+            ? m_Stream.WriteFrame( request.pBuffer )
+            : SaveImage( request.Filename, m_Width, m_Height, request.pBuffer );
+        locker.lock();
+
+        if ( !result )
+        { m_ErrorCount++; }
+
+        m_Writing--;
+        m_FreeBuffers.push_back( request.pBuffer );
+        m_FreeCV.notify_all();
+    }
+}
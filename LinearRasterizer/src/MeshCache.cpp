@@ -0,0 +1,720 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : MeshCache.cpp
+// Desc : Binary Mesh Cache Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <MeshCache.h>
+#include <MeshOptimizer.h>
+#include <MeshSimplifier.h>
+#include <Obj.h>
+#include <asdxLogger.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if ASDX_IS_WIN
+#include <Windows.h>
+#endif
+
+
+namespace /* anonymous */ {
+
+static_assert( sizeof(asdx::Vector2) == sizeof(f32) * 2, "Vector2 must be tightly packed." );
+static_assert( sizeof(asdx::Vector3) == sizeof(f32) * 3, "Vector3 must be tightly packed." );
+
+//-------------------------------------------------------------------------------------------------
+//      アライメントに合わせて切り上げます.
+//-------------------------------------------------------------------------------------------------
+inline u64 AlignUp( u64 value )
+{ return ( value + MESH_CACHE_ALIGNMENT - 1 ) & ~u64( MESH_CACHE_ALIGNMENT - 1 ); }
+
+//-------------------------------------------------------------------------------------------------
+//      ファイルパスのハッシュ値を求めます (FNV-1a).
+//-------------------------------------------------------------------------------------------------
+u64 HashPath( const char* filename )
+{
+    auto hash = 0xcbf29ce484222325ull;
+    for( auto ptr = filename; *ptr != '\0'; ++ptr )
+    {
+        hash ^= u64( u8( *ptr ) );
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      ファイルサイズと更新日時を取得します.
+//-------------------------------------------------------------------------------------------------
+bool GetFileInfo( const char* filename, u64& size, u64& time )
+{
+#if ASDX_IS_WIN
+    struct _stat64 info;
+    if ( _stat64( filename, &info ) != 0 )
+    { return false; }
+#else
+    struct stat info;
+    if ( stat( filename, &info ) != 0 )
+    { return false; }
+#endif
+
+    size = u64( info.st_size );
+    time = u64( info.st_mtime );
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      指定オフセットにデータをコピーします.
+//-------------------------------------------------------------------------------------------------
+void CopyAt( std::vector<char>& buffer, u64 offset, const void* pData, u64 size )
+{
+    if ( size > 0 )
+    { memcpy( buffer.data() + offset, pData, size_t( size ) ); }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      一時ファイルに書き出してから置き換えます.
+//-------------------------------------------------------------------------------------------------
+bool WriteFileAtomic( const char* filename, const std::vector<char>& buffer )
+{
+    auto tempPath = std::string( filename ) + ".tmp";
+
+    FILE* pFile = nullptr;
+#if ASDX_IS_WIN
+    if ( fopen_s( &pFile, tempPath.c_str(), "wb" ) != 0 )
+    { pFile = nullptr; }
+#else
+    pFile = fopen( tempPath.c_str(), "wb" );
+#endif
+    if ( pFile == nullptr )
+    {
+        ELOG( "Error : File Open Failed. filename = %s", tempPath.c_str() );
+        return false;
+    }
+
+    auto result = fwrite( buffer.data(), 1, buffer.size(), pFile ) == buffer.size();
+    result = ( fclose( pFile ) == 0 ) && result;
+
+    if ( !result )
+    {
+        ELOG( "Error : File Write Failed. filename = %s", tempPath.c_str() );
+        remove( tempPath.c_str() );
+        return false;
+    }
+
+    // マップ中の古いファイルは名前が外れるだけなので, 読んでいるプロセスには影響しない.
+#if ASDX_IS_WIN
+    result = MoveFileExA( tempPath.c_str(), filename, MOVEFILE_REPLACE_EXISTING ) != FALSE;
+#else
+    result = rename( tempPath.c_str(), filename ) == 0;
+#endif
+    if ( !result )
+    {
+        ELOG( "Error : File Rename Failed. filename = %s", filename );
+        remove( tempPath.c_str() );
+        return false;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// StringTable class
+///////////////////////////////////////////////////////////////////////////////////////////////////
+class StringTable
+{
+public:
+    //---------------------------------------------------------------------------------------------
+    //      文字列を追加します.
+    //---------------------------------------------------------------------------------------------
+    MeshCacheString Add( const std::string& value )
+    {
+        MeshCacheString result = {};
+        result.Offset = u32( m_Buffer.size() );
+        result.Length = u32( value.size() );
+
+        // C 文字列としても扱えるように終端文字も格納する.
+        m_Buffer.append( value );
+        m_Buffer.push_back( '\0' );
+        return result;
+    }
+
+    //---------------------------------------------------------------------------------------------
+    //      バッファを取得します.
+    //---------------------------------------------------------------------------------------------
+    const std::string& GetBuffer() const
+    { return m_Buffer; }
+
+private:
+    std::string m_Buffer;   //!< 文字列バッファです.
+};
+
+//-------------------------------------------------------------------------------------------------
+//      メッシュをキャッシュファイルのイメージに変換します.
+//-------------------------------------------------------------------------------------------------
+bool SerializeMeshCache
+(
+    const char*         filename,
+    const ResOBJ&       mesh,
+    const ResLOD*       pLods,
+    u32                 lodCount,
+    u64                 sourceSize,
+    u64                 sourceTime,
+    u64                 sourceHash,
+    std::vector<char>&  result
+)
+{
+    if ( pLods == nullptr && lodCount > 0 )
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    // SoA で格納するので, 属性は無いか頂点数と一致している必要がある.
+    auto vertexCount = mesh.Positions.size();
+    if ( ( !mesh.TexCoords.empty() && mesh.TexCoords.size() != vertexCount )
+      || ( !mesh.Normals  .empty() && mesh.Normals  .size() != vertexCount ) )
+    {
+        ELOG( "Error : Vertex Attributes Mismatch. filename = %s", filename );
+        return false;
+    }
+
+    // 読み込み時はインデックスの値を調べないので, 書き出す前に範囲内であることを保証する.
+    for( auto index : mesh.Indices )
+    {
+        if ( index >= vertexCount )
+        {
+            ELOG( "Error : Index Out Of Range. filename = %s", filename );
+            return false;
+        }
+    }
+
+    StringTable strings;
+
+    std::vector<MeshCacheSubset> subsets( mesh.Subsets.size() );
+    for( size_t i=0; i<mesh.Subsets.size(); ++i )
+    {
+        subsets[i].Name       = strings.Add( mesh.Subsets[i].Name );
+        subsets[i].Offset     = mesh.Subsets[i].Offset;
+        subsets[i].Count      = mesh.Subsets[i].Count;
+        subsets[i].MaterialId = mesh.Subsets[i].MaterialId;
+        subsets[i].Bounds     = mesh.Subsets[i].Bounds;
+        subsets[i].LodOffset  = 0;
+        subsets[i].LodCount   = 0;
+    }
+
+    // LOD はサブセット順, レベル順に並んでいる. LOD0 以外は元のインデックスの末尾に格納されている.
+    std::vector<MeshCacheLod> lods( lodCount );
+    u32 lodIndexCount = 0;
+    for( u32 i=0; i<lodCount; ++i )
+    {
+        auto& src = pLods[i];
+        if ( src.SubsetId >= subsets.size() )
+        {
+            ELOG( "Error : Invalid LOD. filename = %s", filename );
+            return false;
+        }
+
+        auto& subset = subsets[src.SubsetId];
+        if ( subset.LodCount == 0 )
+        { subset.LodOffset = i; }
+        subset.LodCount++;
+
+        lods[i].Offset = src.Offset;
+        lods[i].Count  = src.Count;
+        lods[i].Error  = src.Error;
+
+        if ( src.Level > 0 )
+        { lodIndexCount += src.Count; }
+    }
+
+    if ( lodIndexCount > mesh.Indices.size() )
+    {
+        ELOG( "Error : Invalid LOD. filename = %s", filename );
+        return false;
+    }
+
+    // MTL の変更でもキャッシュを作り直せるよう, 参照したファイルのサイズと更新日時を記録しておく.
+    std::vector<MeshCacheDependency> dependencies( mesh.Libraries.size() );
+    for( size_t i=0; i<mesh.Libraries.size(); ++i )
+    {
+        auto& dst = dependencies[i];
+        dst.Path = strings.Add( mesh.Libraries[i] );
+        if ( !GetFileInfo( mesh.Libraries[i].c_str(), dst.Size, dst.Time ) )
+        {
+            dst.Size = U64_MAX;
+            dst.Time = 0;
+        }
+    }
+
+    std::vector<MeshCacheMaterial> materials( mesh.Materials.size() );
+    for( size_t i=0; i<mesh.Materials.size(); ++i )
+    {
+        auto& src = mesh.Materials[i];
+        auto& dst = materials[i];
+
+        dst.Name        = strings.Add( src.Name );
+        dst.Ambient     = src.Ambient;
+        dst.Diffuse     = src.Diffuse;
+        dst.Specular    = src.Specular;
+        dst.Alpha       = src.Alpha;
+        dst.Power       = src.Power;
+        dst.AmbientMap  = strings.Add( src.AmbientMap );
+        dst.DiffuseMap  = strings.Add( src.DiffuseMap );
+        dst.SpecularMap = strings.Add( src.SpecularMap );
+        dst.BumpMap     = strings.Add( src.BumpMap );
+    }
+
+    MeshCacheHeader header = {};
+    header.Magic           = MESH_CACHE_MAGIC;
+    header.Version         = MESH_CACHE_VERSION;
+    header.SourceSize      = sourceSize;
+    header.SourceTime      = sourceTime;
+    header.SourceHash      = sourceHash;
+    header.VertexCount     = u32( vertexCount );
+    header.IndexCount      = u32( mesh.Indices.size() ) - lodIndexCount;
+    header.SubsetCount     = u32( subsets.size() );
+    header.MaterialCount   = u32( materials.size() );
+    header.TexCoordCount   = u32( mesh.TexCoords.size() );
+    header.NormalCount     = u32( mesh.Normals.size() );
+    header.LodCount        = lodCount;
+    header.LodIndexCount   = lodIndexCount;
+    header.DependencyCount = u32( dependencies.size() );
+
+    // 各ストリームをアライメントを揃えて並べる.
+    u64 offset = AlignUp( sizeof(header) );
+    header.PositionOffset   = offset; offset = AlignUp( offset + mesh.Positions.size() * sizeof(asdx::Vector3) );
+    header.NormalOffset     = offset; offset = AlignUp( offset + mesh.Normals  .size() * sizeof(asdx::Vector3) );
+    header.TexCoordOffset   = offset; offset = AlignUp( offset + mesh.TexCoords.size() * sizeof(asdx::Vector2) );
+    header.IndexOffset      = offset; offset = AlignUp( offset + mesh.Indices  .size() * sizeof(u32) );
+    header.SubsetOffset     = offset; offset = AlignUp( offset + subsets       .size() * sizeof(MeshCacheSubset) );
+    header.MaterialOffset   = offset; offset = AlignUp( offset + materials     .size() * sizeof(MeshCacheMaterial) );
+    header.LodOffset        = offset; offset = AlignUp( offset + lods          .size() * sizeof(MeshCacheLod) );
+    header.DependencyOffset = offset; offset = AlignUp( offset + dependencies  .size() * sizeof(MeshCacheDependency) );
+    header.StringOffset     = offset;
+    header.StringSize       = strings.GetBuffer().size();
+
+    result.assign( size_t( header.StringOffset + header.StringSize ), 0 );
+    CopyAt( result, 0,                       &header,                    sizeof(header) );
+    CopyAt( result, header.PositionOffset,   mesh.Positions.data(),      mesh.Positions.size() * sizeof(asdx::Vector3) );
+    CopyAt( result, header.NormalOffset,     mesh.Normals  .data(),      mesh.Normals  .size() * sizeof(asdx::Vector3) );
+    CopyAt( result, header.TexCoordOffset,   mesh.TexCoords.data(),      mesh.TexCoords.size() * sizeof(asdx::Vector2) );
+    CopyAt( result, header.IndexOffset,      mesh.Indices  .data(),      mesh.Indices  .size() * sizeof(u32) );
+    CopyAt( result, header.SubsetOffset,     subsets       .data(),      subsets       .size() * sizeof(MeshCacheSubset) );
+    CopyAt( result, header.MaterialOffset,   materials     .data(),      materials     .size() * sizeof(MeshCacheMaterial) );
+    CopyAt( result, header.LodOffset,        lods          .data(),      lods          .size() * sizeof(MeshCacheLod) );
+    CopyAt( result, header.DependencyOffset, dependencies  .data(),      dependencies  .size() * sizeof(MeshCacheDependency) );
+    CopyAt( result, header.StringOffset,     strings.GetBuffer().data(), header.StringSize );
+
+    return true;
+}
+
+} // namespace /* anonymous */
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// MeshCache class
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------------------------------
+//      コンストラクタです.
+//-------------------------------------------------------------------------------------------------
+MeshCache::MeshCache()
+: m_pHeader   ( nullptr )
+, m_pPositions( nullptr )
+, m_pNormals  ( nullptr )
+, m_pTexCoords( nullptr )
+, m_pIndices  ( nullptr )
+, m_pSubsets  ( nullptr )
+, m_pMaterials( nullptr )
+, m_pLods     ( nullptr )
+, m_pStrings  ( nullptr )
+{ /* DO_NOTHING */ }
+
+//-------------------------------------------------------------------------------------------------
+//      デストラクタです.
+//-------------------------------------------------------------------------------------------------
+MeshCache::~MeshCache()
+{ Close(); }
+
+//-------------------------------------------------------------------------------------------------
+//      OBJファイルに対応するキャッシュを読み込みます.
+//-------------------------------------------------------------------------------------------------
+bool MeshCache::Load( const char* filename )
+{
+    if ( filename == nullptr )
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    u64 sourceSize = 0;
+    u64 sourceTime = 0;
+    if ( !GetFileInfo( filename, sourceSize, sourceTime ) )
+    {
+        ELOG( "Error : File Not Found. filename = %s", filename );
+        return false;
+    }
+
+    auto sourceHash = HashPath( filename );
+    auto cachePath  = std::string( filename ) + ".mesh";
+
+    // 有効なキャッシュがあればそのまま使う. 初回にエラーログが出ないよう, 先に存在を確認する.
+    // 壊れたキャッシュは Open() で弾かれるので, 下で作り直される.
+    {
+        u64 cacheSize = 0;
+        u64 cacheTime = 0;
+        if ( GetFileInfo( cachePath.c_str(), cacheSize, cacheTime ) && Open( cachePath.c_str() ) )
+        {
+            if ( m_pHeader->SourceSize == sourceSize
+              && m_pHeader->SourceTime == sourceTime
+              && m_pHeader->SourceHash == sourceHash
+              && IsDependencyValid() )
+            { return true; }
+
+            Close();
+        }
+    }
+
+    // キャッシュを作り直す.
+    {
+        ResOBJ mesh;
+        if ( !LoadFromOBJ( filename, &mesh, true ) )
+        { return false; }
+
+        // 変換時に一度だけ描画順と頂点順を最適化しておく.
+        auto vertexCount = u32( mesh.Positions.size() );
+        auto indexCount  = u32( mesh.Indices.size() );
+        auto acmr = ComputeACMR( mesh.Indices.data(), indexCount, vertexCount, VERTEX_CACHE_SIZE );
+
+        OptimizeMesh( &mesh );
+
+        ILOG( "Info : Mesh optimized. ACMR = %.3f -> %.3f",
+            acmr, ComputeACMR( mesh.Indices.data(), indexCount, u32( mesh.Positions.size() ), VERTEX_CACHE_SIZE ) );
+
+        // 遠景用の LOD を生成する. インデックスは元のインデックスの末尾に追加される.
+        std::vector<ResLOD> lods;
+        BuildLODs( &mesh, lods );
+
+        ILOG( "Info : Mesh LODs built. lod count = %u, index count = %u -> %u",
+            u32( lods.size() ), indexCount, u32( mesh.Indices.size() ) );
+
+        std::vector<char> buffer;
+        if ( !SerializeMeshCache( filename, mesh, lods.data(), u32( lods.size() ), sourceSize, sourceTime, sourceHash, buffer ) )
+        { return false; }
+
+        if ( !WriteFileAtomic( cachePath.c_str(), buffer ) )
+        {
+            // 書き出せなくても描画はできるので, メモリ上のキャッシュを使う.
+            ILOG( "Info : Mesh cache not saved, using in-memory mesh. filename = %s", cachePath.c_str() );
+            m_Memory = std::move( buffer );
+            if ( !Attach( m_Memory.data(), m_Memory.size(), filename ) )
+            {
+                Close();
+                return false;
+            }
+            return true;
+        }
+
+        ILOG( "Info : Mesh cache created. filename = %s", cachePath.c_str() );
+    }
+
+    return Open( cachePath.c_str() );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      キャッシュファイルをメモリにマップします.
+//-------------------------------------------------------------------------------------------------
+bool MeshCache::Open( const char* filename )
+{
+    Close();
+
+    if ( !m_File.Open( filename ) )
+    { return false; }
+
+    if ( !Attach( m_File.GetData(), m_File.GetSize(), filename ) )
+    {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      キャッシュのデータを検証して参照します.
+//-------------------------------------------------------------------------------------------------
+bool MeshCache::Attach( const char* data, u64 size, const char* filename )
+{
+    if ( size < sizeof(MeshCacheHeader) )
+    {
+        ELOG( "Error : Invalid Mesh Cache. filename = %s", filename );
+        return false;
+    }
+
+    auto pHeader = reinterpret_cast<const MeshCacheHeader*>( data );
+    if ( pHeader->Magic != MESH_CACHE_MAGIC || pHeader->Version != MESH_CACHE_VERSION )
+    {
+        ELOG( "Error : Invalid Mesh Cache Version. filename = %s", filename );
+        return false;
+    }
+
+    // 各ストリームがファイル内に収まっているかチェック.
+    auto isValid = [&]( u64 offset, u64 count, u64 stride )
+    {
+        return ( offset % MESH_CACHE_ALIGNMENT ) == 0
+            && offset <= size
+            && count * stride <= size - offset;
+    };
+
+    if ( !isValid( pHeader->PositionOffset,   pHeader->VertexCount,     sizeof(asdx::Vector3) )
+      || !isValid( pHeader->NormalOffset,     pHeader->NormalCount,     sizeof(asdx::Vector3) )
+      || !isValid( pHeader->TexCoordOffset,   pHeader->TexCoordCount,   sizeof(asdx::Vector2) )
+      || !isValid( pHeader->IndexOffset,      u64( pHeader->IndexCount ) + pHeader->LodIndexCount, sizeof(u32) )
+      || !isValid( pHeader->SubsetOffset,     pHeader->SubsetCount,     sizeof(MeshCacheSubset) )
+      || !isValid( pHeader->MaterialOffset,   pHeader->MaterialCount,   sizeof(MeshCacheMaterial) )
+      || !isValid( pHeader->LodOffset,        pHeader->LodCount,        sizeof(MeshCacheLod) )
+      || !isValid( pHeader->DependencyOffset, pHeader->DependencyCount, sizeof(MeshCacheDependency) )
+      || !isValid( pHeader->StringOffset,     pHeader->StringSize,      1 ) )
+    {
+        ELOG( "Error : Broken Mesh Cache. filename = %s", filename );
+        return false;
+    }
+
+    // 属性は無いか頂点数と一致している.
+    if ( ( pHeader->NormalCount   != 0 && pHeader->NormalCount   != pHeader->VertexCount )
+      || ( pHeader->TexCoordCount != 0 && pHeader->TexCoordCount != pHeader->VertexCount ) )
+    {
+        ELOG( "Error : Broken Mesh Cache. filename = %s", filename );
+        return false;
+    }
+
+    // 描画時に範囲外を読まないよう, 各テーブルの範囲もチェック.
+    auto pSubsets       = reinterpret_cast<const MeshCacheSubset*>  ( data + pHeader->SubsetOffset );
+    auto pLods          = reinterpret_cast<const MeshCacheLod*>     ( data + pHeader->LodOffset );
+    auto totalIndices   = u64( pHeader->IndexCount ) + pHeader->LodIndexCount;
+
+#if defined(DEBUG) || defined(_DEBUG)
+    // インデックスの値は書き出し時に検証済み. 全ページに触れることになるので, デバッグビルドでのみ確認する.
+    auto pIndices = reinterpret_cast<const u32*>( data + pHeader->IndexOffset );
+    for( u64 i=0; i<totalIndices; ++i )
+    {
+        if ( pIndices[i] >= pHeader->VertexCount )
+        {
+            ELOG( "Error : Broken Mesh Cache. filename = %s", filename );
+            return false;
+        }
+    }
+#endif
+
+    for( u32 i=0; i<pHeader->SubsetCount; ++i )
+    {
+        auto& subset = pSubsets[i];
+        if ( u64( subset.Offset ) + subset.Count > pHeader->IndexCount
+          || u64( subset.LodOffset ) + subset.LodCount > pHeader->LodCount
+          || subset.MaterialId >= pHeader->MaterialCount )
+        {
+            ELOG( "Error : Broken Mesh Cache. filename = %s", filename );
+            return false;
+        }
+    }
+
+    for( u32 i=0; i<pHeader->LodCount; ++i )
+    {
+        if ( u64( pLods[i].Offset ) + pLods[i].Count > totalIndices )
+        {
+            ELOG( "Error : Broken Mesh Cache. filename = %s", filename );
+            return false;
+        }
+    }
+
+    m_pHeader    = pHeader;
+    m_pPositions = reinterpret_cast<const asdx::Vector3*>    ( data + pHeader->PositionOffset );
+    m_pNormals   = ( pHeader->NormalCount   > 0 ) ? reinterpret_cast<const asdx::Vector3*>( data + pHeader->NormalOffset   ) : nullptr;
+    m_pTexCoords = ( pHeader->TexCoordCount > 0 ) ? reinterpret_cast<const asdx::Vector2*>( data + pHeader->TexCoordOffset ) : nullptr;
+    m_pIndices   = reinterpret_cast<const u32*>              ( data + pHeader->IndexOffset );
+    m_pSubsets   = reinterpret_cast<const MeshCacheSubset*>  ( data + pHeader->SubsetOffset );
+    m_pMaterials = reinterpret_cast<const MeshCacheMaterial*>( data + pHeader->MaterialOffset );
+    m_pLods      = reinterpret_cast<const MeshCacheLod*>     ( data + pHeader->LodOffset );
+    m_pStrings   = data + pHeader->StringOffset;
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      参照ファイルが変換時から変更されていないかチェックします.
+//-------------------------------------------------------------------------------------------------
+bool MeshCache::IsDependencyValid() const
+{
+    auto pDependencies = reinterpret_cast<const MeshCacheDependency*>(
+        reinterpret_cast<const char*>( m_pHeader ) + m_pHeader->DependencyOffset );
+
+    for( u32 i=0; i<m_pHeader->DependencyCount; ++i )
+    {
+        auto& dependency = pDependencies[i];
+        auto  path       = std::string( GetString( dependency.Path ) );
+
+        u64 size = 0;
+        u64 time = 0;
+        if ( !GetFileInfo( path.c_str(), size, time ) )
+        {
+            size = U64_MAX;
+            time = 0;
+        }
+
+        if ( size != dependency.Size || time != dependency.Time )
+        { return false; }
+    }
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      キャッシュを閉じます.
+//-------------------------------------------------------------------------------------------------
+void MeshCache::Close()
+{
+    m_File.Close();
+    m_Memory.clear();
+    m_Memory.shrink_to_fit();
+
+    m_pHeader    = nullptr;
+    m_pPositions = nullptr;
+    m_pNormals   = nullptr;
+    m_pTexCoords = nullptr;
+    m_pIndices   = nullptr;
+    m_pSubsets   = nullptr;
+    m_pMaterials = nullptr;
+    m_pLods      = nullptr;
+    m_pStrings   = nullptr;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      頂点数を取得します.
+//-------------------------------------------------------------------------------------------------
+u32 MeshCache::GetVertexCount() const
+{ return ( m_pHeader != nullptr ) ? m_pHeader->VertexCount : 0; }
+
+//-------------------------------------------------------------------------------------------------
+//      インデックス数を取得します.
+//-------------------------------------------------------------------------------------------------
+u32 MeshCache::GetIndexCount() const
+{ return ( m_pHeader != nullptr ) ? m_pHeader->IndexCount : 0; }
+
+//-------------------------------------------------------------------------------------------------
+//      LOD のインデックス数を取得します.
+//-------------------------------------------------------------------------------------------------
+u32 MeshCache::GetLodIndexCount() const
+{ return ( m_pHeader != nullptr ) ? m_pHeader->LodIndexCount : 0; }
+
+//-------------------------------------------------------------------------------------------------
+//      サブセット数を取得します.
+//-------------------------------------------------------------------------------------------------
+u32 MeshCache::GetSubsetCount() const
+{ return ( m_pHeader != nullptr ) ? m_pHeader->SubsetCount : 0; }
+
+//-------------------------------------------------------------------------------------------------
+//      マテリアル数を取得します.
+//-------------------------------------------------------------------------------------------------
+u32 MeshCache::GetMaterialCount() const
+{ return ( m_pHeader != nullptr ) ? m_pHeader->MaterialCount : 0; }
+
+//-------------------------------------------------------------------------------------------------
+//      位置座標を取得します.
+//-------------------------------------------------------------------------------------------------
+const asdx::Vector3* MeshCache::GetPositions() const
+{ return m_pPositions; }
+
+//-------------------------------------------------------------------------------------------------
+//      法線ベクトルを取得します.
+//-------------------------------------------------------------------------------------------------
+const asdx::Vector3* MeshCache::GetNormals() const
+{ return m_pNormals; }
+
+//-------------------------------------------------------------------------------------------------
+//      テクスチャ座標を取得します.
+//-------------------------------------------------------------------------------------------------
+const asdx::Vector2* MeshCache::GetTexCoords() const
+{ return m_pTexCoords; }
+
+//-------------------------------------------------------------------------------------------------
+//      インデックスバッファを取得します.
+//-------------------------------------------------------------------------------------------------
+const u32* MeshCache::GetIndices() const
+{ return m_pIndices; }
+
+//-------------------------------------------------------------------------------------------------
+//      サブセットを取得します.
+//-------------------------------------------------------------------------------------------------
+const MeshCacheSubset& MeshCache::GetSubset( u32 index ) const
+{
+    assert( index < GetSubsetCount() );
+    return m_pSubsets[index];
+}
+
+//-------------------------------------------------------------------------------------------------
+//      マテリアルを取得します.
+//-------------------------------------------------------------------------------------------------
+const MeshCacheMaterial& MeshCache::GetMaterial( u32 index ) const
+{
+    assert( index < GetMaterialCount() );
+    return m_pMaterials[index];
+}
+
+//-------------------------------------------------------------------------------------------------
+//      LOD 数を取得します.
+//-------------------------------------------------------------------------------------------------
+u32 MeshCache::GetLodCount() const
+{ return ( m_pHeader != nullptr ) ? m_pHeader->LodCount : 0; }
+
+//-------------------------------------------------------------------------------------------------
+//      LOD を取得します.
+//-------------------------------------------------------------------------------------------------
+const MeshCacheLod& MeshCache::GetLod( u32 index ) const
+{
+    assert( index < GetLodCount() );
+    return m_pLods[index];
+}
+
+//-------------------------------------------------------------------------------------------------
+//      文字列テーブルから文字列を取得します.
+//-------------------------------------------------------------------------------------------------
+std::string_view MeshCache::GetString( const MeshCacheString& value ) const
+{
+    if ( m_pHeader == nullptr || u64( value.Offset ) + value.Length > m_pHeader->StringSize )
+    { return std::string_view(); }
+
+    return std::string_view( m_pStrings + value.Offset, value.Length );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      メッシュをキャッシュファイルに書き出します.
+//-------------------------------------------------------------------------------------------------
+bool SaveMeshCache
+(
+    const char*     filename,
+    const ResOBJ&   mesh,
+    const ResLOD*   pLods,
+    u32             lodCount,
+    u64             sourceSize,
+    u64             sourceTime,
+    u64             sourceHash
+)
+{
+    if ( filename == nullptr )
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    std::vector<char> buffer;
+    if ( !SerializeMeshCache( filename, mesh, pLods, lodCount, sourceSize, sourceTime, sourceHash, buffer ) )
+    { return false; }
+
+    return WriteFileAtomic( filename, buffer );
+}
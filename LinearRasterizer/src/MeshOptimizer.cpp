@@ -0,0 +1,424 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : MeshOptimizer.cpp
+// Desc : Mesh Optimizer Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <MeshOptimizer.h>
+#include <Obj.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+//-------------------------------------------------------------------------------------------------
+// Using Statements
+//-------------------------------------------------------------------------------------------------
+using namespace asdx;
+
+
+namespace /* anonymous */ {
+
+//-------------------------------------------------------------------------------------------------
+// Constant Values
+//-------------------------------------------------------------------------------------------------
+static constexpr u32 INVALID_INDEX       = U32_MAX;    //!< 無効な番号です.
+static constexpr u32 MAX_VALENCE         = 32;         //!< スコアテーブルで扱う最大の残り三角形数です.
+static constexpr f32 CACHE_DECAY_POWER   = 1.5f;       //!< キャッシュ位置スコアの減衰指数です.
+static constexpr f32 LAST_TRIANGLE_SCORE = 0.75f;      //!< 直前の三角形で使った頂点のスコアです.
+static constexpr f32 VALENCE_BOOST_SCALE = 2.0f;       //!< 残り三角形数スコアの係数です.
+static constexpr f32 VALENCE_BOOST_POWER = 0.5f;       //!< 残り三角形数スコアの指数です.
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// ScoreTable structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct ScoreTable
+{
+    f32 Cache  [VERTEX_CACHE_SIZE];     //!< キャッシュ位置ごとのスコアです.
+    f32 Valence[MAX_VALENCE + 1];       //!< 残り三角形数ごとのスコアです.
+
+    ScoreTable()
+    {
+        for( u32 i=0; i<VERTEX_CACHE_SIZE; ++i )
+        {
+            if ( i < 3 )
+            {
+                // 直前の三角形の頂点は, 同じ三角形を続けて出さないように固定値にする.
+                Cache[i] = LAST_TRIANGLE_SCORE;
+            }
+            else
+            {
+                auto scale = 1.0f / f32(VERTEX_CACHE_SIZE - 3);
+                Cache[i] = powf( 1.0f - f32(i - 3) * scale, CACHE_DECAY_POWER );
+            }
+        }
+
+        // 残りが少ない頂点ほど優先して片付ける.
+        Valence[0] = 0.0f;
+        for( u32 i=1; i<=MAX_VALENCE; ++i )
+        { Valence[i] = VALENCE_BOOST_SCALE * powf( f32(i), -VALENCE_BOOST_POWER ); }
+    }
+};
+
+//-------------------------------------------------------------------------------------------------
+//      頂点のスコアを求めます.
+//-------------------------------------------------------------------------------------------------
+f32 GetVertexScore( const ScoreTable& table, u32 cachePos, u32 remaining )
+{
+    if ( remaining == 0 )
+    { return -1.0f; }
+
+    auto score = table.Valence[ asdx::Min( remaining, MAX_VALENCE ) ];
+    if ( cachePos < VERTEX_CACHE_SIZE )
+    { score += table.Cache[cachePos]; }
+
+    return score;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Cluster structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct Cluster
+{
+    u32     Offset;     //!< 先頭三角形の番号です.
+    u32     Count;      //!< 三角形数です.
+    f32     Sort;       //!< ソートキーです.
+};
+
+} // namespace /* anonymous */
+
+
+//-------------------------------------------------------------------------------------------------
+//      頂点キャッシュの効率が良くなるように三角形を並べ替えます.
+//-------------------------------------------------------------------------------------------------
+void OptimizeVertexCache( u32* pIndices, u32 indexCount, u32 vertexCount )
+{
+    auto triCount = indexCount / 3;
+    if ( pIndices == nullptr || triCount == 0 || vertexCount == 0 )
+    { return; }
+
+    static const ScoreTable table;
+
+    // 頂点ごとに参照する三角形のリストを作る.
+    std::vector<u32> adjOffsets( vertexCount + 1, 0 );
+    std::vector<u32> remaining ( vertexCount, 0 );
+    for( u32 i=0; i<triCount * 3; ++i )
+    { remaining[ pIndices[i] ]++; }
+
+    for( u32 i=0; i<vertexCount; ++i )
+    { adjOffsets[i + 1] = adjOffsets[i] + remaining[i]; }
+
+    std::vector<u32> adjTriangles( triCount * 3 );
+    {
+        std::vector<u32> fill( adjOffsets.begin(), adjOffsets.end() - 1 );
+        for( u32 i=0; i<triCount * 3; ++i )
+        { adjTriangles[ fill[ pIndices[i] ]++ ] = i / 3; }
+    }
+
+    std::vector<u32>  cachePos   ( vertexCount, INVALID_INDEX );
+    std::vector<f32>  vertexScore( vertexCount );
+    for( u32 i=0; i<vertexCount; ++i )
+    { vertexScore[i] = GetVertexScore( table, INVALID_INDEX, remaining[i] ); }
+
+    std::vector<f32>  triScore( triCount );
+    std::vector<bool> emitted ( triCount, false );
+
+    auto bestTri   = INVALID_INDEX;
+    auto bestScore = -1.0f;
+    for( u32 i=0; i<triCount; ++i )
+    {
+        triScore[i] = vertexScore[ pIndices[i * 3 + 0] ]
+                    + vertexScore[ pIndices[i * 3 + 1] ]
+                    + vertexScore[ pIndices[i * 3 + 2] ];
+
+        if ( triScore[i] > bestScore )
+        {
+            bestScore = triScore[i];
+            bestTri   = i;
+        }
+    }
+
+    std::vector<u32> result( triCount * 3 );
+
+    u32 cache   [VERTEX_CACHE_SIZE + 3];
+    u32 newCache[VERTEX_CACHE_SIZE + 3];
+    u32 cacheCount = 0;
+    u32 cursor     = 0;
+
+    for( u32 i=0; i<triCount; ++i )
+    {
+        // キャッシュ内に候補が無い場合は, 未出力の三角形を先頭から探す.
+        if ( bestTri == INVALID_INDEX )
+        {
+            while( emitted[cursor] )
+            { cursor++; }
+
+            bestTri = cursor;
+        }
+
+        auto tri = &pIndices[bestTri * 3];
+        result[i * 3 + 0] = tri[0];
+        result[i * 3 + 1] = tri[1];
+        result[i * 3 + 2] = tri[2];
+        emitted[bestTri] = true;
+
+        // 出力した三角形を隣接リストから外す.
+        u32 newCount = 0;
+        for( u32 j=0; j<3; ++j )
+        {
+            auto v     = tri[j];
+            auto begin = adjOffsets[v];
+            auto end   = begin + remaining[v];
+            for( auto k=begin; k<end; ++k )
+            {
+                if ( adjTriangles[k] == bestTri )
+                {
+                    adjTriangles[k] = adjTriangles[end - 1];
+                    remaining[v]--;
+                    break;
+                }
+            }
+
+            // 縮退三角形で同じ頂点が重複しないようにする.
+            if ( std::find( newCache, newCache + newCount, v ) == newCache + newCount )
+            { newCache[newCount++] = v; }
+        }
+
+        // LRU キャッシュを更新.
+        for( u32 j=0; j<cacheCount; ++j )
+        {
+            auto v = cache[j];
+            if ( v != tri[0] && v != tri[1] && v != tri[2] )
+            { newCache[newCount++] = v; }
+        }
+
+        // キャッシュに関わる頂点と三角形のスコアを更新.
+        for( u32 j=0; j<newCount; ++j )
+        {
+            auto v = newCache[j];
+            cachePos[v]    = ( j < VERTEX_CACHE_SIZE ) ? j : INVALID_INDEX;
+            vertexScore[v] = GetVertexScore( table, cachePos[v], remaining[v] );
+        }
+
+        bestTri   = INVALID_INDEX;
+        bestScore = -1.0f;
+        for( u32 j=0; j<newCount; ++j )
+        {
+            auto v     = newCache[j];
+            auto begin = adjOffsets[v];
+            auto end   = begin + remaining[v];
+            for( auto k=begin; k<end; ++k )
+            {
+                auto t = adjTriangles[k];
+                triScore[t] = vertexScore[ pIndices[t * 3 + 0] ]
+                            + vertexScore[ pIndices[t * 3 + 1] ]
+                            + vertexScore[ pIndices[t * 3 + 2] ];
+
+                if ( triScore[t] > bestScore )
+                {
+                    bestScore = triScore[t];
+                    bestTri   = t;
+                }
+            }
+        }
+
+        cacheCount = asdx::Min( newCount, VERTEX_CACHE_SIZE );
+        std::copy( newCache, newCache + cacheCount, cache );
+    }
+
+    std::copy( result.begin(), result.end(), pIndices );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      オーバードローが少なくなるように三角形のクラスタを並べ替えます.
+//-------------------------------------------------------------------------------------------------
+void OptimizeOverdraw( u32* pIndices, u32 indexCount, const Vector3* pPositions, u32 vertexCount )
+{
+    auto triCount = indexCount / 3;
+    if ( pIndices == nullptr || pPositions == nullptr || triCount == 0 || vertexCount == 0 )
+    { return; }
+
+    // FIFO キャッシュを模擬して, 3頂点とも外れる位置をクラスタの境界とする.
+    std::vector<Cluster> clusters;
+    {
+        std::vector<u32> timestamps( vertexCount, 0 );
+        u32 timestamp = VERTEX_CACHE_SIZE + 1;
+
+        for( u32 i=0; i<triCount; ++i )
+        {
+            u32 misses = 0;
+            for( u32 j=0; j<3; ++j )
+            {
+                auto v = pIndices[i * 3 + j];
+                if ( timestamp - timestamps[v] > VERTEX_CACHE_SIZE )
+                {
+                    timestamps[v] = timestamp++;
+                    misses++;
+                }
+            }
+
+            if ( clusters.empty() || misses == 3 )
+            { clusters.push_back( { i, 0, 0.0f } ); }
+
+            clusters.back().Count++;
+        }
+    }
+
+    if ( clusters.size() <= 1 )
+    { return; }
+
+    // 面積で重み付けしたメッシュ中心とクラスタごとの中心・法線を求める.
+    auto meshCenter = Vector3( 0.0f, 0.0f, 0.0f );
+    auto meshArea   = 0.0f;
+
+    std::vector<Vector3> clusterCenters( clusters.size() );
+    std::vector<Vector3> clusterNormals( clusters.size() );
+
+    for( size_t i=0; i<clusters.size(); ++i )
+    {
+        auto center = Vector3( 0.0f, 0.0f, 0.0f );
+        auto normal = Vector3( 0.0f, 0.0f, 0.0f );
+        auto area   = 0.0f;
+
+        for( u32 j=0; j<clusters[i].Count; ++j )
+        {
+            auto tri = &pIndices[( clusters[i].Offset + j ) * 3];
+            auto& p0 = pPositions[tri[0]];
+            auto& p1 = pPositions[tri[1]];
+            auto& p2 = pPositions[tri[2]];
+
+            auto n = Vector3::Cross( p1 - p0, p2 - p0 );
+            auto a = n.Length();
+
+            center += ( p0 + p1 + p2 ) * ( a / 3.0f );
+            normal += n;
+            area   += a;
+        }
+
+        meshCenter += center;
+        meshArea   += area;
+
+        clusterCenters[i] = ( area > 0.0f ) ? center / area : center;
+        clusterNormals[i] = normal;
+    }
+
+    if ( meshArea > 0.0f )
+    { meshCenter /= meshArea; }
+
+    // メッシュ中心から外側を向いているクラスタほど他を隠しやすいので先に描画する.
+    for( size_t i=0; i<clusters.size(); ++i )
+    {
+        auto length = clusterNormals[i].Length();
+        clusters[i].Sort = ( length > 0.0f )
+            ? Vector3::Dot( clusterCenters[i] - meshCenter, clusterNormals[i] ) / length
+            : 0.0f;
+    }
+
+    std::stable_sort( clusters.begin(), clusters.end(),
+        []( const Cluster& lhs, const Cluster& rhs )
+        { return lhs.Sort > rhs.Sort; } );
+
+    std::vector<u32> result;
+    result.reserve( triCount * 3 );
+    for( auto& cluster : clusters )
+    {
+        result.insert( result.end(),
+            pIndices + cluster.Offset * 3,
+            pIndices + ( cluster.Offset + cluster.Count ) * 3 );
+    }
+
+    std::copy( result.begin(), result.end(), pIndices );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      平均キャッシュミス率 (ACMR) を求めます.
+//-------------------------------------------------------------------------------------------------
+f32 ComputeACMR( const u32* pIndices, u32 indexCount, u32 vertexCount, u32 cacheSize )
+{
+    auto triCount = indexCount / 3;
+    if ( pIndices == nullptr || triCount == 0 || vertexCount == 0 )
+    { return 0.0f; }
+
+    std::vector<u32> timestamps( vertexCount, 0 );
+    u32 timestamp = cacheSize + 1;
+    u32 misses    = 0;
+
+    for( u32 i=0; i<triCount * 3; ++i )
+    {
+        auto v = pIndices[i];
+        if ( timestamp - timestamps[v] > cacheSize )
+        {
+            timestamps[v] = timestamp++;
+            misses++;
+        }
+    }
+
+    return f32(misses) / f32(triCount);
+}
+
+//-------------------------------------------------------------------------------------------------
+//      メッシュを最適化します.
+//-------------------------------------------------------------------------------------------------
+void OptimizeMesh( ResOBJ* pMesh )
+{
+    if ( pMesh == nullptr || pMesh->Indices.empty() )
+    { return; }
+
+    auto vertexCount = u32( pMesh->Positions.size() );
+
+    // サブセットをまたがないように並べ替える.
+    for( auto& subset : pMesh->Subsets )
+    {
+        auto pIndices = pMesh->Indices.data() + subset.Offset;
+        auto count    = subset.Count - subset.Count % 3;
+
+        OptimizeVertexCache( pIndices, count, vertexCount );
+        OptimizeOverdraw   ( pIndices, count, pMesh->Positions.data(), vertexCount );
+    }
+
+    // 頂点を初めて参照される順に並べ替える. 参照されない頂点は取り除く.
+    std::vector<u32> remap( vertexCount, INVALID_INDEX );
+    u32 newCount = 0;
+    for( auto& index : pMesh->Indices )
+    {
+        if ( remap[index] == INVALID_INDEX )
+        { remap[index] = newCount++; }
+
+        index = remap[index];
+    }
+
+    std::vector<Vector3> positions( newCount );
+    for( u32 i=0; i<vertexCount; ++i )
+    {
+        if ( remap[i] != INVALID_INDEX )
+        { positions[remap[i]] = pMesh->Positions[i]; }
+    }
+    pMesh->Positions.swap( positions );
+
+    if ( pMesh->TexCoords.size() == vertexCount )
+    {
+        std::vector<Vector2> texcoords( newCount );
+        for( u32 i=0; i<vertexCount; ++i )
+        {
+            if ( remap[i] != INVALID_INDEX )
+            { texcoords[remap[i]] = pMesh->TexCoords[i]; }
+        }
+        pMesh->TexCoords.swap( texcoords );
+    }
+
+    if ( pMesh->Normals.size() == vertexCount )
+    {
+        std::vector<Vector3> normals( newCount );
+        for( u32 i=0; i<vertexCount; ++i )
+        {
+            if ( remap[i] != INVALID_INDEX )
+            { normals[remap[i]] = pMesh->Normals[i]; }
+        }
+        pMesh->Normals.swap( normals );
+    }
+}
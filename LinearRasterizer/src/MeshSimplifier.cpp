@@ -0,0 +1,527 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : MeshSimplifier.cpp
+// Desc : Mesh Simplifier Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <MeshSimplifier.h>
+#include <MeshOptimizer.h>
+#include <Obj.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+//-------------------------------------------------------------------------------------------------
+// Using Statements
+//-------------------------------------------------------------------------------------------------
+using namespace asdx;
+
+
+namespace /* anonymous */ {
+
+//-------------------------------------------------------------------------------------------------
+// Constant Values
+//-------------------------------------------------------------------------------------------------
+static constexpr u32 INVALID_INDEX      = U32_MAX;  //!< 無効な番号です.
+static constexpr f32 MIN_LOD_REDUCTION  = 0.9f;     //!< 1 つ前の LOD に対して必要な三角形数の割合です.
+static constexpr f32 MIN_NORMAL_DOT     = 0.2f;     //!< 縮約後の面法線が元の面法線となす角の余弦の下限です.
+static constexpr f32 MAX_LOD_ERROR_RATIO = 0.05f;   //!< バウンディングボックスの対角線長に対する LOD の誤差の上限です.
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Quadric structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct Quadric
+{
+    f64 A00, A11, A22;      //!< 対称行列の対角成分です.
+    f64 A01, A02, A12;      //!< 対称行列の非対角成分です.
+    f64 B0,  B1,  B2;       //!< 1 次の項です.
+    f64 C;                  //!< 定数項です.
+    f64 Weight;             //!< 面積の合計です.
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      平面を加えます.
+    //---------------------------------------------------------------------------------------------
+    void AddPlane( f64 nx, f64 ny, f64 nz, f64 d, f64 weight )
+    {
+        A00 += weight * nx * nx;
+        A11 += weight * ny * ny;
+        A22 += weight * nz * nz;
+        A01 += weight * nx * ny;
+        A02 += weight * nx * nz;
+        A12 += weight * ny * nz;
+        B0  += weight * nx * d;
+        B1  += weight * ny * d;
+        B2  += weight * nz * d;
+        C   += weight * d  * d;
+        Weight += weight;
+    }
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      二次誤差行列を加えます.
+    //---------------------------------------------------------------------------------------------
+    void Add( const Quadric& value )
+    {
+        A00 += value.A00; A11 += value.A11; A22 += value.A22;
+        A01 += value.A01; A02 += value.A02; A12 += value.A12;
+        B0  += value.B0;  B1  += value.B1;  B2  += value.B2;
+        C   += value.C;
+        Weight += value.Weight;
+    }
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      位置の誤差 (平面までの距離の 2 乗の面積平均) を求めます.
+    //---------------------------------------------------------------------------------------------
+    f64 Evaluate( const Vector3& p ) const
+    {
+        f64 x = p.x;
+        f64 y = p.y;
+        f64 z = p.z;
+
+        auto error = A00 * x * x + A11 * y * y + A22 * z * z
+                   + 2.0 * ( A01 * x * y + A02 * x * z + A12 * y * z )
+                   + 2.0 * ( B0 * x + B1 * y + B2 * z )
+                   + C;
+
+        return ( Weight > 0.0 ) ? asdx::Max( error, 0.0 ) / Weight : 0.0;
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Collapse structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct Collapse
+{
+    u32     From;       //!< 取り除く頂点です.
+    u32     To;         //!< 縮約先の頂点です.
+    f64     Cost;       //!< 縮約による誤差です.
+};
+
+//-------------------------------------------------------------------------------------------------
+//      位置が同じ頂点に同じグループ番号を割り当てます.
+//-------------------------------------------------------------------------------------------------
+u32 BuildPositionGroups( const std::vector<Vector3>& positions, std::vector<u32>& groups )
+{
+    auto count = u32( positions.size() );
+
+    std::vector<u32> order( count );
+    for( u32 i=0; i<count; ++i )
+    { order[i] = i; }
+
+    auto less = [&]( u32 lhs, u32 rhs )
+    {
+        auto& a = positions[lhs];
+        auto& b = positions[rhs];
+        if ( a.x != b.x ) { return a.x < b.x; }
+        if ( a.y != b.y ) { return a.y < b.y; }
+        return a.z < b.z;
+    };
+
+    std::sort( order.begin(), order.end(), less );
+
+    groups.resize( count );
+    u32 groupCount = 0;
+    for( u32 i=0; i<count; ++i )
+    {
+        if ( i > 0 && less( order[i - 1], order[i] ) )
+        { groupCount++; }
+
+        groups[order[i]] = groupCount;
+    }
+
+    return ( count > 0 ) ? groupCount + 1 : 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      動かしてはいけない頂点を求めます.
+//-------------------------------------------------------------------------------------------------
+void FindLockedVertices
+(
+    const std::vector<u32>& indices,
+    const std::vector<u32>& groups,
+    u32                     groupCount,
+    std::vector<bool>&      locked
+)
+{
+    auto vertexCount = u32( groups.size() );
+    locked.assign( vertexCount, false );
+
+    // 位置を共有する頂点は属性の継ぎ目なので固定する.
+    std::vector<u32> groupSizes( groupCount, 0 );
+    for( u32 i=0; i<vertexCount; ++i )
+    { groupSizes[groups[i]]++; }
+
+    for( u32 i=0; i<vertexCount; ++i )
+    { locked[i] = ( groupSizes[groups[i]] > 1 ); }
+
+    // 2 枚の三角形で共有されていない辺は境界か非多様体なので, 両端を固定する.
+    struct Edge
+    {
+        u64 Key;
+        u32 V0;
+        u32 V1;
+    };
+
+    std::vector<Edge> edges;
+    edges.reserve( indices.size() );
+    for( size_t i=0; i<indices.size(); i+=3 )
+    {
+        for( u32 j=0; j<3; ++j )
+        {
+            auto v0 = indices[i + j];
+            auto v1 = indices[i + ( j + 1 ) % 3];
+            auto g0 = u64( groups[v0] );
+            auto g1 = u64( groups[v1] );
+            auto key = ( g0 < g1 ) ? ( g0 << 32 ) | g1 : ( g1 << 32 ) | g0;
+            edges.push_back( { key, v0, v1 } );
+        }
+    }
+
+    std::sort( edges.begin(), edges.end(),
+        []( const Edge& lhs, const Edge& rhs )
+        { return lhs.Key < rhs.Key; } );
+
+    size_t begin = 0;
+    while( begin < edges.size() )
+    {
+        auto end = begin + 1;
+        while( end < edges.size() && edges[end].Key == edges[begin].Key )
+        { end++; }
+
+        if ( end - begin != 2 )
+        {
+            for( auto i=begin; i<end; ++i )
+            {
+                locked[edges[i].V0] = true;
+                locked[edges[i].V1] = true;
+            }
+        }
+
+        begin = end;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      頂点を移動しても周囲の三角形が裏返らないか判定します.
+//-------------------------------------------------------------------------------------------------
+bool IsCollapseValid
+(
+    const std::vector<Vector3>& positions,
+    const std::vector<u32>&     indices,
+    const std::vector<Vector3>& normals,
+    const u32*                  pAdjacency,
+    u32                         adjacencyCount,
+    u32                         from,
+    u32                         to
+)
+{
+    for( u32 i=0; i<adjacencyCount; ++i )
+    {
+        auto tri = &indices[pAdjacency[i] * 3];
+        if ( tri[0] == to || tri[1] == to || tri[2] == to )
+        { continue; }   // 縮約で消える三角形.
+
+        // 取り除く頂点が先頭になるように巡回させる.
+        auto k  = ( tri[0] == from ) ? 0 : ( tri[1] == from ) ? 1 : 2;
+        auto& p1 = positions[tri[( k + 1 ) % 3]];
+        auto& p2 = positions[tri[( k + 2 ) % 3]];
+
+        auto n1 = Vector3::Cross( p1 - positions[to], p2 - positions[to] );
+        auto l1 = n1.Length();
+        if ( l1 <= 0.0f )
+        { return false; }
+
+        // パスをまたいで回転が積み重ならないように, 縮約前ではなく元の面法線と比べる.
+        auto& n0 = normals[pAdjacency[i]];
+        if ( n0.x == 0.0f && n0.y == 0.0f && n0.z == 0.0f )
+        { continue; }   // 元から縮退している三角形.
+
+        if ( Vector3::Dot( n0, n1 ) < MIN_NORMAL_DOT * l1 )
+        { return false; }
+    }
+
+    return true;
+}
+
+} // namespace /* anonymous */
+
+
+//-------------------------------------------------------------------------------------------------
+//      三角形リストを簡略化します.
+//-------------------------------------------------------------------------------------------------
+f32 SimplifyMesh
+(
+    const Vector3*      pPositions,
+    u32                 vertexCount,
+    const u32*          pIndices,
+    u32                 indexCount,
+    u32                 targetIndexCount,
+    std::vector<u32>&   result
+)
+{
+    result.clear();
+    indexCount -= indexCount % 3;
+    if ( pPositions == nullptr || pIndices == nullptr || indexCount == 0 || vertexCount == 0 )
+    { return 0.0f; }
+
+    // 参照される頂点だけを詰めた局所的な番号に振り直す.
+    std::vector<u32>     remap( vertexCount, INVALID_INDEX );
+    std::vector<u32>     globals;
+    std::vector<Vector3> positions;
+    std::vector<u32>     indices( indexCount );
+    for( u32 i=0; i<indexCount; ++i )
+    {
+        auto index = pIndices[i];
+        if ( remap[index] == INVALID_INDEX )
+        {
+            remap[index] = u32( globals.size() );
+            globals  .push_back( index );
+            positions.push_back( pPositions[index] );
+        }
+
+        indices[i] = remap[index];
+    }
+
+    auto localCount = u32( globals.size() );
+
+    std::vector<u32> groups;
+    auto groupCount = BuildPositionGroups( positions, groups );
+
+    std::vector<bool> locked;
+    FindLockedVertices( indices, groups, groupCount, locked );
+
+    // 面積で重み付けした平面の二次誤差行列を頂点ごとに集める.
+    // 三角形ごとの元の面法線も, 裏返りの判定のために保持しておく.
+    std::vector<Quadric> quadrics( localCount, Quadric() );
+    std::vector<Vector3> normals ( indexCount / 3, Vector3( 0.0f, 0.0f, 0.0f ) );
+    for( u32 i=0; i<indexCount; i+=3 )
+    {
+        auto& p0 = positions[indices[i + 0]];
+        auto& p1 = positions[indices[i + 1]];
+        auto& p2 = positions[indices[i + 2]];
+
+        auto n = Vector3::Cross( p1 - p0, p2 - p0 );
+        auto l = n.Length();
+        if ( l <= 0.0f )
+        { continue; }
+
+        normals[i / 3] = n / l;
+
+        f64 nx = n.x / l;
+        f64 ny = n.y / l;
+        f64 nz = n.z / l;
+        f64 d  = -( nx * p0.x + ny * p0.y + nz * p0.z );
+
+        Quadric q = {};
+        q.AddPlane( nx, ny, nz, d, l * 0.5 );
+        for( u32 j=0; j<3; ++j )
+        { quadrics[indices[i + j]].Add( q ); }
+    }
+
+    std::vector<u32>      adjOffsets;
+    std::vector<u32>      adjTriangles;
+    std::vector<Collapse> collapses;
+    std::vector<u32>      collapseTo( localCount );
+    std::vector<bool>     touched;
+
+    f64 maxError = 0.0;
+
+    while( indices.size() > targetIndexCount )
+    {
+        auto triCount = u32( indices.size() / 3 );
+
+        // 頂点ごとに参照する三角形のリストを作る.
+        adjOffsets.assign( localCount + 1, 0 );
+        for( auto index : indices )
+        { adjOffsets[index + 1]++; }
+
+        for( u32 i=0; i<localCount; ++i )
+        { adjOffsets[i + 1] += adjOffsets[i]; }
+
+        adjTriangles.resize( indices.size() );
+        {
+            std::vector<u32> fill( adjOffsets.begin(), adjOffsets.end() - 1 );
+            for( u32 i=0; i<u32( indices.size() ); ++i )
+            { adjTriangles[ fill[ indices[i] ]++ ] = i / 3; }
+        }
+
+        // 辺ごとに誤差の小さい向きの縮約を候補にする.
+        // 境界辺は両端が固定されているので, 内部の辺だけを片方向から数えればよい.
+        collapses.clear();
+        for( u32 i=0; i<triCount; ++i )
+        {
+            for( u32 j=0; j<3; ++j )
+            {
+                auto v0 = indices[i * 3 + j];
+                auto v1 = indices[i * 3 + ( j + 1 ) % 3];
+                if ( v0 > v1 || ( locked[v0] && locked[v1] ) )
+                { continue; }
+
+                auto q = quadrics[v0];
+                q.Add( quadrics[v1] );
+
+                if ( locked[v0] )
+                { collapses.push_back( { v1, v0, q.Evaluate( positions[v0] ) } ); }
+                else if ( locked[v1] )
+                { collapses.push_back( { v0, v1, q.Evaluate( positions[v1] ) } ); }
+                else
+                {
+                    auto c0 = q.Evaluate( positions[v1] );
+                    auto c1 = q.Evaluate( positions[v0] );
+                    if ( c0 <= c1 )
+                    { collapses.push_back( { v0, v1, c0 } ); }
+                    else
+                    { collapses.push_back( { v1, v0, c1 } ); }
+                }
+            }
+        }
+
+        if ( collapses.empty() )
+        { break; }
+
+        std::sort( collapses.begin(), collapses.end(),
+            []( const Collapse& lhs, const Collapse& rhs )
+            { return lhs.Cost < rhs.Cost; } );
+
+        // 1 回の縮約で概ね 2 枚の三角形が消えるので, 目標を超えないように上限を決める.
+        auto limit = ( triCount - targetIndexCount / 3 ) / 2 + 1;
+
+        for( u32 i=0; i<localCount; ++i )
+        { collapseTo[i] = i; }
+
+        touched.assign( localCount, false );
+
+        u32 collapseCount = 0;
+        for( auto& collapse : collapses )
+        {
+            if ( collapseCount >= limit )
+            { break; }
+
+            // 同じパスで周囲が変化した頂点は誤差が古いので次のパスに回す.
+            if ( touched[collapse.From] || touched[collapse.To] )
+            { continue; }
+
+            auto pAdjacency     = &adjTriangles[adjOffsets[collapse.From]];
+            auto adjacencyCount = adjOffsets[collapse.From + 1] - adjOffsets[collapse.From];
+            if ( !IsCollapseValid( positions, indices, normals, pAdjacency, adjacencyCount, collapse.From, collapse.To ) )
+            { continue; }
+
+            collapseTo[collapse.From] = collapse.To;
+            quadrics[collapse.To].Add( quadrics[collapse.From] );
+            maxError = asdx::Max( maxError, collapse.Cost );
+
+            for( auto v : { collapse.From, collapse.To } )
+            {
+                for( auto k=adjOffsets[v]; k<adjOffsets[v + 1]; ++k )
+                {
+                    auto tri = &indices[adjTriangles[k] * 3];
+                    touched[tri[0]] = true;
+                    touched[tri[1]] = true;
+                    touched[tri[2]] = true;
+                }
+            }
+
+            collapseCount++;
+        }
+
+        if ( collapseCount == 0 )
+        { break; }
+
+        // 縮約を反映して, 縮退した三角形を取り除く.
+        size_t writeIndex = 0;
+        for( size_t i=0; i<indices.size(); i+=3 )
+        {
+            auto i0 = collapseTo[indices[i + 0]];
+            auto i1 = collapseTo[indices[i + 1]];
+            auto i2 = collapseTo[indices[i + 2]];
+            if ( i0 == i1 || i1 == i2 || i2 == i0 )
+            { continue; }
+
+            indices[writeIndex + 0] = i0;
+            indices[writeIndex + 1] = i1;
+            indices[writeIndex + 2] = i2;
+            normals[writeIndex / 3] = normals[i / 3];
+            writeIndex += 3;
+        }
+
+        indices.resize( writeIndex );
+        normals.resize( writeIndex / 3 );
+    }
+
+    result.resize( indices.size() );
+    for( size_t i=0; i<indices.size(); ++i )
+    { result[i] = globals[indices[i]]; }
+
+    return f32( sqrt( maxError ) );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      サブセットごとに LOD を生成します.
+//-------------------------------------------------------------------------------------------------
+void BuildLODs( ResOBJ* pMesh, std::vector<ResLOD>& lods )
+{
+    lods.clear();
+    if ( pMesh == nullptr || pMesh->Indices.empty() )
+    { return; }
+
+    auto vertexCount = u32( pMesh->Positions.size() );
+
+    std::vector<u32> lodIndices;
+    std::vector<u32> simplified;
+
+    for( u32 i=0; i<u32( pMesh->Subsets.size() ); ++i )
+    {
+        auto& subset = pMesh->Subsets[i];
+        auto  count  = subset.Count - subset.Count % 3;
+
+        lods.push_back( { i, 0, subset.Offset, subset.Count, 0.0f } );
+
+        // 形状が崩れた LOD を出力しないように, 誤差の上限をサブセットの大きさから決める.
+        auto maxError = ( subset.Bounds.Maxi - subset.Bounds.Mini ).Length() * MAX_LOD_ERROR_RATIO;
+
+        // 誤差が積み重ならないように, 各レベルとも元のメッシュから簡略化する.
+        auto prevCount = count;
+        for( u32 level=1; level<MAX_LOD_COUNT; ++level )
+        {
+            auto target = ( ( count >> level ) / 3 ) * 3;
+            if ( target < MIN_LOD_TRIANGLES * 3 )
+            { break; }
+
+            auto error = SimplifyMesh(
+                pMesh->Positions.data(),
+                vertexCount,
+                pMesh->Indices.data() + subset.Offset,
+                count,
+                target,
+                simplified );
+
+            auto lodCount = u32( simplified.size() );
+            if ( lodCount == 0 || f32(lodCount) > f32(prevCount) * MIN_LOD_REDUCTION )
+            { break; }
+
+            if ( error > maxError )
+            { break; }
+
+            OptimizeVertexCache( simplified.data(), lodCount, vertexCount );
+
+            // オフセットは後で元のインデックスの末尾からの位置に直す.
+            lods.push_back( { i, level, u32( lodIndices.size() ), lodCount, error } );
+            lodIndices.insert( lodIndices.end(), simplified.begin(), simplified.end() );
+
+            prevCount = lodCount;
+        }
+    }
+
+    auto baseCount = u32( pMesh->Indices.size() );
+    for( auto& lod : lods )
+    {
+        if ( lod.Level > 0 )
+        { lod.Offset += baseCount; }
+    }
+
+    pMesh->Indices.insert( pMesh->Indices.end(), lodIndices.begin(), lodIndices.end() );
+}
@@ -0,0 +1,388 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : Meshlet.cpp
+// Desc : Meshlet Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <Meshlet.h>
+#include <algorithm>
+#include <cmath>
+
+
+//-------------------------------------------------------------------------------------------------
+// Using Statements
+//-------------------------------------------------------------------------------------------------
+using namespace asdx;
+
+
+namespace /* anonymous */ {
+
+//-------------------------------------------------------------------------------------------------
+//      平面を正規化します.
+//-------------------------------------------------------------------------------------------------
+Vector4 NormalizePlane( f32 a, f32 b, f32 c, f32 d )
+{
+    auto length = sqrtf( a * a + b * b + c * c );
+    if ( length > 0.0f )
+    { return Vector4( a / length, b / length, c / length, d / length ); }
+
+    return Vector4( a, b, c, d );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      メッシュレットのバウンディングスフィアと法線コーンを求めます.
+//-------------------------------------------------------------------------------------------------
+void ComputeMeshletBounds( const Vector3* pPositions, const u32* pIndices, u32 offset, u32 count, Meshlet& meshlet )
+{
+    auto pBegin = pIndices + offset;
+    auto pEnd   = pBegin + count;
+
+    // Ritter の方法で近似的な最小包含球を求める.
+    auto& first = pPositions[*pBegin];
+    auto  mini  = first;
+    auto  maxi  = first;
+    for( auto pIndex = pBegin; pIndex != pEnd; ++pIndex )
+    {
+        auto& p = pPositions[*pIndex];
+        mini = Vector3::Min( mini, p );
+        maxi = Vector3::Max( maxi, p );
+    }
+
+    auto center = ( mini + maxi ) * 0.5f;
+    auto radius = 0.0f;
+    for( auto pIndex = pBegin; pIndex != pEnd; ++pIndex )
+    {
+        auto& p    = pPositions[*pIndex];
+        auto  dist = ( p - center ).Length();
+        if ( dist > radius )
+        {
+            // 点を含むように球を広げる.
+            auto newRadius = ( radius + dist ) * 0.5f;
+            center += ( p - center ) * ( ( newRadius - radius ) / dist );
+            radius  = newRadius;
+        }
+    }
+
+    meshlet.Center = center;
+    meshlet.Radius = radius;
+
+    // 法線コーンの軸は三角形の法線の平均とする.
+    auto axis  = Vector3( 0.0f, 0.0f, 0.0f );
+    auto valid = 0u;
+    for( auto pIndex = pBegin; pIndex + 2 < pEnd; pIndex += 3 )
+    {
+        auto& p0 = pPositions[pIndex[0]];
+        auto& p1 = pPositions[pIndex[1]];
+        auto& p2 = pPositions[pIndex[2]];
+
+        auto n = Vector3::Cross( p1 - p0, p2 - p0 );
+        auto l = n.Length();
+        if ( l <= 0.0f )
+        { continue; }
+
+        axis += n / l;
+        valid++;
+    }
+
+    meshlet.ConeAxis   = Vector3( 0.0f, 0.0f, 1.0f );
+    meshlet.ConeCutoff = 1.0f;
+
+    auto axisLength = axis.Length();
+    if ( valid == 0 || axisLength <= 0.0f )
+    { return; }
+
+    axis /= axisLength;
+
+    auto minDot = 1.0f;
+    for( auto pIndex = pBegin; pIndex + 2 < pEnd; pIndex += 3 )
+    {
+        auto& p0 = pPositions[pIndex[0]];
+        auto& p1 = pPositions[pIndex[1]];
+        auto& p2 = pPositions[pIndex[2]];
+
+        auto n = Vector3::Cross( p1 - p0, p2 - p0 );
+        auto l = n.Length();
+        if ( l <= 0.0f )
+        { continue; }
+
+        minDot = Min( minDot, Vector3::Dot( axis, n / l ) );
+    }
+
+    meshlet.ConeAxis = axis;
+
+    // 半球以上に広がる場合は背面カリングできない.
+    if ( minDot > 0.0f )
+    { meshlet.ConeCutoff = sqrtf( 1.0f - minDot * minDot ); }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      メッシュレットを追加します.
+//-------------------------------------------------------------------------------------------------
+void AppendMeshlet
+(
+    const Vector3*          pPositions,
+    const u32*              pIndices,
+    u32                     offset,
+    u32                     count,
+    u32                     materialId,
+    std::vector<Meshlet>&   meshlets,
+    std::vector<u32>&       vertices,
+    std::vector<u8>&        indices
+)
+{
+    if ( count == 0 )
+    { return; }
+
+    Meshlet meshlet = {};
+    meshlet.Offset       = u32( indices.size() );
+    meshlet.Count        = count;
+    meshlet.VertexOffset = u32( vertices.size() );
+    meshlet.MaterialId   = materialId;
+    ComputeMeshletBounds( pPositions, pIndices, offset, count, meshlet );
+
+    // 頂点番号を初出順に並べ, インデックスをリスト内の番号に置き換える.
+    for( auto i=offset; i<offset + count; ++i )
+    {
+        auto pBegin = vertices.data() + meshlet.VertexOffset;
+        auto pEnd   = vertices.data() + vertices.size();
+        auto pFound = std::find( pBegin, pEnd, pIndices[i] );
+        if ( pFound == pEnd )
+        { vertices.push_back( pIndices[i] ); }
+
+        indices.push_back( u8( pFound - pBegin ) );
+    }
+
+    meshlet.VertexCount = u32( vertices.size() ) - meshlet.VertexOffset;
+    meshlets.push_back( meshlet );
+}
+
+} // namespace /* anonymous */
+
+
+//-------------------------------------------------------------------------------------------------
+//      三角形リストをメッシュレットに分割します.
+//-------------------------------------------------------------------------------------------------
+void BuildMeshlets
+(
+    const Vector3*          pPositions,
+    const u32*              pIndices,
+    u32                     offset,
+    u32                     count,
+    u32                     materialId,
+    std::vector<Meshlet>&   meshlets,
+    std::vector<u32>&       vertices,
+    std::vector<u8>&        indices
+)
+{
+    if ( pPositions == nullptr || pIndices == nullptr )
+    { return; }
+
+    static_assert( MESHLET_MAX_VERTICES <= 256, "Local indices must fit in u8." );
+
+    u32 unique[MESHLET_MAX_VERTICES];
+    u32 vertexCount   = 0;
+    u32 triangleCount = 0;
+    u32 begin         = offset;
+
+    auto end = offset + count - count % 3;
+    for( auto i=offset; i<end; i += 3 )
+    {
+        // この三角形で新しく増える頂点を数える.
+        u32 added[3];
+        u32 addedCount = 0;
+        for( u32 j=0; j<3; ++j )
+        {
+            auto v = pIndices[i + j];
+            if ( std::find( unique, unique + vertexCount, v ) != unique + vertexCount )
+            { continue; }
+
+            if ( std::find( added, added + addedCount, v ) != added + addedCount )
+            { continue; }
+
+            added[addedCount++] = v;
+        }
+
+        // 上限を超える場合は, ここで区切る.
+        if ( vertexCount + addedCount > MESHLET_MAX_VERTICES || triangleCount == MESHLET_MAX_TRIANGLES )
+        {
+            AppendMeshlet( pPositions, pIndices, begin, i - begin, materialId, meshlets, vertices, indices );
+
+            begin         = i;
+            vertexCount   = 0;
+            triangleCount = 0;
+
+            // 区切った後は全ての頂点が新しく増える.
+            addedCount = 0;
+            for( u32 j=0; j<3; ++j )
+            {
+                auto v = pIndices[i + j];
+                if ( std::find( added, added + addedCount, v ) == added + addedCount )
+                { added[addedCount++] = v; }
+            }
+        }
+
+        for( u32 j=0; j<addedCount; ++j )
+        { unique[vertexCount++] = added[j]; }
+
+        triangleCount++;
+    }
+
+    AppendMeshlet( pPositions, pIndices, begin, end - begin, materialId, meshlets, vertices, indices );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      カリングに使うビュー情報を生成します.
+//-------------------------------------------------------------------------------------------------
+CullingView CreateCullingView( const Matrix& world, const Matrix& view, const Matrix& proj )
+{
+    CullingView result = {};
+
+    auto worldView = world * view;
+    auto& m = result.WorldViewProj;
+    m = worldView * proj;
+
+    // 行ベクトル形式なので, 列から平面を取り出す. 深度は [0, w] の範囲.
+    result.Planes[0] = NormalizePlane( m._14 + m._11, m._24 + m._21, m._34 + m._31, m._44 + m._41 );
+    result.Planes[1] = NormalizePlane( m._14 - m._11, m._24 - m._21, m._34 - m._31, m._44 - m._41 );
+    result.Planes[2] = NormalizePlane( m._14 + m._12, m._24 + m._22, m._34 + m._32, m._44 + m._42 );
+    result.Planes[3] = NormalizePlane( m._14 - m._12, m._24 - m._22, m._34 - m._32, m._44 - m._42 );
+    result.Planes[4] = NormalizePlane( m._13,         m._23,         m._33,         m._43 );
+    result.Planes[5] = NormalizePlane( m._14 - m._13, m._24 - m._23, m._34 - m._33, m._44 - m._43 );
+
+    result.CameraPos  = Vector3::Transform( Vector3( 0.0f, 0.0f, 0.0f ), Matrix::Invert( worldView ) );
+    result.DepthScale = sqrtf( m._13 * m._13 + m._23 * m._23 + m._33 * m._33 );
+    result.ProjScale  = proj._22;
+
+    return result;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      バウンディングボックスと視錐台の関係を判定します.
+//-------------------------------------------------------------------------------------------------
+FrustumTest TestFrustum( const CullingView& view, const BoundingBox& box )
+{
+    auto result = FrustumTest::Inside;
+    for( auto& plane : view.Planes )
+    {
+        // 平面の法線方向に最も遠い頂点と最も近い頂点で判定する.
+        auto maxDist = plane.w
+            + ( ( plane.x > 0.0f ) ? plane.x * box.Maxi.x : plane.x * box.Mini.x )
+            + ( ( plane.y > 0.0f ) ? plane.y * box.Maxi.y : plane.y * box.Mini.y )
+            + ( ( plane.z > 0.0f ) ? plane.z * box.Maxi.z : plane.z * box.Mini.z );
+        if ( maxDist < 0.0f )
+        { return FrustumTest::Outside; }
+
+        auto minDist = plane.w
+            + ( ( plane.x > 0.0f ) ? plane.x * box.Mini.x : plane.x * box.Maxi.x )
+            + ( ( plane.y > 0.0f ) ? plane.y * box.Mini.y : plane.y * box.Maxi.y )
+            + ( ( plane.z > 0.0f ) ? plane.z * box.Mini.z : plane.z * box.Maxi.z );
+        if ( minDist < 0.0f )
+        { result = FrustumTest::Intersect; }
+    }
+
+    return result;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      粗い深度バッファをレンダーターゲットの深度から更新します.
+//-------------------------------------------------------------------------------------------------
+void UpdateCoarseDepth( const RenderTarget& target, CoarseDepth& coarse )
+{
+    coarse.Width  = target.Width;
+    coarse.Height = target.Height;
+    coarse.TileX  = ( target.Width  + COARSE_TILE_SIZE - 1 ) / COARSE_TILE_SIZE;
+    coarse.TileY  = ( target.Height + COARSE_TILE_SIZE - 1 ) / COARSE_TILE_SIZE;
+    coarse.MaxDepth.assign( coarse.TileX * coarse.TileY, 0.0f );
+
+    for( u32 y=0; y<target.Height; ++y )
+    {
+        auto pRow  = target.pDepth + y * target.Width;
+        auto pTile = coarse.MaxDepth.data() + ( y / COARSE_TILE_SIZE ) * coarse.TileX;
+        for( u32 x=0; x<target.Width; ++x )
+        {
+            auto& depth = pTile[x / COARSE_TILE_SIZE];
+            depth = Max( depth, pRow[x] );
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      メッシュレットが可視かどうか判定します.
+//-------------------------------------------------------------------------------------------------
+bool IsMeshletVisible( const CullingView& view, const CoarseDepth* pDepth, const Meshlet& meshlet )
+{
+    auto& center = meshlet.Center;
+    auto  radius = meshlet.Radius;
+
+    // 視錐台カリング.
+    for( auto& plane : view.Planes )
+    {
+        auto dist = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+        if ( dist < -radius )
+        { return false; }
+    }
+
+    // 法線コーンによる背面カリング. 全ての三角形が裏を向いていれば描画しない.
+    {
+        auto dir  = center - view.CameraPos;
+        auto dist = dir.Length();
+        if ( Vector3::Dot( dir, meshlet.ConeAxis ) >= meshlet.ConeCutoff * dist + radius )
+        { return false; }
+    }
+
+    if ( pDepth == nullptr || pDepth->MaxDepth.empty() )
+    { return true; }
+
+    // 球の中で最も手前の深度. 射影後の z は位置に対して線形なので保守的に求まる.
+    auto& m = view.WorldViewProj;
+    auto nearDepth = center.x * m._13 + center.y * m._23 + center.z * m._33 + m._43 - radius * view.DepthScale;
+    if ( nearDepth <= 0.0f )
+    { return true; }
+
+    // 球を囲むボックスを投影してスクリーン上の範囲を求める.
+    auto mini = Vector2( F32_MAX, F32_MAX );
+    auto maxi = Vector2(-F32_MAX,-F32_MAX );
+    for( auto i=0; i<8; ++i )
+    {
+        auto p = Vector3(
+            center.x + ( ( i & 1 ) ? radius : -radius ),
+            center.y + ( ( i & 2 ) ? radius : -radius ),
+            center.z + ( ( i & 4 ) ? radius : -radius ) );
+
+        auto clip = Vector4::Transform( Vector4( p, 1.0f ), m );
+        if ( clip.w <= 0.0f )
+        { return true; }
+
+        auto ndc = Vector2( clip.x / clip.w, clip.y / clip.w );
+        mini = Vector2::Min( mini, ndc );
+        maxi = Vector2::Max( maxi, ndc );
+    }
+
+    auto w = f32( pDepth->Width );
+    auto h = f32( pDepth->Height );
+
+    auto x0 = s32( floorf( ( mini.x * 0.5f + 0.5f ) * w ) );
+    auto y0 = s32( floorf( ( mini.y * 0.5f + 0.5f ) * h ) );
+    auto x1 = s32( ceilf ( ( maxi.x * 0.5f + 0.5f ) * w ) );
+    auto y1 = s32( ceilf ( ( maxi.y * 0.5f + 0.5f ) * h ) );
+
+    x0 = Clamp<s32>( x0, 0, s32( pDepth->Width  ) - 1 );
+    y0 = Clamp<s32>( y0, 0, s32( pDepth->Height ) - 1 );
+    x1 = Clamp<s32>( x1, 0, s32( pDepth->Width  ) - 1 );
+    y1 = Clamp<s32>( y1, 0, s32( pDepth->Height ) - 1 );
+
+    // 覆う全てのタイルで描画済みの深度より奥にあれば遮蔽されている.
+    for( auto ty = u32( y0 ) / COARSE_TILE_SIZE; ty <= u32( y1 ) / COARSE_TILE_SIZE; ++ty )
+    {
+        for( auto tx = u32( x0 ) / COARSE_TILE_SIZE; tx <= u32( x1 ) / COARSE_TILE_SIZE; ++tx )
+        {
+            if ( pDepth->MaxDepth[ty * pDepth->TileX + tx] >= nearDepth )
+            { return true; }
+        }
+    }
+
+    return false;
+}
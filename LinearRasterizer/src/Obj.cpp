@@ -9,7 +9,301 @@
 //-------------------------------------------------------------------------------------------------
 #include <Obj.h>
 #include <asdxLogger.h>
+#include <MappedFile.h>
+#include <Parallel.h>
 #include <fstream>
+#include <string_view>
+#include <charconv>
+#include <algorithm>
+#include <unordered_map>
+
+
+namespace /* anonymous */ {
+
+//-------------------------------------------------------------------------------------------------
+// Constant Values
+//-------------------------------------------------------------------------------------------------
+static constexpr u64 MIN_CHUNK_SIZE = 1024 * 1024;      //!< 1Xbh̍ŏ`NTCYł.
+static constexpr s32 INVALID_INDEX  = S32_MIN;          //!< ȃCfbNXł.
+static constexpr u32 RELATIVE_P     = 0x1;              //!< ʒuW΃CfbNXł邱ƂtOł.
+static constexpr u32 RELATIVE_U     = 0x2;              //!< eNX`W΃CfbNXł邱ƂtOł.
+static constexpr u32 RELATIVE_N     = 0x4;              //!< @xNg΃CfbNXł邱ƂtOł.
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// FaceCorner structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct FaceCorner
+{
+    s32     P;          //!< ʒuW̃CfbNX.
+    s32     U;          //!< eNX`W̃CfbNX.
+    s32     N;          //!< @xNg̃CfbNX.
+    u32     Flags;      //!< ΃CfbNXtO. Ăvf̓`N擪̃CfbNX.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// FaceVertex structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct FaceVertex
+{
+    u32     P;      //!< ʒuW̃CfbNX.
+    u32     U;      //!< eNX`W̃CfbNX. ꍇ U32_MAX.
+    u32     N;      //!< @xNg̃CfbNX. ꍇ U32_MAX.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// ChunkSubset structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct ChunkSubset
+{
+    std::string_view    Name;       //!< Kp}eA.
+    u32                 Offset;     //!< `Nł̎Op`ItZbg.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// ObjChunk structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct ObjChunk
+{
+    const char*                 pBegin;         //!< `N̐擪.
+    const char*                 pEnd;           //!< `N̏I[.
+    std::vector<asdx::Vector3>  Positions;      //!< ʒuW.
+    std::vector<asdx::Vector2>  TexCoords;      //!< eNX`W.
+    std::vector<asdx::Vector3>  Normals;        //!< @xNg.
+    std::vector<FaceCorner>     Corners;        //!< Op`ꂽʂ̒_.
+    std::vector<ChunkSubset>    Subsets;        //!< TuZbg.
+    std::vector<std::string_view> Libraries;    //!< }eACu.
+    u32                         TexCoordCount;  //!< eNX`W_.
+    u32                         NormalCount;    //!< @xNg_.
+    u32                         LineCount;      //!< s.
+    u32                         ErrorLine;      //!< G[s (`N, 1n܂). 0 ̓G[.
+};
+
+//-------------------------------------------------------------------------------------------------
+//      󔒕ǂ`FbN܂.
+//-------------------------------------------------------------------------------------------------
+inline bool IsSpace( char c )
+{ return c == ' ' || c == '\t' || c == '\r'; }
+
+//-------------------------------------------------------------------------------------------------
+//      󔒕ǂݔ΂܂.
+//-------------------------------------------------------------------------------------------------
+inline const char* SkipSpace( const char* ptr, const char* end )
+{
+    while( ptr < end && IsSpace( *ptr ) )
+    { ptr++; }
+
+    return ptr;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      g[N؂o܂.
+//-------------------------------------------------------------------------------------------------
+inline std::string_view NextToken( const char*& ptr, const char* end )
+{
+    ptr = SkipSpace( ptr, end );
+
+    auto begin = ptr;
+    while( ptr < end && !IsSpace( *ptr ) )
+    { ptr++; }
+
+    return std::string_view( begin, size_t(ptr - begin) );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      ͂܂.
+//-------------------------------------------------------------------------------------------------
+inline const char* ParseFloat( const char* ptr, const char* end, f32& value )
+{
+    ptr = SkipSpace( ptr, end );
+
+    // from_chars ͐擪 '+' 󂯕tȂ̂œǂݔ΂.
+    if ( ptr < end && *ptr == '+' )
+    { ptr++; }
+
+    auto result = std::from_chars( ptr, end, value );
+    if ( result.ec != std::errc() )
+    {
+        value = 0.0f;
+        while( ptr < end && !IsSpace( *ptr ) )
+        { ptr++; }
+        return ptr;
+    }
+
+    return result.ptr;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      _CfbNX͂܂.
+//-------------------------------------------------------------------------------------------------
+//  OBJ ̃CfbNX 1 n܂, ͒O܂łɒ`ꂽvf̑ΎwƂȂ.
+//  Ύw̓`N擪̗vfm肷܂ŉłȂ̂, `ÑCfbNXƂĕԂ.
+//-------------------------------------------------------------------------------------------------
+inline bool ParseIndex( const char*& ptr, const char* end, size_t localCount, s32& index, bool& relative )
+{
+    s32 value = 0;
+    auto result = std::from_chars( ptr, end, value );
+    if ( result.ec != std::errc() || value == 0 )
+    { return false; }
+
+    ptr = result.ptr;
+
+    relative = ( value < 0 );
+    index    = ( relative ) ? s32(localCount) + value : value - 1;
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      `N͂܂.
+//-------------------------------------------------------------------------------------------------
+void ParseChunk( ObjChunk& chunk )
+{
+    auto ptr = chunk.pBegin;
+    auto end = chunk.pEnd;
+
+    // _sƖʍs̕ϓIȒvfςĊmۂĂ.
+    chunk.Positions.reserve( size_t(end - ptr) / 96 );
+    chunk.Corners  .reserve( size_t(end - ptr) / 32 );
+
+    while( ptr < end )
+    {
+        chunk.LineCount++;
+
+        auto eol = static_cast<const char*>( memchr( ptr, '\n', size_t(end - ptr) ) );
+        if ( eol == nullptr )
+        { eol = end; }
+
+        auto cur = ptr;
+        ptr = ( eol < end ) ? eol + 1 : end;
+
+        auto tag = NextToken( cur, eol );
+
+        if ( tag.empty() || tag[0] == '#' )
+        { continue; }
+        else if ( tag == "v" )
+        {
+            asdx::Vector3 val;
+            cur = ParseFloat( cur, eol, val.x );
+            cur = ParseFloat( cur, eol, val.y );
+            cur = ParseFloat( cur, eol, val.z );
+            chunk.Positions.push_back( val );
+        }
+        else if ( tag == "vt" )
+        {
+            asdx::Vector2 val;
+            cur = ParseFloat( cur, eol, val.x );
+            cur = ParseFloat( cur, eol, val.y );
+            chunk.TexCoords.push_back( val );
+        }
+        else if ( tag == "vn" )
+        {
+            asdx::Vector3 val;
+            cur = ParseFloat( cur, eol, val.x );
+            cur = ParseFloat( cur, eol, val.y );
+            cur = ParseFloat( cur, eol, val.z );
+            chunk.Normals.push_back( val );
+        }
+        else if ( tag == "f" )
+        {
+            // p` (0, 1, 2), (2, 3, 0), (3, 4, 0) ... ̏ɎOp`.
+            FaceCorner first = {};
+            FaceCorner prev  = {};
+
+            for( u32 i=0; ; ++i )
+            {
+                cur = SkipSpace( cur, eol );
+                if ( cur >= eol )
+                { break; }
+
+                FaceCorner corner = { INVALID_INDEX, INVALID_INDEX, INVALID_INDEX, 0 };
+                auto relative = false;
+
+                auto valid = ParseIndex( cur, eol, chunk.Positions.size(), corner.P, relative );
+                if ( relative )
+                { corner.Flags |= RELATIVE_P; }
+
+                if ( valid && cur < eol && *cur == '/' )
+                {
+                    cur++;
+
+                    if ( cur < eol && *cur != '/' )
+                    {
+                        valid = ParseIndex( cur, eol, chunk.TexCoords.size(), corner.U, relative );
+                        if ( relative )
+                        { corner.Flags |= RELATIVE_U; }
+                    }
+
+                    if ( valid && cur < eol && *cur == '/' )
+                    {
+                        cur++;
+                        valid = ParseIndex( cur, eol, chunk.Normals.size(), corner.N, relative );
+                        if ( relative )
+                        { corner.Flags |= RELATIVE_N; }
+                    }
+                }
+
+                if ( !valid )
+                {
+                    chunk.ErrorLine = chunk.LineCount;
+                    return;
+                }
+
+                if ( i == 0 )
+                { first = corner; }
+                else if ( i == 2 )
+                {
+                    chunk.Corners.push_back( first );
+                    chunk.Corners.push_back( prev );
+                    chunk.Corners.push_back( corner );
+                }
+                else if ( i > 2 )
+                {
+                    chunk.Corners.push_back( prev );
+                    chunk.Corners.push_back( corner );
+                    chunk.Corners.push_back( first );
+                }
+
+                prev = corner;
+            }
+        }
+        else if ( tag == "mtllib" )
+        {
+            // 1sɕ̃t@Cw肳邱Ƃ.
+            for( auto path = NextToken( cur, eol ); !path.empty(); path = NextToken( cur, eol ) )
+            { chunk.Libraries.push_back( path ); }
+        }
+        else if ( tag == "usemtl" )
+        {
+            ChunkSubset instance = {};
+            instance.Name   = NextToken( cur, eol );
+            instance.Offset = u32(chunk.Corners.size() / 3);
+
+            chunk.Subsets.push_back( instance );
+        }
+    }
+
+    for( auto& corner : chunk.Corners )
+    {
+        if ( corner.U != INVALID_INDEX )
+        { chunk.TexCoordCount++; }
+        if ( corner.N != INVALID_INDEX )
+        { chunk.NormalCount++; }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      _̃nbVl߂܂.
+//-------------------------------------------------------------------------------------------------
+inline u32 HashVertex( const FaceVertex& value )
+{
+    auto hash = value.P * 0x9E3779B1u;
+    hash ^= value.U * 0x85EBCA77u + ( hash << 6 ) + ( hash >> 2 );
+    hash ^= value.N * 0xC2B2AE3Du + ( hash << 6 ) + ( hash >> 2 );
+    return hash;
+}
+
+} // namespace /* anonymous */
 
 
 //-------------------------------------------------------------------------------------------------
@@ -48,7 +342,9 @@ bool LoadFromMTL( const char* filename, ResOBJ* pResult )
             file >> name;
 
             ResMTL instance = {};
-            instance.Name = name;
+            instance.Name    = name;
+            instance.Diffuse = asdx::Vector3( 1.0f, 1.0f, 1.0f );
+            instance.Alpha   = 1.0f;
 
             auto index = pResult->Materials.size();
             pResult->Materials.push_back( instance );
@@ -65,6 +361,8 @@ bool LoadFromMTL( const char* filename, ResOBJ* pResult )
             { file >> material->Specular.x >> material->Specular.y >> material->Specular.z; }
             else if ( 0 == strcmp( buf, "d") || 0 == strcmp( buf, "Tr") )
             { file >> material->Alpha; }
+            else if ( 0 == strcmp( buf, "Ns") )
+            { file >> material->Power; }
             else if ( 0 == strcmp( buf, "map_Ka") )
             { file >> material->AmbientMap; }
             else if ( 0 == strcmp( buf, "map_Kd") )
@@ -84,11 +382,14 @@ bool LoadFromMTL( const char* filename, ResOBJ* pResult )
 
     return true;
 }
-
 //-------------------------------------------------------------------------------------------------
 //      OBJt@Cǂݍ݂܂.
 //-------------------------------------------------------------------------------------------------
-bool LoadFromOBJ( const char* filename, ResOBJ* pResult )
+//  t@CɃ}bv, sEŃ`NɕăXbhƂɉ͂.
+//  g[N string_view Ő؂o, l from_chars ŕϊ.
+//  e`N̗vf̗ݐϘa, ΃CfbNXƃTuZbg̃ItZbgm肳Č.
+//-------------------------------------------------------------------------------------------------
+bool LoadFromOBJ( const char* filename, ResOBJ* pResult, bool weldVertices )
 {
     if ( filename == nullptr || pResult == nullptr )
     {
@@ -96,142 +397,270 @@ bool LoadFromOBJ( const char* filename, ResOBJ* pResult )
         return false;
     }
 
-    std::ifstream file;
-    file.open( filename, std::ios::in );
+    MappedFile file;
+    if ( !file.Open( filename ) )
+    { return false; }
 
-    if ( !file.is_open() )
+    auto data = file.GetData();
+    auto size = file.GetSize();
+
+    // sEŃ`Nɕ.
+    std::vector<ObjChunk> chunks;
     {
-        ELOG( "Error : File Open Failed. filename = %s", filename );
-        return false;
+        auto chunkCount = GetChunkCount( size, MIN_CHUNK_SIZE );
+
+        chunks.resize( chunkCount );
+
+        auto begin = data;
+        auto end   = data + size;
+        for( u32 i=0; i<chunkCount; ++i )
+        {
+            auto split = ( i + 1 == chunkCount ) ? end : data + ( size * ( i + 1 ) ) / chunkCount;
+            if ( split < begin )
+            { split = begin; }
+
+            if ( split < end )
+            {
+                auto eol = static_cast<const char*>( memchr( split, '\n', size_t(end - split) ) );
+                split = ( eol != nullptr ) ? eol + 1 : end;
+            }
+
+            chunks[i].pBegin = begin;
+            chunks[i].pEnd   = split;
+            begin = split;
+        }
     }
 
-    char buf[2048];
+    auto chunkCount = u32(chunks.size());
+    ParallelFor( chunkCount, [&]( u32 index ) { ParseChunk( chunks[index] ); } );
 
-    std::vector<asdx::Vector3> positions;
-    std::vector<asdx::Vector3> normals;
-    std::vector<asdx::Vector2> texcoords;
-    u32 offset = 0;
+    // ݐϘa߂.
+    std::vector<size_t> basePositions( chunkCount + 1, 0 );
+    std::vector<size_t> baseTexCoords( chunkCount + 1, 0 );
+    std::vector<size_t> baseNormals  ( chunkCount + 1, 0 );
+    std::vector<size_t> baseCorners  ( chunkCount + 1, 0 );
+    std::vector<size_t> baseOutputU  ( chunkCount + 1, 0 );
+    std::vector<size_t> baseOutputN  ( chunkCount + 1, 0 );
+    {
+        u32 line = 0;
+        for( u32 i=0; i<chunkCount; ++i )
+        {
+            auto& chunk = chunks[i];
+            if ( chunk.ErrorLine != 0 )
+            {
+                ELOG( "Error : Invalid Face Index. filename = %s, line = %u", filename, line + chunk.ErrorLine );
+                return false;
+            }
+            line += chunk.LineCount;
+
+            basePositions[i + 1] = basePositions[i] + chunk.Positions.size();
+            baseTexCoords[i + 1] = baseTexCoords[i] + chunk.TexCoords.size();
+            baseNormals  [i + 1] = baseNormals  [i] + chunk.Normals  .size();
+            baseCorners  [i + 1] = baseCorners  [i] + chunk.Corners  .size();
+            baseOutputU  [i + 1] = baseOutputU  [i] + chunk.TexCoordCount;
+            baseOutputN  [i + 1] = baseOutputN  [i] + chunk.NormalCount;
+        }
+    }
 
-    for( ;; )
+    if ( baseCorners[chunkCount] > U32_MAX )
     {
-        file >> buf;
+        ELOG( "Error : Too Many Vertices. filename = %s", filename );
+        return false;
+    }
 
-        if ( !file || file.eof() )
-        { break; }
+    std::vector<asdx::Vector3> positions( basePositions[chunkCount] );
+    std::vector<asdx::Vector2> texcoords( baseTexCoords[chunkCount] );
+    std::vector<asdx::Vector3> normals  ( baseNormals  [chunkCount] );
 
-        if ( 0 == strcmp( buf, "#" ) )
-        { continue; }
-        else if ( 0 == strcmp( buf, "v" ) )
+    // _f[^.
+    ParallelFor( chunkCount, [&]( u32 index )
+    {
+        auto& chunk = chunks[index];
+        std::copy( chunk.Positions.begin(), chunk.Positions.end(), positions.begin() + basePositions[index] );
+        std::copy( chunk.TexCoords.begin(), chunk.TexCoords.end(), texcoords.begin() + baseTexCoords[index] );
+        std::copy( chunk.Normals  .begin(), chunk.Normals  .end(), normals  .begin() + baseNormals  [index] );
+    });
+
+    // CfbNX.
+    std::vector<FaceVertex> corners( baseCorners[chunkCount] );
+    std::vector<u8>         invalid( chunkCount, 0 );
+    ParallelFor( chunkCount, [&]( u32 index )
+    {
+        auto resolve = []( s32 value, bool relative, size_t base, size_t count, u32& result )
         {
-            asdx::Vector3 val;
-            file >> val.x >> val.y >> val.z;
-            positions.push_back( val );
-        }
-        else if ( 0 == strcmp( buf, "vt" ) )
+            if ( value == INVALID_INDEX )
+            {
+                result = U32_MAX;
+                return true;
+            }
+
+            auto idx = s64(value) + ( relative ? s64(base) : 0 );
+            if ( idx < 0 || idx >= s64(count) )
+            { return false; }
+
+            result = u32(idx);
+            return true;
+        };
+
+        auto& chunk = chunks[index];
+        auto  dst   = baseCorners[index];
+
+        for( auto& corner : chunk.Corners )
         {
-            asdx::Vector2 val;
-            file >> val.x >> val.y;
-            texcoords.push_back( val );
+            auto& vertex = corners[dst++];
+            if ( !resolve( corner.P, ( corner.Flags & RELATIVE_P ) != 0, basePositions[index], positions.size(), vertex.P )
+              || !resolve( corner.U, ( corner.Flags & RELATIVE_U ) != 0, baseTexCoords[index], texcoords.size(), vertex.U )
+              || !resolve( corner.N, ( corner.Flags & RELATIVE_N ) != 0, baseNormals  [index], normals  .size(), vertex.N ) )
+            {
+                invalid[index] = 1;
+                return;
+            }
         }
-        else if ( 0 == strcmp( buf, "vn" ) )
+    });
+
+    for( auto flag : invalid )
+    {
+        if ( flag != 0 )
         {
-            asdx::Vector3 val;
-            file >> val.x >> val.y >> val.z;
-            normals.push_back( val );
+            ELOG( "Error : Face Index Out Of Range. filename = %s", filename );
+            return false;
         }
-        else if ( 0 == strcmp( buf, "f" ) )
-        {
-            offset++;
-            u32 indexP[4] = {U32_MAX, U32_MAX, U32_MAX, U32_MAX};
-            u32 indexU[4] = {U32_MAX, U32_MAX, U32_MAX, U32_MAX};
-            u32 indexN[4] = {U32_MAX, U32_MAX, U32_MAX, U32_MAX};
+    }
 
-            auto i = 0;
-            for( i=0; i<4; ++i )
-            {
-                u32 index;
-                file >> index;
-                indexP[i] = index - 1;
+    if ( weldVertices )
+    {
+        // (ʒu, eNX`W, @) ̃CfbNX̑gnbV, dȂ_o͂.
+        auto hasTexCoord = baseOutputU[chunkCount] > 0;
+        auto hasNormal   = baseOutputN[chunkCount] > 0;
 
-                if ( '/' == file.peek() )
-                {
-                    file.ignore();
+        size_t capacity = 16;
+        while( capacity < corners.size() * 2 )
+        { capacity <<= 1; }
 
-                    if ( '/' != file.peek() )
-                    {
-                        file >> index;
-                        indexU[i] = index - 1;
-                    }
+        std::vector<u32>        table( capacity, U32_MAX );
+        std::vector<FaceVertex> unique;
+        unique.reserve( corners.size() / 4 );
 
-                    if ( '/' == file.peek() )
-                    {
-                        file.ignore();
-                        file >> index;
-                        indexN[i] = index - 1;
-                    }
-                }
+        pResult->Indices.resize( corners.size() );
 
-                if ( i < 3 )
-                {
-                    auto idx = u32(pResult->Positions.size());
-                    pResult->Indices.push_back(idx);
-
-                    if ( indexP[i] != U32_MAX )
-                    { pResult->Positions.push_back( positions[indexP[i]] ); }
-                    if ( indexU[i] != U32_MAX )
-                    { pResult->TexCoords.push_back( texcoords[indexU[i]] ); }
-                    if ( indexN[i] != U32_MAX )
-                    { pResult->Normals.push_back( normals[indexN[i]] ); }
-                }
-
-                if ( '\n' == file.peek() || '\r' == file.peek() )
-                { break; }
-            }
+        for( size_t i=0; i<corners.size(); ++i )
+        {
+            auto& key  = corners[i];
+            auto  slot = size_t( HashVertex( key ) ) & ( capacity - 1 );
 
-            if ( i >= 3 )
+            for( ;; )
             {
-                offset++;
-
-                for( auto j=1; j<4; ++j )
+                auto idx = table[slot];
+                if ( idx == U32_MAX )
                 {
-                    auto k = (j + 1) % 4;
-
-                    auto idx = u32(pResult->Positions.size());
-                    pResult->Indices.push_back(idx);
+                    idx = u32(unique.size());
+                    table[slot] = idx;
+                    unique.push_back( key );
+                    pResult->Indices[i] = idx;
+                    break;
+                }
 
-                    if ( indexP[k] != U32_MAX )
-                    { pResult->Positions.push_back( positions[indexP[k]] ); }
-                    if ( indexU[k] != U32_MAX )
-                    { pResult->TexCoords.push_back( texcoords[indexU[k]] ); }
-                    if ( indexN[k] != U32_MAX )
-                    { pResult->Normals.push_back( normals[indexN[k]] ); }
+                auto& value = unique[idx];
+                if ( value.P == key.P && value.U == key.U && value.N == key.N )
+                {
+                    pResult->Indices[i] = idx;
+                    break;
                 }
+
+                slot = ( slot + 1 ) & ( capacity - 1 );
             }
         }
-        else if ( 0 == strcmp( buf, "mtllib") )
+
+        // Ȃ_ 0 Ŗ߂, ʒuWƓɑ.
+        pResult->Positions.resize( unique.size() );
+        pResult->TexCoords.resize( hasTexCoord ? unique.size() : 0 );
+        pResult->Normals  .resize( hasNormal   ? unique.size() : 0 );
+
+        for( size_t i=0; i<unique.size(); ++i )
         {
-            char path[256] = {};
-            file >> path;
+            auto& vertex = unique[i];
+            pResult->Positions[i] = positions[vertex.P];
 
-            //LoadFromMTL( path, pResult );
+            if ( hasTexCoord )
+            { pResult->TexCoords[i] = ( vertex.U != U32_MAX ) ? texcoords[vertex.U] : asdx::Vector2( 0.0f, 0.0f ); }
+            if ( hasNormal )
+            { pResult->Normals[i] = ( vertex.N != U32_MAX ) ? normals[vertex.N] : asdx::Vector3( 0.0f, 0.0f, 0.0f ); }
         }
-        else if ( 0 == strcmp( buf, "usemtl") )
+    }
+    else
+    {
+        // ʂ̒_ƂɓWJ.
+        pResult->Positions.resize( corners.size() );
+        pResult->Indices  .resize( corners.size() );
+        pResult->TexCoords.resize( baseOutputU[chunkCount] );
+        pResult->Normals  .resize( baseOutputN[chunkCount] );
+
+        ParallelFor( chunkCount, [&]( u32 index )
         {
-            char name[256] = {};
-            file >> name;
+            auto dstU = baseOutputU[index];
+            auto dstN = baseOutputN[index];
+
+            for( auto i=baseCorners[index]; i<baseCorners[index + 1]; ++i )
+            {
+                auto& vertex = corners[i];
 
+                pResult->Positions[i] = positions[vertex.P];
+                pResult->Indices  [i] = u32(i);
+
+                if ( vertex.U != U32_MAX )
+                { pResult->TexCoords[dstU++] = texcoords[vertex.U]; }
+                if ( vertex.N != U32_MAX )
+                { pResult->Normals[dstN++] = normals[vertex.N]; }
+            }
+        });
+    }
+
+    // TuZbg.
+    for( u32 i=0; i<chunkCount; ++i )
+    {
+        for( auto& subset : chunks[i].Subsets )
+        {
             ResSubset instance = {};
-            instance.Name   = name;
-            instance.Offset = offset * 3;
+            instance.Name   = std::string( subset.Name );
+            instance.Offset = u32(baseCorners[i]) + subset.Offset * 3;
             instance.Count  = 0;
 
             pResult->Subsets.push_back( instance );
         }
+    }
 
-        file.ignore( 2048, '\n' );
+    // ŏ usemtl O̖ʂ, O̖TuZbgɂ܂Ƃ߂.
+    if ( !pResult->Subsets.empty() && pResult->Subsets.front().Offset > 0 )
+    {
+        ResSubset instance = {};
+        instance.Offset = 0;
+        instance.Count  = 0;
+
+        pResult->Subsets.insert( pResult->Subsets.begin(), instance );
     }
 
-    file.close();
+    // }eACu OBJ t@C̑΃pXŎw肳.
+    {
+        std::string directory( filename );
+        auto pos = directory.find_last_of( "/\\" );
+        directory = ( pos != std::string::npos ) ? directory.substr( 0, pos + 1 ) : std::string();
+
+        for( auto& chunk : chunks )
+        {
+            for( auto& library : chunk.Libraries )
+            {
+                auto path = directory + std::string( library );
+                LoadFromMTL( path.c_str(), pResult );
+                pResult->Libraries.push_back( path );
+            }
+        }
+    }
+
+    auto offset = u32(baseCorners[chunkCount] / 3);
+
+    // ̓}bvwĂ̂, QƂȂĂ.
+    chunks.clear();
+    file.Close();
 
     {
         auto index = pResult->Subsets.size();
@@ -244,8 +673,20 @@ bool LoadFromOBJ( const char* filename, ResOBJ* pResult )
                 pResult->Subsets[i].Count = pResult->Subsets[i+1].Offset - pResult->Subsets[i].Offset;
             }
         }
+        else if ( offset > 0 )
+        {
+            // usemtl ꍇ͑Ŝ1̃TuZbgƂ.
+            ResSubset instance = {};
+            instance.Offset = 0;
+            instance.Count  = offset * 3;
+
+            pResult->Subsets.push_back( instance );
+        }
     }
 
+    ResolveMaterials( pResult );
+    ComputeSubsetBounds( pResult );
+
     positions.clear();
     texcoords.clear();
     normals  .clear();
@@ -255,6 +696,65 @@ bool LoadFromOBJ( const char* filename, ResOBJ* pResult )
     pResult->TexCoords  .shrink_to_fit();
     pResult->Subsets    .shrink_to_fit();
     pResult->Indices    .shrink_to_fit();
+    pResult->Materials  .shrink_to_fit();
 
     return true;
 }
+
+//-------------------------------------------------------------------------------------------------
+//      TuZbg̃}eA}eAԍɉ܂.
+//-------------------------------------------------------------------------------------------------
+void ResolveMaterials( ResOBJ* pResult )
+{
+    if ( pResult == nullptr )
+    { return; }
+
+    // ̃}eAꍇ͐ɒ`ꂽ̂g.
+    std::unordered_map<std::string, u32> ids;
+    ids.reserve( pResult->Materials.size() );
+    for( u32 i=0; i<u32(pResult->Materials.size()); ++i )
+    { ids.emplace( pResult->Materials[i].Name, i ); }
+
+    for( auto& subset : pResult->Subsets )
+    {
+        auto itr = ids.find( subset.Name );
+        if ( itr != ids.end() )
+        {
+            subset.MaterialId = itr->second;
+            continue;
+        }
+
+        // `̖}eA͊lŒǉ, ɗLȔԍQƂł悤ɂ.
+        ResMTL instance = {};
+        instance.Name    = subset.Name;
+        instance.Diffuse = asdx::Vector3( 1.0f, 1.0f, 1.0f );
+        instance.Alpha   = 1.0f;
+
+        subset.MaterialId = u32(pResult->Materials.size());
+        ids.emplace( subset.Name, subset.MaterialId );
+        pResult->Materials.push_back( instance );
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      TuZbg̃oEfBO{bNXvZ܂.
+//-------------------------------------------------------------------------------------------------
+void ComputeSubsetBounds( ResOBJ* pResult )
+{
+    if ( pResult == nullptr )
+    { return; }
+
+    for( auto& subset : pResult->Subsets )
+    {
+        subset.Bounds = CreateEmptyBox();
+
+        for( u32 i=0; i<subset.Count; ++i )
+        {
+            auto index = subset.Offset + i;
+            if ( index >= pResult->Indices.size() )
+            { break; }
+
+            Merge( subset.Bounds, pResult->Positions[ pResult->Indices[index] ] );
+        }
+    }
+}
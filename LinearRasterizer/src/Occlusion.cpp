@@ -0,0 +1,264 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : Occlusion.cpp
+// Desc : Software Occlusion Culling Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <Occlusion.h>
+#include <Meshlet.h>
+#include <algorithm>
+#include <cmath>
+
+
+//-------------------------------------------------------------------------------------------------
+// Using Statements
+//-------------------------------------------------------------------------------------------------
+using namespace asdx;
+
+
+namespace /* anonymous */ {
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// ScreenVertex structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct ScreenVertex
+{
+    f32     X;      //!< スクリーン座標 X (ピクセル) です.
+    f32     Y;      //!< スクリーン座標 Y (ピクセル) です.
+    f32     Z;      //!< 正規化デバイス座標系の深度です.
+};
+
+//-------------------------------------------------------------------------------------------------
+//      射影空間の座標をスクリーン座標に変換します.
+//-------------------------------------------------------------------------------------------------
+inline ScreenVertex ToScreen( const Vector4& clip, f32 w, f32 h )
+{
+    auto invW = 1.0f / clip.w;
+
+    ScreenVertex result;
+    result.X = ( clip.x * invW * 0.5f + 0.5f ) * w;
+    result.Y = ( clip.y * invW * 0.5f + 0.5f ) * h;
+    result.Z = clip.z * invW;
+    return result;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      スクリーン上の三角形を深度のみ描画します.
+//-------------------------------------------------------------------------------------------------
+void RasterizeDepth( OcclusionBuffer& buffer, ScreenVertex v0, ScreenVertex v1, ScreenVertex v2 )
+{
+    auto area = ( v1.X - v0.X ) * ( v2.Y - v0.Y ) - ( v2.X - v0.X ) * ( v1.Y - v0.Y );
+    if ( fabsf( area ) < 1e-6f )
+    { return; }
+
+    // 両面描画なので, 辺関数が内側で正になる向きに揃える.
+    if ( area < 0.0f )
+    {
+        std::swap( v1, v2 );
+        area = -area;
+    }
+
+    // ピクセル中心を含む範囲.
+    auto minX = Max( s32( ceilf ( Min( v0.X, Min( v1.X, v2.X ) ) - 0.5f ) ), 0 );
+    auto minY = Max( s32( ceilf ( Min( v0.Y, Min( v1.Y, v2.Y ) ) - 0.5f ) ), 0 );
+    auto maxX = Min( s32( floorf( Max( v0.X, Max( v1.X, v2.X ) ) - 0.5f ) ), s32( buffer.Width  ) - 1 );
+    auto maxY = Min( s32( floorf( Max( v0.Y, Max( v1.Y, v2.Y ) ) - 0.5f ) ), s32( buffer.Height ) - 1 );
+    if ( minX > maxX || minY > maxY )
+    { return; }
+
+    // 辺関数 E(x, y) = A * x + B * y + C. ピクセル中心で全て 0 以上であれば内側.
+    const ScreenVertex* edges[3][2] = { { &v1, &v2 }, { &v2, &v0 }, { &v0, &v1 } };
+
+    f32 A[3], B[3], C[3];
+    for( auto i=0; i<3; ++i )
+    {
+        auto& a = *edges[i][0];
+        auto& b = *edges[i][1];
+        A[i] = a.Y - b.Y;
+        B[i] = b.X - a.X;
+        C[i] = a.X * b.Y - a.Y * b.X;
+    }
+
+    // 深度の平面式. 正規化デバイス座標系の z はスクリーン上で線形に変化する.
+    auto invArea = 1.0f / area;
+    auto dzdx = ( ( v1.Z - v0.Z ) * ( v2.Y - v0.Y ) - ( v2.Z - v0.Z ) * ( v1.Y - v0.Y ) ) * invArea;
+    auto dzdy = ( ( v2.Z - v0.Z ) * ( v1.X - v0.X ) - ( v1.Z - v0.Z ) * ( v2.X - v0.X ) ) * invArea;
+    auto zMax = Max( v0.Z, Max( v1.Z, v2.Z ) );
+    auto z0   = v0.Z - dzdx * v0.X - dzdy * v0.Y;
+
+    for( auto y=minY; y<=maxY; ++y )
+    {
+        auto py = f32( y ) + 0.5f;
+        auto px = f32( minX ) + 0.5f;
+
+        auto e0 = A[0] * px + B[0] * py + C[0];
+        auto e1 = A[1] * px + B[1] * py + C[1];
+        auto e2 = A[2] * px + B[2] * py + C[2];
+        auto z  = z0 + dzdx * px + dzdy * py;
+
+        auto pRow = buffer.Depth.data() + y * buffer.Width;
+        for( auto x=minX; x<=maxX; ++x )
+        {
+            if ( e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f )
+            {
+                auto depth = Min( z, zMax );
+                if ( depth < pRow[x] )
+                { pRow[x] = depth; }
+            }
+
+            e0 += A[0];
+            e1 += A[1];
+            e2 += A[2];
+            z  += dzdx;
+        }
+    }
+}
+
+} // namespace /* anonymous */
+
+
+//-------------------------------------------------------------------------------------------------
+//      遮蔽バッファをクリアします.
+//-------------------------------------------------------------------------------------------------
+void ClearOcclusionBuffer( OcclusionBuffer& buffer, u32 width, u32 height )
+{
+    buffer.Width  = width;
+    buffer.Height = height;
+    buffer.Depth.assign( width * height, F32_MAX );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      遮蔽物の三角形リストを深度のみ描画します.
+//-------------------------------------------------------------------------------------------------
+void RasterizeOccluder
+(
+    OcclusionBuffer&    buffer,
+    const Matrix&       worldViewProj,
+    const Vector3*      pPositions,
+    const u32*          pVertices,
+    u32                 vertexCount,
+    const u8*           pIndices,
+    u32                 count,
+    const Vector4&      clipOffset
+)
+{
+    if ( pPositions == nullptr || pVertices == nullptr || pIndices == nullptr || buffer.Depth.empty() )
+    { return; }
+
+    if ( vertexCount > MESHLET_MAX_VERTICES )
+    { return; }
+
+    auto w = f32( buffer.Width );
+    auto h = f32( buffer.Height );
+
+    // 三角形で共有する頂点は 1 回だけ変換する.
+    Vector4 clip[MESHLET_MAX_VERTICES];
+    for( u32 i=0; i<vertexCount; ++i )
+    { clip[i] = Vector4::Transform( Vector4( pPositions[pVertices[i]], 1.0f ), worldViewProj ) + clipOffset; }
+
+    count -= count % 3;
+    for( u32 i=0; i<count; i+=3 )
+    {
+        auto& c0 = clip[pIndices[i + 0]];
+        auto& c1 = clip[pIndices[i + 1]];
+        auto& c2 = clip[pIndices[i + 2]];
+
+        // 視点の後方にかかる三角形は遮蔽物として使わない.
+        if ( c0.w <= 0.0f || c1.w <= 0.0f || c2.w <= 0.0f )
+        { continue; }
+
+        RasterizeDepth( buffer, ToScreen( c0, w, h ), ToScreen( c1, w, h ), ToScreen( c2, w, h ) );
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      遮蔽バッファを保守的な値に変換します.
+//-------------------------------------------------------------------------------------------------
+void ResolveOcclusionBuffer( OcclusionBuffer& buffer )
+{
+    if ( buffer.Depth.empty() )
+    { return; }
+
+    auto w = s32( buffer.Width );
+    auto h = s32( buffer.Height );
+
+    // ピクセルはその周囲 8 ピクセルの中心を結んだ範囲に含まれるので, 3x3 の最大値を取れば
+    // ピクセル全体を覆っている場合だけ, 覆っている面の最も奥の深度が残る.
+    // 横方向と縦方向に分けて最大値を取る.
+    std::vector<f32> temp( buffer.Depth.size() );
+    for( auto y=0; y<h; ++y )
+    {
+        auto pSrc = buffer.Depth.data() + y * w;
+        auto pDst = temp.data() + y * w;
+        for( auto x=0; x<w; ++x )
+        { pDst[x] = Max( pSrc[Max( x - 1, 0 )], Max( pSrc[x], pSrc[Min( x + 1, w - 1 )] ) ); }
+    }
+
+    for( auto y=0; y<h; ++y )
+    {
+        auto pPrev = temp.data() + Max( y - 1, 0 ) * w;
+        auto pCurr = temp.data() + y * w;
+        auto pNext = temp.data() + Min( y + 1, h - 1 ) * w;
+        auto pDst  = buffer.Depth.data() + y * w;
+        for( auto x=0; x<w; ++x )
+        { pDst[x] = Max( pPrev[x], Max( pCurr[x], pNext[x] ) ); }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      バウンディングボックスが遮蔽物に完全に隠れているか判定します.
+//-------------------------------------------------------------------------------------------------
+bool IsOccluded( const OcclusionBuffer& buffer, const Matrix& worldViewProj, const BoundingBox& box )
+{
+    if ( buffer.Depth.empty() )
+    { return false; }
+
+    auto w = f32( buffer.Width );
+    auto h = f32( buffer.Height );
+
+    // 深度はビュー空間の奥行きに対して単調なので, 最も手前の値は角のどれかで得られる.
+    auto nearDepth = F32_MAX;
+    auto mini = Vector2( F32_MAX, F32_MAX );
+    auto maxi = Vector2(-F32_MAX,-F32_MAX );
+    for( auto i=0; i<8; ++i )
+    {
+        auto p = Vector3(
+            ( i & 1 ) ? box.Maxi.x : box.Mini.x,
+            ( i & 2 ) ? box.Maxi.y : box.Mini.y,
+            ( i & 4 ) ? box.Maxi.z : box.Mini.z );
+
+        auto clip = Vector4::Transform( Vector4( p, 1.0f ), worldViewProj );
+        if ( clip.w <= 0.0f )
+        { return false; }
+
+        auto screen = ToScreen( clip, w, h );
+        nearDepth = Min( nearDepth, screen.Z );
+        mini = Vector2::Min( mini, Vector2( screen.X, screen.Y ) );
+        maxi = Vector2::Max( maxi, Vector2( screen.X, screen.Y ) );
+    }
+
+    auto x0 = Max( s32( floorf( mini.x ) ), 0 );
+    auto y0 = Max( s32( floorf( mini.y ) ), 0 );
+    auto x1 = Min( s32( ceilf ( maxi.x ) ), s32( buffer.Width  ) ) - 1;
+    auto y1 = Min( s32( ceilf ( maxi.y ) ), s32( buffer.Height ) ) - 1;
+
+    // 画面外は視錐台カリングに任せる.
+    if ( x0 > x1 || y0 > y1 )
+    { return false; }
+
+    // 一部でも覆うピクセルのどれかで遮蔽物より手前にあれば可視.
+    for( auto y=y0; y<=y1; ++y )
+    {
+        auto pRow = buffer.Depth.data() + y * buffer.Width;
+        for( auto x=x0; x<=x1; ++x )
+        {
+            if ( pRow[x] >= nearDepth )
+            { return false; }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,171 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : Qoi.cpp
+// Desc : QOI Image Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <Qoi.h>
+#include <ImageFile.h>
+#include <vector>
+#include <asdxLogger.h>
+
+
+namespace /* anonymous */ {
+
+//-------------------------------------------------------------------------------------------------
+// Constant Values
+//-------------------------------------------------------------------------------------------------
+static constexpr u8  QOI_OP_INDEX   = 0x00;     //!< 直前に出現した色の参照です.
+static constexpr u8  QOI_OP_DIFF    = 0x40;     //!< 直前の色との小さな差分です.
+static constexpr u8  QOI_OP_LUMA    = 0x80;     //!< 緑を基準にした差分です.
+static constexpr u8  QOI_OP_RUN     = 0xc0;     //!< 直前の色の繰り返しです.
+static constexpr u8  QOI_OP_RGB     = 0xfe;     //!< RGB の値です.
+static constexpr u8  QOI_OP_RGBA    = 0xff;     //!< RGBA の値です.
+static constexpr u32 QOI_MAX_RUN    = 62;       //!< 1 回で表せる繰り返しの最大数です.
+static constexpr u32 QOI_HEADER_SIZE = 14;      //!< ヘッダサイズです.
+static constexpr u8  QOI_PADDING[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };   //!< 終端です.
+
+
+//-------------------------------------------------------------------------------------------------
+//      ビッグエンディアンで 32bit 値を書き込みます.
+//-------------------------------------------------------------------------------------------------
+inline u8* WriteU32BE( u8* pDst, u32 value )
+{
+    pDst[0] = u8( value >> 24 );
+    pDst[1] = u8( value >> 16 );
+    pDst[2] = u8( value >>  8 );
+    pDst[3] = u8( value );
+    return pDst + 4;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      色の参照テーブルの番号を求めます.
+//-------------------------------------------------------------------------------------------------
+inline u32 GetIndex( const u8* pColor )
+{ return ( pColor[0] * 3 + pColor[1] * 5 + pColor[2] * 7 + pColor[3] * 11 ) % 64; }
+
+} // namespace /* anonymous */
+
+
+//-------------------------------------------------------------------------------------------------
+//      QOIファイルに保存します.
+//-------------------------------------------------------------------------------------------------
+bool SaveToQoi( const char16* filename, u32 width, u32 height, const u8* pBuffer )
+{
+    if ( filename == nullptr || pBuffer == nullptr || width == 0 || height == 0 )
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    // 全てのピクセルが QOI_OP_RGBA になる場合が最大サイズ.
+    auto pixelCount = size_t( width ) * height;
+    std::vector<u8> data( QOI_HEADER_SIZE + pixelCount * 5 + sizeof(QOI_PADDING) );
+
+    auto pDst = data.data();
+    *pDst++ = 'q';
+    *pDst++ = 'o';
+    *pDst++ = 'i';
+    *pDst++ = 'f';
+    pDst = WriteU32BE( pDst, width );
+    pDst = WriteU32BE( pDst, height );
+    *pDst++ = 4;    // RGBA.
+    *pDst++ = 0;    // sRGB.
+
+    u8  table[64][4] = {};
+    u8  prev[4] = { 0, 0, 0, 255 };
+    u32 run = 0;
+
+    // ピクセルデータは下端の行から並んでいるので, 逆順にたどって上端から書き込む.
+    for( u32 y=0; y<height; ++y )
+    {
+        auto pRow = pBuffer + size_t( height - 1 - y ) * width * 4;
+        for( u32 x=0; x<width; ++x )
+        {
+            auto pColor = pRow + x * 4;
+
+            if ( pColor[0] == prev[0] && pColor[1] == prev[1] && pColor[2] == prev[2] && pColor[3] == prev[3] )
+            {
+                run++;
+                if ( run == QOI_MAX_RUN )
+                {
+                    *pDst++ = u8( QOI_OP_RUN | ( run - 1 ) );
+                    run = 0;
+                }
+                continue;
+            }
+
+            if ( run > 0 )
+            {
+                *pDst++ = u8( QOI_OP_RUN | ( run - 1 ) );
+                run = 0;
+            }
+
+            auto  index = GetIndex( pColor );
+            auto& entry = table[index];
+
+            if ( entry[0] == pColor[0] && entry[1] == pColor[1] && entry[2] == pColor[2] && entry[3] == pColor[3] )
+            {
+                *pDst++ = u8( QOI_OP_INDEX | index );
+            }
+            else
+            {
+                entry[0] = pColor[0];
+                entry[1] = pColor[1];
+                entry[2] = pColor[2];
+                entry[3] = pColor[3];
+
+                if ( pColor[3] == prev[3] )
+                {
+                    auto dr = s8( pColor[0] - prev[0] );
+                    auto dg = s8( pColor[1] - prev[1] );
+                    auto db = s8( pColor[2] - prev[2] );
+
+                    auto dgr = s8( dr - dg );
+                    auto dgb = s8( db - dg );
+
+                    if ( dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1 )
+                    {
+                        *pDst++ = u8( QOI_OP_DIFF | ( ( dr + 2 ) << 4 ) | ( ( dg + 2 ) << 2 ) | ( db + 2 ) );
+                    }
+                    else if ( dgr >= -8 && dgr <= 7 && dg >= -32 && dg <= 31 && dgb >= -8 && dgb <= 7 )
+                    {
+                        *pDst++ = u8( QOI_OP_LUMA | ( dg + 32 ) );
+                        *pDst++ = u8( ( ( dgr + 8 ) << 4 ) | ( dgb + 8 ) );
+                    }
+                    else
+                    {
+                        *pDst++ = QOI_OP_RGB;
+                        *pDst++ = pColor[0];
+                        *pDst++ = pColor[1];
+                        *pDst++ = pColor[2];
+                    }
+                }
+                else
+                {
+                    *pDst++ = QOI_OP_RGBA;
+                    *pDst++ = pColor[0];
+                    *pDst++ = pColor[1];
+                    *pDst++ = pColor[2];
+                    *pDst++ = pColor[3];
+                }
+            }
+
+            prev[0] = pColor[0];
+            prev[1] = pColor[1];
+            prev[2] = pColor[2];
+            prev[3] = pColor[3];
+        }
+    }
+
+    if ( run > 0 )
+    { *pDst++ = u8( QOI_OP_RUN | ( run - 1 ) ); }
+
+    for( auto value : QOI_PADDING )
+    { *pDst++ = value; }
+
+    return WriteImageFile( filename, data.data(), size_t( pDst - data.data() ) );
+}
@@ -0,0 +1,954 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : Renderer.cpp
+// Desc : Software Renderer Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <Renderer.h>
+#include <Meshlet.h>
+#include <Occlusion.h>
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+    #include <xmmintrin.h>
+    #define RENDERER_USE_SSE    (1)
+#endif
+
+
+//-------------------------------------------------------------------------------------------------
+// Using Statements
+//-------------------------------------------------------------------------------------------------
+using namespace asdx;
+
+
+namespace /* anonymous */ {
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// VertexAttribute structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct VertexAttribute
+{
+    Vector2     TexCoord;       //!< テクスチャ座標です.
+    Vector4     Color;          //!< 頂点カラーです.
+};
+
+//-------------------------------------------------------------------------------------------------
+//      2次元ベクトルに変換します.
+//-------------------------------------------------------------------------------------------------
+Vector2 ToVector2( const Vector4& value )
+{ return Vector2( value.x, value.y ); }
+
+//-------------------------------------------------------------------------------------------------
+//      正規化デバイス座標系に変換します。[-1, 1]の範囲です.
+//-------------------------------------------------------------------------------------------------
+Vector4 ToNDC( const Vector4& value )
+{
+    return Vector4(
+        value.x / value.w,
+        value.y / value.w,
+        value.z / value.w,
+        1.0f / value.w );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      スクリーン空間座標系に変換します. [0, 1]の範囲です.
+//-------------------------------------------------------------------------------------------------
+Vector4 ToSS( const Vector4& value )
+{
+    return Vector4(
+        value.x * 0.5f + 0.5f,
+        value.y * 0.5f + 0.5f,
+        value.z,
+        value.w );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      デバイス座標系に変換します. (ビューポートサイズの範囲内).
+//      offsetY は描画先のバッファの先頭行に対応する画像上の行です.
+//-------------------------------------------------------------------------------------------------
+Vector4 ToDC( const Vector4& value, f32 w, f32 h, f32 offsetY )
+{
+    return Vector4(
+        value.x * w,
+        value.y * h - offsetY,
+        value.z,
+        value.w );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      レンダーターゲットが表す画像全体の縦幅を取得します.
+//-------------------------------------------------------------------------------------------------
+inline u32 GetImageHeight( const RenderTarget& target )
+{ return ( target.ImageHeight > 0 ) ? target.ImageHeight : target.Height; }
+
+//-------------------------------------------------------------------------------------------------
+//      2次元ベクトルの外積を求めます.
+//-------------------------------------------------------------------------------------------------
+f32 CrossProduct( const Vector2& a, const Vector2& b )
+{ return a.x * b.y - b.x * a.y; }
+
+//-------------------------------------------------------------------------------------------------
+//      頂点番号リストの位置座標をまとめて射影空間に変換します.
+//-------------------------------------------------------------------------------------------------
+void TransformPositions( const Matrix& matrix, const Vector3* pPositions, const u32* pVertices, u32 count, Vector4* pResult )
+{
+#if defined(RENDERER_USE_SSE)
+    auto r0 = _mm_loadu_ps( &matrix._11 );
+    auto r1 = _mm_loadu_ps( &matrix._21 );
+    auto r2 = _mm_loadu_ps( &matrix._31 );
+    auto r3 = _mm_loadu_ps( &matrix._41 );
+
+    for( u32 i=0; i<count; ++i )
+    {
+        auto& p = pPositions[pVertices[i]];
+        auto  v = _mm_mul_ps( _mm_set1_ps( p.x ), r0 );
+        v = _mm_add_ps( v, _mm_mul_ps( _mm_set1_ps( p.y ), r1 ) );
+        v = _mm_add_ps( v, _mm_mul_ps( _mm_set1_ps( p.z ), r2 ) );
+        v = _mm_add_ps( v, r3 );
+        _mm_storeu_ps( &pResult[i].x, v );
+    }
+#else
+    for( u32 i=0; i<count; ++i )
+    { pResult[i] = Vector4::Transform( Vector4( pPositions[pVertices[i]], 1.0f ), matrix ); }
+#endif
+}
+
+//-------------------------------------------------------------------------------------------------
+//      ラスタライズで補間する頂点属性を取得します.
+//-------------------------------------------------------------------------------------------------
+VertexAttribute FetchAttribute( const DrawMesh& mesh, u32 index )
+{
+    VertexAttribute result;
+    result.TexCoord = ( mesh.pTexCoords != nullptr ) ? mesh.pTexCoords[index] : Vector2( 0.0f, 0.0f );
+
+    if ( mesh.pColors != nullptr )
+    { result.Color = mesh.pColors[index]; }
+    else
+    {
+        // 法線を色として可視化する.
+        auto normal  = ( mesh.pNormals != nullptr ) ? mesh.pNormals[index] : Vector3( 0.0f, 0.0f, 1.0f );
+        result.Color = Vector4( normal * 0.5f + Vector3( 0.5f, 0.5f, 0.5f ), 1.0f );
+    }
+
+    return result;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      射影空間に変換済みの三角形を描画します.
+//-------------------------------------------------------------------------------------------------
+void RasterizeTriangle
+(
+    RenderTarget&           target,
+    const Vector4&          diffuse,
+    const TiledTexture*     pTexture,
+    const SamplerState&     sampler,
+    Vector4                 P0p,
+    Vector4                 P1p,
+    Vector4                 P2p,
+    const VertexAttribute&  v0,
+    const VertexAttribute&  v1,
+    const VertexAttribute&  v2
+)
+{
+    auto w = f32(target.Width);
+    auto h = f32(target.Height);
+
+    // 帯単位で描画する場合も, 画像全体のビューポートで変換してからバッファの位置にずらす.
+    auto imageH  = f32(GetImageHeight(target));
+    auto offsetY = f32(target.OffsetY);
+
+    // 視点の後方にかかる三角形は処理しない.
+    if ( P0p.w <= 0.0f || P1p.w <= 0.0f || P2p.w <= 0.0f )
+    { return; }
+
+    // 正規化デバイス座標系に変換.
+    P0p = ToNDC( P0p );
+    P1p = ToNDC( P1p );
+    P2p = ToNDC( P2p );
+
+    // スクリーン空間座標系に変換.
+    P0p = ToSS( P0p );
+    P1p = ToSS( P1p );
+    P2p = ToSS( P2p );
+
+    // デバイス座標系に変換.
+    P0p = ToDC( P0p, w, imageH, offsetY );
+    P1p = ToDC( P1p, w, imageH, offsetY );
+    P2p = ToDC( P2p, w, imageH, offsetY );
+
+    auto mini = Vector2::Min(ToVector2(P0p), Vector2::Min(ToVector2(P1p), ToVector2(P2p)));
+    auto maxi = Vector2::Max(ToVector2(P0p), Vector2::Max(ToVector2(P1p), ToVector2(P2p)));
+
+    // ビューポートでクリッピング.
+    mini = Vector2::Max( mini, Vector2(0.0f, 0.0f) );
+    maxi = Vector2::Min( maxi, Vector2(w, h) );
+
+    // 三角形の外側は処理しない.
+    if ( mini.x > maxi.x || mini.y > maxi.y )
+    { return; }
+
+    // ラスタライズ処理.
+    auto vs1 = ToVector2(P1p) - ToVector2(P0p);
+    auto vs2 = ToVector2(P2p) - ToVector2(P0p);
+
+    float div = CrossProduct( vs1, vs2 );
+
+    // 書き込み先のチャンネルの並びに合わせる.
+    auto idxR = ( target.ColorOrder == COLOR_ORDER_BGRA ) ? 2 : 0;
+    auto idxB = 2 - idxR;
+
+    // ピクセルサイズに合わせる.
+    auto TriMin = Vector2(floor(mini.x), floor(mini.y));
+    auto TriMax = Vector2(ceil(maxi.x), ceil(maxi.y));
+
+    // ピクセル中心まで移動.
+    TriMin += Vector2(0.5f, 0.5f);
+    TriMax += Vector2(0.5f, 0.5f);
+
+    // 2x2 ピクセルのクアッド単位で処理する. テクスチャのミップレベルはクアッド内の差分で決まるので,
+    // 帯単位で描画する場合も画像上の偶数の行と列からクアッドを始める.
+    auto QuadMin = Vector2(
+        TriMin.x - f32( s32(TriMin.x) & 1 ),
+        TriMin.y - f32( ( s32(TriMin.y) + s32(target.OffsetY) ) & 1 ) );
+
+    auto textured = ( pTexture != nullptr && !pTexture->IsEmpty() );
+
+    // カラーバッファがない場合は, 深度とテクスチャが参照するページだけを記録する.
+    auto feedback = ( target.pColor == nullptr );
+
+    Vector2 vQuad;
+    for( vQuad.y = QuadMin.y; vQuad.y < TriMax.y; vQuad.y += 2.0f )
+    {
+        for( vQuad.x = QuadMin.x; vQuad.x < TriMax.x; vQuad.x += 2.0f )
+        {
+            f32 bs[4], bt[4], bu[4], depth[4];
+            u32 mask = 0;
+
+            // クアッドの並びは (x, y), (x+1, y), (x, y+1), (x+1, y+1) の順.
+            for( u32 i=0; i<4; ++i )
+            {
+                auto vPos = vQuad + Vector2( f32(i & 1), f32(i >> 1) );
+                auto p    = vPos - ToVector2( P0p );
+
+                // p = s * vs1 + t * vs2 となる重みを求める.
+                // 三角形の外側のピクセルの重みもテクスチャ座標の差分に使う.
+                auto s = bs[i] = CrossProduct( p, vs2 ) / div;
+                auto t = bt[i] = CrossProduct( vs1, p ) / div;
+                auto u = bu[i] = 1.0f - s - t;
+
+                // 矩形の外側のピクセルは書き込まない.
+                if ( vPos.x < TriMin.x || vPos.x >= TriMax.x || vPos.y < TriMin.y || vPos.y >= TriMax.y )
+                { continue; }
+
+                if ( s >= 0.0f && t >= 0.0f && u >= 0.0f )
+                {
+                    auto z = P0p.z * u + P1p.z * s + P2p.z * t;
+                    auto w = P0p.w * u + P1p.w * s + P2p.w * t;
+                    depth[i] = (z / w);
+
+                    auto idxD = s32(vPos.y) * target.Width + s32(vPos.x);
+
+                    // シェーディングの前に深度値を比較.
+                    if ( target.pDepth[idxD] >= depth[i] )
+                    { mask |= 1u << i; }
+                }
+            }
+
+            if ( mask == 0 )
+            { continue; }
+
+            Vector4 texel[4];
+            if ( textured )
+            {
+                // テクスチャ座標はパースペクティブ補正する. w には 1/w が入っている.
+                f32 texU[4], texV[4];
+                for( u32 i=0; i<4; ++i )
+                {
+                    auto w0 = P0p.w * bu[i];
+                    auto w1 = P1p.w * bs[i];
+                    auto w2 = P2p.w * bt[i];
+                    auto rcp = 1.0f / ( w0 + w1 + w2 );
+                    texU[i] = ( v0.TexCoord.x * w0 + v1.TexCoord.x * w1 + v2.TexCoord.x * w2 ) * rcp;
+                    texV[i] = ( v0.TexCoord.y * w0 + v1.TexCoord.y * w1 + v2.TexCoord.y * w2 ) * rcp;
+                }
+
+                if ( feedback )
+                { RequestQuad( *pTexture, sampler, texU, texV ); }
+                else
+                { SampleQuad( *pTexture, sampler, texU, texV, texel ); }
+            }
+
+            for( u32 i=0; i<4; ++i )
+            {
+                if ( ( mask & ( 1u << i ) ) == 0 )
+                { continue; }
+
+                // クアッドは矩形の 1 つ手前から始まることがあるので, ピクセル中心から求める.
+                auto x = s32(vQuad.x + f32(i & 1));
+                auto y = s32(vQuad.y + f32(i >> 1));
+
+                if ( feedback )
+                {
+                    target.pDepth[y * target.Width + x] = depth[i];
+                    continue;
+                }
+
+                auto u = bu[i];
+                auto s = bs[i];
+                auto t = bt[i];
+
+                auto col = v0.Color * u + v1.Color * s + v2.Color * t;
+                col = Vector4(
+                    col.x * diffuse.x,
+                    col.y * diffuse.y,
+                    col.z * diffuse.z,
+                    col.w * diffuse.w );
+
+                if ( textured )
+                {
+                    col = Vector4(
+                        col.x * texel[i].x,
+                        col.y * texel[i].y,
+                        col.z * texel[i].z,
+                        col.w * texel[i].w );
+                }
+
+                auto idxC = y * target.Width * 4 + x * 4;
+
+                target.pColor[idxC + idxR] = asdx::Clamp( int(col.x * 255.0f), 0, 255 );
+                target.pColor[idxC + 1   ] = asdx::Clamp( int(col.y * 255.0f), 0, 255 );
+                target.pColor[idxC + idxB] = asdx::Clamp( int(col.z * 255.0f), 0, 255 );
+                target.pColor[idxC + 3] = asdx::Clamp( int(col.w * 255.0f), 0, 255 );
+
+                target.pDepth[y * target.Width + x] = depth[i];
+            }
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      メッシュレットの頂点を 1 回ずつワールドビュー射影行列で変換して描画します.
+//-------------------------------------------------------------------------------------------------
+void DrawMeshlet
+(
+    const Matrix&       worldViewProj,
+    const Vector4&      diffuse,
+    const TiledTexture* pTexture,
+    const SamplerState& sampler,
+    RenderTarget&       target,
+    const DrawMesh&     mesh,
+    const Meshlet&      meshlet
+)
+{
+    if ( meshlet.VertexCount > MESHLET_MAX_VERTICES )
+    { return; }
+
+    auto pVertices = mesh.pMeshletVertices + meshlet.VertexOffset;
+    auto pIndices  = mesh.pMeshletIndices  + meshlet.Offset;
+
+    Vector4 clip[MESHLET_MAX_VERTICES];
+    TransformPositions( worldViewProj, mesh.pPositions, pVertices, meshlet.VertexCount, clip );
+
+    auto count = meshlet.Count - meshlet.Count % 3;
+    for( u32 i=0; i<count; i += 3 )
+    {
+        auto i0 = pIndices[i + 0];
+        auto i1 = pIndices[i + 1];
+        auto i2 = pIndices[i + 2];
+
+        RasterizeTriangle( target, diffuse, pTexture, sampler,
+            clip[i0], clip[i1], clip[i2],
+            FetchAttribute( mesh, pVertices[i0] ),
+            FetchAttribute( mesh, pVertices[i1] ),
+            FetchAttribute( mesh, pVertices[i2] ) );
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      メッシュレットの頂点を 1 回ずつ変換して, 三角形を描画せずにビンへ追加します.
+//-------------------------------------------------------------------------------------------------
+void BinMeshlet
+(
+    const Matrix&       worldViewProj,
+    const Vector4&      diffuse,
+    const TiledTexture* pTexture,
+    const SamplerState& sampler,
+    TriangleBin&        bin,
+    const DrawMesh&     mesh,
+    const Meshlet&      meshlet
+)
+{
+    if ( meshlet.VertexCount > MESHLET_MAX_VERTICES )
+    { return; }
+
+    auto pVertices = mesh.pMeshletVertices + meshlet.VertexOffset;
+    auto pIndices  = mesh.pMeshletIndices  + meshlet.Offset;
+
+    Vector4 clip[MESHLET_MAX_VERTICES];
+    TransformPositions( worldViewProj, mesh.pPositions, pVertices, meshlet.VertexCount, clip );
+
+    auto count = meshlet.Count - meshlet.Count % 3;
+    for( u32 i=0; i<count; i += 3 )
+    {
+        auto i0 = pIndices[i + 0];
+        auto i1 = pIndices[i + 1];
+        auto i2 = pIndices[i + 2];
+
+        // 視点の後方にかかる三角形は描画されないので, ビンに入れない.
+        auto nearW = Min( clip[i0].w, Min( clip[i1].w, clip[i2].w ) );
+        if ( nearW <= 0.0f )
+        { continue; }
+
+        BinTriangle triangle;
+        triangle.Position[0] = clip[i0];
+        triangle.Position[1] = clip[i1];
+        triangle.Position[2] = clip[i2];
+        triangle.Diffuse     = diffuse;
+        triangle.pTexture    = pTexture;
+        triangle.Sampler     = sampler;
+        triangle.pMesh       = &mesh;
+        triangle.Vertices[0] = pVertices[i0];
+        triangle.Vertices[1] = pVertices[i1];
+        triangle.Vertices[2] = pVertices[i2];
+
+        // 正の浮動小数のビット列は値と同じ順に並ぶので, ビュー空間の奥行きをそのままキーにする.
+        u32 key;
+        memcpy( &key, &nearW, sizeof(key) );
+
+        bin.Triangles.push_back( triangle );
+        bin.Keys     .push_back( key );
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      ビンに追加した三角形を描画します.
+//-------------------------------------------------------------------------------------------------
+void RasterizeBinTriangle( RenderTarget& target, const BinTriangle& triangle )
+{
+    auto& mesh = *triangle.pMesh;
+    RasterizeTriangle( target, triangle.Diffuse, triangle.pTexture, triangle.Sampler,
+        triangle.Position[0], triangle.Position[1], triangle.Position[2],
+        FetchAttribute( mesh, triangle.Vertices[0] ),
+        FetchAttribute( mesh, triangle.Vertices[1] ),
+        FetchAttribute( mesh, triangle.Vertices[2] ) );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      キーの昇順に並べた描画順を基数ソートで求めます. 同じキーの間では元の順を保ちます.
+//-------------------------------------------------------------------------------------------------
+void SortBin( TriangleBin& bin )
+{
+    auto count = u32( bin.Keys.size() );
+
+    bin.Order    .resize( count );
+    bin.TempKeys .resize( count );
+    bin.TempOrder.resize( count );
+
+    for( u32 i=0; i<count; ++i )
+    { bin.Order[i] = i; }
+
+    // 8 ビットずつ下位から 4 パス. 全て同じ桁になるパスは飛ばす.
+    for( u32 shift=0; shift<32; shift += 8 )
+    {
+        u32 histogram[256] = {};
+        for( u32 i=0; i<count; ++i )
+        { histogram[( bin.Keys[i] >> shift ) & 0xff]++; }
+
+        if ( histogram[( bin.Keys[0] >> shift ) & 0xff] == count )
+        { continue; }
+
+        u32 sum = 0;
+        for( auto& bucket : histogram )
+        {
+            auto c = bucket;
+            bucket = sum;
+            sum += c;
+        }
+
+        for( u32 i=0; i<count; ++i )
+        {
+            auto dst = histogram[( bin.Keys[i] >> shift ) & 0xff]++;
+            bin.TempKeys [dst] = bin.Keys [i];
+            bin.TempOrder[dst] = bin.Order[i];
+        }
+
+        std::swap( bin.Keys,  bin.TempKeys );
+        std::swap( bin.Order, bin.TempOrder );
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      ビンの三角形を手前から順に描画して空にします.
+//-------------------------------------------------------------------------------------------------
+void FlushBin( RenderTarget& target, TriangleBin& bin )
+{
+    if ( bin.Triangles.empty() )
+    { return; }
+
+    SortBin( bin );
+
+    for( auto index : bin.Order )
+    { RasterizeBinTriangle( target, bin.Triangles[index] ); }
+
+    bin.Triangles.clear();
+    bin.Keys     .clear();
+}
+
+//-------------------------------------------------------------------------------------------------
+//      メッシュレットをワールド空間に変換します.
+//-------------------------------------------------------------------------------------------------
+Meshlet TransformMeshlet( const Meshlet& meshlet, const Matrix& world, f32 scale, bool uniform )
+{
+    auto result = meshlet;
+    result.Center = Vector3::Transform( meshlet.Center, world );
+    result.Radius = meshlet.Radius * scale;
+
+    // 非一様スケールでは法線コーンが保てないので, 背面カリングしない.
+    if ( uniform )
+    { result.ConeAxis = Vector3::Normalize( Vector3::TransformNormal( meshlet.ConeAxis, world ) ); }
+    else
+    { result.ConeCutoff = 1.0f; }
+
+    return result;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      ワールド行列の各軸のスケールを求めます.
+//-------------------------------------------------------------------------------------------------
+f32 GetMaxScale( const Matrix& world, bool* pUniform )
+{
+    auto sx = Vector3( world._11, world._12, world._13 ).Length();
+    auto sy = Vector3( world._21, world._22, world._23 ).Length();
+    auto sz = Vector3( world._31, world._32, world._33 ).Length();
+    auto scale = Max( sx, Max( sy, sz ) );
+
+    if ( pUniform != nullptr )
+    { *pUniform = ( scale - Min( sx, Min( sy, sz ) ) ) <= scale * 1e-4f; }
+
+    return scale;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      バウンディングスフィアまでの距離を求めます. 球の内側にある場合は 0 以下になります.
+//-------------------------------------------------------------------------------------------------
+f32 GetSphereDistance( const CullingView& view, const DrawMesh& mesh, const Matrix& world, f32 scale, f32* pRadius )
+{
+    auto center = Vector3::Transform( ( mesh.Bounds.Mini + mesh.Bounds.Maxi ) * 0.5f, world );
+    auto radius = ( mesh.Bounds.Maxi - mesh.Bounds.Mini ).Length() * 0.5f * scale;
+
+    if ( pRadius != nullptr )
+    { *pRadius = radius; }
+
+    return ( center - view.CameraPos ).Length() - radius;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      画面上の誤差が許容値以下になる最も粗い LOD を選択します.
+//-------------------------------------------------------------------------------------------------
+u32 SelectLod( const CullingView& view, const DrawMesh& mesh, f32 distance, f32 scale, f32 height, f32 maxError )
+{
+    u32 lod = 0;
+    if ( mesh.pLods == nullptr || distance <= 0.0f )
+    { return lod; }
+
+    // オブジェクト空間の誤差を画面上のピクセル数に換算する.
+    auto pixelScale = scale * view.ProjScale * height * 0.5f / distance;
+    while( lod + 1 < mesh.LodCount && mesh.pLods[lod + 1].Error * pixelScale <= maxError )
+    { lod++; }
+
+    return lod;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      インスタンスをカリングして, 可視なメッシュレットを描画またはビンへ追加します.
+//      retain が true の場合はビンの三角形を描画せずに全て溜めます.
+//-------------------------------------------------------------------------------------------------
+DrawStats ProcessInstances
+(
+    const CullingView&      view,
+    RenderTarget&           target,
+    const DrawMesh&         mesh,
+    const Matrix*           pInstances,
+    u32                     instanceCount,
+    CoarseDepth*            pDepth,
+    const OcclusionBuffer*  pOcclusion,
+    TriangleBin*            pBin,
+    bool                    retain
+)
+{
+    DrawStats stats = {};
+    if ( mesh.pPositions == nullptr || mesh.pMeshletVertices == nullptr || mesh.pMeshletIndices == nullptr || mesh.pMeshlets == nullptr || pInstances == nullptr )
+    { return stats; }
+
+    if ( pBin != nullptr )
+    {
+        pBin->Triangles.clear();
+        pBin->Keys     .clear();
+        pBin->Triangles.reserve( TRIANGLE_BIN_CAPACITY );
+        pBin->Keys     .reserve( TRIANGLE_BIN_CAPACITY );
+
+        // ビンを使う場合, 粗い深度は描画済みの深度が変わるフラッシュの後だけ更新する.
+        if ( pDepth != nullptr )
+        { UpdateCoarseDepth( target, *pDepth ); }
+    }
+
+    auto white = Vector4( 1.0f, 1.0f, 1.0f, 1.0f );
+
+    for( u32 i=0; i<instanceCount; ++i )
+    {
+        auto& world = pInstances[i];
+        stats.Instances++;
+
+        // 変換後のバウンディングボックスでインスタンスをカリング.
+        auto worldBox = TransformBox( mesh.Bounds, world );
+        if ( TestFrustum( view, worldBox ) == FrustumTest::Outside )
+        { continue; }
+
+        // 遮蔽物に完全に隠れていれば, メッシュレットを調べる前に棄却する.
+        if ( pOcclusion != nullptr && IsOccluded( *pOcclusion, view.WorldViewProj, worldBox ) )
+        {
+            stats.OccludedInstances++;
+            continue;
+        }
+
+        stats.VisibleInstances++;
+
+        // 各軸のスケールからバウンディングスフィアの拡大率を求める.
+        bool uniform = false;
+        auto scale   = GetMaxScale( world, &uniform );
+
+        // インスタンスごとに1回だけ行列を合成する.
+        auto worldViewProj = world * view.WorldViewProj;
+
+        // バウンディングスフィアまでの距離から, 画面上の誤差が許容値以下の LOD を選ぶ.
+        auto meshletBegin = 0u;
+        auto meshletEnd   = mesh.MeshletCount;
+        if ( mesh.pLods != nullptr && mesh.LodCount > 0 )
+        {
+            auto distance = GetSphereDistance( view, mesh, world, scale, nullptr );
+            auto lod      = SelectLod( view, mesh, distance, scale, f32( GetImageHeight( target ) ), LOD_PIXEL_ERROR );
+
+            meshletBegin = mesh.pLods[lod].MeshletOffset;
+            meshletEnd   = Min( meshletBegin + mesh.pLods[lod].MeshletCount, mesh.MeshletCount );
+        }
+
+        u32 currentMaterial = U32_MAX;
+        auto diffuse = white;
+        const TiledTexture* pTexture = nullptr;
+
+        for( auto j=meshletBegin; j<meshletEnd; ++j )
+        {
+            auto& meshlet = mesh.pMeshlets[j];
+
+            // ビンが一杯になったら, 手前から順に描画して空ける.
+            if ( pBin != nullptr && !retain && pBin->Triangles.size() + meshlet.Count / 3 > TRIANGLE_BIN_CAPACITY )
+            {
+                FlushBin( target, *pBin );
+
+                if ( pDepth != nullptr )
+                { UpdateCoarseDepth( target, *pDepth ); }
+            }
+
+            // 描画済みの面で遮蔽されたメッシュレットを判定できるように, 一定間隔で粗い深度を更新する.
+            if ( pDepth != nullptr && pBin == nullptr && stats.Meshlets % COARSE_UPDATE_INTERVAL == 0 )
+            { UpdateCoarseDepth( target, *pDepth ); }
+
+            stats.Meshlets++;
+
+            // 頂点変換の前にメッシュレット単位でカリング.
+            auto bounds = TransformMeshlet( meshlet, world, scale, uniform );
+            if ( !IsMeshletVisible( view, pDepth, bounds ) )
+            { continue; }
+
+            if ( pOcclusion != nullptr )
+            {
+                auto radius = Vector3( bounds.Radius, bounds.Radius, bounds.Radius );
+
+                BoundingBox box;
+                box.Mini = bounds.Center - radius;
+                box.Maxi = bounds.Center + radius;
+
+                if ( IsOccluded( *pOcclusion, view.WorldViewProj, box ) )
+                {
+                    stats.OccludedMeshlets++;
+                    continue;
+                }
+            }
+
+            // マテリアルが切り替わった時だけ色を設定する.
+            if ( meshlet.MaterialId != currentMaterial )
+            {
+                currentMaterial = meshlet.MaterialId;
+                diffuse = ( currentMaterial < mesh.MaterialCount ) ? mesh.pMaterials[currentMaterial] : white;
+
+                pTexture = nullptr;
+                if ( mesh.pTextures != nullptr && currentMaterial < mesh.MaterialCount && !mesh.pTextures[currentMaterial].IsEmpty() )
+                { pTexture = &mesh.pTextures[currentMaterial]; }
+            }
+
+            if ( pBin != nullptr )
+            { BinMeshlet( worldViewProj, diffuse, pTexture, mesh.Sampler, *pBin, mesh, meshlet ); }
+            else
+            { DrawMeshlet( worldViewProj, diffuse, pTexture, mesh.Sampler, target, mesh, meshlet ); }
+
+            stats.VisibleMeshlets++;
+            stats.Triangles += meshlet.Count / 3;
+            stats.Vertices  += meshlet.VertexCount;
+        }
+    }
+
+    if ( pBin != nullptr && !retain )
+    { FlushBin( target, *pBin ); }
+
+    return stats;
+}
+
+} // namespace /* anonymous */
+
+
+//-------------------------------------------------------------------------------------------------
+//      レンダーターゲットをクリアします.
+//-------------------------------------------------------------------------------------------------
+void ClearRenderTarget( RenderTarget& target )
+{
+    for( u32 i=0; i<target.Height; ++i )
+    {
+        for( u32 j=0; j<target.Width; ++j )
+        {
+            if ( target.pColor != nullptr )
+            {
+                auto idx = i * target.Width * 4 + j * 4;
+                target.pColor[idx + 0] = 255;
+                target.pColor[idx + 1] = 255;
+                target.pColor[idx + 2] = 255;
+                target.pColor[idx + 3] = 255;
+            }
+
+            auto idx = i * target.Width + j;
+            target.pDepth[idx] = F32_MAX;
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      メッシュをインスタンスごとのワールド行列で描画します.
+//-------------------------------------------------------------------------------------------------
+DrawStats DrawInstanced
+(
+    const CullingView&      view,
+    RenderTarget&           target,
+    const DrawMesh&         mesh,
+    const Matrix*           pInstances,
+    u32                     instanceCount,
+    CoarseDepth*            pDepth,
+    const OcclusionBuffer*  pOcclusion,
+    TriangleBin*            pBin
+)
+{ return ProcessInstances( view, target, mesh, pInstances, instanceCount, pDepth, pOcclusion, pBin, false ); }
+
+//-------------------------------------------------------------------------------------------------
+//      メッシュを 1 回だけ変換して, 画像を分割した帯ごとに三角形を振り分けます.
+//-------------------------------------------------------------------------------------------------
+DrawStats BinInstanced
+(
+    const CullingView&      view,
+    const RenderTarget&     target,
+    const DrawMesh&         mesh,
+    const Matrix*           pInstances,
+    u32                     instanceCount,
+    const OcclusionBuffer*  pOcclusion,
+    StripBin&               bin
+)
+{
+    auto imageH = GetImageHeight( target );
+
+    bin.StripHeight = Max( target.Height, 1u );
+    bin.Strips.resize( ( imageH + bin.StripHeight - 1 ) / bin.StripHeight );
+    for( auto& strip : bin.Strips )
+    { strip.clear(); }
+
+    // 三角形は溜めるだけなので, 描画先のバッファには触れない.
+    auto layout = target;
+    layout.pColor = nullptr;
+    layout.pDepth = nullptr;
+
+    auto stats = ProcessInstances( view, layout, mesh, pInstances, instanceCount, nullptr, pOcclusion, &bin.Bin, true );
+    if ( bin.Bin.Triangles.empty() )
+    { return stats; }
+
+    // 全体を 1 回だけソートし, その順に振り分けることで各帯の中も手前から並ぶ.
+    SortBin( bin.Bin );
+
+    auto w = f32( target.Width );
+    auto h = f32( imageH );
+
+    for( auto index : bin.Bin.Order )
+    {
+        auto& triangle = bin.Bin.Triangles[index];
+
+        auto mini = Vector2( F32_MAX, F32_MAX );
+        auto maxi = Vector2(-F32_MAX,-F32_MAX );
+        for( auto i=0; i<3; ++i )
+        {
+            auto& p   = triangle.Position[i];
+            auto  pos = Vector2( ( p.x / p.w * 0.5f + 0.5f ) * w, ( p.y / p.w * 0.5f + 0.5f ) * h );
+            mini = Vector2::Min( mini, pos );
+            maxi = Vector2::Max( maxi, pos );
+        }
+
+        // 画面外の三角形はどの帯にも入れない.
+        if ( maxi.x < 0.0f || mini.x > w || maxi.y < 0.0f || mini.y > h )
+        { continue; }
+
+        // 帯の境界での丸め誤差を考えて, 上下に 1 行広げて振り分ける.
+        auto row0 = Max( s32( floorf( Max( mini.y, 0.0f ) ) ) - 1, 0 );
+        auto row1 = Min( s32( ceilf ( Min( maxi.y, h    ) ) ) + 1, s32( imageH ) - 1 );
+
+        for( auto i = u32( row0 ) / bin.StripHeight; i <= u32( row1 ) / bin.StripHeight; ++i )
+        { bin.Strips[i].push_back( index ); }
+    }
+
+    return stats;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      BinInstanced() で振り分けた三角形のうち, 描画先の帯に含まれるものを描画します.
+//-------------------------------------------------------------------------------------------------
+void DrawStrip( RenderTarget& target, const StripBin& bin )
+{
+    if ( bin.StripHeight == 0 || target.OffsetY % bin.StripHeight != 0 )
+    { return; }
+
+    auto index = target.OffsetY / bin.StripHeight;
+    if ( index >= bin.Strips.size() )
+    { return; }
+
+    for( auto i : bin.Strips[index] )
+    { RasterizeBinTriangle( target, bin.Bin.Triangles[i] ); }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      画面上で大きなインスタンスを遮蔽物として遮蔽バッファに描画します.
+//-------------------------------------------------------------------------------------------------
+u32 DrawOccluders
+(
+    const CullingView&  view,
+    OcclusionBuffer&    buffer,
+    const DrawMesh&     mesh,
+    const Matrix*       pInstances,
+    u32                 instanceCount
+)
+{
+    if ( mesh.pPositions == nullptr || mesh.pMeshletVertices == nullptr || mesh.pMeshletIndices == nullptr || mesh.pMeshlets == nullptr || pInstances == nullptr )
+    { return 0; }
+
+    struct Candidate
+    {
+        u32 Index;      // インスタンス番号.
+        f32 Size;       // 投影半径 (画面の高さに対する割合).
+    };
+
+    // 投影半径が大きいインスタンスほど多くを隠すので, 大きい順に選ぶ.
+    std::vector<Candidate> candidates;
+    for( u32 i=0; i<instanceCount; ++i )
+    {
+        auto& world = pInstances[i];
+        if ( TestFrustum( view, TransformBox( mesh.Bounds, world ) ) == FrustumTest::Outside )
+        { continue; }
+
+        auto radius   = 0.0f;
+        auto distance = GetSphereDistance( view, mesh, world, GetMaxScale( world, nullptr ), &radius );
+        auto size     = ( distance > 0.0f ) ? radius * view.ProjScale * 0.5f / ( distance + radius ) : F32_MAX;
+        if ( size >= OCCLUDER_MIN_SCREEN_SIZE )
+        { candidates.push_back( { i, size } ); }
+    }
+
+    std::sort( candidates.begin(), candidates.end(),
+        []( const Candidate& lhs, const Candidate& rhs )
+        { return lhs.Size > rhs.Size; } );
+
+    if ( candidates.size() > OCCLUDER_MAX_INSTANCES )
+    { candidates.resize( OCCLUDER_MAX_INSTANCES ); }
+
+    // 近平面の法線はオブジェクト空間の視線方向になる.
+    auto forward = Vector3( view.Planes[4].x, view.Planes[4].y, view.Planes[4].z );
+
+    for( auto& candidate : candidates )
+    {
+        auto& world = pInstances[candidate.Index];
+
+        bool uniform  = false;
+        auto scale    = GetMaxScale( world, &uniform );
+        auto distance = GetSphereDistance( view, mesh, world, scale, nullptr );
+
+        // 遮蔽バッファの解像度で誤差が 1 ピクセル以下になる LOD を使う.
+        auto meshletBegin = 0u;
+        auto meshletEnd   = mesh.MeshletCount;
+        auto error        = 0.0f;
+        if ( mesh.pLods != nullptr && mesh.LodCount > 0 )
+        {
+            auto lod = SelectLod( view, mesh, distance, scale, f32( buffer.Height ), 1.0f );
+            meshletBegin = mesh.pLods[lod].MeshletOffset;
+            meshletEnd   = Min( meshletBegin + mesh.pLods[lod].MeshletCount, mesh.MeshletCount );
+            error        = mesh.pLods[lod].Error * scale;
+        }
+
+        // 簡略化で手前にはみ出した分だけ視線方向の奥へずらし, 過剰に隠さないようにする.
+        auto clipOffset    = Vector4::Transform( Vector4( forward * error, 0.0f ), view.WorldViewProj );
+        auto worldViewProj = world * view.WorldViewProj;
+
+        for( auto j=meshletBegin; j<meshletEnd; ++j )
+        {
+            auto& meshlet = mesh.pMeshlets[j];
+
+            // 本描画でカリングされる面は遮蔽物にもしない.
+            if ( !IsMeshletVisible( view, nullptr, TransformMeshlet( meshlet, world, scale, uniform ) ) )
+            { continue; }
+
+            RasterizeOccluder( buffer, worldViewProj, mesh.pPositions,
+                mesh.pMeshletVertices + meshlet.VertexOffset, meshlet.VertexCount,
+                mesh.pMeshletIndices  + meshlet.Offset,       meshlet.Count,
+                clipOffset );
+        }
+    }
+
+    ResolveOcclusionBuffer( buffer );
+
+    return u32( candidates.size() );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      描画バッチをマテリアルごとにまとめます.
+//-------------------------------------------------------------------------------------------------
+void SortDrawBatches( std::vector<DrawBatch>& batches )
+{
+    std::stable_sort( batches.begin(), batches.end(),
+        []( const DrawBatch& lhs, const DrawBatch& rhs )
+        { return lhs.MaterialId < rhs.MaterialId; } );
+
+    // 同じマテリアルで連続する範囲は1つのバッチにする.
+    size_t count = 0;
+    for( size_t i=0; i<batches.size(); ++i )
+    {
+        if ( batches[i].Count == 0 )
+        { continue; }
+
+        if ( count > 0 )
+        {
+            auto& prev = batches[count - 1];
+            if ( prev.MaterialId == batches[i].MaterialId && prev.Offset + prev.Count == batches[i].Offset )
+            {
+                prev.Count += batches[i].Count;
+                continue;
+            }
+        }
+
+        batches[count++] = batches[i];
+    }
+
+    batches.resize( count );
+}
@@ -0,0 +1,1063 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : Sampler.cpp
+// Desc : Texture Sampler Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <Sampler.h>
+#include <Texture.h>
+#include <VirtualTexture.h>
+#include <Parallel.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <asdxLogger.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+    #include <emmintrin.h>
+    #define SAMPLER_USE_SSE2    (1)
+#endif
+
+
+namespace /* anonymous */ {
+
+//-------------------------------------------------------------------------------------------------
+// Constant Values
+//-------------------------------------------------------------------------------------------------
+static constexpr u32 TILE_TEXEL_COUNT  = TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE;   //!< 1 タイルのテクセル数です.
+static constexpr f32 COORD_LIMIT       = 8388608.0f;    //!< テクスチャ座標の絶対値の上限です. これより大きい浮動小数は全て整数です.
+static constexpr u32 BLOCK_CACHE_SIZE  = 128;           //!< スレッドごとに保持する展開済みのブロック数です. 2 のべき乗にします.
+static constexpr u32 ENCODE_MIN_ROWS   = 16;            //!< 圧縮で 1 スレッドが処理する最小のタイルの行数です.
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// BlockCache structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct BlockCache
+{
+    u64             Keys[BLOCK_CACHE_SIZE];                             //!< ブロックの識別子です. 0 は空きです.
+    alignas(64) u8  Texels[BLOCK_CACHE_SIZE][TILE_TEXEL_COUNT * 4];     //!< 展開したテクセルです.
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Global Variables
+//-------------------------------------------------------------------------------------------------
+static std::atomic<u32>         g_TextureId( 0 );   //!< 最後に割り当てたテクスチャの識別子です.
+static thread_local BlockCache  g_BlockCache;       //!< 展開したブロックのキャッシュです.
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Footprint structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct Footprint
+{
+    s32     X0[4];      //!< 左のテクセルの列です.
+    s32     X1[4];      //!< 右のテクセルの列です.
+    s32     Y0[4];      //!< 下のテクセルの行です.
+    s32     Y1[4];      //!< 上のテクセルの行です.
+    f32     FracX[4];   //!< 横方向の補間係数です.
+    f32     FracY[4];   //!< 縦方向の補間係数です.
+};
+
+//-------------------------------------------------------------------------------------------------
+//      1 タイルのバイト数を取得します.
+//-------------------------------------------------------------------------------------------------
+inline u32 GetTileSize( TEXTURE_FORMAT format )
+{
+    switch( format )
+    {
+    case TEXTURE_FORMAT_BC1: return 8;
+    case TEXTURE_FORMAT_BC3: return 16;
+    default:                 return TILE_TEXEL_COUNT * 4;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      RGB565 を RGB8 に展開します.
+//-------------------------------------------------------------------------------------------------
+inline void DecodeRGB565( u16 color, u8* pRGB )
+{
+    auto r = ( color >> 11 ) & 0x1f;
+    auto g = ( color >> 5  ) & 0x3f;
+    auto b = ( color       ) & 0x1f;
+    pRGB[0] = u8( ( r << 3 ) | ( r >> 2 ) );
+    pRGB[1] = u8( ( g << 2 ) | ( g >> 4 ) );
+    pRGB[2] = u8( ( b << 3 ) | ( b >> 2 ) );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      RGB8 を RGB565 に量子化します.
+//-------------------------------------------------------------------------------------------------
+inline u16 EncodeRGB565( const f32* pRGB )
+{
+    auto r = u32( asdx::Clamp( pRGB[0], 0.0f, 255.0f ) * 31.0f / 255.0f + 0.5f );
+    auto g = u32( asdx::Clamp( pRGB[1], 0.0f, 255.0f ) * 63.0f / 255.0f + 0.5f );
+    auto b = u32( asdx::Clamp( pRGB[2], 0.0f, 255.0f ) * 31.0f / 255.0f + 0.5f );
+    return u16( ( r << 11 ) | ( g << 5 ) | b );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      カラーブロックの 4 色のパレットを求めます.
+//      opaque が false の場合は c0 <= c1 で 3 色と透明の黒になります.
+//-------------------------------------------------------------------------------------------------
+void GetColorPalette( u16 c0, u16 c1, bool opaque, u8 (*pPalette)[4] )
+{
+    DecodeRGB565( c0, pPalette[0] );
+    DecodeRGB565( c1, pPalette[1] );
+    pPalette[0][3] = 255;
+    pPalette[1][3] = 255;
+    pPalette[2][3] = 255;
+    pPalette[3][3] = 255;
+
+    if ( opaque || c0 > c1 )
+    {
+        for( u32 ch=0; ch<3; ++ch )
+        {
+            pPalette[2][ch] = u8( ( 2 * pPalette[0][ch] + pPalette[1][ch] + 1 ) / 3 );
+            pPalette[3][ch] = u8( ( pPalette[0][ch] + 2 * pPalette[1][ch] + 1 ) / 3 );
+        }
+    }
+    else
+    {
+        for( u32 ch=0; ch<3; ++ch )
+        {
+            pPalette[2][ch] = u8( ( pPalette[0][ch] + pPalette[1][ch] + 1 ) / 2 );
+            pPalette[3][ch] = 0;
+        }
+        pPalette[3][3] = 0;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      アルファブロックの 8 段階のパレットを求めます.
+//-------------------------------------------------------------------------------------------------
+void GetAlphaPalette( u8 a0, u8 a1, u8* pPalette )
+{
+    pPalette[0] = a0;
+    pPalette[1] = a1;
+
+    if ( a0 > a1 )
+    {
+        for( u32 i=1; i<7; ++i )
+        { pPalette[i + 1] = u8( ( ( 7 - i ) * a0 + i * a1 + 3 ) / 7 ); }
+    }
+    else
+    {
+        for( u32 i=1; i<5; ++i )
+        { pPalette[i + 1] = u8( ( ( 5 - i ) * a0 + i * a1 + 2 ) / 5 ); }
+        pPalette[6] = 0;
+        pPalette[7] = 255;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      カラーブロックを展開します. アルファも書き込みます.
+//-------------------------------------------------------------------------------------------------
+void DecodeColorBlock( const u8* pBlock, bool opaque, u8* pTexels )
+{
+    auto c0      = u16( pBlock[0] | ( pBlock[1] << 8 ) );
+    auto c1      = u16( pBlock[2] | ( pBlock[3] << 8 ) );
+    auto indices = u32( pBlock[4] ) | ( u32( pBlock[5] ) << 8 ) | ( u32( pBlock[6] ) << 16 ) | ( u32( pBlock[7] ) << 24 );
+
+    u8 palette[4][4];
+    GetColorPalette( c0, c1, opaque, palette );
+
+    for( u32 i=0; i<TILE_TEXEL_COUNT; ++i )
+    { memcpy( pTexels + i * 4, palette[( indices >> ( i * 2 ) ) & 0x3], 4 ); }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      アルファブロックを展開します.
+//-------------------------------------------------------------------------------------------------
+void DecodeAlphaBlock( const u8* pBlock, u8* pTexels )
+{
+    u8 palette[8];
+    GetAlphaPalette( pBlock[0], pBlock[1], palette );
+
+    u64 indices = 0;
+    for( u32 i=0; i<6; ++i )
+    { indices |= u64( pBlock[2 + i] ) << ( i * 8 ); }
+
+    for( u32 i=0; i<TILE_TEXEL_COUNT; ++i )
+    { pTexels[i * 4 + 3] = palette[( indices >> ( i * 3 ) ) & 0x7]; }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      カラーブロックに圧縮します. アルファは無視します.
+//-------------------------------------------------------------------------------------------------
+void EncodeColorBlock( const u8* pTexels, u8* pBlock )
+{
+    // 平均と共分散.
+    f32 mean[3] = {};
+    for( u32 i=0; i<TILE_TEXEL_COUNT; ++i )
+    {
+        for( u32 ch=0; ch<3; ++ch )
+        { mean[ch] += pTexels[i * 4 + ch]; }
+    }
+    for( u32 ch=0; ch<3; ++ch )
+    { mean[ch] /= f32( TILE_TEXEL_COUNT ); }
+
+    f32 cov[6] = {};
+    for( u32 i=0; i<TILE_TEXEL_COUNT; ++i )
+    {
+        auto r = pTexels[i * 4 + 0] - mean[0];
+        auto g = pTexels[i * 4 + 1] - mean[1];
+        auto b = pTexels[i * 4 + 2] - mean[2];
+        cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+        cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+    }
+
+    // 主軸をべき乗法で求める.
+    f32 axis[3] = { 1.0f, 1.0f, 1.0f };
+    for( u32 iter=0; iter<4; ++iter )
+    {
+        f32 v[3] = {
+            cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+            cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+            cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2],
+        };
+
+        auto scale = asdx::Max( fabsf( v[0] ), asdx::Max( fabsf( v[1] ), fabsf( v[2] ) ) );
+        if ( scale < 1e-6f )
+        { break; }
+
+        for( u32 ch=0; ch<3; ++ch )
+        { axis[ch] = v[ch] / scale; }
+    }
+
+    // 主軸上で両端にあるテクセルを端点にする.
+    u32 minIndex = 0;
+    u32 maxIndex = 0;
+    auto minDot = F32_MAX;
+    auto maxDot = -F32_MAX;
+    for( u32 i=0; i<TILE_TEXEL_COUNT; ++i )
+    {
+        auto d = pTexels[i * 4 + 0] * axis[0] + pTexels[i * 4 + 1] * axis[1] + pTexels[i * 4 + 2] * axis[2];
+        if ( d < minDot ) { minDot = d; minIndex = i; }
+        if ( d > maxDot ) { maxDot = d; maxIndex = i; }
+    }
+
+    // 補間色が端に寄りすぎないように, 範囲の 1/16 だけ内側に寄せる.
+    f32 hi[3], lo[3];
+    for( u32 ch=0; ch<3; ++ch )
+    {
+        f32 a = pTexels[maxIndex * 4 + ch];
+        f32 b = pTexels[minIndex * 4 + ch];
+        auto inset = ( a - b ) / 16.0f;
+        hi[ch] = a - inset;
+        lo[ch] = b + inset;
+    }
+
+    auto c0 = EncodeRGB565( hi );
+    auto c1 = EncodeRGB565( lo );
+
+    // c0 > c1 で 4 色のモードになる. 等しい場合は全て c0 を参照する.
+    if ( c0 < c1 )
+    { std::swap( c0, c1 ); }
+
+    u32 indices = 0;
+    if ( c0 != c1 )
+    {
+        u8 palette[4][4];
+        GetColorPalette( c0, c1, true, palette );
+
+        for( u32 i=0; i<TILE_TEXEL_COUNT; ++i )
+        {
+            u32 best     = 0;
+            s32 bestDist = S32_MAX;
+            for( u32 j=0; j<4; ++j )
+            {
+                auto dr = s32( pTexels[i * 4 + 0] ) - palette[j][0];
+                auto dg = s32( pTexels[i * 4 + 1] ) - palette[j][1];
+                auto db = s32( pTexels[i * 4 + 2] ) - palette[j][2];
+                auto dist = dr * dr + dg * dg + db * db;
+                if ( dist < bestDist )
+                {
+                    bestDist = dist;
+                    best     = j;
+                }
+            }
+            indices |= best << ( i * 2 );
+        }
+    }
+
+    pBlock[0] = u8( c0 );
+    pBlock[1] = u8( c0 >> 8 );
+    pBlock[2] = u8( c1 );
+    pBlock[3] = u8( c1 >> 8 );
+    pBlock[4] = u8( indices );
+    pBlock[5] = u8( indices >> 8 );
+    pBlock[6] = u8( indices >> 16 );
+    pBlock[7] = u8( indices >> 24 );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      アルファブロックに圧縮します.
+//-------------------------------------------------------------------------------------------------
+void EncodeAlphaBlock( const u8* pTexels, u8* pBlock )
+{
+    u8 a0 = 0;
+    u8 a1 = 255;
+    for( u32 i=0; i<TILE_TEXEL_COUNT; ++i )
+    {
+        a0 = asdx::Max( a0, pTexels[i * 4 + 3] );
+        a1 = asdx::Min( a1, pTexels[i * 4 + 3] );
+    }
+
+    // a0 > a1 で 8 段階のモードになる. 等しい場合は全て a0 を参照する.
+    u64 indices = 0;
+    if ( a0 != a1 )
+    {
+        u8 palette[8];
+        GetAlphaPalette( a0, a1, palette );
+
+        for( u32 i=0; i<TILE_TEXEL_COUNT; ++i )
+        {
+            u32 best     = 0;
+            s32 bestDist = S32_MAX;
+            for( u32 j=0; j<8; ++j )
+            {
+                auto dist = abs( s32( pTexels[i * 4 + 3] ) - palette[j] );
+                if ( dist < bestDist )
+                {
+                    bestDist = dist;
+                    best     = j;
+                }
+            }
+            indices |= u64( best ) << ( i * 3 );
+        }
+    }
+
+    pBlock[0] = a0;
+    pBlock[1] = a1;
+    for( u32 i=0; i<6; ++i )
+    { pBlock[2 + i] = u8( indices >> ( i * 8 ) ); }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      ミップレベルから 1 タイル分のテクセルを集めます. はみ出した部分は端のテクセルを繰り返します.
+//-------------------------------------------------------------------------------------------------
+void GatherTile( const u8* pSrc, u32 width, u32 height, u32 tileX, u32 tileY, u8* pTexels )
+{
+    for( u32 y=0; y<TEXTURE_TILE_SIZE; ++y )
+    {
+        auto sy   = asdx::Min( tileY * TEXTURE_TILE_SIZE + y, height - 1 );
+        auto pRow = pSrc + size_t( sy ) * width * 4;
+        for( u32 x=0; x<TEXTURE_TILE_SIZE; ++x )
+        {
+            auto sx = asdx::Min( tileX * TEXTURE_TILE_SIZE + x, width - 1 );
+            memcpy( pTexels + ( y * TEXTURE_TILE_SIZE + x ) * 4, pRow + sx * 4, 4 );
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      タイルの先頭を取得します. ページに分割されたレベルは読み込まれたページから取得します.
+//-------------------------------------------------------------------------------------------------
+inline const u8* GetTile( const TiledTexture& texture, const TiledLevel& level, const u8* pTexels, u32 tileX, u32 tileY, u32 tileSize )
+{
+    if ( level.FirstPage == U32_MAX )
+    { return pTexels + ( size_t( tileY ) * level.TileCountX + tileX ) * tileSize; }
+
+    auto page = level.FirstPage + ( tileY / TEXTURE_PAGE_TILE ) * level.PageCountX + tileX / TEXTURE_PAGE_TILE;
+    return texture.GetPage( page ) + ( ( tileY % TEXTURE_PAGE_TILE ) * TEXTURE_PAGE_TILE + tileX % TEXTURE_PAGE_TILE ) * tileSize;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      テクセルを読み込みます. 圧縮されたブロックはキャッシュに展開してから読み込みます.
+//-------------------------------------------------------------------------------------------------
+inline void FetchTexel
+(
+    const TiledTexture& texture,
+    u32                 levelIndex,
+    const TiledLevel&   level,
+    const u8*           pTexels,
+    u32                 x,
+    u32                 y,
+    u8*                 pResult
+)
+{
+    auto format   = texture.GetFormat();
+    auto tileSize = GetTileSize( format );
+    auto tileX    = x / TEXTURE_TILE_SIZE;
+    auto tileY    = y / TEXTURE_TILE_SIZE;
+    auto texel    = ( ( y % TEXTURE_TILE_SIZE ) * TEXTURE_TILE_SIZE + x % TEXTURE_TILE_SIZE ) * 4;
+
+    // ComputeAxis() でレベルの範囲内に収めてある.
+    assert( x < level.Width && y < level.Height );
+
+    if ( format == TEXTURE_FORMAT_RGBA8 )
+    {
+        memcpy( pResult, GetTile( texture, level, pTexels, tileX, tileY, tileSize ) + texel, 4 );
+        return;
+    }
+
+    // ブロックはレベル内の通し番号, ミップレベル, テクスチャの識別子で区別する.
+    // ページの読み込み先には依存しないので, ページを読み込み直しても展開したブロックを使える.
+    auto number = u64( tileY ) * level.TileCountX + tileX;
+    auto key    = ( u64( texture.GetId() ) << 40 ) | ( u64( levelIndex ) << 32 ) | number;
+    auto slot   = ( u32( number ^ ( number >> 7 ) ^ ( number >> 14 ) ) + levelIndex * 37 ) & ( BLOCK_CACHE_SIZE - 1 );
+
+    auto& cache = g_BlockCache;
+    if ( cache.Keys[slot] != key )
+    {
+        auto pBlock = GetTile( texture, level, pTexels, tileX, tileY, tileSize );
+        if ( format == TEXTURE_FORMAT_BC1 )
+        { DecodeColorBlock( pBlock, false, cache.Texels[slot] ); }
+        else
+        {
+            DecodeColorBlock( pBlock + 8, true, cache.Texels[slot] );
+            DecodeAlphaBlock( pBlock, cache.Texels[slot] );
+        }
+        cache.Keys[slot] = key;
+    }
+
+    memcpy( pResult, cache.Texels[slot] + texel, 4 );
+}
+
+#if defined(SAMPLER_USE_SSE2)
+//-------------------------------------------------------------------------------------------------
+//      4 要素をまとめて切り捨てます. 絶対値は COORD_LIMIT 以下にします.
+//-------------------------------------------------------------------------------------------------
+inline __m128 Floor4( __m128 value )
+{
+    auto t = _mm_cvtepi32_ps( _mm_cvttps_epi32( value ) );
+    return _mm_sub_ps( t, _mm_and_ps( _mm_cmpgt_ps( t, value ), _mm_set1_ps( 1.0f ) ) );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      4 ピクセル分の 1 軸のテクセル位置と補間係数を求めます.
+//-------------------------------------------------------------------------------------------------
+void ComputeAxis( const f32* pCoord, u32 size, TEXTURE_ADDRESS mode, s32* pIndex0, s32* pIndex1, f32* pFrac )
+{
+    // NaN は下限に置き換わる.
+    auto coord = _mm_min_ps( _mm_max_ps( _mm_loadu_ps( pCoord ), _mm_set1_ps( -COORD_LIMIT ) ), _mm_set1_ps( COORD_LIMIT ) );
+    if ( mode == TEXTURE_ADDRESS_WRAP )
+    { coord = _mm_sub_ps( coord, Floor4( coord ) ); }
+
+    auto x = _mm_sub_ps( _mm_mul_ps( coord, _mm_set1_ps( f32( size ) ) ), _mm_set1_ps( 0.5f ) );
+    if ( mode == TEXTURE_ADDRESS_CLAMP )
+    { x = _mm_min_ps( _mm_max_ps( x, _mm_set1_ps( -1.0f ) ), _mm_set1_ps( f32( size ) ) ); }
+
+    auto xf = Floor4( x );
+    _mm_storeu_ps( pFrac, _mm_sub_ps( x, xf ) );
+
+    auto zero = _mm_setzero_si128();
+    auto i0   = _mm_cvttps_epi32( xf );
+    auto i1   = _mm_add_epi32( i0, _mm_set1_epi32( 1 ) );
+
+    if ( mode == TEXTURE_ADDRESS_WRAP )
+    {
+        // 折り返した座標は [0, 1] なので, はみ出すのは左端の -1 と右端の size だけ.
+        auto n = _mm_set1_epi32( s32( size ) );
+        i0 = _mm_add_epi32( i0, _mm_and_si128( _mm_cmplt_epi32( i0, zero ), n ) );
+        i1 = _mm_sub_epi32( i1, _mm_andnot_si128( _mm_cmplt_epi32( i1, n ), n ) );
+    }
+    else
+    {
+        // 範囲外の座標は x が -1 か size になるので, i0 と i1 の両方を [0, size - 1] に収める.
+        auto last = _mm_set1_epi32( s32( size - 1 ) );
+        i0 = _mm_andnot_si128( _mm_cmplt_epi32( i0, zero ), i0 );
+        auto m0 = _mm_cmpgt_epi32( i0, last );
+        auto m1 = _mm_cmpgt_epi32( i1, last );
+        i0 = _mm_or_si128( _mm_and_si128( m0, last ), _mm_andnot_si128( m0, i0 ) );
+        i1 = _mm_or_si128( _mm_and_si128( m1, last ), _mm_andnot_si128( m1, i1 ) );
+    }
+
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( pIndex0 ), i0 );
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( pIndex1 ), i1 );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      テクセルを 4 チャンネルの浮動小数に変換します.
+//-------------------------------------------------------------------------------------------------
+inline __m128 LoadTexel( const u8* pTexel )
+{
+    s32 texel;
+    memcpy( &texel, pTexel, sizeof(texel) );
+
+    auto zero = _mm_setzero_si128();
+    return _mm_cvtepi32_ps( _mm_unpacklo_epi16( _mm_unpacklo_epi8( _mm_cvtsi32_si128( texel ), zero ), zero ) );
+}
+#else
+//-------------------------------------------------------------------------------------------------
+//      4 ピクセル分の 1 軸のテクセル位置と補間係数を求めます.
+//-------------------------------------------------------------------------------------------------
+void ComputeAxis( const f32* pCoord, u32 size, TEXTURE_ADDRESS mode, s32* pIndex0, s32* pIndex1, f32* pFrac )
+{
+    for( u32 i=0; i<4; ++i )
+    {
+        // NaN は下限に置き換わる.
+        auto coord = ( pCoord[i] > -COORD_LIMIT ) ? asdx::Min( pCoord[i], COORD_LIMIT ) : -COORD_LIMIT;
+        if ( mode == TEXTURE_ADDRESS_WRAP )
+        { coord -= floorf( coord ); }
+
+        auto x = coord * f32( size ) - 0.5f;
+        if ( mode == TEXTURE_ADDRESS_CLAMP )
+        { x = asdx::Clamp( x, -1.0f, f32( size ) ); }
+
+        auto xf = floorf( x );
+        auto i0 = s32( xf );
+        auto i1 = i0 + 1;
+        pFrac[i] = x - xf;
+
+        if ( mode == TEXTURE_ADDRESS_WRAP )
+        {
+            pIndex0[i] = ( i0 < 0 ) ? i0 + s32( size ) : i0;
+            pIndex1[i] = ( i1 >= s32( size ) ) ? i1 - s32( size ) : i1;
+        }
+        else
+        {
+            // 範囲外の座標は x が -1 か size になるので, i0 と i1 の両方を [0, size - 1] に収める.
+            pIndex0[i] = asdx::Clamp( i0, 0, s32( size - 1 ) );
+            pIndex1[i] = asdx::Clamp( i1, 0, s32( size - 1 ) );
+        }
+    }
+}
+#endif
+
+//-------------------------------------------------------------------------------------------------
+//      1 つのミップレベルで 4 ピクセルのテクセル位置と補間係数を求めます.
+//-------------------------------------------------------------------------------------------------
+inline void ComputeFootprint( const TiledLevel& level, const SamplerState& sampler, const f32* pU, const f32* pV, Footprint& fp )
+{
+    ComputeAxis( pU, level.Width,  sampler.AddressU, fp.X0, fp.X1, fp.FracX );
+    ComputeAxis( pV, level.Height, sampler.AddressV, fp.Y0, fp.Y1, fp.FracY );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      4 ピクセルが参照するページを列挙します. func が false を返すと中断して false を返却します.
+//      常駐するレベルではページがないので, 何もせずに true を返却します.
+//-------------------------------------------------------------------------------------------------
+template<typename Func>
+bool ForEachPage( const TiledLevel& level, const Footprint& fp, Func func )
+{
+    if ( level.FirstPage == U32_MAX )
+    { return true; }
+
+    for( u32 i=0; i<4; ++i )
+    {
+        auto x0 = u32( fp.X0[i] ) / TEXTURE_PAGE_SIZE;
+        auto x1 = u32( fp.X1[i] ) / TEXTURE_PAGE_SIZE;
+        auto y0 = level.FirstPage + ( u32( fp.Y0[i] ) / TEXTURE_PAGE_SIZE ) * level.PageCountX;
+        auto y1 = level.FirstPage + ( u32( fp.Y1[i] ) / TEXTURE_PAGE_SIZE ) * level.PageCountX;
+
+        if ( !func( y0 + x0 ) || !func( y0 + x1 ) || !func( y1 + x0 ) || !func( y1 + x1 ) )
+        { return false; }
+    }
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      1 つのミップレベルで 4 ピクセルをバイリニア補間します.
+//-------------------------------------------------------------------------------------------------
+void SampleLevel
+(
+    const TiledTexture&     texture,
+    const SamplerState&     sampler,
+    u32                     levelIndex,
+    const f32*              pU,
+    const f32*              pV,
+    asdx::Vector4*          pResult
+)
+{
+    auto isResident = [&]( u32 page ) { return texture.GetPage( page ) != nullptr; };
+
+    // 座標の計算は 4 ピクセルまとめて行う.
+    Footprint fp;
+    ComputeFootprint( texture.GetLevel( levelIndex ), sampler, pU, pV, fp );
+
+    // 読み込まれていないページがあれば, 粗いレベルで代用する. 最下位のレベルは常駐している.
+    while( !ForEachPage( texture.GetLevel( levelIndex ), fp, isResident ) )
+    {
+        levelIndex++;
+        ComputeFootprint( texture.GetLevel( levelIndex ), sampler, pU, pV, fp );
+    }
+
+    auto& level   = texture.GetLevel( levelIndex );
+    auto  pTexels = texture.GetTexels( levelIndex );
+
+    for( u32 i=0; i<4; ++i )
+    {
+        // 展開したブロックはキャッシュから追い出されることがあるので, 値をコピーしておく.
+        u8 p00[4], p10[4], p01[4], p11[4];
+        FetchTexel( texture, levelIndex, level, pTexels, fp.X0[i], fp.Y0[i], p00 );
+        FetchTexel( texture, levelIndex, level, pTexels, fp.X1[i], fp.Y0[i], p10 );
+        FetchTexel( texture, levelIndex, level, pTexels, fp.X0[i], fp.Y1[i], p01 );
+        FetchTexel( texture, levelIndex, level, pTexels, fp.X1[i], fp.Y1[i], p11 );
+
+    #if defined(SAMPLER_USE_SSE2)
+        // 4 チャンネルをまとめて補間する.
+        auto fx = _mm_set1_ps( fp.FracX[i] );
+        auto fy = _mm_set1_ps( fp.FracY[i] );
+        auto t00 = LoadTexel( p00 );
+        auto t01 = LoadTexel( p01 );
+        auto c0  = _mm_add_ps( t00, _mm_mul_ps( _mm_sub_ps( LoadTexel( p10 ), t00 ), fx ) );
+        auto c1  = _mm_add_ps( t01, _mm_mul_ps( _mm_sub_ps( LoadTexel( p11 ), t01 ), fx ) );
+        auto c   = _mm_add_ps( c0, _mm_mul_ps( _mm_sub_ps( c1, c0 ), fy ) );
+        _mm_storeu_ps( &pResult[i].x, _mm_mul_ps( c, _mm_set1_ps( 1.0f / 255.0f ) ) );
+    #else
+        auto fx = fp.FracX[i];
+        auto fy = fp.FracY[i];
+        f32 c[4];
+        for( u32 ch=0; ch<4; ++ch )
+        {
+            auto c0 = p00[ch] + ( p10[ch] - p00[ch] ) * fx;
+            auto c1 = p01[ch] + ( p11[ch] - p01[ch] ) * fx;
+            c[ch] = ( c0 + ( c1 - c0 ) * fy ) * ( 1.0f / 255.0f );
+        }
+        pResult[i] = asdx::Vector4( c[0], c[1], c[2], c[3] );
+    #endif
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      クアッド内のテクスチャ座標の差分からミップレベルを求めます.
+//-------------------------------------------------------------------------------------------------
+f32 ComputeLod( const TiledTexture& texture, const f32* pU, const f32* pV )
+{
+    auto& level = texture.GetLevel( 0 );
+    auto  w     = f32( level.Width );
+    auto  h     = f32( level.Height );
+
+    auto dudx = ( pU[1] - pU[0] ) * w;
+    auto dvdx = ( pV[1] - pV[0] ) * h;
+    auto dudy = ( pU[2] - pU[0] ) * w;
+    auto dvdy = ( pV[2] - pV[0] ) * h;
+
+    // 1 ピクセルあたりのテクセル数の大きい方の軸で決める. log2(sqrt(x)) = log2(x) / 2.
+    auto rho2 = asdx::Max( dudx * dudx + dvdx * dvdx, dudy * dudy + dvdy * dvdy );
+    auto lod  = 0.5f * log2f( rho2 );
+
+    // 拡大時と NaN は最上位のレベルにする.
+    return ( lod > 0.0f ) ? asdx::Min( lod, f32( texture.GetLevelCount() - 1 ) ) : 0.0f;
+}
+
+} // namespace /* anonymous */
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// TiledTexture class
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------------------------------
+//      コンストラクタです.
+//-------------------------------------------------------------------------------------------------
+TiledTexture::TiledTexture()
+: m_pTexels     ( nullptr )
+, m_Size        ( 0 )
+, m_Format      ( TEXTURE_FORMAT_RGBA8 )
+, m_Id          ( 0 )
+, m_pPageData   ( nullptr )
+, m_PageSize    ( 0 )
+{ /* DO_NOTHING */ }
+
+//-------------------------------------------------------------------------------------------------
+//      デストラクタです.
+//-------------------------------------------------------------------------------------------------
+TiledTexture::~TiledTexture()
+{ Term(); }
+
+//-------------------------------------------------------------------------------------------------
+//      テクスチャの全てのミップレベルをタイル単位の並びに変換して初期化します.
+//-------------------------------------------------------------------------------------------------
+bool TiledTexture::Init( const Texture& source, TEXTURE_FORMAT format )
+{
+    if ( source.GetLevelCount() == 0 )
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    Term();
+
+    // 各レベルの先頭はタイルのサイズの倍数になる. 非圧縮では TEXTURE_ALIGNMENT にも揃う.
+    auto   tileSize = ::GetTileSize( format );
+    size_t size     = 0;
+    for( u32 i=0; i<source.GetLevelCount(); ++i )
+    {
+        auto& src = source.GetLevel( i );
+
+        TiledLevel level;
+        level.Width      = src.Width;
+        level.Height     = src.Height;
+        level.TileCountX = ( src.Width + TEXTURE_TILE_SIZE - 1 ) / TEXTURE_TILE_SIZE;
+        level.PageCountX = 0;
+        level.FirstPage  = U32_MAX;
+        level.Offset     = size;
+        m_Levels.push_back( level );
+
+        auto tileCountY = ( src.Height + TEXTURE_TILE_SIZE - 1 ) / TEXTURE_TILE_SIZE;
+        size += size_t( level.TileCountX ) * tileCountY * tileSize;
+    }
+
+    m_pTexels = static_cast<u8*>( ::operator new( size, std::align_val_t( TEXTURE_ALIGNMENT ), std::nothrow ) );
+    if ( m_pTexels == nullptr )
+    {
+        ELOG( "Error : Out of Memory. size = %zu", size );
+        m_Levels.clear();
+        return false;
+    }
+
+    m_Size   = size;
+    m_Format = format;
+    m_Id     = ++g_TextureId;
+
+    for( u32 i=0; i<source.GetLevelCount(); ++i )
+    {
+        auto& level      = m_Levels[i];
+        auto  pSrc       = source.GetPixels( i );
+        auto  pDst       = m_pTexels + level.Offset;
+        auto  tileCountY = ( level.Height + TEXTURE_TILE_SIZE - 1 ) / TEXTURE_TILE_SIZE;
+
+        // 圧縮が重いので, タイルの行単位で分割して並列に処理する.
+        auto chunkCount = ( format == TEXTURE_FORMAT_RGBA8 ) ? 1u : GetChunkCount( tileCountY, ENCODE_MIN_ROWS );
+        ParallelFor( chunkCount, [&]( u32 index )
+        {
+            auto beginRow = u32( u64( tileCountY ) * index / chunkCount );
+            auto endRow   = u32( u64( tileCountY ) * ( index + 1 ) / chunkCount );
+
+            u8 texels[TILE_TEXEL_COUNT * 4];
+            for( auto ty=beginRow; ty<endRow; ++ty )
+            {
+                for( u32 tx=0; tx<level.TileCountX; ++tx )
+                {
+                    auto pOut = pDst + ( size_t( ty ) * level.TileCountX + tx ) * tileSize;
+                    GatherTile( pSrc, level.Width, level.Height, tx, ty, texels );
+
+                    switch( format )
+                    {
+                    case TEXTURE_FORMAT_BC1:
+                        EncodeColorBlock( texels, pOut );
+                        break;
+
+                    case TEXTURE_FORMAT_BC3:
+                        EncodeAlphaBlock( texels, pOut );
+                        EncodeColorBlock( texels, pOut + 8 );
+                        break;
+
+                    default:
+                        memcpy( pOut, texels, sizeof(texels) );
+                        break;
+                    }
+                }
+            }
+        } );
+    }
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      ページファイルを開いて仮想テクスチャとして初期化します.
+//-------------------------------------------------------------------------------------------------
+bool TiledTexture::Open( const char* filename )
+{
+    if ( filename == nullptr )
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    Term();
+
+    if ( !m_File.Open( filename ) )
+    { return false; }
+
+    auto data = reinterpret_cast<const u8*>( m_File.GetData() );
+    auto size = m_File.GetSize();
+
+    auto pHeader = reinterpret_cast<const PageFileHeader*>( data );
+    if ( size < sizeof(PageFileHeader)
+      || pHeader->Magic   != PAGE_FILE_MAGIC
+      || pHeader->Version != PAGE_FILE_VERSION
+      || pHeader->Format  >  TEXTURE_FORMAT_BC3 )
+    {
+        ELOG( "Error : Invalid Page File. filename = %s", filename );
+        Term();
+        return false;
+    }
+
+    // 各テーブルがファイル内に収まっているかチェック.
+    auto isValid = [&]( u64 offset, u64 count, u64 stride )
+    {
+        return offset <= size
+            && count * stride <= size - offset;
+    };
+
+    auto format   = TEXTURE_FORMAT( pHeader->Format );
+    auto tileSize = ::GetTileSize( format );
+
+    if ( pHeader->LevelCount == 0
+      || pHeader->PageSize != TEXTURE_PAGE_TILE * TEXTURE_PAGE_TILE * tileSize
+      || ( pHeader->PageOffset % PAGE_FILE_ALIGNMENT ) != 0
+      || !isValid( pHeader->LevelOffset, pHeader->LevelCount, sizeof(PageFileLevel) )
+      || !isValid( pHeader->TailOffset,  pHeader->TailSize,   1 )
+      || !isValid( pHeader->PageOffset,  pHeader->PageCount,  pHeader->PageSize ) )
+    {
+        ELOG( "Error : Broken Page File. filename = %s", filename );
+        Term();
+        return false;
+    }
+
+    // ページの番号が連続していて, 常駐するレベルがミップテールに収まっているかチェック.
+    auto pLevels   = reinterpret_cast<const PageFileLevel*>( data + pHeader->LevelOffset );
+    u32  pageCount = 0;
+    for( u32 i=0; i<pHeader->LevelCount; ++i )
+    {
+        auto& src = pLevels[i];
+
+        TiledLevel level;
+        level.Width      = src.Width;
+        level.Height     = src.Height;
+        level.TileCountX = ( src.Width + TEXTURE_TILE_SIZE - 1 ) / TEXTURE_TILE_SIZE;
+        level.PageCountX = src.PageCountX;
+        level.FirstPage  = src.FirstPage;
+        level.Offset     = 0;
+
+        auto tileCountY = ( src.Height + TEXTURE_TILE_SIZE - 1 ) / TEXTURE_TILE_SIZE;
+        auto valid      = ( src.Width > 0 && src.Height > 0 );
+        if ( src.FirstPage == U32_MAX )
+        {
+            level.Offset = size_t( src.Offset );
+            valid = valid
+                 && ( src.Offset % tileSize ) == 0
+                 && src.Offset <= pHeader->TailSize
+                 && u64( level.TileCountX ) * tileCountY * tileSize <= pHeader->TailSize - src.Offset;
+        }
+        else
+        {
+            auto pageCountY = ( tileCountY + TEXTURE_PAGE_TILE - 1 ) / TEXTURE_PAGE_TILE;
+            valid = valid
+                 && src.PageCountX == ( level.TileCountX + TEXTURE_PAGE_TILE - 1 ) / TEXTURE_PAGE_TILE
+                 && src.FirstPage  == pageCount
+                 && i + 1 < pHeader->LevelCount;
+            pageCount += src.PageCountX * pageCountY;
+        }
+
+        if ( !valid )
+        {
+            ELOG( "Error : Broken Page File. filename = %s", filename );
+            Term();
+            return false;
+        }
+
+        m_Levels.push_back( level );
+    }
+
+    if ( pageCount != pHeader->PageCount )
+    {
+        ELOG( "Error : Broken Page File. filename = %s", filename );
+        Term();
+        return false;
+    }
+
+    // ミップテールはファイルのマップとは別に確保して常駐させる.
+    auto tailSize = size_t( pHeader->TailSize );
+    m_pTexels = static_cast<u8*>( ::operator new( tailSize, std::align_val_t( TEXTURE_ALIGNMENT ), std::nothrow ) );
+    if ( m_pTexels == nullptr )
+    {
+        ELOG( "Error : Out of Memory. size = %zu", tailSize );
+        Term();
+        return false;
+    }
+
+    memcpy( m_pTexels, data + pHeader->TailOffset, tailSize );
+
+    m_Size      = tailSize;
+    m_Format    = format;
+    m_Id        = ++g_TextureId;
+    m_pPageData = data + pHeader->PageOffset;
+    m_PageSize  = pHeader->PageSize;
+    m_Pages   .assign( pageCount, nullptr );
+    m_Requests.assign( pageCount, 0 );
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      テクセルデータを解放します.
+//-------------------------------------------------------------------------------------------------
+void TiledTexture::Term()
+{
+    if ( m_pTexels != nullptr )
+    { ::operator delete( m_pTexels, std::align_val_t( TEXTURE_ALIGNMENT ) ); }
+
+    m_File.Close();
+
+    m_pTexels   = nullptr;
+    m_Size      = 0;
+    m_Id        = 0;
+    m_pPageData = nullptr;
+    m_PageSize  = 0;
+    m_Levels  .clear();
+    m_Pages   .clear();
+    m_Requests.clear();
+}
+
+//-------------------------------------------------------------------------------------------------
+//      初期化されているかどうかを取得します.
+//-------------------------------------------------------------------------------------------------
+bool TiledTexture::IsEmpty() const
+{ return m_Levels.empty(); }
+
+//-------------------------------------------------------------------------------------------------
+//      フォーマットを取得します.
+//-------------------------------------------------------------------------------------------------
+TEXTURE_FORMAT TiledTexture::GetFormat() const
+{ return m_Format; }
+
+//-------------------------------------------------------------------------------------------------
+//      識別子を取得します.
+//-------------------------------------------------------------------------------------------------
+u32 TiledTexture::GetId() const
+{ return m_Id; }
+
+//-------------------------------------------------------------------------------------------------
+//      全てのミップレベルのテクセルデータのサイズを取得します.
+//-------------------------------------------------------------------------------------------------
+size_t TiledTexture::GetSize() const
+{ return m_Size; }
+
+//-------------------------------------------------------------------------------------------------
+//      1 タイルのサイズを取得します.
+//-------------------------------------------------------------------------------------------------
+u32 TiledTexture::GetTileSize() const
+{ return ::GetTileSize( m_Format ); }
+
+//-------------------------------------------------------------------------------------------------
+//      仮想テクスチャかどうかを取得します.
+//-------------------------------------------------------------------------------------------------
+bool TiledTexture::IsVirtual() const
+{ return m_PageSize > 0; }
+
+//-------------------------------------------------------------------------------------------------
+//      仮想テクスチャのページ数を取得します.
+//-------------------------------------------------------------------------------------------------
+u32 TiledTexture::GetPageCount() const
+{ return u32( m_Pages.size() ); }
+
+//-------------------------------------------------------------------------------------------------
+//      1 ページのサイズを取得します.
+//-------------------------------------------------------------------------------------------------
+u32 TiledTexture::GetPageSize() const
+{ return m_PageSize; }
+
+//-------------------------------------------------------------------------------------------------
+//      読み込まれたページのテクセルデータを取得します.
+//-------------------------------------------------------------------------------------------------
+const u8* TiledTexture::GetPage( u32 page ) const
+{ return m_Pages[page]; }
+
+//-------------------------------------------------------------------------------------------------
+//      ページの読み込みを要求します.
+//-------------------------------------------------------------------------------------------------
+void TiledTexture::RequestPage( u32 page ) const
+{ m_Requests[page] = 1; }
+
+//-------------------------------------------------------------------------------------------------
+//      ミップレベル数を取得します.
+//-------------------------------------------------------------------------------------------------
+u32 TiledTexture::GetLevelCount() const
+{ return u32( m_Levels.size() ); }
+
+//-------------------------------------------------------------------------------------------------
+//      ミップレベルの情報を取得します.
+//-------------------------------------------------------------------------------------------------
+const TiledLevel& TiledTexture::GetLevel( u32 level ) const
+{ return m_Levels[level]; }
+
+//-------------------------------------------------------------------------------------------------
+//      ミップレベルのテクセルデータを取得します.
+//-------------------------------------------------------------------------------------------------
+const u8* TiledTexture::GetTexels( u32 level ) const
+{ return m_pTexels + m_Levels[level].Offset; }
+
+
+//-------------------------------------------------------------------------------------------------
+//      2x2 ピクセルのクアッドの 4 ピクセルをまとめてサンプリングします.
+//-------------------------------------------------------------------------------------------------
+void SampleQuad
+(
+    const TiledTexture&     texture,
+    const SamplerState&     sampler,
+    const f32*              pU,
+    const f32*              pV,
+    asdx::Vector4*          pResult
+)
+{
+    if ( texture.IsEmpty() )
+    {
+        for( u32 i=0; i<4; ++i )
+        { pResult[i] = asdx::Vector4( 1.0f, 1.0f, 1.0f, 1.0f ); }
+        return;
+    }
+
+    auto lod = ComputeLod( texture, pU, pV );
+
+    if ( sampler.Filter == TEXTURE_FILTER_BILINEAR )
+    {
+        SampleLevel( texture, sampler, u32( lod + 0.5f ), pU, pV, pResult );
+        return;
+    }
+
+    auto level = u32( lod );
+    auto frac  = lod - f32( level );
+    SampleLevel( texture, sampler, level, pU, pV, pResult );
+
+    // 下位のレベルの寄与がある場合だけ 2 回目をサンプリングする.
+    if ( frac > 0.0f && level + 1 < texture.GetLevelCount() )
+    {
+        asdx::Vector4 lower[4];
+        SampleLevel( texture, sampler, level + 1, pU, pV, lower );
+
+        for( u32 i=0; i<4; ++i )
+        { pResult[i] = pResult[i] + ( lower[i] - pResult[i] ) * frac; }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      2x2 ピクセルのクアッドがサンプリングするページを要求します.
+//-------------------------------------------------------------------------------------------------
+void RequestQuad
+(
+    const TiledTexture&     texture,
+    const SamplerState&     sampler,
+    const f32*              pU,
+    const f32*              pV
+)
+{
+    if ( !texture.IsVirtual() )
+    { return; }
+
+    // SampleQuad() と同じミップレベルを選ぶ.
+    auto lod   = ComputeLod( texture, pU, pV );
+    auto first = u32( lod );
+    auto last  = first;
+    if ( sampler.Filter == TEXTURE_FILTER_BILINEAR )
+    { first = last = u32( lod + 0.5f ); }
+    else if ( lod > f32( first ) && first + 1 < texture.GetLevelCount() )
+    { last = first + 1; }
+
+    auto request = [&]( u32 page )
+    {
+        texture.RequestPage( page );
+        return true;
+    };
+
+    for( auto i=first; i<=last; ++i )
+    {
+        Footprint fp;
+        ComputeFootprint( texture.GetLevel( i ), sampler, pU, pV, fp );
+        ForEachPage( texture.GetLevel( i ), fp, request );
+    }
+}
@@ -0,0 +1,489 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : Scene.cpp
+// Desc : Scene Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <Scene.h>
+#include <Parallel.h>
+#include <asdxLogger.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+
+//-------------------------------------------------------------------------------------------------
+// Using Statements
+//-------------------------------------------------------------------------------------------------
+using namespace asdx;
+
+
+namespace /* anonymous */ {
+
+//-------------------------------------------------------------------------------------------------
+// Constant Values
+//-------------------------------------------------------------------------------------------------
+static constexpr u32 INVALID_INDEX      = U32_MAX;      //!< 無効な番号です.
+static constexpr u32 INSIDE_FLAG        = 0x80000000;   //!< 視錐台に完全に含まれるノードを示すフラグです.
+static constexpr u32 PARALLEL_THRESHOLD = 4096;         //!< 別スレッドで構築する部分木の最小インスタンス数です.
+
+
+//-------------------------------------------------------------------------------------------------
+//      指定軸の成分を取得します.
+//-------------------------------------------------------------------------------------------------
+f32 GetAxis( const Vector3& value, u32 axis )
+{ return ( axis == 0 ) ? value.x : ( axis == 1 ) ? value.y : value.z; }
+
+//-------------------------------------------------------------------------------------------------
+//      バウンディングボックスの表面積を求めます.
+//-------------------------------------------------------------------------------------------------
+f32 SurfaceArea( const BoundingBox& box )
+{
+    if ( IsEmpty( box ) )
+    { return 0.0f; }
+
+    auto d = box.Maxi - box.Mini;
+    return 2.0f * ( d.x * d.y + d.y * d.z + d.z * d.x );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      バウンディングボックスが等しいかどうかチェックします.
+//-------------------------------------------------------------------------------------------------
+bool IsEqual( const BoundingBox& a, const BoundingBox& b )
+{
+    return a.Mini.x == b.Mini.x && a.Mini.y == b.Mini.y && a.Mini.z == b.Mini.z
+        && a.Maxi.x == b.Maxi.x && a.Maxi.y == b.Maxi.y && a.Maxi.z == b.Maxi.z;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// BvhBin structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct BvhBin
+{
+    BoundingBox     Bounds;     //!< バウンディングボックスです.
+    u32             Count;      //!< インスタンス数です.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// BvhBuilder structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct BvhBuilder
+{
+    const SceneInstance*    pInstances;     //!< インスタンスです.
+    const Vector3*          pCenters;       //!< インスタンスの中心です.
+    u32*                    pIndices;       //!< 並べ替えるインスタンス番号です.
+    BvhNode*                pNodes;         //!< ノードです.
+    u32*                    pParents;       //!< 親ノード番号です.
+    u32*                    pLeaves;        //!< インスタンスごとの所属リーフ番号です.
+    std::atomic<u32>        NodeCount;      //!< 確保済みノード数です.
+    u32                     ParallelDepth;  //!< 別スレッドで構築する最大の深さです.
+
+    //---------------------------------------------------------------------------------------------
+    //      リーフにします.
+    //---------------------------------------------------------------------------------------------
+    void MakeLeaf( u32 nodeIndex, u32 begin, u32 end )
+    {
+        auto& node = pNodes[nodeIndex];
+        node.Index = begin;
+        node.Count = end - begin;
+
+        for( auto i=begin; i<end; ++i )
+        { pLeaves[ pIndices[i] ] = nodeIndex; }
+    }
+
+    //---------------------------------------------------------------------------------------------
+    //      ノードを構築します.
+    //---------------------------------------------------------------------------------------------
+    void BuildNode( u32 nodeIndex, u32 begin, u32 end, u32 depth )
+    {
+        auto& node  = pNodes[nodeIndex];
+        auto  count = end - begin;
+
+        node.Bounds = CreateEmptyBox();
+        auto centerBox = CreateEmptyBox();
+        for( auto i=begin; i<end; ++i )
+        {
+            Merge( node.Bounds, pInstances[ pIndices[i] ].Bounds );
+            Merge( centerBox,   pCenters  [ pIndices[i] ] );
+        }
+
+        if ( count <= 1 )
+        {
+            MakeLeaf( nodeIndex, begin, end );
+            return;
+        }
+
+        // 中心の広がりが最大の軸で分割する.
+        auto extent = centerBox.Maxi - centerBox.Mini;
+        u32 axis = 0;
+        if ( extent.y > GetAxis( extent, axis ) ) { axis = 1; }
+        if ( extent.z > GetAxis( extent, axis ) ) { axis = 2; }
+
+        auto mini  = GetAxis( centerBox.Mini, axis );
+        auto width = GetAxis( extent, axis );
+        auto mid   = begin;
+
+        if ( width > 0.0f )
+        {
+            auto scale = f32( BVH_BIN_COUNT ) / width;
+            auto toBin = [&]( u32 index )
+            { return Min( u32( ( GetAxis( pCenters[index], axis ) - mini ) * scale ), BVH_BIN_COUNT - 1 ); };
+
+            BvhBin bins[BVH_BIN_COUNT];
+            for( auto& bin : bins )
+            {
+                bin.Bounds = CreateEmptyBox();
+                bin.Count  = 0;
+            }
+
+            for( auto i=begin; i<end; ++i )
+            {
+                auto& bin = bins[ toBin( pIndices[i] ) ];
+                Merge( bin.Bounds, pInstances[ pIndices[i] ].Bounds );
+                bin.Count++;
+            }
+
+            // 右側からの累積を求めておき, 左側から掃引して SAH コストが最小の分割位置を探す.
+            f32 rightArea [BVH_BIN_COUNT];
+            u32 rightCount[BVH_BIN_COUNT];
+            {
+                auto box = CreateEmptyBox();
+                u32  sum = 0;
+                for( auto i=BVH_BIN_COUNT - 1; i>0; --i )
+                {
+                    Merge( box, bins[i].Bounds );
+                    sum += bins[i].Count;
+                    rightArea [i] = SurfaceArea( box );
+                    rightCount[i] = sum;
+                }
+            }
+
+            auto bestCost  = F32_MAX;
+            u32  bestSplit = 0;
+            {
+                auto box = CreateEmptyBox();
+                u32  sum = 0;
+                for( u32 i=1; i<BVH_BIN_COUNT; ++i )
+                {
+                    Merge( box, bins[i - 1].Bounds );
+                    sum += bins[i - 1].Count;
+
+                    if ( sum == 0 || rightCount[i] == 0 )
+                    { continue; }
+
+                    auto cost = SurfaceArea( box ) * f32( sum ) + rightArea[i] * f32( rightCount[i] );
+                    if ( cost < bestCost )
+                    {
+                        bestCost  = cost;
+                        bestSplit = i;
+                    }
+                }
+            }
+
+            // 分割しても得にならなければリーフにする.
+            auto area = SurfaceArea( node.Bounds );
+            if ( count <= BVH_MAX_LEAF_SIZE && ( bestSplit == 0 || area + bestCost >= area * f32( count ) ) )
+            {
+                MakeLeaf( nodeIndex, begin, end );
+                return;
+            }
+
+            if ( bestSplit > 0 )
+            {
+                auto pMid = std::partition( pIndices + begin, pIndices + end,
+                    [&]( u32 index ) { return toBin( index ) < bestSplit; } );
+                mid = u32( pMid - pIndices );
+            }
+        }
+        else if ( count <= BVH_MAX_LEAF_SIZE )
+        {
+            MakeLeaf( nodeIndex, begin, end );
+            return;
+        }
+
+        // 分割できない場合は中央で分ける.
+        if ( mid == begin || mid == end )
+        {
+            mid = begin + count / 2;
+            std::nth_element( pIndices + begin, pIndices + mid, pIndices + end,
+                [&]( u32 lhs, u32 rhs )
+                { return GetAxis( pCenters[lhs], axis ) < GetAxis( pCenters[rhs], axis ); } );
+        }
+
+        auto children = NodeCount.fetch_add( 2 );
+        node.Index = children;
+        node.Count = 0;
+        pParents[children + 0] = nodeIndex;
+        pParents[children + 1] = nodeIndex;
+
+        // 大きな部分木は別スレッドで構築する.
+        if ( count >= PARALLEL_THRESHOLD && depth < ParallelDepth )
+        {
+            std::thread thread( [=]() { BuildNode( children, begin, mid, depth + 1 ); } );
+            BuildNode( children + 1, mid, end, depth + 1 );
+            thread.join();
+        }
+        else
+        {
+            BuildNode( children + 0, begin, mid, depth + 1 );
+            BuildNode( children + 1, mid,   end, depth + 1 );
+        }
+    }
+};
+
+} // namespace /* anonymous */
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Scene class
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------------------------------
+//      コンストラクタです.
+//-------------------------------------------------------------------------------------------------
+Scene::Scene()
+: m_Dirty( false )
+{ /* DO_NOTHING */ }
+
+//-------------------------------------------------------------------------------------------------
+//      デストラクタです.
+//-------------------------------------------------------------------------------------------------
+Scene::~Scene()
+{ /* DO_NOTHING */ }
+
+//-------------------------------------------------------------------------------------------------
+//      メッシュを登録します.
+//-------------------------------------------------------------------------------------------------
+u32 Scene::AddMesh( const BoundingBox& bounds )
+{
+    m_MeshBounds.push_back( bounds );
+    return u32( m_MeshBounds.size() - 1 );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      インスタンスを追加します.
+//-------------------------------------------------------------------------------------------------
+u32 Scene::AddInstance( u32 meshId, const Matrix& world )
+{
+    // 以降の処理はメッシュ番号が有効であることを前提にする.
+    if ( meshId >= m_MeshBounds.size() )
+    {
+        ELOG( "Error : Invalid Mesh Id. meshId = %u", meshId );
+        return U32_MAX;
+    }
+
+    SceneInstance instance = {};
+    instance.MeshId = meshId;
+    instance.World  = world;
+    instance.Bounds = TransformBox( m_MeshBounds[meshId], world );
+
+    m_Instances .push_back( instance );
+    m_MovedFlags.push_back( false );
+    m_Dirty = true;
+
+    return u32( m_Instances.size() - 1 );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      インスタンスのワールド行列を設定します.
+//-------------------------------------------------------------------------------------------------
+void Scene::SetWorld( u32 index, const Matrix& world )
+{
+    if ( index >= m_Instances.size() )
+    { return; }
+
+    m_Instances[index].World = world;
+
+    if ( !m_MovedFlags[index] )
+    {
+        m_MovedFlags[index] = true;
+        m_Moved.push_back( index );
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      BVH を構築します.
+//-------------------------------------------------------------------------------------------------
+void Scene::Build()
+{
+    // 移動済みのインスタンスは先にボックスを更新しておく.
+    for( auto index : m_Moved )
+    {
+        auto& instance = m_Instances[index];
+        instance.Bounds = TransformBox( m_MeshBounds[instance.MeshId], instance.World );
+        m_MovedFlags[index] = false;
+    }
+    m_Moved.clear();
+    m_Dirty = false;
+
+    auto count = u32( m_Instances.size() );
+
+    m_Nodes  .clear();
+    m_Parents.clear();
+    m_Indices.resize( count );
+    m_Leaves .assign( count, INVALID_INDEX );
+
+    if ( count == 0 )
+    { return; }
+
+    std::vector<Vector3> centers( count );
+    for( u32 i=0; i<count; ++i )
+    {
+        auto& box = m_Instances[i].Bounds;
+        centers  [i] = ( box.Mini + box.Maxi ) * 0.5f;
+        m_Indices[i] = i;
+    }
+
+    // 二分木なのでノード数は 2N - 1 を超えない.
+    m_Nodes  .resize( count * 2 );
+    m_Parents.resize( count * 2, INVALID_INDEX );
+
+    BvhBuilder builder;
+    builder.pInstances    = m_Instances.data();
+    builder.pCenters      = centers.data();
+    builder.pIndices      = m_Indices.data();
+    builder.pNodes        = m_Nodes.data();
+    builder.pParents      = m_Parents.data();
+    builder.pLeaves       = m_Leaves.data();
+    builder.NodeCount     = 1;
+    builder.ParallelDepth = 0;
+
+    auto threadCount = GetThreadCount();
+    while( ( 1u << builder.ParallelDepth ) < threadCount )
+    { builder.ParallelDepth++; }
+
+    builder.BuildNode( 0, 0, count, 0 );
+
+    auto nodeCount = builder.NodeCount.load();
+    m_Nodes  .resize( nodeCount );
+    m_Parents.resize( nodeCount );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      BVH を更新します.
+//-------------------------------------------------------------------------------------------------
+void Scene::Update()
+{
+    if ( m_Dirty )
+    { Build(); }
+    else if ( !m_Moved.empty() )
+    { Refit(); }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      移動したインスタンスを含むノードを再適合します.
+//-------------------------------------------------------------------------------------------------
+void Scene::Refit()
+{
+    for( auto index : m_Moved )
+    {
+        auto& instance = m_Instances[index];
+        instance.Bounds = TransformBox( m_MeshBounds[instance.MeshId], instance.World );
+        m_MovedFlags[index] = false;
+
+        // ボックスが変わらなくなるまで親をたどる.
+        auto nodeIndex = m_Leaves[index];
+        while( nodeIndex != INVALID_INDEX )
+        {
+            auto& node = m_Nodes[nodeIndex];
+            auto  box  = CreateEmptyBox();
+            if ( node.Count > 0 )
+            {
+                for( u32 i=0; i<node.Count; ++i )
+                { Merge( box, m_Instances[ m_Indices[node.Index + i] ].Bounds ); }
+            }
+            else
+            {
+                Merge( box, m_Nodes[node.Index + 0].Bounds );
+                Merge( box, m_Nodes[node.Index + 1].Bounds );
+            }
+
+            if ( IsEqual( box, node.Bounds ) )
+            { break; }
+
+            node.Bounds = box;
+            nodeIndex   = m_Parents[nodeIndex];
+        }
+    }
+
+    m_Moved.clear();
+}
+
+//-------------------------------------------------------------------------------------------------
+//      視錐台と交差するインスタンスを列挙します.
+//-------------------------------------------------------------------------------------------------
+void Scene::Cull( const CullingView& view, std::vector<u32>& result ) const
+{
+    result.clear();
+    if ( m_Nodes.empty() )
+    { return; }
+
+    std::vector<u32> stack;
+    stack.reserve( 64 );
+    stack.push_back( 0 );
+
+    while( !stack.empty() )
+    {
+        auto entry = stack.back();
+        stack.pop_back();
+
+        auto  inside = ( entry & INSIDE_FLAG ) != 0;
+        auto& node   = m_Nodes[entry & ~INSIDE_FLAG];
+
+        // 完全に内側にある部分木は判定を省略する.
+        if ( !inside )
+        {
+            auto test = TestFrustum( view, node.Bounds );
+            if ( test == FrustumTest::Outside )
+            { continue; }
+
+            inside = ( test == FrustumTest::Inside );
+        }
+
+        if ( node.Count > 0 )
+        {
+            for( u32 i=0; i<node.Count; ++i )
+            {
+                auto index = m_Indices[node.Index + i];
+                if ( inside || TestFrustum( view, m_Instances[index].Bounds ) != FrustumTest::Outside )
+                { result.push_back( index ); }
+            }
+            continue;
+        }
+
+        auto flag = inside ? INSIDE_FLAG : 0;
+        stack.push_back( ( node.Index + 1 ) | flag );
+        stack.push_back( ( node.Index + 0 ) | flag );
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      シーン全体のバウンディングボックスを取得します.
+//-------------------------------------------------------------------------------------------------
+BoundingBox Scene::GetBounds() const
+{
+    if ( !m_Nodes.empty() && !m_Dirty && m_Moved.empty() )
+    { return m_Nodes[0].Bounds; }
+
+    auto result = CreateEmptyBox();
+    for( auto& instance : m_Instances )
+    { Merge( result, TransformBox( m_MeshBounds[instance.MeshId], instance.World ) ); }
+
+    return result;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      インスタンス数を取得します.
+//-------------------------------------------------------------------------------------------------
+u32 Scene::GetInstanceCount() const
+{ return u32( m_Instances.size() ); }
+
+//-------------------------------------------------------------------------------------------------
+//      インスタンスを取得します.
+//-------------------------------------------------------------------------------------------------
+const SceneInstance& Scene::GetInstance( u32 index ) const
+{ return m_Instances[index]; }
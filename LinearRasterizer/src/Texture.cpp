@@ -0,0 +1,668 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : Texture.cpp
+// Desc : Texture Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <Texture.h>
+#include <Bmp.h>
+#include <MappedFile.h>
+#include <Parallel.h>
+#include <cctype>
+#include <cstring>
+#include <new>
+#include <asdxMath.h>
+#include <asdxLogger.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+    #include <emmintrin.h>
+    #define TEXTURE_USE_SSE2    (1)
+#endif
+
+
+namespace /* anonymous */ {
+
+//-------------------------------------------------------------------------------------------------
+// Constant Values
+//-------------------------------------------------------------------------------------------------
+static constexpr u32 TEXTURE_MIP_MIN_ROWS   = 64;   //!< ミップの生成で 1 スレッドが処理する最小の行数です.
+static constexpr u32 BMP_COMPRESSION_RGB        = 0;    //!< 無圧縮です.
+static constexpr u32 BMP_COMPRESSION_BITFIELDS  = 3;    //!< ビットマスクで各チャンネルを指定します.
+
+
+//-------------------------------------------------------------------------------------------------
+//      リトルエンディアンの 16bit 値を読み込みます.
+//-------------------------------------------------------------------------------------------------
+inline u16 ReadU16( const u8* p )
+{ return u16( p[0] | ( p[1] << 8 ) ); }
+
+//-------------------------------------------------------------------------------------------------
+//      リトルエンディアンの 32bit 値を読み込みます.
+//-------------------------------------------------------------------------------------------------
+inline u32 ReadU32( const u8* p )
+{ return u32( p[0] ) | ( u32( p[1] ) << 8 ) | ( u32( p[2] ) << 16 ) | ( u32( p[3] ) << 24 ); }
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// ChannelMask structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct ChannelMask
+{
+    u32     Mask;       //!< ビットマスクです.
+    u32     Shift;      //!< 最下位ビットの位置です.
+    u32     Bits;       //!< ビット数です.
+
+    //---------------------------------------------------------------------------------------------
+    //      ビットマスクから設定します.
+    //---------------------------------------------------------------------------------------------
+    void Set( u32 mask )
+    {
+        Mask  = mask;
+        Shift = 0;
+        Bits  = 0;
+        if ( mask == 0 )
+        { return; }
+
+        while( ( ( mask >> Shift ) & 1 ) == 0 )
+        { Shift++; }
+        while( Shift + Bits < 32 && ( ( mask >> ( Shift + Bits ) ) & 1 ) != 0 )
+        { Bits++; }
+    }
+
+    //---------------------------------------------------------------------------------------------
+    //      ピクセルからチャンネルを取り出して 8bit に変換します. マスクが無い場合は value を返します.
+    //---------------------------------------------------------------------------------------------
+    u8 Extract( u32 pixel, u8 value ) const
+    {
+        if ( Mask == 0 )
+        { return value; }
+
+        auto v = ( pixel & Mask ) >> Shift;
+        if ( Bits >= 8 )
+        { return u8( v >> ( Bits - 8 ) ); }
+
+        return u8( v * 255 / ( ( 1u << Bits ) - 1 ) );
+    }
+};
+
+//-------------------------------------------------------------------------------------------------
+//      BMP ファイルをデコードします.
+//-------------------------------------------------------------------------------------------------
+bool DecodeBitmap( const u8* pData, size_t size, bool mipmaps, Texture& texture )
+{
+    if ( size < 54 )
+    {
+        ELOG( "Error : Invalid BMP File." );
+        return false;
+    }
+
+    auto offBits     = ReadU32( pData + 10 );
+    auto infoSize    = ReadU32( pData + 14 );
+    auto width       = s32( ReadU32( pData + 18 ) );
+    auto height      = s32( ReadU32( pData + 22 ) );
+    auto bitCount    = ReadU16( pData + 28 );
+    auto compression = ReadU32( pData + 30 );
+    auto colorUsed   = ReadU32( pData + 46 );
+
+    if ( infoSize < 40 || width <= 0 || height == 0 || height == s32( 0x80000000 ) )
+    {
+        ELOG( "Error : Invalid BMP Header." );
+        return false;
+    }
+
+    auto supported = ( compression == BMP_COMPRESSION_RGB && ( bitCount == 8 || bitCount == 24 || bitCount == 32 ) )
+                  || ( compression == BMP_COMPRESSION_BITFIELDS && bitCount == 32 );
+    if ( !supported )
+    {
+        ELOG( "Error : Unsupported BMP Format. bitCount = %u, compression = %u", bitCount, compression );
+        return false;
+    }
+
+    // 高さが負の場合は上端の行から並んでいる.
+    auto topDown = ( height < 0 );
+    auto w       = u32( width );
+    auto h       = u32( topDown ? -height : height );
+    auto stride  = ( u64( w ) * bitCount + 31 ) / 32 * 4;
+
+    if ( u64( offBits ) + stride * h > size )
+    {
+        ELOG( "Error : BMP File Truncated." );
+        return false;
+    }
+
+    // 32bit のチャンネルの配置. BI_RGB の場合は BGRX で, アルファは予約領域.
+    ChannelMask masks[4];
+    masks[0].Set( 0x00ff0000 );
+    masks[1].Set( 0x0000ff00 );
+    masks[2].Set( 0x000000ff );
+    masks[3].Set( 0xff000000 );
+
+    if ( compression == BMP_COMPRESSION_BITFIELDS )
+    {
+        // V3 ヘッダでは直後に, V4 以降ではヘッダ内の同じ位置にマスクがある.
+        if ( size < 66 || ( infoSize >= 56 && size < 70 ) )
+        {
+            ELOG( "Error : Invalid BMP Header." );
+            return false;
+        }
+
+        masks[0].Set( ReadU32( pData + 54 ) );
+        masks[1].Set( ReadU32( pData + 58 ) );
+        masks[2].Set( ReadU32( pData + 62 ) );
+        masks[3].Set( ( infoSize >= 56 ) ? ReadU32( pData + 66 ) : 0 );
+    }
+
+    auto standard = ( masks[0].Mask == 0x00ff0000 && masks[1].Mask == 0x0000ff00 && masks[2].Mask == 0x000000ff
+                   && ( masks[3].Mask == 0xff000000 || masks[3].Mask == 0 ) );
+
+    // 8bit はパレットを参照する.
+    const u8* pPalette     = nullptr;
+    u32       paletteCount = 0;
+    if ( bitCount == 8 )
+    {
+        paletteCount = ( colorUsed > 0 && colorUsed < 256 ) ? colorUsed : 256;
+        if ( 14 + u64( infoSize ) + paletteCount * 4 > size )
+        {
+            ELOG( "Error : BMP File Truncated." );
+            return false;
+        }
+        pPalette = pData + 14 + infoSize;
+    }
+
+    if ( !texture.Init( w, h, mipmaps ? 0 : 1 ) )
+    { return false; }
+
+    auto pDst = texture.GetPixels( 0 );
+    u8   alpha = 0;
+
+    for( u32 y=0; y<h; ++y )
+    {
+        auto pSrc = pData + offBits + stride * ( topDown ? h - 1 - y : y );
+        auto pOut = pDst + size_t( y ) * w * 4;
+
+        if ( bitCount == 32 && standard )
+        {
+            SwapRedBlue( pSrc, pOut, w );
+            if ( masks[3].Mask == 0 )
+            {
+                for( u32 x=0; x<w; ++x )
+                { pOut[x * 4 + 3] = 255; }
+            }
+        }
+        else if ( bitCount == 32 )
+        {
+            for( u32 x=0; x<w; ++x )
+            {
+                auto pixel = ReadU32( pSrc + x * 4 );
+                pOut[x * 4 + 0] = masks[0].Extract( pixel, 0 );
+                pOut[x * 4 + 1] = masks[1].Extract( pixel, 0 );
+                pOut[x * 4 + 2] = masks[2].Extract( pixel, 0 );
+                pOut[x * 4 + 3] = masks[3].Extract( pixel, 255 );
+            }
+        }
+        else if ( bitCount == 24 )
+        {
+            for( u32 x=0; x<w; ++x )
+            {
+                pOut[x * 4 + 0] = pSrc[x * 3 + 2];
+                pOut[x * 4 + 1] = pSrc[x * 3 + 1];
+                pOut[x * 4 + 2] = pSrc[x * 3 + 0];
+                pOut[x * 4 + 3] = 255;
+            }
+        }
+        else
+        {
+            for( u32 x=0; x<w; ++x )
+            {
+                auto index = asdx::Min<u32>( pSrc[x], paletteCount - 1 );
+                pOut[x * 4 + 0] = pPalette[index * 4 + 2];
+                pOut[x * 4 + 1] = pPalette[index * 4 + 1];
+                pOut[x * 4 + 2] = pPalette[index * 4 + 0];
+                pOut[x * 4 + 3] = 255;
+            }
+        }
+
+        if ( compression == BMP_COMPRESSION_RGB && bitCount == 32 )
+        {
+            for( u32 x=0; x<w; ++x )
+            { alpha |= pOut[x * 4 + 3]; }
+        }
+    }
+
+    // BI_RGB の 32bit はアルファが予約領域なので, 全て 0 の場合は不透明として扱う.
+    if ( compression == BMP_COMPRESSION_RGB && bitCount == 32 && alpha == 0 )
+    {
+        for( size_t i=0; i<size_t( w ) * h; ++i )
+        { pDst[i * 4 + 3] = 255; }
+    }
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      TGA の 1 ピクセルを RGBA8 に変換します.
+//-------------------------------------------------------------------------------------------------
+inline void ConvertTargaPixel( const u8* pSrc, u32 bytesPerPixel, u8* pDst )
+{
+    switch( bytesPerPixel )
+    {
+    case 1:
+        pDst[0] = pDst[1] = pDst[2] = pSrc[0];
+        pDst[3] = 255;
+        break;
+
+    case 3:
+        pDst[0] = pSrc[2];
+        pDst[1] = pSrc[1];
+        pDst[2] = pSrc[0];
+        pDst[3] = 255;
+        break;
+
+    default:
+        pDst[0] = pSrc[2];
+        pDst[1] = pSrc[1];
+        pDst[2] = pSrc[0];
+        pDst[3] = pSrc[3];
+        break;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      TGA ファイルをデコードします.
+//-------------------------------------------------------------------------------------------------
+bool DecodeTarga( const u8* pData, size_t size, bool mipmaps, Texture& texture )
+{
+    if ( size < 18 )
+    {
+        ELOG( "Error : Invalid TGA File." );
+        return false;
+    }
+
+    auto idLength       = pData[0];
+    auto colorMapType   = pData[1];
+    auto imageType      = pData[2];
+    auto colorMapLength = ReadU16( pData + 5 );
+    auto colorMapBits   = pData[7];
+    auto width          = ReadU16( pData + 12 );
+    auto height         = ReadU16( pData + 14 );
+    auto pixelDepth     = pData[16];
+    auto descriptor     = pData[17];
+
+    // 2 : フルカラー, 3 : グレースケール, 10, 11 : それぞれの RLE 圧縮.
+    auto rle  = ( imageType == 10 || imageType == 11 );
+    auto gray = ( imageType == 3  || imageType == 11 );
+
+    auto supported = ( imageType == 2 || imageType == 3 || rle )
+                  && ( gray ? pixelDepth == 8 : ( pixelDepth == 24 || pixelDepth == 32 ) )
+                  && ( descriptor & 0x10 ) == 0;
+    if ( !supported )
+    {
+        ELOG( "Error : Unsupported TGA Format. imageType = %u, pixelDepth = %u", imageType, pixelDepth );
+        return false;
+    }
+
+    if ( width == 0 || height == 0 )
+    {
+        ELOG( "Error : Invalid TGA Header." );
+        return false;
+    }
+
+    auto offset = size_t( 18 ) + idLength;
+    if ( colorMapType == 1 )
+    { offset += size_t( colorMapLength ) * ( ( colorMapBits + 7 ) / 8 ); }
+
+    auto bytesPerPixel = u32( pixelDepth / 8 );
+    auto pixelCount    = size_t( width ) * height;
+
+    if ( offset > size || ( !rle && size - offset < pixelCount * bytesPerPixel ) )
+    {
+        ELOG( "Error : TGA File Truncated." );
+        return false;
+    }
+
+    if ( !texture.Init( width, height, mipmaps ? 0 : 1 ) )
+    { return false; }
+
+    // ファイルの行の順にデコードし, 必要なら後で上下を入れ替える.
+    auto pDst = texture.GetPixels( 0 );
+    auto pSrc = pData + offset;
+
+    if ( !rle )
+    {
+        if ( bytesPerPixel == 4 )
+        { SwapRedBlue( pSrc, pDst, u32( pixelCount ) ); }
+        else
+        {
+            for( size_t i=0; i<pixelCount; ++i )
+            { ConvertTargaPixel( pSrc + i * bytesPerPixel, bytesPerPixel, pDst + i * 4 ); }
+        }
+    }
+    else
+    {
+        // ランは行をまたいでも構わない.
+        auto pEnd = pData + size;
+        for( size_t i=0; i<pixelCount; )
+        {
+            if ( pSrc >= pEnd )
+            {
+                ELOG( "Error : TGA File Truncated." );
+                return false;
+            }
+
+            auto header = *pSrc++;
+            auto count  = size_t( header & 0x7f ) + 1;
+            auto raw    = ( header & 0x80 ) == 0;
+            auto bytes  = raw ? count * bytesPerPixel : bytesPerPixel;
+
+            if ( count > pixelCount - i || size_t( pEnd - pSrc ) < bytes )
+            {
+                ELOG( "Error : Invalid TGA RLE Packet." );
+                return false;
+            }
+
+            for( size_t j=0; j<count; ++j, ++i )
+            { ConvertTargaPixel( pSrc + ( raw ? j * bytesPerPixel : 0 ), bytesPerPixel, pDst + i * 4 ); }
+
+            pSrc += bytes;
+        }
+    }
+
+    // アルファのビット数が 0 の場合, 4 バイト目は意味を持たない.
+    if ( bytesPerPixel == 4 && ( descriptor & 0x0f ) == 0 )
+    {
+        for( size_t i=0; i<pixelCount; ++i )
+        { pDst[i * 4 + 3] = 255; }
+    }
+
+    // 上端の行から並んでいる場合は, 下端の行から並ぶように入れ替える.
+    if ( ( descriptor & 0x20 ) != 0 )
+    {
+        auto rowSize = size_t( width ) * 4;
+        std::vector<u8> temp( rowSize );
+        for( u32 y=0; y<height / 2u; ++y )
+        {
+            auto pRow0 = pDst + rowSize * y;
+            auto pRow1 = pDst + rowSize * ( height - 1 - y );
+            memcpy( temp.data(), pRow0, rowSize );
+            memcpy( pRow0, pRow1, rowSize );
+            memcpy( pRow1, temp.data(), rowSize );
+        }
+    }
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      拡張子が一致するか判定します. 大文字と小文字は区別しません.
+//-------------------------------------------------------------------------------------------------
+bool HasExtension( const char* filename, const char* extension )
+{
+    auto dot = strrchr( filename, '.' );
+    if ( dot == nullptr )
+    { return false; }
+
+    for( ++dot; *dot != '\0' && *extension != '\0'; ++dot, ++extension )
+    {
+        if ( tolower( u8( *dot ) ) != *extension )
+        { return false; }
+    }
+
+    return *dot == '\0' && *extension == '\0';
+}
+
+//-------------------------------------------------------------------------------------------------
+//      2x2 ピクセルの平均で, 縮小後のレベルの行を生成します.
+//-------------------------------------------------------------------------------------------------
+void DownsampleRows
+(
+    const TextureLevel& src,
+    const u8*           pSrc,
+    const TextureLevel& dst,
+    u8*                 pDst,
+    u32                 beginRow,
+    u32                 endRow
+)
+{
+    for( auto y=beginRow; y<endRow; ++y )
+    {
+        auto pRow0 = pSrc + size_t( asdx::Min( y * 2,     src.Height - 1 ) ) * src.Width * 4;
+        auto pRow1 = pSrc + size_t( asdx::Min( y * 2 + 1, src.Height - 1 ) ) * src.Width * 4;
+        auto pOut  = pDst + size_t( y ) * dst.Width * 4;
+
+        u32 x = 0;
+
+    #if defined(TEXTURE_USE_SSE2)
+        // 2 行 x 8 ピクセルを 16bit に広げて足し合わせ, 4 ピクセルにする.
+        auto zero  = _mm_setzero_si128();
+        auto round = _mm_set1_epi16( 2 );
+        for( ; x + 4 <= dst.Width && x * 2 + 8 <= src.Width; x += 4 )
+        {
+            auto a0 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pRow0 + x * 8 ) );
+            auto a1 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pRow0 + x * 8 + 16 ) );
+            auto b0 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pRow1 + x * 8 ) );
+            auto b1 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pRow1 + x * 8 + 16 ) );
+
+            // 縦方向の和. 各レジスタは 2 ピクセル分.
+            auto s0 = _mm_add_epi16( _mm_unpacklo_epi8( a0, zero ), _mm_unpacklo_epi8( b0, zero ) );
+            auto s1 = _mm_add_epi16( _mm_unpackhi_epi8( a0, zero ), _mm_unpackhi_epi8( b0, zero ) );
+            auto s2 = _mm_add_epi16( _mm_unpacklo_epi8( a1, zero ), _mm_unpacklo_epi8( b1, zero ) );
+            auto s3 = _mm_add_epi16( _mm_unpackhi_epi8( a1, zero ), _mm_unpackhi_epi8( b1, zero ) );
+
+            // 横方向の和. 隣り合うピクセルは 64bit の上位と下位にある.
+            auto t0 = _mm_add_epi16( _mm_unpacklo_epi64( s0, s1 ), _mm_unpackhi_epi64( s0, s1 ) );
+            auto t1 = _mm_add_epi16( _mm_unpacklo_epi64( s2, s3 ), _mm_unpackhi_epi64( s2, s3 ) );
+
+            t0 = _mm_srli_epi16( _mm_add_epi16( t0, round ), 2 );
+            t1 = _mm_srli_epi16( _mm_add_epi16( t1, round ), 2 );
+
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( pOut + x * 4 ), _mm_packus_epi16( t0, t1 ) );
+        }
+    #endif
+
+        for( ; x<dst.Width; ++x )
+        {
+            auto x0 = asdx::Min( x * 2,     src.Width - 1 ) * 4;
+            auto x1 = asdx::Min( x * 2 + 1, src.Width - 1 ) * 4;
+            for( u32 c=0; c<4; ++c )
+            { pOut[x * 4 + c] = u8( ( pRow0[x0 + c] + pRow0[x1 + c] + pRow1[x0 + c] + pRow1[x1 + c] + 2 ) >> 2 ); }
+        }
+    }
+}
+
+} // namespace /* anonymous */
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Texture class
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------------------------------
+//      コンストラクタです.
+//-------------------------------------------------------------------------------------------------
+Texture::Texture()
+: m_pPixels ( nullptr )
+, m_Size    ( 0 )
+{ /* DO_NOTHING */ }
+
+//-------------------------------------------------------------------------------------------------
+//      デストラクタです.
+//-------------------------------------------------------------------------------------------------
+Texture::~Texture()
+{ Term(); }
+
+//-------------------------------------------------------------------------------------------------
+//      BMP または TGA ファイルから読み込みます.
+//-------------------------------------------------------------------------------------------------
+bool Texture::Load( const char* filename, bool mipmaps )
+{
+    if ( filename == nullptr )
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    MappedFile file;
+    if ( !file.Open( filename ) )
+    { return false; }
+
+    auto pData = reinterpret_cast<const u8*>( file.GetData() );
+    auto size  = size_t( file.GetSize() );
+
+    // BMP はシグネチャで, シグネチャを持たない TGA は拡張子で判定する.
+    auto result = false;
+    if ( size >= 2 && pData[0] == 'B' && pData[1] == 'M' )
+    { result = DecodeBitmap( pData, size, mipmaps, *this ); }
+    else if ( HasExtension( filename, "tga" ) )
+    { result = DecodeTarga( pData, size, mipmaps, *this ); }
+    else
+    { ELOG( "Error : Unsupported Image Format. filename = %s", filename ); }
+
+    if ( !result )
+    {
+        ELOG( "Error : Texture Load Failed. filename = %s", filename );
+        Term();
+        return false;
+    }
+
+    if ( mipmaps )
+    { GenerateMips(); }
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      ピクセルデータの格納先を確保します.
+//-------------------------------------------------------------------------------------------------
+bool Texture::Init( u32 width, u32 height, u32 levelCount )
+{
+    if ( width == 0 || height == 0 || width > TEXTURE_MAX_SIZE || height > TEXTURE_MAX_SIZE )
+    {
+        ELOG( "Error : Invalid Argument. width = %u, height = %u", width, height );
+        return false;
+    }
+
+    Term();
+
+    // 各レベルの先頭をアラインメントに揃えて, 1 つの領域に並べる.
+    size_t size = 0;
+    {
+        auto w = width;
+        auto h = height;
+        do
+        {
+            m_Levels.push_back( { w, h, size } );
+            size += ( size_t( w ) * h * 4 + TEXTURE_ALIGNMENT - 1 ) & ~size_t( TEXTURE_ALIGNMENT - 1 );
+
+            if ( w == 1 && h == 1 )
+            { break; }
+
+            w = asdx::Max( w / 2, 1u );
+            h = asdx::Max( h / 2, 1u );
+        }
+        while( levelCount == 0 || u32( m_Levels.size() ) < levelCount );
+    }
+
+    m_pPixels = static_cast<u8*>( ::operator new( size, std::align_val_t( TEXTURE_ALIGNMENT ), std::nothrow ) );
+    if ( m_pPixels == nullptr )
+    {
+        ELOG( "Error : Out of Memory. size = %zu", size );
+        m_Levels.clear();
+        return false;
+    }
+    m_Size = size;
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      ピクセルデータを解放します.
+//-------------------------------------------------------------------------------------------------
+void Texture::Term()
+{
+    if ( m_pPixels != nullptr )
+    { ::operator delete( m_pPixels, std::align_val_t( TEXTURE_ALIGNMENT ) ); }
+
+    m_pPixels = nullptr;
+    m_Size    = 0;
+    m_Levels.clear();
+}
+
+//-------------------------------------------------------------------------------------------------
+//      最上位のレベルから下位のミップレベルを生成します.
+//-------------------------------------------------------------------------------------------------
+void Texture::GenerateMips()
+{
+    for( size_t i=1; i<m_Levels.size(); ++i )
+    {
+        auto& src  = m_Levels[i - 1];
+        auto& dst  = m_Levels[i];
+        auto  pSrc = m_pPixels + src.Offset;
+        auto  pDst = m_pPixels + dst.Offset;
+
+        // 小さなレベルはスレッドを起こすより 1 スレッドで処理する方が速い.
+        auto chunkCount = GetChunkCount( dst.Height, TEXTURE_MIP_MIN_ROWS );
+        ParallelFor( chunkCount, [&]( u32 index )
+        {
+            auto beginRow = u32( u64( dst.Height ) * index / chunkCount );
+            auto endRow   = u32( u64( dst.Height ) * ( index + 1 ) / chunkCount );
+            DownsampleRows( src, pSrc, dst, pDst, beginRow, endRow );
+        } );
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      最上位のレベルの横幅を取得します.
+//-------------------------------------------------------------------------------------------------
+u32 Texture::GetWidth() const
+{ return m_Levels.empty() ? 0 : m_Levels[0].Width; }
+
+//-------------------------------------------------------------------------------------------------
+//      最上位のレベルの縦幅を取得します.
+//-------------------------------------------------------------------------------------------------
+u32 Texture::GetHeight() const
+{ return m_Levels.empty() ? 0 : m_Levels[0].Height; }
+
+//-------------------------------------------------------------------------------------------------
+//      最上位のレベルの全てのピクセルが不透明かどうかを判定します.
+//-------------------------------------------------------------------------------------------------
+bool Texture::IsOpaque() const
+{
+    if ( m_Levels.empty() )
+    { return true; }
+
+    auto pPixels = m_pPixels + m_Levels[0].Offset;
+    auto count   = size_t( m_Levels[0].Width ) * m_Levels[0].Height;
+    for( size_t i=0; i<count; ++i )
+    {
+        if ( pPixels[i * 4 + 3] != 255 )
+        { return false; }
+    }
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      ミップレベル数を取得します.
+//-------------------------------------------------------------------------------------------------
+u32 Texture::GetLevelCount() const
+{ return u32( m_Levels.size() ); }
+
+//-------------------------------------------------------------------------------------------------
+//      ミップレベルの情報を取得します.
+//-------------------------------------------------------------------------------------------------
+const TextureLevel& Texture::GetLevel( u32 level ) const
+{ return m_Levels[level]; }
+
+//-------------------------------------------------------------------------------------------------
+//      ミップレベルのピクセルデータを取得します.
+//-------------------------------------------------------------------------------------------------
+u8* Texture::GetPixels( u32 level )
+{ return m_pPixels + m_Levels[level].Offset; }
+
+//-------------------------------------------------------------------------------------------------
+//      ミップレベルのピクセルデータを取得します.
+//-------------------------------------------------------------------------------------------------
+const u8* Texture::GetPixels( u32 level ) const
+{ return m_pPixels + m_Levels[level].Offset; }
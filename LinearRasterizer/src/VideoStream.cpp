@@ -0,0 +1,371 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : VideoStream.cpp
+// Desc : Raw Video Stream Output Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <VideoStream.h>
+#include <ImageFile.h>
+#include <cstring>
+#include <cwchar>
+#include <asdxLogger.h>
+
+#if ASDX_IS_WIN
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+    #include <emmintrin.h>
+    #define VIDEO_USE_SSE2  (1)
+#endif
+
+
+namespace /* anonymous */ {
+
+//-------------------------------------------------------------------------------------------------
+// Constant Values
+//-------------------------------------------------------------------------------------------------
+static constexpr char Y4M_FRAME_HEADER[] = "FRAME\n";     //!< フレームヘッダです.
+static constexpr u32  Y4M_FRAME_HEADER_SIZE = sizeof(Y4M_FRAME_HEADER) - 1;
+
+
+//-------------------------------------------------------------------------------------------------
+//      輝度を求めます (BT.601 リミテッドレンジ).
+//-------------------------------------------------------------------------------------------------
+inline u8 ToY( s32 r, s32 g, s32 b )
+{ return u8( ( ( 66 * r + 129 * g + 25 * b + 128 ) >> 8 ) + 16 ); }
+
+//-------------------------------------------------------------------------------------------------
+//      色差 (Cb) を求めます (BT.601 リミテッドレンジ).
+//-------------------------------------------------------------------------------------------------
+inline u8 ToU( s32 r, s32 g, s32 b )
+{ return u8( ( ( 112 * b + 128 - 38 * r - 74 * g ) >> 8 ) + 128 ); }
+
+//-------------------------------------------------------------------------------------------------
+//      色差 (Cr) を求めます (BT.601 リミテッドレンジ).
+//-------------------------------------------------------------------------------------------------
+inline u8 ToV( s32 r, s32 g, s32 b )
+{ return u8( ( ( 112 * r + 128 - 94 * g - 18 * b ) >> 8 ) + 128 ); }
+
+#if defined(VIDEO_USE_SSE2)
+//-------------------------------------------------------------------------------------------------
+//      32bit レーンの値を係数倍します. 積が 16bit に収まる場合に限ります.
+//-------------------------------------------------------------------------------------------------
+inline __m128i Mul16( __m128i value, s32 scale )
+{ return _mm_mullo_epi16( value, _mm_set1_epi32( scale ) ); }
+
+//-------------------------------------------------------------------------------------------------
+//      4 ピクセル分の輝度を 32bit レーンで求めます.
+//-------------------------------------------------------------------------------------------------
+inline __m128i ToY4( __m128i pixels )
+{
+    auto mask = _mm_set1_epi32( 0xff );
+    auto r = _mm_and_si128( pixels, mask );
+    auto g = _mm_and_si128( _mm_srli_epi32( pixels, 8 ), mask );
+    auto b = _mm_and_si128( _mm_srli_epi32( pixels, 16 ), mask );
+
+    // 係数の和が 220 なので, 255 倍しても 32bit レーンの下位 16bit に収まる.
+    auto y = _mm_add_epi32( _mm_add_epi32( Mul16( r, 66 ), Mul16( g, 129 ) ), _mm_add_epi32( Mul16( b, 25 ), _mm_set1_epi32( 128 ) ) );
+    return _mm_add_epi32( _mm_srli_epi32( y, 8 ), _mm_set1_epi32( 16 ) );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      2 行 x 2 ピクセルの平均を求めます. 偶数番目のレーンに結果が入ります.
+//-------------------------------------------------------------------------------------------------
+inline __m128i Average2x2( __m128i a, __m128i b )
+{
+    auto v = _mm_add_epi32( a, b );
+    v = _mm_add_epi32( v, _mm_shuffle_epi32( v, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+    return _mm_srli_epi32( _mm_add_epi32( v, _mm_set1_epi32( 2 ) ), 2 );
+}
+#endif
+
+//-------------------------------------------------------------------------------------------------
+//      1 行分の輝度を求めます.
+//-------------------------------------------------------------------------------------------------
+void ConvertLuma( const u8* pSrc, u8* pDst, u32 width )
+{
+    u32 x = 0;
+
+#if defined(VIDEO_USE_SSE2)
+    for( ; x + 16 <= width; x += 16 )
+    {
+        auto p = reinterpret_cast<const __m128i*>( pSrc + x * 4 );
+        auto y0 = ToY4( _mm_loadu_si128( p + 0 ) );
+        auto y1 = ToY4( _mm_loadu_si128( p + 1 ) );
+        auto y2 = ToY4( _mm_loadu_si128( p + 2 ) );
+        auto y3 = ToY4( _mm_loadu_si128( p + 3 ) );
+
+        auto lo = _mm_packs_epi32( y0, y1 );
+        auto hi = _mm_packs_epi32( y2, y3 );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( pDst + x ), _mm_packus_epi16( lo, hi ) );
+    }
+#endif
+
+    for( ; x<width; ++x )
+    {
+        auto p = pSrc + x * 4;
+        pDst[x] = ToY( p[0], p[1], p[2] );
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      2 行分のピクセルから 1 行分の色差を求めます. 2x2 ピクセルの平均色から求めます.
+//-------------------------------------------------------------------------------------------------
+void ConvertChroma( const u8* pRow0, const u8* pRow1, u8* pDstU, u8* pDstV, u32 width )
+{
+    auto chromaWidth = ( width + 1 ) / 2;
+    u32  x = 0;
+
+#if defined(VIDEO_USE_SSE2)
+    auto mask = _mm_set1_epi32( 0xff );
+    auto bias = _mm_set1_epi32( 128 );
+
+    // 4 ピクセル (2 サンプル) ずつ処理する. 偶数番目のレーンに 2 ピクセルの和が入る.
+    for( ; x + 2 <= width / 2; x += 2 )
+    {
+        auto a = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pRow0 + x * 8 ) );
+        auto b = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pRow1 + x * 8 ) );
+
+        __m128i sum[3];
+        sum[0] = Average2x2( _mm_and_si128( a, mask ),                      _mm_and_si128( b, mask ) );
+        sum[1] = Average2x2( _mm_and_si128( _mm_srli_epi32( a,  8 ), mask ), _mm_and_si128( _mm_srli_epi32( b,  8 ), mask ) );
+        sum[2] = Average2x2( _mm_and_si128( _mm_srli_epi32( a, 16 ), mask ), _mm_and_si128( _mm_srli_epi32( b, 16 ), mask ) );
+
+        // 負の係数は別に求めて引く. どちらも 16bit に収まる.
+        auto u = _mm_sub_epi32( _mm_add_epi32( Mul16( sum[2], 112 ), bias ), _mm_add_epi32( Mul16( sum[0], 38 ), Mul16( sum[1], 74 ) ) );
+        auto v = _mm_sub_epi32( _mm_add_epi32( Mul16( sum[0], 112 ), bias ), _mm_add_epi32( Mul16( sum[1], 94 ), Mul16( sum[2], 18 ) ) );
+        u = _mm_add_epi32( _mm_srai_epi32( u, 8 ), bias );
+        v = _mm_add_epi32( _mm_srai_epi32( v, 8 ), bias );
+
+        pDstU[x + 0] = u8( _mm_cvtsi128_si32( u ) );
+        pDstU[x + 1] = u8( _mm_cvtsi128_si32( _mm_srli_si128( u, 8 ) ) );
+        pDstV[x + 0] = u8( _mm_cvtsi128_si32( v ) );
+        pDstV[x + 1] = u8( _mm_cvtsi128_si32( _mm_srli_si128( v, 8 ) ) );
+    }
+#endif
+
+    for( ; x<chromaWidth; ++x )
+    {
+        // 奇数幅の右端は同じ列を 2 回使う.
+        auto x0 = x * 2;
+        auto x1 = ( x0 + 1 < width ) ? x0 + 1 : x0;
+
+        s32 sum[3];
+        for( auto c=0; c<3; ++c )
+        { sum[c] = ( pRow0[x0 * 4 + c] + pRow0[x1 * 4 + c] + pRow1[x0 * 4 + c] + pRow1[x1 * 4 + c] + 2 ) >> 2; }
+
+        pDstU[x] = ToU( sum[0], sum[1], sum[2] );
+        pDstV[x] = ToV( sum[0], sum[1], sum[2] );
+    }
+}
+
+} // namespace /* anonymous */
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// VideoStream class
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------------------------------
+//      コンストラクタです.
+//-------------------------------------------------------------------------------------------------
+VideoStream::VideoStream()
+: m_pFile   ( nullptr )
+, m_Owned   ( false )
+, m_Width   ( 0 )
+, m_Height  ( 0 )
+, m_Format  ( VIDEO_FORMAT_Y4M )
+{ /* DO_NOTHING */ }
+
+//-------------------------------------------------------------------------------------------------
+//      デストラクタです.
+//-------------------------------------------------------------------------------------------------
+VideoStream::~VideoStream()
+{ Close(); }
+
+//-------------------------------------------------------------------------------------------------
+//      出力先のファイルを開きます.
+//-------------------------------------------------------------------------------------------------
+bool VideoStream::Open( const char16* filename, u32 width, u32 height, VIDEO_FORMAT format, u32 frameRate )
+{
+    if ( filename == nullptr || width == 0 || height == 0 || frameRate == 0 )
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    Close();
+
+    if ( wcscmp( filename, L"-" ) == 0 )
+    {
+    #if ASDX_IS_WIN
+        _setmode( _fileno( stdout ), _O_BINARY );
+    #endif
+        fflush( stdout );
+        m_pFile = stdout;
+        m_Owned = false;
+    }
+    else
+    {
+        m_pFile = OpenImageFile( filename );
+        m_Owned = true;
+    }
+
+    if ( m_pFile == nullptr )
+    {
+        ELOG( "Error : File Open Failed." );
+        return false;
+    }
+
+    m_Width  = width;
+    m_Height = height;
+    m_Format = format;
+
+    return WriteHeader( frameRate );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      開いているファイル記述子を出力先にします.
+//-------------------------------------------------------------------------------------------------
+bool VideoStream::OpenDescriptor( s32 fd, u32 width, u32 height, VIDEO_FORMAT format, u32 frameRate )
+{
+    if ( fd < 0 || width == 0 || height == 0 || frameRate == 0 )
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    Close();
+
+#if ASDX_IS_WIN
+    _setmode( fd, _O_BINARY );
+    m_pFile = _fdopen( fd, "wb" );
+#else
+    m_pFile = fdopen( fd, "wb" );
+#endif
+    if ( m_pFile == nullptr )
+    {
+        ELOG( "Error : fdopen() Failed. fd = %d", fd );
+        return false;
+    }
+
+    setvbuf( m_pFile, nullptr, _IONBF, 0 );
+    m_Owned  = true;
+    m_Width  = width;
+    m_Height = height;
+    m_Format = format;
+
+    return WriteHeader( frameRate );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      出力先を閉じます.
+//-------------------------------------------------------------------------------------------------
+void VideoStream::Close()
+{
+    if ( m_pFile != nullptr )
+    {
+        if ( m_Owned )
+        { fclose( m_pFile ); }
+        else
+        { fflush( m_pFile ); }
+    }
+
+    m_pFile  = nullptr;
+    m_Owned  = false;
+    m_Width  = 0;
+    m_Height = 0;
+    m_Frame.clear();
+}
+
+//-------------------------------------------------------------------------------------------------
+//      ストリームヘッダを書き込みます.
+//-------------------------------------------------------------------------------------------------
+bool VideoStream::WriteHeader( u32 frameRate )
+{
+    if ( m_Format == VIDEO_FORMAT_Y4M )
+    {
+        auto chromaSize = size_t( ( m_Width + 1 ) / 2 ) * ( ( m_Height + 1 ) / 2 );
+        m_Frame.resize( Y4M_FRAME_HEADER_SIZE + size_t( m_Width ) * m_Height + chromaSize * 2 );
+        memcpy( m_Frame.data(), Y4M_FRAME_HEADER, Y4M_FRAME_HEADER_SIZE );
+
+        char header[128];
+        auto length = snprintf( header, sizeof(header),
+            "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n", m_Width, m_Height, frameRate );
+
+        if ( fwrite( header, 1, size_t( length ), m_pFile ) != size_t( length ) )
+        {
+            ELOG( "Error : Stream Header Write Failed." );
+            Close();
+            return false;
+        }
+    }
+    else
+    {
+        m_Frame.resize( size_t( m_Width ) * m_Height * 4 );
+    }
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      1 フレームを変換して書き込みます.
+//-------------------------------------------------------------------------------------------------
+bool VideoStream::WriteFrame( const u8* pBuffer )
+{
+    if ( m_pFile == nullptr || pBuffer == nullptr )
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    // ピクセルデータは下端の行から並んでいるので, 画像の行 y はバッファの height - 1 - y 行目.
+    auto rowSize = size_t( m_Width ) * 4;
+    auto GetRow  = [&]( u32 y ) { return pBuffer + size_t( m_Height - 1 - y ) * rowSize; };
+
+    if ( m_Format == VIDEO_FORMAT_Y4M )
+    {
+        auto chromaWidth  = ( m_Width  + 1 ) / 2;
+        auto chromaHeight = ( m_Height + 1 ) / 2;
+
+        auto pY = m_Frame.data() + Y4M_FRAME_HEADER_SIZE;
+        auto pU = pY + size_t( m_Width ) * m_Height;
+        auto pV = pU + size_t( chromaWidth ) * chromaHeight;
+
+        for( u32 y=0; y<m_Height; ++y )
+        { ConvertLuma( GetRow( y ), pY + size_t( y ) * m_Width, m_Width ); }
+
+        // 奇数高さの下端は同じ行を 2 回使う.
+        for( u32 y=0; y<chromaHeight; ++y )
+        {
+            auto y0 = y * 2;
+            auto y1 = ( y0 + 1 < m_Height ) ? y0 + 1 : y0;
+            ConvertChroma( GetRow( y0 ), GetRow( y1 ),
+                pU + size_t( y ) * chromaWidth, pV + size_t( y ) * chromaWidth, m_Width );
+        }
+    }
+    else
+    {
+        for( u32 y=0; y<m_Height; ++y )
+        { memcpy( m_Frame.data() + y * rowSize, GetRow( y ), rowSize ); }
+    }
+
+    if ( fwrite( m_Frame.data(), 1, m_Frame.size(), m_pFile ) != m_Frame.size() )
+    {
+        ELOG( "Error : Frame Write Failed." );
+        return false;
+    }
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      出力先が開いているかどうかを取得します.
+//-------------------------------------------------------------------------------------------------
+bool VideoStream::IsOpen() const
+{ return m_pFile != nullptr; }
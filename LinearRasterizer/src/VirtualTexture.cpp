@@ -0,0 +1,537 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : VirtualTexture.cpp
+// Desc : Virtual Texture Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <VirtualTexture.h>
+#include <Texture.h>
+#include <asdxLogger.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <string>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if ASDX_IS_WIN
+#include <Windows.h>
+#endif
+
+
+namespace /* anonymous */ {
+
+//-------------------------------------------------------------------------------------------------
+//      アライメントに合わせて切り上げます.
+//-------------------------------------------------------------------------------------------------
+inline u64 AlignUp( u64 value, u64 alignment )
+{ return ( value + alignment - 1 ) & ~( alignment - 1 ); }
+
+//-------------------------------------------------------------------------------------------------
+//      ファイルサイズと更新日時を取得します.
+//-------------------------------------------------------------------------------------------------
+bool GetFileInfo( const char* filename, u64& size, u64& time )
+{
+#if ASDX_IS_WIN
+    struct _stat64 info;
+    if ( _stat64( filename, &info ) != 0 )
+    { return false; }
+#else
+    struct stat info;
+    if ( stat( filename, &info ) != 0 )
+    { return false; }
+#endif
+
+    size = u64( info.st_size );
+    time = u64( info.st_mtime );
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      指定オフセットまで 0 で埋めてからデータを書き込みます.
+//-------------------------------------------------------------------------------------------------
+bool WriteAt( FILE* pFile, u64& cursor, u64 offset, const void* pData, u64 size )
+{
+    static const u8 padding[TEXTURE_ALIGNMENT] = {};
+
+    while( cursor < offset )
+    {
+        auto count = size_t( ( offset - cursor < TEXTURE_ALIGNMENT ) ? offset - cursor : TEXTURE_ALIGNMENT );
+        if ( fwrite( padding, 1, count, pFile ) != count )
+        { return false; }
+        cursor += count;
+    }
+
+    if ( size > 0 && fwrite( pData, 1, size_t( size ), pFile ) != size_t( size ) )
+    { return false; }
+
+    cursor += size;
+    return true;
+}
+
+} // namespace /* anonymous */
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// PageCache class
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------------------------------
+//      コンストラクタです.
+//-------------------------------------------------------------------------------------------------
+PageCache::PageCache()
+: m_pMemory     ( nullptr )
+, m_SlotSize    ( 0 )
+, m_Head        ( U32_MAX )
+, m_Tail        ( U32_MAX )
+, m_Frame       ( 0 )
+{ /* DO_NOTHING */ }
+
+//-------------------------------------------------------------------------------------------------
+//      デストラクタです.
+//-------------------------------------------------------------------------------------------------
+PageCache::~PageCache()
+{ Term(); }
+
+//-------------------------------------------------------------------------------------------------
+//      物理ページの格納先を確保します.
+//-------------------------------------------------------------------------------------------------
+bool PageCache::Init( size_t budget, u32 pageSize )
+{
+    if ( pageSize == 0 || budget < pageSize )
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    Term();
+
+    auto count = u32( asdx::Min<size_t>( budget / pageSize, U32_MAX - 1 ) );
+    auto size  = size_t( count ) * pageSize;
+
+    m_pMemory = static_cast<u8*>( ::operator new( size, std::align_val_t( TEXTURE_ALIGNMENT ), std::nothrow ) );
+    if ( m_pMemory == nullptr )
+    {
+        ELOG( "Error : Out of Memory. size = %zu", size );
+        return false;
+    }
+
+    // 全てのスロットを空きとして LRU リストにつなぐ.
+    m_Slots.resize( count );
+    for( u32 i=0; i<count; ++i )
+    {
+        auto& slot = m_Slots[i];
+        slot.pOwner   = nullptr;
+        slot.Page     = 0;
+        slot.Prev     = ( i > 0 ) ? i - 1 : U32_MAX;
+        slot.Next     = ( i + 1 < count ) ? i + 1 : U32_MAX;
+        slot.LastUsed = 0;
+    }
+
+    m_SlotSize = pageSize;
+    m_Head     = 0;
+    m_Tail     = count - 1;
+    m_Frame    = 0;
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      格納先を解放します.
+//-------------------------------------------------------------------------------------------------
+void PageCache::Term()
+{
+    // 解放したスロットをテクスチャから参照しないようにする.
+    for( auto& slot : m_Slots )
+    {
+        if ( slot.pOwner != nullptr )
+        { slot.pOwner->m_Pages[slot.Page] = nullptr; }
+    }
+
+    if ( m_pMemory != nullptr )
+    { ::operator delete( m_pMemory, std::align_val_t( TEXTURE_ALIGNMENT ) ); }
+
+    m_pMemory  = nullptr;
+    m_SlotSize = 0;
+    m_Head     = U32_MAX;
+    m_Tail     = U32_MAX;
+    m_Slots   .clear();
+    m_Textures.clear();
+    m_Requests.clear();
+}
+
+//-------------------------------------------------------------------------------------------------
+//      仮想テクスチャを登録します.
+//-------------------------------------------------------------------------------------------------
+bool PageCache::Register( TiledTexture* pTexture )
+{
+    if ( pTexture == nullptr || !pTexture->IsVirtual() || pTexture->GetPageSize() > m_SlotSize )
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    m_Textures.push_back( pTexture );
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      登録したテクスチャで要求されたページを読み込みます.
+//-------------------------------------------------------------------------------------------------
+PageCacheStats PageCache::Update()
+{
+    PageCacheStats stats = {};
+
+    m_Frame++;
+    m_Requests.clear();
+
+    // 読み込み済みのページは今回使うものとして先頭に移し, 読み込まれていないページを集める.
+    for( auto pTexture : m_Textures )
+    {
+        auto& levels   = pTexture->m_Levels;
+        auto& requests = pTexture->m_Requests;
+
+        // ページ番号はレベル順に並んでいる.
+        u32 level = 0;
+        for( u32 page=0; page<u32( requests.size() ); ++page )
+        {
+            if ( requests[page] == 0 )
+            { continue; }
+
+            requests[page] = 0;
+            stats.Requested++;
+
+            while( level + 1 < u32( levels.size() ) && levels[level + 1].FirstPage <= page )
+            { level++; }
+
+            auto pData = pTexture->m_Pages[page];
+            if ( pData != nullptr )
+            {
+                auto index = u32( ( pData - m_pMemory ) / m_SlotSize );
+                m_Slots[index].LastUsed = m_Frame;
+                Touch( index );
+                continue;
+            }
+
+            m_Requests.push_back( { pTexture, page, level } );
+        }
+    }
+
+    // 粗いレベルから読み込む. スロットが足りなくても, 代わりに使うページは先に揃う.
+    std::stable_sort( m_Requests.begin(), m_Requests.end(), []( const Request& lhs, const Request& rhs )
+    { return lhs.Level > rhs.Level; } );
+
+    for( auto& request : m_Requests )
+    {
+        // 最も古いスロットも今回使う場合は, 全てのスロットが使用中.
+        auto  index = m_Tail;
+        auto& slot  = m_Slots[index];
+        if ( slot.LastUsed == m_Frame )
+        { break; }
+
+        if ( slot.pOwner != nullptr )
+        {
+            slot.pOwner->m_Pages[slot.Page] = nullptr;
+            stats.Evicted++;
+        }
+
+        // ページはマップしたファイルからコピーする. 初めて触れたページはここでディスクから読み込まれる.
+        auto pTexture = request.pTexture;
+        auto pDst     = m_pMemory + size_t( index ) * m_SlotSize;
+        memcpy( pDst, pTexture->m_pPageData + size_t( request.Page ) * pTexture->m_PageSize, pTexture->m_PageSize );
+        pTexture->m_Pages[request.Page] = pDst;
+
+        slot.pOwner   = pTexture;
+        slot.Page     = request.Page;
+        slot.LastUsed = m_Frame;
+        Touch( index );
+
+        stats.Loaded++;
+    }
+
+    stats.Dropped = u32( m_Requests.size() ) - stats.Loaded;
+
+    for( auto& slot : m_Slots )
+    {
+        if ( slot.pOwner != nullptr )
+        { stats.Resident++; }
+    }
+
+    return stats;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      スロット数を取得します.
+//-------------------------------------------------------------------------------------------------
+u32 PageCache::GetSlotCount() const
+{ return u32( m_Slots.size() ); }
+
+//-------------------------------------------------------------------------------------------------
+//      登録したテクスチャの数を取得します.
+//-------------------------------------------------------------------------------------------------
+u32 PageCache::GetTextureCount() const
+{ return u32( m_Textures.size() ); }
+
+//-------------------------------------------------------------------------------------------------
+//      スロットを LRU リストの先頭に移動します.
+//-------------------------------------------------------------------------------------------------
+void PageCache::Touch( u32 index )
+{
+    if ( index == m_Head )
+    { return; }
+
+    // リストから外す. 先頭ではないので, 1 つ新しいスロットが必ずある.
+    auto& slot = m_Slots[index];
+    m_Slots[slot.Prev].Next = slot.Next;
+    if ( slot.Next != U32_MAX )
+    { m_Slots[slot.Next].Prev = slot.Prev; }
+    else
+    { m_Tail = slot.Prev; }
+
+    // 先頭につなぐ.
+    slot.Prev = U32_MAX;
+    slot.Next = m_Head;
+    m_Slots[m_Head].Prev = index;
+    m_Head = index;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+//      タイル単位に並べたテクスチャをページファイルに書き出します.
+//-------------------------------------------------------------------------------------------------
+bool SavePageFile
+(
+    const char*         filename,
+    const TiledTexture& texture,
+    u64                 sourceSize,
+    u64                 sourceTime
+)
+{
+    if ( filename == nullptr || texture.IsEmpty() || texture.IsVirtual() )
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    auto tileSize   = texture.GetTileSize();
+    auto pageSize   = TEXTURE_PAGE_TILE * TEXTURE_PAGE_TILE * tileSize;
+    auto levelCount = texture.GetLevelCount();
+
+    // 1 ページに収まる最初のレベルからをミップテールにする. 最下位のレベルは必ず含める.
+    auto tailLevel = levelCount - 1;
+    for( u32 i=0; i<levelCount; ++i )
+    {
+        auto& level = texture.GetLevel( i );
+        if ( level.Width <= TEXTURE_PAGE_SIZE && level.Height <= TEXTURE_PAGE_SIZE )
+        {
+            tailLevel = i;
+            break;
+        }
+    }
+
+    std::vector<PageFileLevel> levels( levelCount );
+    u32 pageCount = 0;
+    u64 tailSize  = 0;
+    for( u32 i=0; i<levelCount; ++i )
+    {
+        auto& src        = texture.GetLevel( i );
+        auto& dst        = levels[i];
+        auto  tileCountY = ( src.Height + TEXTURE_TILE_SIZE - 1 ) / TEXTURE_TILE_SIZE;
+
+        dst.Width  = src.Width;
+        dst.Height = src.Height;
+
+        if ( i < tailLevel )
+        {
+            auto pageCountY = ( tileCountY + TEXTURE_PAGE_TILE - 1 ) / TEXTURE_PAGE_TILE;
+            dst.PageCountX = ( src.TileCountX + TEXTURE_PAGE_TILE - 1 ) / TEXTURE_PAGE_TILE;
+            dst.FirstPage  = pageCount;
+            dst.Offset     = 0;
+            pageCount += dst.PageCountX * pageCountY;
+        }
+        else
+        {
+            dst.PageCountX = 0;
+            dst.FirstPage  = U32_MAX;
+            dst.Offset     = tailSize;
+            tailSize += u64( src.TileCountX ) * tileCountY * tileSize;
+        }
+    }
+
+    PageFileHeader header = {};
+    header.Magic       = PAGE_FILE_MAGIC;
+    header.Version     = PAGE_FILE_VERSION;
+    header.SourceSize  = sourceSize;
+    header.SourceTime  = sourceTime;
+    header.Format      = u32( texture.GetFormat() );
+    header.Width       = texture.GetLevel( 0 ).Width;
+    header.Height      = texture.GetLevel( 0 ).Height;
+    header.LevelCount  = levelCount;
+    header.PageCount   = pageCount;
+    header.PageSize    = pageSize;
+    header.LevelOffset = AlignUp( sizeof(header), TEXTURE_ALIGNMENT );
+    header.TailOffset  = AlignUp( header.LevelOffset + levels.size() * sizeof(PageFileLevel), TEXTURE_ALIGNMENT );
+    header.TailSize    = tailSize;
+    header.PageOffset  = AlignUp( header.TailOffset + tailSize, PAGE_FILE_ALIGNMENT );
+
+    // 他のプロセスがマップしている古いページファイルを書き換えないよう, 一時ファイルに書き出してから置き換える.
+    auto tempPath = std::string( filename ) + ".tmp";
+
+    FILE* pFile = nullptr;
+#if ASDX_IS_WIN
+    if ( fopen_s( &pFile, tempPath.c_str(), "wb" ) != 0 )
+    { pFile = nullptr; }
+#else
+    pFile = fopen( tempPath.c_str(), "wb" );
+#endif
+    if ( pFile == nullptr )
+    {
+        ELOG( "Error : File Open Failed. filename = %s", tempPath.c_str() );
+        return false;
+    }
+
+    u64  cursor = 0;
+    auto result = WriteAt( pFile, cursor, 0,                  &header,       sizeof(header) )
+               && WriteAt( pFile, cursor, header.LevelOffset, levels.data(), levels.size() * sizeof(PageFileLevel) );
+
+    // ミップテールは常駐するレベルのテクセルデータをそのまま並べる.
+    for( auto i=tailLevel; result && i<levelCount; ++i )
+    {
+        auto& level      = texture.GetLevel( i );
+        auto  tileCountY = ( level.Height + TEXTURE_TILE_SIZE - 1 ) / TEXTURE_TILE_SIZE;
+        result = WriteAt( pFile, cursor, header.TailOffset + levels[i].Offset, texture.GetTexels( i ), u64( level.TileCountX ) * tileCountY * tileSize );
+    }
+
+    // ページはタイルの行ごとに集めて固定サイズで書き出す. レベルからはみ出すタイルは 0 で埋める.
+    std::vector<u8> page( pageSize );
+    for( u32 i=0; result && i<tailLevel; ++i )
+    {
+        auto& level      = texture.GetLevel( i );
+        auto  pTexels    = texture.GetTexels( i );
+        auto  tileCountY = ( level.Height + TEXTURE_TILE_SIZE - 1 ) / TEXTURE_TILE_SIZE;
+        auto  pageCountY = ( tileCountY + TEXTURE_PAGE_TILE - 1 ) / TEXTURE_PAGE_TILE;
+
+        for( u32 py=0; result && py<pageCountY; ++py )
+        {
+            for( u32 px=0; result && px<levels[i].PageCountX; ++px )
+            {
+                std::fill( page.begin(), page.end(), u8( 0 ) );
+
+                auto tileX = px * TEXTURE_PAGE_TILE;
+                auto count = asdx::Min( TEXTURE_PAGE_TILE, level.TileCountX - tileX );
+                for( u32 row=0; row<TEXTURE_PAGE_TILE; ++row )
+                {
+                    auto tileY = py * TEXTURE_PAGE_TILE + row;
+                    if ( tileY >= tileCountY )
+                    { break; }
+
+                    memcpy( page.data() + row * TEXTURE_PAGE_TILE * tileSize,
+                            pTexels + ( size_t( tileY ) * level.TileCountX + tileX ) * tileSize,
+                            count * tileSize );
+                }
+
+                auto number = levels[i].FirstPage + py * levels[i].PageCountX + px;
+                result = WriteAt( pFile, cursor, header.PageOffset + u64( number ) * pageSize, page.data(), pageSize );
+            }
+        }
+    }
+
+    result = ( fclose( pFile ) == 0 ) && result;
+
+    if ( !result )
+    {
+        ELOG( "Error : File Write Failed. filename = %s", tempPath.c_str() );
+        remove( tempPath.c_str() );
+        return false;
+    }
+
+#if ASDX_IS_WIN
+    result = MoveFileExA( tempPath.c_str(), filename, MOVEFILE_REPLACE_EXISTING ) != FALSE;
+#else
+    result = rename( tempPath.c_str(), filename ) == 0;
+#endif
+    if ( !result )
+    {
+        ELOG( "Error : File Rename Failed. filename = %s", filename );
+        remove( tempPath.c_str() );
+        return false;
+    }
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      画像ファイルに対応するページファイルを開いて仮想テクスチャとして初期化します.
+//-------------------------------------------------------------------------------------------------
+bool LoadVirtualTexture( const char* filename, TiledTexture* pTexture )
+{
+    if ( filename == nullptr || pTexture == nullptr )
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    u64 sourceSize = 0;
+    u64 sourceTime = 0;
+    if ( !GetFileInfo( filename, sourceSize, sourceTime ) )
+    {
+        ELOG( "Error : File Not Found. filename = %s", filename );
+        return false;
+    }
+
+    auto pagePath = std::string( filename ) + ".vtex";
+
+    // 有効なページファイルがあればそのまま使う. 初回にエラーログが出ないよう, 先に存在を確認する.
+    {
+        u64 pageSize = 0;
+        u64 pageTime = 0;
+        auto valid = false;
+
+        MappedFile file;
+        if ( GetFileInfo( pagePath.c_str(), pageSize, pageTime )
+          && file.Open( pagePath.c_str() )
+          && file.GetSize() >= sizeof(PageFileHeader) )
+        {
+            auto pHeader = reinterpret_cast<const PageFileHeader*>( file.GetData() );
+            valid = pHeader->Magic      == PAGE_FILE_MAGIC
+                 && pHeader->Version    == PAGE_FILE_VERSION
+                 && pHeader->SourceSize == sourceSize
+                 && pHeader->SourceTime == sourceTime;
+        }
+
+        // ヘッダを確認したら閉じる. 使う場合は TiledTexture::Open() でマップし直す.
+        file.Close();
+
+        if ( valid && pTexture->Open( pagePath.c_str() ) )
+        { return true; }
+    }
+
+    // ページファイルを作り直す.
+    {
+        Texture image;
+        if ( !image.Load( filename ) )
+        { return false; }
+
+        // アルファが不要なら BC1 にする.
+        auto format = image.IsOpaque() ? TEXTURE_FORMAT_BC1 : TEXTURE_FORMAT_BC3;
+        if ( !pTexture->Init( image, format ) )
+        { return false; }
+
+        // 読み取り専用のディレクトリなどで書き出せない場合は, 圧縮したテクスチャを常駐させて使う.
+        if ( !SavePageFile( pagePath.c_str(), *pTexture, sourceSize, sourceTime ) )
+        {
+            ILOG( "Info : Page file not saved, using resident texture. filename = %s", pagePath.c_str() );
+            return true;
+        }
+
+        pTexture->Term();
+
+        ILOG( "Info : Page file created. filename = %s", pagePath.c_str() );
+    }
+
+    return pTexture->Open( pagePath.c_str() );
+}
@@ -10,8 +10,24 @@
 #include <asdxMath.h>
 #include <asdxLogger.h>
 #include <vector>
+#include <string>
+#include <ImageWriter.h>
 #include <Bmp.h>
-#include <Obj.h>
+#include <Png.h>
+#include <MeshCache.h>
+#include <Bounds.h>
+#include <Renderer.h>
+#include <Meshlet.h>
+#include <Occlusion.h>
+#include <DepthPyramid.h>
+#include <Scene.h>
+#include <Sampler.h>
+#include <VirtualTexture.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <algorithm>
 
 
 //-------------------------------------------------------------------------------------------------
@@ -20,259 +36,643 @@
 using namespace asdx;
 
 
-///////////////////////////////////////////////////////////////////////////////////////////////////
-// Vertex structure
-///////////////////////////////////////////////////////////////////////////////////////////////////
-struct Vertex
-{
-    Vector3     Position;       //!< 位置座標です.
-};
-
-
 //-------------------------------------------------------------------------------------------------
-//      2次元ベクトルに変換します.
+// Constant Values
 //-------------------------------------------------------------------------------------------------
-Vector2 ToVector2( const Vector4& value )
-{ return Vector2( value.x, value.y ); }
+static constexpr u32 VIDEO_FRAME_RATE    = 30;                   //!< 動画ストリームのフレームレートです.
+static constexpr u64 STRIP_MEMORY_BUDGET = 256 * 1024 * 1024;    //!< 帯単位で描画する場合のカラーバッファと深度バッファの合計サイズの上限です.
+static constexpr u64 TEXTURE_PAGE_BUDGET = 16 * 1024 * 1024;     //!< 仮想テクスチャのページを読み込むスロットの合計サイズの上限です.
 
 
 //-------------------------------------------------------------------------------------------------
-//      3次元ベクトルに変換します.
+//      メインエントリーポイントです.
 //-------------------------------------------------------------------------------------------------
-Vector3 ToVector3( const Vector4& value )
-{ return Vector3( value.x, value.y, value.z ); }
+int main(int argc, char** argv)
+{
+    // 動画ストリームを標準出力に書き込む場合は, ログが混ざらないように最初のログより前に標準エラー出力へ切り替える.
+    if ( argc > 7 && strcmp( argv[7], "-" ) == 0 && ( strcmp( argv[6], "y4m" ) == 0 || strcmp( argv[6], "rgba" ) == 0 ) )
+    { SystemLogger::GetInstance().SetStdErr( true ); }
 
+    Vector3 position = Vector3(0.0f, 0.0f, 350.0f);
+    Vector3 target   = Vector3(0.0f, 0.0f, 0.0f);
+    Vector3 upward   = Vector3(0.0f, 1.0f, 0.0f);
 
-//-------------------------------------------------------------------------------------------------
-//      正規化デバイス座標系に変換します。[-1, 1]の範囲です.
-//-------------------------------------------------------------------------------------------------
-Vector4 ToNDC( const Vector4& value )
-{
-    return Vector4( 
-        value.x / value.w,
-        value.y / value.w,
-        value.z / value.w,
-        1.0f / value.w );
-}
+    f32 fov       = F_PIDIV4;
+    f32 nearClip  = 1.0f;
+    f32 farClip   = 1000.0f;
+    f32 nearRatio = 0.0001f;
 
-//-------------------------------------------------------------------------------------------------
-//      スクリーン空間座標系に変換します. [0, 1]の範囲です.
-//-------------------------------------------------------------------------------------------------
-Vector4 ToSS( const Vector4& value )
-{
-    return Vector4( 
-        value.x * 0.5f + 0.5f,
-        value.y * 0.5f + 0.5f,
-        value.z,
-        value.w ); 
-}
+    // 入力頂点座標.
+    std::vector<BoundingBox> bounds;
+    std::vector<std::vector<DrawBatch>> lodBatches;
+    std::vector<f32>         lodErrors;
+    std::vector<Vector4>     materials;
+    std::vector<Vector3>     positions;
+    std::vector<Vector2>     texcoords;
+    std::vector<Vector4>     colors;
+    std::vector<u32>         indices;
+
+    // 頂点ストリームとインデックス. モデルの場合はキャッシュファイルのマップ先を直接参照する.
+    const Vector3* pPositions = nullptr;
+    const Vector3* pNormals   = nullptr;
+    const Vector2* pTexCoords = nullptr;
+    const Vector4* pColors    = nullptr;
+    const u32*     pIndices   = nullptr;
+
+    // マテリアルごとのディフューズマップ. ミップテール以外は描画で参照したページだけを読み込む.
+    TiledTexture* textures = nullptr;
+    PageCache     pageCache;
+
+    auto meshBox = CreateEmptyBox();
+
+    MeshCache model;
+    if ( argc > 1 && model.Load( argv[1] ) )
+    {
+        // 頂点カラーは持たないので, 法線を色として可視化する.
+        pPositions = model.GetPositions();
+        pNormals   = model.GetNormals();
+        pTexCoords = model.GetTexCoords();
+        pIndices   = model.GetIndices();
 
-//-------------------------------------------------------------------------------------------------
-//      デバイス座標系に変換します. (ビューポートサイズの範囲内).
-//-------------------------------------------------------------------------------------------------
-Vector4 ToDC( const Vector4& value, f32 w, f32 h )
-{
-    return Vector4(
-        value.x * w,
-        value.y * h,
-        value.z,
-        value.w );
-}
+        // LOD 数が足りないサブセットは最も粗い LOD を使い続ける.
+        u32 lodCount = 1;
+        for( u32 i=0; i<model.GetSubsetCount(); ++i )
+        { lodCount = Max( lodCount, model.GetSubset( i ).LodCount ); }
 
-//-------------------------------------------------------------------------------------------------
-//      2次元ベクトルの外積を求めます.
-//-------------------------------------------------------------------------------------------------
-f32 CrossProduct( const Vector2& a, const Vector2& b )
-{ return a.x * b.y - b.x * a.y; }
+        lodBatches.resize( lodCount );
+        lodErrors .resize( lodCount, 0.0f );
 
+        for( u32 i=0; i<model.GetSubsetCount(); ++i )
+        {
+            auto& subset = model.GetSubset( i );
+            bounds.push_back( subset.Bounds );
+            Merge( meshBox, subset.Bounds );
 
-//-------------------------------------------------------------------------------------------------
-//      メインエントリーポイントです.
-//-------------------------------------------------------------------------------------------------
-int main(int argc, char** argv)
-{
-    const char16* filename = L"depth.bmp";
+            for( u32 level=0; level<lodCount; ++level )
+            {
+                DrawBatch batch = {};
+                batch.MaterialId = subset.MaterialId;
+                batch.Offset     = subset.Offset;
+                batch.Count      = subset.Count;
 
-    Vector3 position = Vector3(0.0f, 0.0f, 350.0f);
-    Vector3 target   = Vector3(0.0f, 0.0f, 0.0f);
-    Vector3 upward   = Vector3(0.0f, 1.0f, 0.0f);
+                if ( subset.LodCount > 0 )
+                {
+                    auto& lod = model.GetLod( subset.LodOffset + Min( level, subset.LodCount - 1 ) );
+                    batch.Offset = lod.Offset;
+                    batch.Count  = lod.Count;
+                    lodErrors[level] = Max( lodErrors[level], lod.Error );
+                }
+
+                lodBatches[level].push_back( batch );
+            }
+        }
 
-    f32 fov      = F_PIDIV4;
-    f32 nearClip = 1.0f;
-    f32 farClip  = 1000.0f;
+        for( u32 i=0; i<model.GetMaterialCount(); ++i )
+        {
+            auto& material = model.GetMaterial( i );
+            materials.push_back( Vector4( material.Diffuse, material.Alpha ) );
+        }
+
+        // テクスチャは OBJ ファイルからの相対パスで指定される.
+        if ( model.GetMaterialCount() > 0 )
+        {
+            std::string directory( argv[1] );
+            auto pos = directory.find_last_of( "/\\" );
+            directory = ( pos != std::string::npos ) ? directory.substr( 0, pos + 1 ) : std::string();
+
+            textures = new TiledTexture[model.GetMaterialCount()];
 
-    struct Vertex
+            u32 pageSize = 0;
+            for( u32 i=0; i<model.GetMaterialCount(); ++i )
+            {
+                auto name = model.GetString( model.GetMaterial( i ).DiffuseMap );
+                if ( name.empty() )
+                { continue; }
+
+                // 画像はブロック圧縮したページファイルに一度だけ変換し, 以降はページファイルを開く.
+                auto path = directory + std::string( name );
+                if ( !LoadVirtualTexture( path.c_str(), &textures[i] ) )
+                { continue; }
+
+                auto& level = textures[i].GetLevel( 0 );
+                ILOG( "Info : Texture loaded. %s (%u x %u, mip levels = %u, %s, pages = %u, mip tail = %zu KiB)",
+                    path.c_str(), level.Width, level.Height, textures[i].GetLevelCount(),
+                    ( textures[i].GetFormat() == TEXTURE_FORMAT_BC1 ) ? "BC1" : "BC3",
+                    textures[i].GetPageCount(), textures[i].GetSize() / 1024 );
+
+                if ( textures[i].GetPageCount() > 0 )
+                { pageSize = Max( pageSize, textures[i].GetPageSize() ); }
+            }
+
+            // ページを読み込むスロットは最初に固定サイズで確保し, テクスチャの数や大きさによらず増やさない.
+            if ( pageSize > 0 && pageCache.Init( size_t( TEXTURE_PAGE_BUDGET ), pageSize ) )
+            {
+                for( u32 i=0; i<model.GetMaterialCount(); ++i )
+                {
+                    if ( textures[i].GetPageCount() > 0 )
+                    { pageCache.Register( &textures[i] ); }
+                }
+
+                ILOG( "Info : Page cache created. slots = %u (%zu KiB)",
+                    pageCache.GetSlotCount(), size_t( pageCache.GetSlotCount() ) * pageSize / 1024 );
+            }
+        }
+
+        // モデル全体が収まるようにカメラを配置.
+        if ( !IsEmpty( meshBox ) )
+        {
+            target   = ( meshBox.Mini + meshBox.Maxi ) * 0.5f;
+            position = target + Vector3( 0.0f, 0.0f, ( meshBox.Maxi - meshBox.Mini ).Length() * 1.25f );
+        }
+    }
+    else
     {
-        Vector3 Position;
-        Vector2 TexCoord;
-        Vector4 Color;
+        positions = {
+            Vector3(-100.0f, -100.0f, 100.0f), Vector3( 100.0f, -100.0f, 100.0f), Vector3(   0.0f,  50.0f,  100.0f),
+            Vector3(-150.0f, -80.0f, 50.0f),   Vector3(  50.0f, -80.0f, 50.0f),   Vector3( -50.0f,  70.0f, 50.0f),
+            Vector3(-200.0f, -50.0f, 0.0f),    Vector3( 200.0f, -50.0f, 0.0f),    Vector3(   0.0f, 240.0f, 0.0f),
+        };
+
+        texcoords = {
+            Vector2(0.0f, 0.0f), Vector2(1.0f, 0.0f), Vector2(0.0f, 1.0f),
+            Vector2(0.0f, 0.0f), Vector2(1.0f, 0.0f), Vector2(0.0f, 1.0f),
+            Vector2(0.0f, 0.0f), Vector2(1.0f, 0.0f), Vector2(0.0f, 1.0f),
+        };
+
+        colors = {
+            Vector4(1.0f, 0.0f, 0.0f, 1.0f), Vector4(0.0f, 1.0f, 0.0f, 1.0f), Vector4(0.0f, 0.0f, 1.0f, 1.0f),
+            Vector4(1.0f, 1.0f, 0.0f, 1.0f), Vector4(0.0f, 1.0f, 1.0f, 1.0f), Vector4(1.0f, 0.0f, 1.0f, 1.0f),
+            Vector4(1.0f, 0.0f, 0.0f, 1.0f), Vector4(1.0f, 0.0f, 0.0f, 1.0f), Vector4(1.0f, 0.0f, 0.0f, 1.0f),
+        };
+
+        for( auto& p : positions )
+        { Merge( meshBox, p ); }
+
+        bounds.push_back( meshBox );
+
+        for( u32 i=0; i<u32(positions.size()); ++i )
+        { indices.push_back( i ); }
+
+        pPositions = positions.data();
+        pTexCoords = texcoords.data();
+        pColors    = colors.data();
+        pIndices   = indices.data();
+
+        DrawBatch batch = {};
+        batch.MaterialId = 0;
+        batch.Offset     = 0;
+        batch.Count      = u32(indices.size());
+        lodBatches.push_back( { batch } );
+        lodErrors .push_back( 0.0f );
+
+        materials.push_back( Vector4( 1.0f, 1.0f, 1.0f, 1.0f ) );
+    }
 
-        Vertex()
-        {}
+    // LOD ごとに描画バッチをメッシュレットに分割し, まとめてカリングできるようにする.
+    // メッシュレットは参照する頂点の番号とローカルなインデックスを持ち, 頂点は 1 回ずつ変換すれば済む.
+    std::vector<Meshlet> meshlets;
+    std::vector<u32>     meshletVertices;
+    std::vector<u8>      meshletIndices;
+    std::vector<DrawLod> lods;
+    for( size_t level=0; level<lodBatches.size(); ++level )
+    {
+        auto& batches = lodBatches[level];
 
-        Vertex(const Vector3& p, const Vector2& t, const Vector4& c)
-            : Position(p)
-            , TexCoord(t)
-            , Color(c)
-        { /* DO_NOTHING */ }
-    };
+        // 描画ステートの切り替えがマテリアルごとに1回で済むように並べ替える.
+        SortDrawBatches( batches );
 
-    // 入力頂点座標.
-    std::vector<Vertex> vertices;
+        DrawLod lod = {};
+        lod.MeshletOffset = u32(meshlets.size());
+        lod.Error         = lodErrors[level];
+
+        for( auto& batch : batches )
+        { BuildMeshlets( pPositions, pIndices, batch.Offset, batch.Count, batch.MaterialId, meshlets, meshletVertices, meshletIndices ); }
+
+        lod.MeshletCount = u32(meshlets.size()) - lod.MeshletOffset;
+        lods.push_back( lod );
+    }
+
+    // 頂点キャッシュ最適化で三角形がまとまっているほど, メッシュレットが参照する頂点が減り変換回数も減る.
+    if ( !meshletIndices.empty() )
+    {
+        ILOG( "Info : Meshlets built. count = %u, vertices per triangle = %.3f",
+            u32(meshlets.size()), f32(meshletVertices.size()) * 3.0f / f32(meshletIndices.size()) );
+    }
+
+    // インスタンスを格子状に奥へ並べる. 先頭の行の中央が原点に来る.
+    Scene scene;
     {
-        vertices.resize(9);
-        vertices[0] = Vertex( Vector3(-100.0f, -100.0f, 100.0f), Vector2(0.0f, 0.0f), Vector4(1.0f, 0.0f, 0.0f, 1.0f) );
-        vertices[1] = Vertex( Vector3( 100.0f, -100.0f, 100.0f), Vector2(1.0f, 0.0f), Vector4(0.0f, 1.0f, 0.0f, 1.0f) );
-        vertices[2] = Vertex( Vector3(   0.0f,  50.0f,  100.0f), Vector2(0.0f, 1.0f), Vector4(0.0f, 0.0f, 1.0f, 1.0f) );
-
-        vertices[3] = Vertex( Vector3(-150.0f, -80.0f, 50.0f), Vector2(0.0f, 0.0f), Vector4(1.0f, 1.0f, 0.0f, 1.0f) );
-        vertices[4] = Vertex( Vector3(  50.0f, -80.0f, 50.0f), Vector2(1.0f, 0.0f), Vector4(0.0f, 1.0f, 1.0f, 1.0f) );
-        vertices[5] = Vertex( Vector3( -50.0f,  70.0f, 50.0f), Vector2(0.0f, 1.0f), Vector4(1.0f, 0.0f, 1.0f, 1.0f) );
-
-        vertices[6] = Vertex( Vector3(-200.0f, -50.0f, 0.0f), Vector2(0.0f, 0.0f), Vector4(1.0f, 0.0f, 0.0f, 1.0f) );
-        vertices[7] = Vertex( Vector3( 200.0f, -50.0f, 0.0f), Vector2(1.0f, 0.0f), Vector4(1.0f, 0.0f, 0.0f, 1.0f) );
-        vertices[8] = Vertex( Vector3(   0.0f, 240.0f, 0.0f), Vector2(0.0f, 1.0f), Vector4(1.0f, 0.0f, 0.0f, 1.0f) );
+        auto meshId        = scene.AddMesh( meshBox );
+        auto instanceCount = ( argc > 2 ) ? u32( Max( atoi( argv[2] ), 1 ) ) : 1u;
+        auto columns       = u32( ceilf( sqrtf( f32( instanceCount ) ) ) );
+        auto spacing       = ( meshBox.Maxi - meshBox.Mini ).Length() * 1.5f;
+
+        for( u32 i=0; i<instanceCount; ++i )
+        {
+            auto x = f32( s32( i % columns ) - s32( columns / 2 ) ) * spacing;
+            auto z = -f32( i / columns ) * spacing;
+            scene.AddInstance( meshId, Matrix::CreateTranslation( x, 0.0f, z ) );
+        }
+
+        scene.Build();
     }
 
+    // メッシュのデータは全インスタンスで共有する.
+    DrawMesh mesh = {};
+    mesh.pPositions       = pPositions;
+    mesh.pNormals         = pNormals;
+    mesh.pTexCoords       = pTexCoords;
+    mesh.pColors          = pColors;
+    mesh.pMeshletVertices = meshletVertices.data();
+    mesh.pMeshletIndices  = meshletIndices.data();
+    mesh.pMeshlets        = meshlets.data();
+    mesh.MeshletCount     = u32(meshlets.size());
+    mesh.pMaterials       = materials.data();
+    mesh.MaterialCount    = u32(materials.size());
+    mesh.pTextures        = textures;
+    mesh.Sampler          = { TEXTURE_FILTER_TRILINEAR, TEXTURE_ADDRESS_WRAP, TEXTURE_ADDRESS_WRAP };
+    mesh.pLods            = lods.data();
+    mesh.LodCount         = u32(lods.size());
+    mesh.Bounds           = meshBox;
+
+    // 複数フレームを描画する場合は, カメラを視線方向へ一定の速さで進める.
+    auto frameCount = ( argc > 3 ) ? u32( Max( atoi( argv[3] ), 1 ) ) : 1u;
+    auto temporal   = ( argc > 4 ) ? ( atoi( argv[4] ) != 0 ) : true;
+    auto sorted     = ( argc > 5 ) ? ( atoi( argv[5] ) != 0 ) : true;
+
+    // 出力形式は拡張子で指定する (bmp, png, qoi). y4m, rgba の場合は全フレームを 1 つのストリームに書き込む.
+    // map の場合はメモリにマップした BMP ファイルに直接描画する.
+    char16 extension[8] = L"bmp";
+    if ( argc > 6 )
+    {
+        u32 i = 0;
+        for( ; i<7 && argv[6][i] != '\0'; ++i )
+        { extension[i] = char16( argv[6][i] ); }
+        extension[i] = L'\0';
+    }
+
+    auto mapped = ( wcscmp( extension, L"map" ) == 0 );
+    if ( mapped )
+    { wcscpy( extension, L"bmp" ); }
+
+    // strip の場合は画像を横長の帯に分けて描画し, 帯ごとに PNG ファイルへ書き込む.
+    // 画像全体のバッファを持たないので, 画像サイズ (例 : 65536x65536) も指定できる.
+    auto strip = ( wcscmp( extension, L"strip" ) == 0 );
+    if ( strip )
+    { wcscpy( extension, L"png" ); }
+
     // 画像サイズ.
     u32 width  = 960;
     u32 height = 540;
+    if ( strip && argc > 7 )
+    {
+        u32 x = 0;
+        u32 y = 0;
+        if ( sscanf( argv[7], "%ux%u", &x, &y ) == 2 && x > 0 && y > 0 )
+        {
+            width  = x;
+            height = y;
+        }
+    }
 
     auto w = f32(width);
     auto h = f32(height);
 
-    auto stepX = 1.0f / w;
-    auto stepY = 1.0f / h;
+    // 帯の縦幅は, カラーバッファと深度バッファの合計が上限に収まるように決める.
+    auto bufferHeight = height;
+    if ( strip )
+    { bufferHeight = u32( Clamp<u64>( STRIP_MEMORY_BUDGET / ( u64(width) * 8 ), 1, height ) ); }
 
-    // 変換行列.
-    auto World = Matrix::CreateIdentity();
-    auto View  = Matrix::CreateLookAt( position, target, upward );
-    auto Proj  = Matrix::CreatePerspectiveFieldOfView( fov, w / h, nearClip, farClip );
-    auto ViewProj = View * Proj;
+    // 帯単位で描画する場合は遮蔽判定に画像全体の深度が使えないので, 時間方向の再利用を行わない.
+    if ( strip )
+    { temporal = false; }
 
     // レンダーターゲット.
-    auto colorBuffer = new u8 [ width * height * 4 ];
-    auto depthBuffer = new f32 [ width * height ];
-
-    // レンダーターゲットをクリア.
-    for( u32 i=0; i<height; ++i )
+    auto depthBuffer = new f32 [ size_t(width) * bufferHeight ];
+    auto stripBuffer = strip ? new u8 [ size_t(width) * bufferHeight * 4 ] : nullptr;
+
+    RenderTarget renderTarget = {};
+    renderTarget.Width       = width;
+    renderTarget.Height      = bufferHeight;
+    renderTarget.pColor      = stripBuffer;
+    renderTarget.pDepth      = depthBuffer;
+    renderTarget.ImageHeight = height;
+
+    // カラーバッファは書き込みスレッドと共有し, 描画と並行してファイルに書き込む.
+    // マップしたファイルや帯単位で描画する場合はカラーバッファを確保しない.
+    ImageWriter  imageWriter;
+    MappedBitmap mappedBitmap;
+    PngWriter    pngWriter;
+    if ( !mapped && !strip )
+    { imageWriter.Init( width, height ); }
+
+    if ( wcscmp( extension, L"y4m" ) == 0 || wcscmp( extension, L"rgba" ) == 0 )
     {
-        for( u32 j=0; j<width; ++j )
+        auto format = ( extension[0] == L'y' ) ? VIDEO_FORMAT_Y4M : VIDEO_FORMAT_RGBA;
+
+        // 出力先は名前付きパイプや "-" (標準出力) も指定できる.
+        char16 streamName[256];
+        if ( argc > 7 )
         {
-            auto idx = i * width * 4 + j * 4;
-            colorBuffer[idx + 0] = 255;
-            colorBuffer[idx + 1] = 255;
-            colorBuffer[idx + 2] = 255;
-            colorBuffer[idx + 3] = 255;
-
-            idx = i * width + j;
-            depthBuffer[idx] = F32_MAX;
+            auto length = mbstowcs( streamName, argv[7], 255 );
+            streamName[( length == size_t(-1) ) ? 0 : length] = L'\0';
         }
-    }
+        else
+        { swprintf( streamName, 256, L"output.%ls", extension ); }
+
+        if ( !imageWriter.OpenStream( streamName, format, VIDEO_FRAME_RATE ) )
+        {
+            ELOG( "Error : Video Stream Open Failed." );
+
+            imageWriter.Term();
+            pageCache.Term();
 
-    for( size_t Index=0; Index < vertices.size(); Index += 3 )
+            SafeDeleteArray( depthBuffer );
+            SafeDeleteArray( stripBuffer );
+            SafeDeleteArray( textures );
+
+            return -1;
+        }
+    }
+    auto forward    = Vector3::Normalize( target - position );
+    auto speed      = ( meshBox.Maxi - meshBox.Mini ).Length() * 0.05f;
+
+    // 前のフレームで可視だったインスタンスです.
+    std::vector<bool> prevVisible( scene.GetInstanceCount(), false );
+
+    DepthPyramid             pyramid;
+    TriangleBin              triangleBin;
+    StripBin                 stripBin;
+    std::vector<u32>         visibleInstances;
+    std::vector<BoundingBox> visibleBounds;
+    std::vector<Matrix>      instanceTransforms;
+    std::vector<Matrix>      deferredTransforms;
+    std::vector<u32>         deferredInstances;
+
+    for( u32 frame=0; frame<frameCount; ++frame )
     {
-        auto& v0 = vertices[Index + 0];
-        auto& v1 = vertices[Index + 1];
-        auto& v2 = vertices[Index + 2];
-
-        // ワールド変換.
-        auto P0w = Vector4::Transform( Vector4( v0.Position, 1.0f ), World );
-        auto P1w = Vector4::Transform( Vector4( v1.Position, 1.0f ), World );
-        auto P2w = Vector4::Transform( Vector4( v2.Position, 1.0f ), World );
-
-        // ビュー射影変換.
-        auto P0p = Vector4::Transform( P0w, ViewProj );
-        auto P1p = Vector4::Transform( P1w, ViewProj );
-        auto P2p = Vector4::Transform( P2w, ViewProj );
-
-        // 正規化デバイス座標系に変換.
-        P0p = ToNDC( P0p );
-        P1p = ToNDC( P1p );
-        P2p = ToNDC( P2p );
-
-        // スクリーン空間座標系に変換.
-        P0p = ToSS( P0p );
-        P1p = ToSS( P1p );
-        P2p = ToSS( P2p );
-
-        // デバイス座標系に変換.
-        P0p = ToDC( P0p, w, h );
-        P1p = ToDC( P1p, w, h );
-        P2p = ToDC( P2p, w, h );
-
-        auto mini = Vector2::Min(ToVector2(P0p), Vector2::Min(ToVector2(P1p), ToVector2(P2p)));
-        auto maxi = Vector2::Max(ToVector2(P0p), Vector2::Max(ToVector2(P1p), ToVector2(P2p)));
-
-        // ビューポートでクリッピング.
-        mini = Vector2::Max( mini, Vector2(0.0f, 0.0f) );
-        maxi = Vector2::Min( maxi, Vector2(w, h) );
-
-        // 三角形の外側は処理しない.
-        if ( mini.x > maxi.x && mini.y > maxi.y )
-        { continue; }
-
-        // ラスタライズ処理.
+        auto offset = forward * ( speed * f32(frame) );
+        auto eye    = position + offset;
+
+        // 変換行列.
+        auto View  = Matrix::CreateLookAt( eye, target + offset, upward );
+
+        // シーン全体を含む暫定のクリップ平面で, BVH をたどって視錐台カリング.
         {
-            auto vs1 = ToVector2(P1p) - ToVector2(P0p);
-            auto vs2 = ToVector2(P2p) - ToVector2(P0p);
+            auto sceneBox = scene.GetBounds();
+            auto maxDist  = nearClip;
+            for( auto i=0; i<8; ++i )
+            {
+                auto p = Vector3(
+                    ( i & 1 ) ? sceneBox.Maxi.x : sceneBox.Mini.x,
+                    ( i & 2 ) ? sceneBox.Maxi.y : sceneBox.Mini.y,
+                    ( i & 4 ) ? sceneBox.Maxi.z : sceneBox.Mini.z );
+                maxDist = Max( maxDist, ( p - eye ).Length() );
+            }
 
-            float div = CrossProduct( vs1, vs2 );
+            auto cullFar  = maxDist * 1.01f;
+            auto cullProj = Matrix::CreatePerspectiveFieldOfView( fov, w / h, cullFar * nearRatio, cullFar );
+            scene.Cull( CreateCullingView( Matrix::CreateIdentity(), View, cullProj ), visibleInstances );
+        }
 
-            // ピクセルサイズに合わせる.
-            auto TriMin = Vector2(floor(mini.x), floor(mini.y));
-            auto TriMax = Vector2(ceil(maxi.x), ceil(maxi.y));
+        ILOG( "Info : Instance culling. visible = %u / %u", u32(visibleInstances.size()), scene.GetInstanceCount() );
 
-            // ピクセル中心まで移動.
-            TriMin += Vector2(0.5f, 0.5f);
-            TriMax += Vector2(0.5f, 0.5f);
+        // 可視なインスタンスのサブセットの範囲に合わせてクリップ平面を決定.
+        visibleBounds.clear();
+        for( auto index : visibleInstances )
+        {
+            auto& world = scene.GetInstance( index ).World;
+            for( auto& box : bounds )
+            { visibleBounds.push_back( TransformBox( box, world ) ); }
+        }
+
+        FitClipPlanes( View, fov, w / h, visibleBounds.data(), u32(visibleBounds.size()), nearRatio, nearClip, farClip );
+
+        auto Proj  = Matrix::CreatePerspectiveFieldOfView( fov, w / h, nearClip, farClip );
+
+        // 出力先のファイル名. 複数フレームの場合は連番で保存する.
+        char16 filename[64];
+        if ( frameCount == 1 )
+        { swprintf( filename, 64, L"depth.%ls", extension ); }
+        else
+        { swprintf( filename, 64, L"frame_%04u.%ls", frame, extension ); }
+
+        auto cullingView = CreateCullingView( Matrix::CreateIdentity(), View, Proj );
+
+        instanceTransforms.clear();
+        for( auto index : visibleInstances )
+        { instanceTransforms.push_back( scene.GetInstance( index ).World ); }
+
+        // 手前の大きなインスタンスを低解像度の遮蔽バッファに描画し, 隠れたインスタンスとメッシュレットを先に棄却する.
+        OcclusionBuffer occlusion = {};
+        ClearOcclusionBuffer( occlusion, OCCLUSION_WIDTH, OCCLUSION_HEIGHT );
+
+        auto occluderCount = DrawOccluders(
+            cullingView,
+            occlusion,
+            mesh,
+            instanceTransforms.data(),
+            u32(instanceTransforms.size()) );
+
+        // 仮想テクスチャは, 先に深度と参照するページだけを描画し, 足りないページを読み込んでから描画する.
+        // 帯単位で描画する場合は, 帯への振り分けの後に帯ごとに行う.
+        auto feedback = ( pageCache.GetTextureCount() > 0 );
 
-            Vector2 vPos;
-            for( vPos.y = TriMin.y; vPos.y < TriMax.y; vPos.y++ )
+        auto updatePages = [&]()
+        {
+            auto result = pageCache.Update();
+            ILOG( "Info : Page cache. requested = %u, loaded = %u, evicted = %u, dropped = %u, resident = %u / %u",
+                result.Requested, result.Loaded, result.Evicted, result.Dropped, result.Resident, pageCache.GetSlotCount() );
+        };
+
+        if ( feedback && !strip )
+        {
+            auto feedbackTarget = renderTarget;
+            feedbackTarget.pColor = nullptr;
+            ClearRenderTarget( feedbackTarget );
+
+            DrawInstanced(
+                cullingView,
+                feedbackTarget,
+                mesh,
+                instanceTransforms.data(),
+                u32(instanceTransforms.size()),
+                nullptr,
+                &occlusion,
+                sorted ? &triangleBin : nullptr );
+
+            updatePages();
+        }
+
+        // 描画先を取得してクリア. マップしたファイルには BMP の並びで直接書き込む.
+        // 帯単位で描画する場合は帯ごとにクリアする.
+        if ( mapped )
+        {
+            if ( !mappedBitmap.Create( filename, width, height ) )
+            { break; }
+
+            renderTarget.pColor     = mappedBitmap.GetPixels();
+            renderTarget.ColorOrder = COLOR_ORDER_BGRA;
+            ClearRenderTarget( renderTarget );
+        }
+        else if ( strip )
+        {
+            if ( !pngWriter.Open( filename, width, height ) )
+            { break; }
+
+            renderTarget.pColor     = stripBuffer;
+            renderTarget.ColorOrder = COLOR_ORDER_RGBA;
+        }
+        else
+        {
+            renderTarget.pColor     = imageWriter.Acquire();
+            renderTarget.ColorOrder = COLOR_ORDER_RGBA;
+            ClearRenderTarget( renderTarget );
+        }
+
+        CoarseDepth coarseDepth = {};
+        DrawStats   stats       = {};
+
+        auto accumulate = [&]( const DrawStats& result )
+        {
+            stats.Instances         += result.Instances;
+            stats.VisibleInstances  += result.VisibleInstances;
+            stats.Meshlets          += result.Meshlets;
+            stats.VisibleMeshlets   += result.VisibleMeshlets;
+            stats.Triangles         += result.Triangles;
+            stats.Vertices          += result.Vertices;
+            stats.OccludedInstances += result.OccludedInstances;
+            stats.OccludedMeshlets  += result.OccludedMeshlets;
+        };
+
+        auto draw = [&]( const std::vector<Matrix>& transforms )
+        {
+            accumulate( DrawInstanced(
+                cullingView,
+                renderTarget,
+                mesh,
+                transforms.data(),
+                u32(transforms.size()),
+                &coarseDepth,
+                &occlusion,
+                sorted ? &triangleBin : nullptr ) );
+        };
+
+        if ( strip )
+        {
+            // 変換と帯への振り分けは 1 回だけ行い, 画像の上端の帯から描画して書き込む.
+            accumulate( BinInstanced(
+                cullingView,
+                renderTarget,
+                mesh,
+                instanceTransforms.data(),
+                u32(instanceTransforms.size()),
+                &occlusion,
+                stripBin ) );
+
+            if ( feedback )
             {
-                for( vPos.x = TriMin.x; vPos.x < TriMax.x; vPos.x++ )
+                for( auto i = u32( stripBin.Strips.size() ); i-- > 0; )
                 {
-                    auto p = vPos - ToVector2( P0p );
-
-                    auto s = CrossProduct( p, vs2 ) / div;
-                    auto t = CrossProduct( vs1, p ) / div;
-
-                    if ( s >= 0.0f && s >= 0.0f && (s+t) <= 1.0f )
-                    {
-                        auto col = v0.Color    * s + v1.Color    * t + v2.Color    * ( 1.0f - s - t ); 
-                        auto tex = v0.TexCoord * s + v1.TexCoord * t + v2.TexCoord * ( 1.0f - s - t );
-                       
-                        auto z = P0p.z * s + P1p.z * t + P2p.z * ( 1.0f - s - t );
-                        auto w = P0p.w * s + P1p.w * t + P2p.w * ( 1.0f - s - t );
-                        auto depth = (z / w);
-
-                        auto idxC = s32(vPos.y) * width * 4 + s32(vPos.x) * 4;
-                        auto idxD = s32(vPos.y) * width + s32(vPos.x);
-
-                        // 深度値を比較.
-                        if ( depthBuffer[idxD] >= depth )
-                        {
-                            colorBuffer[idxC + 0] = asdx::Clamp( int(col.x * 255.0f), 0, 255 );
-                            colorBuffer[idxC + 1] = asdx::Clamp( int(col.y * 255.0f), 0, 255 );
-                            colorBuffer[idxC + 2] = asdx::Clamp( int(col.z * 255.0f), 0, 255 );
-                            colorBuffer[idxC + 3] = asdx::Clamp( int(col.w * 255.0f), 0, 255 );
-
-                            depthBuffer[idxD] = depth;
-                        }
-                    }
+                    auto feedbackTarget = renderTarget;
+                    feedbackTarget.pColor  = nullptr;
+                    feedbackTarget.OffsetY = i * bufferHeight;
+                    feedbackTarget.Height  = Min( bufferHeight, height - feedbackTarget.OffsetY );
+
+                    ClearRenderTarget( feedbackTarget );
+                    DrawStrip( feedbackTarget, stripBin );
                 }
+
+                updatePages();
+            }
+
+            for( auto i = u32( stripBin.Strips.size() ); i-- > 0; )
+            {
+                renderTarget.OffsetY = i * bufferHeight;
+                renderTarget.Height  = Min( bufferHeight, height - renderTarget.OffsetY );
+
+                ClearRenderTarget( renderTarget );
+                DrawStrip( renderTarget, stripBin );
+                pngWriter.WriteRows( renderTarget.pColor, renderTarget.Height );
+            }
+
+            renderTarget.OffsetY = 0;
+            renderTarget.Height  = bufferHeight;
+        }
+        else if ( temporal )
+        {
+            // 1st フェーズ : 前のフレームで可視だったインスタンスを判定なしで描画する.
+            instanceTransforms.clear();
+            deferredInstances .clear();
+            for( auto index : visibleInstances )
+            {
+                if ( prevVisible[index] )
+                { instanceTransforms.push_back( scene.GetInstance( index ).World ); }
+                else
+                { deferredInstances.push_back( index ); }
             }
+
+            draw( instanceTransforms );
+
+            // 2nd フェーズ : 描画済みの深度からピラミッドを作り, 残りのインスタンスを判定してから描画する.
+            BuildDepthPyramid( renderTarget, pyramid );
+
+            deferredTransforms.clear();
+            for( auto index : deferredInstances )
+            {
+                auto& instance = scene.GetInstance( index );
+                if ( !IsOccluded( pyramid, cullingView.WorldViewProj, instance.Bounds ) )
+                { deferredTransforms.push_back( instance.World ); }
+            }
+
+            draw( deferredTransforms );
+
+            ILOG( "Info : Temporal culling. 1st phase = %u, 2nd phase = %u / %u",
+                u32(instanceTransforms.size()), u32(deferredTransforms.size()), u32(deferredInstances.size()) );
+
+            // 次のフレームのために, 最終的な深度で可視性を記録する.
+            BuildDepthPyramid( renderTarget, pyramid );
+
+            std::fill( prevVisible.begin(), prevVisible.end(), false );
+            for( auto index : visibleInstances )
+            { prevVisible[index] = !IsOccluded( pyramid, cullingView.WorldViewProj, scene.GetInstance( index ).Bounds ); }
         }
+        else
+        {
+            draw( instanceTransforms );
+        }
+
+        ILOG( "Info : Occlusion culling. occluders = %u, occluded instances = %u, occluded meshlets = %u",
+            occluderCount, stats.OccludedInstances, stats.OccludedMeshlets );
+        ILOG( "Info : Meshlet culling. visible = %u / %u", stats.VisibleMeshlets, stats.Meshlets );
+        ILOG( "Info : Triangles drawn = %u, vertices transformed = %u", stats.Triangles, stats.Vertices );
+
+        // 最終結果の書き込みを要求. マップしたファイルはページキャッシュから書き出される.
+        if ( mapped )
+        { mappedBitmap.Close(); }
+        else if ( strip )
+        { pngWriter.Close(); }
+        else
+        { imageWriter.Submit( renderTarget.pColor, filename ); }
+
+        renderTarget.pColor = nullptr;
     }
 
-    // 最終結果を出力.
-    SaveToBitmap( filename, width, height, colorBuffer );
+    // 書き込み待ちの画像を全て書き込む.
+    imageWriter.Term();
+
+    auto errorCount = imageWriter.GetErrorCount();
+    if ( errorCount > 0 )
+    { ELOG( "Error : Image Write Failed. count = %u", errorCount ); }
+
+    // メモリを解放. ページのスロットはテクスチャより先に解放する.
+    pageCache.Term();
 
-    // メモリを解放.
-    SafeDeleteArray( colorBuffer );
     SafeDeleteArray( depthBuffer );
+    SafeDeleteArray( stripBuffer );
+    SafeDeleteArray( textures );
 
-    vertices.clear();
+    positions.clear();
 
-    return 0;
+    return ( errorCount > 0 ) ? -1 : 0;
 }
\ No newline at end of file
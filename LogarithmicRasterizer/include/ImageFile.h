@@ -0,0 +1,46 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : ImageFile.h
+// Desc : Image File Output Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <asdxTypedef.h>
+#include <cstdio>
+#include <vector>
+
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      画像を書き込むためにファイルをバイナリモードで開きます.
+//!
+//! @details    大きな単位でしか書き込まない前提で, 標準ライブラリのバッファリングを無効にします.
+//!             Windows 以外ではファイル名を現在のロケールのマルチバイト文字列に変換して開きます.
+//!
+//! @param[in]      filename        ファイル名です.
+//! @return     開いたファイルを返却します. 失敗した場合は nullptr を返却します.
+//-------------------------------------------------------------------------------------------------
+FILE* OpenImageFile( const char16* filename );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      ワイド文字のファイル名を現在のロケールのマルチバイト文字列に変換します.
+//!
+//! @param[in]      filename        ファイル名です.
+//! @param[out]     result          終端文字を含む変換結果の格納先です.
+//! @retval true    変換に成功.
+//! @retval false   変換に失敗.
+//-------------------------------------------------------------------------------------------------
+bool ConvertToMultiByte( const char16* filename, std::vector<char>& result );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      エンコード済みの画像データを 1 回の書き込みでファイルに保存します.
+//!
+//! @param[in]      filename        ファイル名です.
+//! @param[in]      pData           書き込むデータです.
+//! @param[in]      size            データサイズです.
+//! @retval true    保存に成功.
+//! @retval false   保存に失敗.
+//-------------------------------------------------------------------------------------------------
+bool WriteImageFile( const char16* filename, const void* pData, size_t size );
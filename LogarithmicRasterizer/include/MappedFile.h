@@ -0,0 +1,96 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : MappedFile.h
+// Desc : Memory Mapped File Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <asdxTypedef.h>
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// MappedFile class
+///////////////////////////////////////////////////////////////////////////////////////////////////
+class MappedFile : private NonCopyable
+{
+    //=============================================================================================
+    // list of friend classes and methods.
+    //=============================================================================================
+    /* NOTHING */
+
+public:
+    //=============================================================================================
+    // public variables.
+    //=============================================================================================
+    /* NOTHING */
+
+    //=============================================================================================
+    // public methods.
+    //=============================================================================================
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //---------------------------------------------------------------------------------------------
+    MappedFile();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //---------------------------------------------------------------------------------------------
+    ~MappedFile();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      ファイルを読み取り専用でメモリにマップします.
+    //!
+    //! @param[in]      filename        ファイル名です.
+    //! @retval true    マップに成功.
+    //! @retval false   マップに失敗.
+    //---------------------------------------------------------------------------------------------
+    bool Open( const char* filename );
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      マップを解除してファイルを閉じます.
+    //---------------------------------------------------------------------------------------------
+    void Close();
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      マップされたデータの先頭を取得します.
+    //!
+    //! @return     マップされたデータの先頭を返却します. 空ファイルの場合は nullptr を返却します.
+    //---------------------------------------------------------------------------------------------
+    const char* GetData() const;
+
+    //---------------------------------------------------------------------------------------------
+    //! @brief      ファイルサイズを取得します.
+    //!
+    //! @return     ファイルサイズをバイト単位で返却します.
+    //---------------------------------------------------------------------------------------------
+    u64 GetSize() const;
+
+protected:
+    //=============================================================================================
+    // protected variables.
+    //=============================================================================================
+    /* NOTHING */
+
+    //=============================================================================================
+    // protected methods.
+    //=============================================================================================
+    /* NOTHING */
+
+private:
+    //=============================================================================================
+    // private variables.
+    //=============================================================================================
+    void*   m_pHandle;      //!< ファイルハンドルです.
+    void*   m_pMapping;     //!< ファイルマッピングハンドルです.
+    char*   m_pData;        //!< マップされたデータです.
+    u64     m_Size;         //!< ファイルサイズです.
+
+    //=============================================================================================
+    // private methods.
+    //=============================================================================================
+    /* NOTHING */
+};
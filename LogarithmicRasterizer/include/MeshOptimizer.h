@@ -0,0 +1,72 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : MeshOptimizer.h
+// Desc : Mesh Optimizer Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <asdxMath.h>
+
+
+//-------------------------------------------------------------------------------------------------
+// Forward Declarations
+//-------------------------------------------------------------------------------------------------
+struct ResOBJ;
+
+
+//-------------------------------------------------------------------------------------------------
+// Constant Values
+//-------------------------------------------------------------------------------------------------
+static constexpr u32 VERTEX_CACHE_SIZE = 32;    //!< 最適化で想定する頂点キャッシュサイズです.
+
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      頂点キャッシュの効率が良くなるように三角形を並べ替えます.
+//!
+//! @details    Forsyth の手法で, キャッシュ内の位置と未処理の三角形数からスコアを求め,
+//!             スコアが最大の三角形から順に出力します.
+//!
+//! @param[in,out]  pIndices        三角形リストのインデックスです.
+//! @param[in]      indexCount      インデックス数です.
+//! @param[in]      vertexCount     頂点数です.
+//-------------------------------------------------------------------------------------------------
+void OptimizeVertexCache( u32* pIndices, u32 indexCount, u32 vertexCount );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      オーバードローが少なくなるように三角形のクラスタを並べ替えます.
+//!
+//! @details    頂点キャッシュ最適化済みのインデックスを, キャッシュが全て外れる位置でクラスタに分割し,
+//!             メッシュ中心から外側を向くクラスタほど先に描画されるように並べ替えます.
+//!             視点に依存しないので, 前処理として一度だけ実行できます.
+//!
+//! @param[in,out]  pIndices        三角形リストのインデックスです.
+//! @param[in]      indexCount      インデックス数です.
+//! @param[in]      pPositions      位置座標です.
+//! @param[in]      vertexCount     頂点数です.
+//-------------------------------------------------------------------------------------------------
+void OptimizeOverdraw( u32* pIndices, u32 indexCount, const asdx::Vector3* pPositions, u32 vertexCount );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      平均キャッシュミス率 (ACMR) を求めます.
+//!
+//! @param[in]      pIndices        三角形リストのインデックスです.
+//! @param[in]      indexCount      インデックス数です.
+//! @param[in]      vertexCount     頂点数です.
+//! @param[in]      cacheSize       FIFO キャッシュのサイズです.
+//! @return     三角形あたりの頂点変換回数を返却します.
+//-------------------------------------------------------------------------------------------------
+f32 ComputeACMR( const u32* pIndices, u32 indexCount, u32 vertexCount, u32 cacheSize );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      メッシュを最適化します.
+//!
+//! @details    サブセットごとに頂点キャッシュ最適化とオーバードロー最適化を行い,
+//!             最後に頂点を初めて参照される順に並べ替えます. サブセットの範囲は変わりません.
+//!             頂点を結合して読み込んだメッシュを想定します.
+//!
+//! @param[in,out]  pMesh           最適化するメッシュです.
+//-------------------------------------------------------------------------------------------------
+void OptimizeMesh( ResOBJ* pMesh );
@@ -0,0 +1,74 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : MeshSimplifier.h
+// Desc : Mesh Simplifier Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <asdxMath.h>
+#include <vector>
+
+
+//-------------------------------------------------------------------------------------------------
+// Forward Declarations
+//-------------------------------------------------------------------------------------------------
+struct ResOBJ;
+
+
+//-------------------------------------------------------------------------------------------------
+// Constant Values
+//-------------------------------------------------------------------------------------------------
+static constexpr u32 MAX_LOD_COUNT          = 8;        //!< サブセットあたりの最大 LOD 数です (LOD0 を含む).
+static constexpr u32 MIN_LOD_TRIANGLES      = 32;       //!< LOD を生成する最小の三角形数です.
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// ResLOD structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct ResLOD
+{
+    u32     SubsetId;       //!< サブセット番号です.
+    u32     Level;          //!< LOD レベルです. 0 が元のメッシュです.
+    u32     Offset;         //!< インデックスオフセットです.
+    u32     Count;          //!< インデックス数です.
+    f32     Error;          //!< 元のメッシュからの誤差 (オブジェクト空間の距離) です.
+};
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      三角形リストを簡略化します.
+//!
+//! @details    二次誤差行列 (QEM) による辺の縮約を, 誤差の小さい順に行います.
+//!             頂点は既存の頂点に縮約するので, 結果のインデックスは元の頂点配列をそのまま参照します.
+//!             属性の継ぎ目と境界の頂点は動かさないので, ひび割れは生じません.
+//!
+//! @param[in]      pPositions          位置座標です.
+//! @param[in]      vertexCount         頂点数です.
+//! @param[in]      pIndices            インデックスです.
+//! @param[in]      indexCount          インデックス数です.
+//! @param[in]      targetIndexCount    目標のインデックス数です.
+//! @param[out]     result              簡略化したインデックスの格納先です.
+//! @return     縮約による最大誤差 (オブジェクト空間の距離) を返却します.
+//-------------------------------------------------------------------------------------------------
+f32 SimplifyMesh(
+    const asdx::Vector3*    pPositions,
+    u32                     vertexCount,
+    const u32*              pIndices,
+    u32                     indexCount,
+    u32                     targetIndexCount,
+    std::vector<u32>&       result );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      サブセットごとに LOD を生成します.
+//!
+//! @details    三角形数を半分ずつ減らした LOD を生成し, インデックスをメッシュの末尾に追加します.
+//!             LOD0 を含めてサブセット順, レベル順に格納します.
+//!             三角形数が減らなくなるか MIN_LOD_TRIANGLES を下回ると打ち切ります.
+//!             誤差がサブセットのバウンディングボックスの大きさに対して大きすぎる場合も打ち切ります.
+//!
+//! @param[in,out]  pMesh       LOD を生成するメッシュです.
+//! @param[out]     lods        生成した LOD の格納先です.
+//-------------------------------------------------------------------------------------------------
+void BuildLODs( ResOBJ* pMesh, std::vector<ResLOD>& lods );
@@ -0,0 +1,135 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : Rasterizer.h
+// Desc : Software Rasterizer Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <asdxMath.h>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// RasterMode enum
+///////////////////////////////////////////////////////////////////////////////////////////////////
+enum class RasterMode : u32
+{
+    Linear = 0,         //!< 線形ラスタライズ.
+    Logarithmic,        //!< 対数ラスタライズ.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// RasterState structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct RasterState
+{
+    RasterMode          Mode;           //!< ラスタライズモードです.
+    f32                 NearClip;       //!< 対数変換に用いるニアクリップ平面までの距離です.
+    f32                 FarClip;        //!< 対数変換に用いるファークリップ平面までの距離です.
+    f32                 C0;             //!< 対数変換の係数 -1 / log(f / n) です.
+    f32                 C1;             //!< 対数変換の係数 (n / f) - 1 です.
+    std::vector<f32>    InvLogTable;    //!< 各ピクセル行の中心を逆対数変換した線形な y 座標です.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// RenderTarget structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct RenderTarget
+{
+    u32             Width;          //!< 横幅です.
+    u32             Height;         //!< 縦幅です.
+    u8*             pColor;         //!< カラーバッファです(RGBA8). nullptrの場合は深度のみ書き込みます.
+    f32*            pDepth;         //!< 深度バッファです.
+};
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      2次元ベクトルに変換します.
+//-------------------------------------------------------------------------------------------------
+asdx::Vector2 ToVector2( const asdx::Vector4& value );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      3次元ベクトルに変換します.
+//-------------------------------------------------------------------------------------------------
+asdx::Vector3 ToVector3( const asdx::Vector4& value );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      正規化デバイス座標系に変換します. [-1, 1]の範囲です.
+//-------------------------------------------------------------------------------------------------
+asdx::Vector4 ToNDC( const asdx::Vector4& value );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      スクリーン空間座標系に変換します. [0, 1]の範囲です.
+//-------------------------------------------------------------------------------------------------
+asdx::Vector4 ToSS( const asdx::Vector4& value );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      デバイス座標系に変換します. (ビューポートサイズの範囲内).
+//-------------------------------------------------------------------------------------------------
+asdx::Vector4 ToDC( const asdx::Vector4& value, f32 w, f32 h );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      対数変換を行います.
+//!
+//! @param[in]      value       スクリーン空間座標です.
+//! @param[in]      n           ニアクリップ平面までの距離です.
+//! @param[in]      f           ファークリップ平面までの距離です.
+//! @return     y成分を対数変換した値を返却します.
+//-------------------------------------------------------------------------------------------------
+asdx::Vector4 LogTransform( const asdx::Vector4& value, f32 n, f32 f );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      逆対数変換を行います.
+//!
+//! @param[in]      value       対数変換済みのデバイス座標です.
+//! @param[in]      n           ニアクリップ平面までの距離です.
+//! @param[in]      f           ファークリップ平面までの距離です.
+//! @param[in]      h           ビューポートの縦幅です.
+//! @return     線形なデバイス座標を返却します.
+//-------------------------------------------------------------------------------------------------
+asdx::Vector2 InvLogTransform( const asdx::Vector2& value, f32 n, f32 f, f32 h );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      2次元ベクトルの外積を求めます.
+//-------------------------------------------------------------------------------------------------
+f32 CrossProduct( const asdx::Vector2& a, const asdx::Vector2& b );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      クリップ平面に合わせてラスタライズ設定を更新します.
+//!
+//! @details    対数変換の係数と, 逆対数変換テーブルを再計算します.
+//!             クリップ平面を変更したフレームごとに呼び出してください.
+//!
+//! @param[in,out]  state       更新するラスタライズ設定です.
+//! @param[in]      nearClip    ニアクリップ平面までの距離です.
+//! @param[in]      farClip     ファークリップ平面までの距離です.
+//! @param[in]      height      描画先のレンダーターゲットの縦幅です.
+//-------------------------------------------------------------------------------------------------
+void UpdateRasterState( RasterState& state, f32 nearClip, f32 farClip, u32 height );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      レンダーターゲットをクリアします.
+//!
+//! @param[in]      target      クリアするレンダーターゲットです.
+//-------------------------------------------------------------------------------------------------
+void ClearRenderTarget( RenderTarget& target );
+
+//-------------------------------------------------------------------------------------------------
+//! @brief      三角形をラスタライズします.
+//!
+//! @param[in]      state       ラスタライズ設定です.
+//! @param[in]      target      描画先のレンダーターゲットです.
+//! @param[in]      P0          1番目の頂点のクリップ空間座標です.
+//! @param[in]      P1          2番目の頂点のクリップ空間座標です.
+//! @param[in]      P2          3番目の頂点のクリップ空間座標です.
+//! @param[in]      pColors     頂点カラー(3要素)です. 深度のみ書き込む場合は nullptr を指定します.
+//-------------------------------------------------------------------------------------------------
+void DrawTriangle(
+    const RasterState&      state,
+    RenderTarget&           target,
+    const asdx::Vector4&    P0,
+    const asdx::Vector4&    P1,
+    const asdx::Vector4&    P2,
+    const asdx::Vector4*    pColors );
@@ -121,6 +121,15 @@ public:
     //---------------------------------------------------------------------------------------------
     LogLevel  GetFilter() override;
 
+    //---------------------------------------------------------------------------------------------
+    //! @brief      ログの出力先を標準エラー出力にするかどうかを設定します.
+    //!
+    //! @details    標準出力にデータを書き込む場合に, ログが混ざらないようにします.
+    //!
+    //! @param[in]      enable      true の場合は標準エラー出力に, false の場合は標準出力に出力します.
+    //---------------------------------------------------------------------------------------------
+    void SetStdErr( bool enable );
+
 protected:
     //=============================================================================================
     // protected variables.
@@ -138,6 +147,7 @@ private:
     //=============================================================================================
     static SystemLogger     s_Instance;     //!< シングルトンインスタンスです.
     LogLevel                m_Filter;       //!< フィルターです.
+    bool                    m_StdErr;       //!< 標準エラー出力に出力するかどうか.
 
     //=============================================================================================
     // private methods.
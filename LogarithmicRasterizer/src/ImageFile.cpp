@@ -0,0 +1,88 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : ImageFile.cpp
+// Desc : Image File Output Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <ImageFile.h>
+#include <cstdlib>
+#include <asdxLogger.h>
+
+
+//-------------------------------------------------------------------------------------------------
+//      画像を書き込むためにファイルをバイナリモードで開きます.
+//-------------------------------------------------------------------------------------------------
+FILE* OpenImageFile( const char16* filename )
+{
+    if ( filename == nullptr )
+    { return nullptr; }
+
+    FILE* pFile = nullptr;
+#if ASDX_IS_WIN
+    if ( _wfopen_s( &pFile, filename, L"wb" ) != 0 )
+    { pFile = nullptr; }
+#else
+    std::vector<char> path;
+    if ( !ConvertToMultiByte( filename, path ) )
+    { return nullptr; }
+
+    pFile = fopen( path.data(), "wb" );
+#endif
+
+    if ( pFile != nullptr )
+    { setvbuf( pFile, nullptr, _IONBF, 0 ); }
+
+    return pFile;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      ワイド文字のファイル名を現在のロケールのマルチバイト文字列に変換します.
+//-------------------------------------------------------------------------------------------------
+bool ConvertToMultiByte( const char16* filename, std::vector<char>& result )
+{
+    if ( filename == nullptr )
+    { return false; }
+
+    auto size = wcstombs( nullptr, filename, 0 );
+    if ( size == size_t(-1) )
+    { return false; }
+
+    result.resize( size + 1 );
+    wcstombs( result.data(), filename, result.size() );
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      エンコード済みの画像データを 1 回の書き込みでファイルに保存します.
+//-------------------------------------------------------------------------------------------------
+bool WriteImageFile( const char16* filename, const void* pData, size_t size )
+{
+    if ( filename == nullptr || pData == nullptr || size == 0 )
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    auto pFile = OpenImageFile( filename );
+    if ( pFile == nullptr )
+    {
+        ELOG( "Error : File Open Failed." );
+        return false;
+    }
+
+    auto result = ( fwrite( pData, 1, size, pFile ) == size );
+
+    if ( fclose( pFile ) != 0 )
+    { result = false; }
+
+    if ( !result )
+    {
+        ELOG( "Error : File Write Failed." );
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,170 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : MappedFile.cpp
+// Desc : Memory Mapped File Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <MappedFile.h>
+#include <asdxLogger.h>
+
+#if ASDX_IS_WIN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cstdint>
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// MappedFile class
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------------------------------
+//      コンストラクタです.
+//-------------------------------------------------------------------------------------------------
+MappedFile::MappedFile()
+: m_pHandle ( nullptr )
+, m_pMapping( nullptr )
+, m_pData   ( nullptr )
+, m_Size    ( 0 )
+{ /* DO_NOTHING */ }
+
+//-------------------------------------------------------------------------------------------------
+//      デストラクタです.
+//-------------------------------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{ Close(); }
+
+//-------------------------------------------------------------------------------------------------
+//      ファイルを読み取り専用でメモリにマップします.
+//-------------------------------------------------------------------------------------------------
+bool MappedFile::Open( const char* filename )
+{
+    if ( filename == nullptr )
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    Close();
+
+#if ASDX_IS_WIN
+    auto handle = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+    if ( handle == INVALID_HANDLE_VALUE )
+    {
+        ELOG( "Error : File Open Failed. filename = %s", filename );
+        return false;
+    }
+    m_pHandle = handle;
+
+    LARGE_INTEGER size;
+    if ( !GetFileSizeEx( handle, &size ) )
+    {
+        ELOG( "Error : GetFileSizeEx() Failed. filename = %s", filename );
+        Close();
+        return false;
+    }
+    m_Size = u64( size.QuadPart );
+
+    // 空ファイルはマップできないので, データ無しとして扱う.
+    if ( m_Size == 0 )
+    { return true; }
+
+    m_pMapping = CreateFileMappingA( handle, nullptr, PAGE_READONLY, 0, 0, nullptr );
+    if ( m_pMapping == nullptr )
+    {
+        ELOG( "Error : CreateFileMapping() Failed. filename = %s", filename );
+        Close();
+        return false;
+    }
+
+    m_pData = static_cast<char*>( MapViewOfFile( m_pMapping, FILE_MAP_READ, 0, 0, 0 ) );
+    if ( m_pData == nullptr )
+    {
+        ELOG( "Error : MapViewOfFile() Failed. filename = %s", filename );
+        Close();
+        return false;
+    }
+#else
+    auto fd = open( filename, O_RDONLY );
+    if ( fd < 0 )
+    {
+        ELOG( "Error : File Open Failed. filename = %s", filename );
+        return false;
+    }
+    m_pHandle = reinterpret_cast<void*>( intptr_t( fd ) + 1 );
+
+    struct stat info;
+    if ( fstat( fd, &info ) != 0 )
+    {
+        ELOG( "Error : fstat() Failed. filename = %s", filename );
+        Close();
+        return false;
+    }
+    m_Size = u64( info.st_size );
+
+    // 空ファイルはマップできないので, データ無しとして扱う.
+    if ( m_Size == 0 )
+    { return true; }
+
+    auto ptr = mmap( nullptr, size_t( m_Size ), PROT_READ, MAP_PRIVATE, fd, 0 );
+    if ( ptr == MAP_FAILED )
+    {
+        ELOG( "Error : mmap() Failed. filename = %s", filename );
+        Close();
+        return false;
+    }
+    m_pData = static_cast<char*>( ptr );
+
+    // 先頭から順に走査するので, 先読みを有効にしておく.
+    madvise( ptr, size_t( m_Size ), MADV_SEQUENTIAL );
+#endif
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      マップを解除してファイルを閉じます.
+//-------------------------------------------------------------------------------------------------
+void MappedFile::Close()
+{
+#if ASDX_IS_WIN
+    if ( m_pData != nullptr )
+    { UnmapViewOfFile( m_pData ); }
+
+    if ( m_pMapping != nullptr )
+    { CloseHandle( m_pMapping ); }
+
+    if ( m_pHandle != nullptr )
+    { CloseHandle( m_pHandle ); }
+#else
+    if ( m_pData != nullptr )
+    { munmap( m_pData, size_t( m_Size ) ); }
+
+    if ( m_pHandle != nullptr )
+    { close( int( reinterpret_cast<intptr_t>( m_pHandle ) - 1 ) ); }
+#endif
+
+    m_pHandle  = nullptr;
+    m_pMapping = nullptr;
+    m_pData    = nullptr;
+    m_Size     = 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      マップされたデータの先頭を取得します.
+//-------------------------------------------------------------------------------------------------
+const char* MappedFile::GetData() const
+{ return m_pData; }
+
+//-------------------------------------------------------------------------------------------------
+//      ファイルサイズを取得します.
+//-------------------------------------------------------------------------------------------------
+u64 MappedFile::GetSize() const
+{ return m_Size; }
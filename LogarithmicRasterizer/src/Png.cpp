@@ -0,0 +1,960 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : Png.cpp
+// Desc : PNG Image Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <Png.h>
+#include <ImageFile.h>
+#include <Parallel.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <asdxMath.h>
+#include <asdxLogger.h>
+
+
+namespace /* anonymous */ {
+
+//-------------------------------------------------------------------------------------------------
+// Constant Values
+//-------------------------------------------------------------------------------------------------
+static constexpr u32 PNG_MIN_STRIP_ROWS     = 32;           //!< 1 ストリップの最小行数です.
+static constexpr u32 DEFLATE_WINDOW_SIZE    = 32768;        //!< スライド窓のサイズです.
+static constexpr u32 DEFLATE_WINDOW_MASK    = DEFLATE_WINDOW_SIZE - 1;
+static constexpr u32 DEFLATE_HASH_BITS      = 15;           //!< 一致を探すハッシュのビット数です.
+static constexpr u32 DEFLATE_HASH_SIZE      = 1u << DEFLATE_HASH_BITS;
+static constexpr u32 DEFLATE_MAX_CHAIN      = 32;           //!< 一致を探す候補の最大数です.
+static constexpr u32 DEFLATE_MIN_MATCH      = 3;            //!< 最短の一致長です.
+static constexpr u32 DEFLATE_MAX_MATCH      = 258;          //!< 最長の一致長です.
+static constexpr u32 DEFLATE_BLOCK_TOKENS   = 16384;        //!< 1 ブロックに含めるトークン数です.
+static constexpr u32 DEFLATE_MAX_BITS       = 15;           //!< リテラル/長さ, 距離の符号の最大ビット数です.
+static constexpr u32 DEFLATE_MAX_CODELEN_BITS = 7;          //!< 符号長の符号の最大ビット数です.
+
+static constexpr u16 LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static constexpr u8 LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static constexpr u16 DIST_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static constexpr u8 DIST_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+static constexpr u8 CODELEN_ORDER[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Token structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct Token
+{
+    u16     Value;      //!< 距離が 0 の場合はリテラル, それ以外は一致長です.
+    u16     Distance;   //!< 一致の距離です.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// BitWriter structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct BitWriter
+{
+    std::vector<u8>*    pData;      //!< 出力先です.
+    u64                 Bits;       //!< 書き込み待ちのビットです.
+    u32                 Count;      //!< 書き込み待ちのビット数です.
+
+    //---------------------------------------------------------------------------------------------
+    //      下位ビットから順に書き込みます.
+    //---------------------------------------------------------------------------------------------
+    void Write( u32 value, u32 count )
+    {
+        Bits  |= u64( value ) << Count;
+        Count += count;
+        while( Count >= 8 )
+        {
+            pData->push_back( u8( Bits ) );
+            Bits  >>= 8;
+            Count  -= 8;
+        }
+    }
+
+    //---------------------------------------------------------------------------------------------
+    //      バイト境界まで 0 で埋めます.
+    //---------------------------------------------------------------------------------------------
+    void Align()
+    {
+        if ( Count > 0 )
+        { Write( 0, 8 - Count ); }
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Strip structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct Strip
+{
+    u32                 BeginRow;   //!< 先頭の行です (上端が 0).
+    u32                 EndRow;     //!< 末尾の次の行です.
+    std::vector<u8>     Data;       //!< 圧縮データです.
+    u32                 Adler;      //!< フィルタ後のデータの Adler-32 です.
+    size_t              Size;       //!< フィルタ後のデータサイズです.
+};
+
+
+//-------------------------------------------------------------------------------------------------
+//      ビット列を反転します.
+//-------------------------------------------------------------------------------------------------
+inline u32 ReverseBits( u32 value, u32 count )
+{
+    u32 result = 0;
+    for( u32 i=0; i<count; ++i )
+    {
+        result = ( result << 1 ) | ( value & 1 );
+        value >>= 1;
+    }
+    return result;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      頻度から最大ビット数以下のハフマン符号長を求めます.
+//-------------------------------------------------------------------------------------------------
+void BuildCodeLengths( const u32* pFreq, u32 count, u32 maxBits, u8* pLengths )
+{
+    memset( pLengths, 0, count );
+
+    std::vector<u32> freq( pFreq, pFreq + count );
+    for(;;)
+    {
+        // ノードは葉 (0 .. count-1) と内部ノード (count ..) を同じ配列で扱う.
+        std::vector<u32> weights;
+        std::vector<s32> parents;
+        std::vector<std::pair<u32, u32>> heap;     // (重み, ノード) の最小ヒープ.
+
+        for( u32 i=0; i<count; ++i )
+        {
+            weights.push_back( freq[i] );
+            parents.push_back( -1 );
+            if ( freq[i] > 0 )
+            { heap.push_back( { freq[i], i } ); }
+        }
+
+        if ( heap.size() < 2 )
+        {
+            for( auto& item : heap )
+            { pLengths[item.second] = 1; }
+            return;
+        }
+
+        auto greater = []( const std::pair<u32, u32>& a, const std::pair<u32, u32>& b ) { return a > b; };
+        std::make_heap( heap.begin(), heap.end(), greater );
+
+        while( heap.size() > 1 )
+        {
+            std::pop_heap( heap.begin(), heap.end(), greater );
+            auto a = heap.back(); heap.pop_back();
+            std::pop_heap( heap.begin(), heap.end(), greater );
+            auto b = heap.back(); heap.pop_back();
+
+            auto node = u32( weights.size() );
+            weights.push_back( a.first + b.first );
+            parents.push_back( -1 );
+            parents[a.second] = s32( node );
+            parents[b.second] = s32( node );
+
+            heap.push_back( { a.first + b.first, node } );
+            std::push_heap( heap.begin(), heap.end(), greater );
+        }
+
+        // 内部ノードは子より後ろに並ぶので, 根から逆順にたどれば深さが求まる.
+        std::vector<u32> depths( weights.size(), 0 );
+        for( auto i = s32( weights.size() ) - 2; i >= 0; --i )
+        {
+            if ( parents[i] >= 0 )
+            { depths[i] = depths[parents[i]] + 1; }
+        }
+
+        u32 maxDepth = 0;
+        for( u32 i=0; i<count; ++i )
+        {
+            if ( freq[i] > 0 )
+            { maxDepth = asdx::Max( maxDepth, depths[i] ); }
+        }
+
+        if ( maxDepth <= maxBits )
+        {
+            for( u32 i=0; i<count; ++i )
+            { pLengths[i] = ( freq[i] > 0 ) ? u8( depths[i] ) : 0; }
+            return;
+        }
+
+        // 深すぎる場合は頻度の差を縮めて作り直す.
+        for( auto& value : freq )
+        {
+            if ( value > 0 )
+            { value = ( value >> 1 ) | 1; }
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      符号長から, 下位ビットから書き込めるように反転した正準ハフマン符号を求めます.
+//-------------------------------------------------------------------------------------------------
+void BuildCodes( const u8* pLengths, u32 count, u16* pCodes )
+{
+    u32 lengthCount[DEFLATE_MAX_BITS + 1] = {};
+    for( u32 i=0; i<count; ++i )
+    { lengthCount[pLengths[i]]++; }
+    lengthCount[0] = 0;
+
+    u32 nextCode[DEFLATE_MAX_BITS + 1] = {};
+    u32 code = 0;
+    for( u32 bits=1; bits<=DEFLATE_MAX_BITS; ++bits )
+    {
+        code = ( code + lengthCount[bits - 1] ) << 1;
+        nextCode[bits] = code;
+    }
+
+    for( u32 i=0; i<count; ++i )
+    {
+        auto length = pLengths[i];
+        pCodes[i] = ( length > 0 ) ? u16( ReverseBits( nextCode[length]++, length ) ) : 0;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      使用する符号が 2 つ未満の場合に, 完全な符号になるようにダミーの頻度を加えます.
+//-------------------------------------------------------------------------------------------------
+void EnsureTwoSymbols( u32* pFreq, u32 count )
+{
+    u32 used = 0;
+    for( u32 i=0; i<count; ++i )
+    {
+        if ( pFreq[i] > 0 )
+        { used++; }
+    }
+
+    for( u32 i=0; i<count && used < 2; ++i )
+    {
+        if ( pFreq[i] == 0 )
+        {
+            pFreq[i] = 1;
+            used++;
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      一致長の符号番号を求めます.
+//-------------------------------------------------------------------------------------------------
+inline u32 GetLengthCode( u32 length )
+{
+    u32 code = 0;
+    while( code + 1 < 29 && LENGTH_BASE[code + 1] <= length )
+    { code++; }
+    return code;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      距離の符号番号を求めます.
+//-------------------------------------------------------------------------------------------------
+inline u32 GetDistanceCode( u32 distance )
+{
+    u32 code = 0;
+    while( code + 1 < 30 && DIST_BASE[code + 1] <= distance )
+    { code++; }
+    return code;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      動的ハフマン符号のブロックを書き込みます.
+//-------------------------------------------------------------------------------------------------
+void WriteBlock( BitWriter& writer, const Token* pTokens, u32 count, bool last )
+{
+    u32 litFreq [286] = {};
+    u32 distFreq[30]  = {};
+
+    for( u32 i=0; i<count; ++i )
+    {
+        auto& token = pTokens[i];
+        if ( token.Distance == 0 )
+        { litFreq[token.Value]++; }
+        else
+        {
+            litFreq [257 + GetLengthCode( token.Value )]++;
+            distFreq[GetDistanceCode( token.Distance )]++;
+        }
+    }
+    litFreq[256]++;
+
+    EnsureTwoSymbols( litFreq,  286 );
+    EnsureTwoSymbols( distFreq, 30 );
+
+    u8  litLengths [286];
+    u8  distLengths[30];
+    u16 litCodes   [286];
+    u16 distCodes  [30];
+    BuildCodeLengths( litFreq,  286, DEFLATE_MAX_BITS, litLengths );
+    BuildCodeLengths( distFreq, 30,  DEFLATE_MAX_BITS, distLengths );
+    BuildCodes( litLengths,  286, litCodes );
+    BuildCodes( distLengths, 30,  distCodes );
+
+    u32 litCount = 286;
+    while( litCount > 257 && litLengths[litCount - 1] == 0 )
+    { litCount--; }
+
+    u32 distCount = 30;
+    while( distCount > 1 && distLengths[distCount - 1] == 0 )
+    { distCount--; }
+
+    // 符号長の並びを連長圧縮する.
+    u8 lengths[286 + 30];
+    memcpy( lengths, litLengths, litCount );
+    memcpy( lengths + litCount, distLengths, distCount );
+    auto total = litCount + distCount;
+
+    std::vector<std::pair<u8, u8>> symbols;     // (符号長の符号, 追加ビット).
+    for( u32 i=0; i<total; )
+    {
+        auto value = lengths[i];
+        u32  run   = 1;
+        while( i + run < total && lengths[i + run] == value )
+        { run++; }
+
+        if ( value == 0 && run >= 3 )
+        {
+            auto n = asdx::Min( run, 138u );
+            if ( n >= 11 )
+            { symbols.push_back( { 18, u8( n - 11 ) } ); }
+            else
+            { symbols.push_back( { 17, u8( n - 3 ) } ); }
+            i += n;
+        }
+        else if ( value != 0 && run >= 4 )
+        {
+            symbols.push_back( { value, 0 } );
+            auto n = asdx::Min( run - 1, 6u );
+            symbols.push_back( { 16, u8( n - 3 ) } );
+            i += n + 1;
+        }
+        else
+        {
+            symbols.push_back( { value, 0 } );
+            i++;
+        }
+    }
+
+    u32 codeLenFreq[19] = {};
+    for( auto& symbol : symbols )
+    { codeLenFreq[symbol.first]++; }
+    EnsureTwoSymbols( codeLenFreq, 19 );
+
+    u8  codeLenLengths[19];
+    u16 codeLenCodes  [19];
+    BuildCodeLengths( codeLenFreq, 19, DEFLATE_MAX_CODELEN_BITS, codeLenLengths );
+    BuildCodes( codeLenLengths, 19, codeLenCodes );
+
+    u32 codeLenCount = 19;
+    while( codeLenCount > 4 && codeLenLengths[CODELEN_ORDER[codeLenCount - 1]] == 0 )
+    { codeLenCount--; }
+
+    // ブロックヘッダ.
+    writer.Write( last ? 1 : 0, 1 );
+    writer.Write( 2, 2 );
+    writer.Write( litCount  - 257, 5 );
+    writer.Write( distCount - 1,   5 );
+    writer.Write( codeLenCount - 4, 4 );
+    for( u32 i=0; i<codeLenCount; ++i )
+    { writer.Write( codeLenLengths[CODELEN_ORDER[i]], 3 ); }
+
+    for( auto& symbol : symbols )
+    {
+        writer.Write( codeLenCodes[symbol.first], codeLenLengths[symbol.first] );
+        if ( symbol.first == 16 )
+        { writer.Write( symbol.second, 2 ); }
+        else if ( symbol.first == 17 )
+        { writer.Write( symbol.second, 3 ); }
+        else if ( symbol.first == 18 )
+        { writer.Write( symbol.second, 7 ); }
+    }
+
+    // データ本体.
+    for( u32 i=0; i<count; ++i )
+    {
+        auto& token = pTokens[i];
+        if ( token.Distance == 0 )
+        {
+            writer.Write( litCodes[token.Value], litLengths[token.Value] );
+            continue;
+        }
+
+        auto lengthCode = GetLengthCode( token.Value );
+        writer.Write( litCodes[257 + lengthCode], litLengths[257 + lengthCode] );
+        writer.Write( token.Value - LENGTH_BASE[lengthCode], LENGTH_EXTRA[lengthCode] );
+
+        auto distCode = GetDistanceCode( token.Distance );
+        writer.Write( distCodes[distCode], distLengths[distCode] );
+        writer.Write( token.Distance - DIST_BASE[distCode], DIST_EXTRA[distCode] );
+    }
+
+    writer.Write( litCodes[256], litLengths[256] );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      3 バイトのハッシュを求めます.
+//-------------------------------------------------------------------------------------------------
+inline u32 Hash3( const u8* p )
+{ return ( ( u32( p[0] ) << 16 | u32( p[1] ) << 8 | p[2] ) * 2654435761u ) >> ( 32 - DEFLATE_HASH_BITS ); }
+
+//-------------------------------------------------------------------------------------------------
+//      データを DEFLATE 形式で圧縮します.
+//
+//      last が false の場合は, 最後に空の無圧縮ブロックを置いてバイト境界で終わらせます (同期フラッシュ).
+//      この場合, 続けて別の DEFLATE データを連結できます.
+//-------------------------------------------------------------------------------------------------
+void Deflate( const u8* pSrc, size_t size, bool last, std::vector<u8>& result )
+{
+    BitWriter writer = { &result, 0, 0 };
+
+    std::vector<s32>   head( DEFLATE_HASH_SIZE, -1 );
+    std::vector<s32>   prev( DEFLATE_WINDOW_SIZE, -1 );
+    std::vector<Token> tokens;
+    tokens.reserve( DEFLATE_BLOCK_TOKENS );
+
+    auto insert = [&]( size_t pos )
+    {
+        auto h = Hash3( pSrc + pos );
+        prev[pos & DEFLATE_WINDOW_MASK] = head[h];
+        head[h] = s32( pos );
+    };
+
+    size_t pos = 0;
+    while( pos < size )
+    {
+        u32 bestLength   = 0;
+        u32 bestDistance = 0;
+
+        if ( pos + DEFLATE_MIN_MATCH <= size )
+        {
+            auto maxLength = u32( asdx::Min<size_t>( size - pos, DEFLATE_MAX_MATCH ) );
+            auto candidate = head[Hash3( pSrc + pos )];
+
+            for( u32 chain=0; chain<DEFLATE_MAX_CHAIN && candidate >= 0; ++chain )
+            {
+                auto distance = pos - size_t( candidate );
+                if ( distance > DEFLATE_WINDOW_SIZE )
+                { break; }
+
+                auto pA = pSrc + candidate;
+                auto pB = pSrc + pos;
+                if ( pA[bestLength] == pB[bestLength] )
+                {
+                    u32 length = 0;
+                    while( length < maxLength && pA[length] == pB[length] )
+                    { length++; }
+
+                    if ( length > bestLength )
+                    {
+                        bestLength   = length;
+                        bestDistance = u32( distance );
+                        if ( length == maxLength )
+                        { break; }
+                    }
+                }
+
+                candidate = prev[size_t( candidate ) & DEFLATE_WINDOW_MASK];
+            }
+        }
+
+        if ( bestLength >= DEFLATE_MIN_MATCH )
+        {
+            tokens.push_back( { u16( bestLength ), u16( bestDistance ) } );
+
+            auto end = asdx::Min( pos + bestLength, size - DEFLATE_MIN_MATCH + 1 );
+            for( auto i=pos; i<end; ++i )
+            { insert( i ); }
+
+            pos += bestLength;
+        }
+        else
+        {
+            tokens.push_back( { pSrc[pos], 0 } );
+
+            if ( pos + DEFLATE_MIN_MATCH <= size )
+            { insert( pos ); }
+
+            pos++;
+        }
+
+        if ( tokens.size() == DEFLATE_BLOCK_TOKENS )
+        {
+            WriteBlock( writer, tokens.data(), u32( tokens.size() ), last && pos == size );
+            tokens.clear();
+        }
+    }
+
+    if ( !tokens.empty() || ( last && size == 0 ) )
+    { WriteBlock( writer, tokens.data(), u32( tokens.size() ), last ); }
+
+    if ( !last )
+    {
+        // 空の無圧縮ブロック.
+        writer.Write( 0, 3 );
+        writer.Align();
+        writer.Write( 0x0000, 16 );
+        writer.Write( 0xffff, 16 );
+    }
+
+    writer.Align();
+}
+
+//-------------------------------------------------------------------------------------------------
+//      Adler-32 を求めます.
+//-------------------------------------------------------------------------------------------------
+u32 ComputeAdler32( const u8* pData, size_t size )
+{
+    static constexpr u32 BASE = 65521;
+    static constexpr size_t NMAX = 5552;    // 32bit で桁あふれしない最大の長さ.
+
+    u32 a = 1;
+    u32 b = 0;
+    while( size > 0 )
+    {
+        auto n = asdx::Min( size, NMAX );
+        for( size_t i=0; i<n; ++i )
+        {
+            a += pData[i];
+            b += a;
+        }
+        a %= BASE;
+        b %= BASE;
+        pData += n;
+        size  -= n;
+    }
+
+    return ( b << 16 ) | a;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      連結したデータの Adler-32 を, それぞれの Adler-32 から求めます.
+//-------------------------------------------------------------------------------------------------
+u32 CombineAdler32( u32 adler1, u32 adler2, size_t size2 )
+{
+    static constexpr u64 BASE = 65521;
+
+    auto rem = u64( size2 % BASE );
+    auto a1  = u64( adler1 & 0xffff );
+    auto b1  = u64( adler1 >> 16 );
+    auto a2  = u64( adler2 & 0xffff );
+    auto b2  = u64( adler2 >> 16 );
+
+    auto a = ( a1 + a2 + BASE - 1 ) % BASE;
+    auto b = ( rem * a1 + b1 + b2 + BASE - rem ) % BASE;
+    return u32( ( b << 16 ) | a );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      CRC-32 を求めます.
+//-------------------------------------------------------------------------------------------------
+u32 ComputeCrc32( const u8* pData, size_t size, u32 crc = 0 )
+{
+    static const auto table = []()
+    {
+        std::vector<u32> result( 256 );
+        for( u32 i=0; i<256; ++i )
+        {
+            auto c = i;
+            for( auto k=0; k<8; ++k )
+            { c = ( c & 1 ) ? ( 0xedb88320u ^ ( c >> 1 ) ) : ( c >> 1 ); }
+            result[i] = c;
+        }
+        return result;
+    }();
+
+    crc = ~crc;
+    for( size_t i=0; i<size; ++i )
+    { crc = table[( crc ^ pData[i] ) & 0xff] ^ ( crc >> 8 ); }
+    return ~crc;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      ビッグエンディアンで 32bit 値を追加します.
+//-------------------------------------------------------------------------------------------------
+inline void AppendU32BE( std::vector<u8>& data, u32 value )
+{
+    data.push_back( u8( value >> 24 ) );
+    data.push_back( u8( value >> 16 ) );
+    data.push_back( u8( value >>  8 ) );
+    data.push_back( u8( value ) );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      PNG のチャンクを追加します.
+//-------------------------------------------------------------------------------------------------
+void AppendChunk( std::vector<u8>& data, const char* type, const u8* pPayload, size_t size )
+{
+    AppendU32BE( data, u32( size ) );
+
+    auto begin = data.size();
+    data.insert( data.end(), type, type + 4 );
+    if ( size > 0 )
+    { data.insert( data.end(), pPayload, pPayload + size ); }
+
+    AppendU32BE( data, ComputeCrc32( data.data() + begin, data.size() - begin ) );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      Paeth 予測子を求めます.
+//-------------------------------------------------------------------------------------------------
+inline u8 Paeth( s32 a, s32 b, s32 c )
+{
+    auto p  = a + b - c;
+    auto pa = abs( p - a );
+    auto pb = abs( p - b );
+    auto pc = abs( p - c );
+    if ( pa <= pb && pa <= pc ) { return u8( a ); }
+    if ( pb <= pc )             { return u8( b ); }
+    return u8( c );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      1 行にフィルタをかけます. 5 種類のうち, 差分の絶対値の和が最小のものを選びます.
+//-------------------------------------------------------------------------------------------------
+void FilterRow( const u8* pRow, const u8* pPrev, u32 rowSize, u8* pCandidates, u8* pDst )
+{
+    static constexpr u32 BPP = 4;
+
+    u32 bestFilter = 0;
+    u64 bestSum    = U64_MAX;
+
+    for( u32 filter=0; filter<5; ++filter )
+    {
+        auto pOut = pCandidates + filter * rowSize;
+        u64  sum  = 0;
+
+        for( u32 i=0; i<rowSize; ++i )
+        {
+            s32 a = ( i >= BPP ) ? pRow[i - BPP] : 0;
+            s32 b = pPrev[i];
+            s32 c = ( i >= BPP ) ? pPrev[i - BPP] : 0;
+
+            u8 value = pRow[i];
+            switch( filter )
+            {
+            case 1: value = u8( value - a ); break;
+            case 2: value = u8( value - b ); break;
+            case 3: value = u8( value - ( ( a + b ) >> 1 ) ); break;
+            case 4: value = u8( value - Paeth( a, b, c ) ); break;
+            default: break;
+            }
+
+            pOut[i] = value;
+            sum += u64( abs( s32( s8( value ) ) ) );
+        }
+
+        if ( sum < bestSum )
+        {
+            bestSum    = sum;
+            bestFilter = filter;
+        }
+    }
+
+    pDst[0] = u8( bestFilter );
+    memcpy( pDst + 1, pCandidates + bestFilter * rowSize, rowSize );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      ストリップにフィルタをかけて圧縮します.
+//-------------------------------------------------------------------------------------------------
+void EncodeStrip
+(
+    Strip&      strip,
+    u32         width,
+    u32         height,
+    const u8*   pBuffer,
+    const u8*   pPrevRow,
+    bool        last
+)
+{
+    auto rowSize = width * 4;
+    auto rows    = strip.EndRow - strip.BeginRow;
+
+    std::vector<u8> filtered( size_t( rowSize + 1 ) * rows );
+    std::vector<u8> candidates( size_t( rowSize ) * 5 );
+    std::vector<u8> zeros( rowSize, 0 );
+
+    // ピクセルデータは下端の行から並んでいるので, 画像の行 y はバッファの height - 1 - y 行目.
+    // バッファの上端の行は, 直前に書き込んだ行 (pPrevRow) を上の行としてフィルタをかける.
+    for( u32 i=0; i<rows; ++i )
+    {
+        auto y     = strip.BeginRow + i;
+        auto pRow  = pBuffer + size_t( height - 1 - y ) * rowSize;
+        auto pPrev = ( y > 0 ) ? pRow + rowSize : ( pPrevRow != nullptr ) ? pPrevRow : zeros.data();
+        FilterRow( pRow, pPrev, rowSize, candidates.data(), filtered.data() + size_t( rowSize + 1 ) * i );
+    }
+
+    strip.Size  = filtered.size();
+    strip.Adler = ComputeAdler32( filtered.data(), filtered.size() );
+    Deflate( filtered.data(), filtered.size(), last, strip.Data );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      行をストリップに分けて並列に圧縮し, zlib ストリームに追加します.
+//-------------------------------------------------------------------------------------------------
+void EncodeRows
+(
+    u32                 width,
+    u32                 height,
+    const u8*           pBuffer,
+    const u8*           pPrevRow,
+    bool                last,
+    std::vector<u8>&    stream,
+    u32&                adler
+)
+{
+    // 行単位でストリップに分割し, 並列に圧縮する.
+    std::vector<Strip> strips;
+    {
+        auto stripCount = GetChunkCount( height, PNG_MIN_STRIP_ROWS );
+
+        strips.resize( stripCount );
+        for( u32 i=0; i<stripCount; ++i )
+        {
+            strips[i].BeginRow = u32( u64( height ) * i / stripCount );
+            strips[i].EndRow   = u32( u64( height ) * ( i + 1 ) / stripCount );
+        }
+    }
+
+    auto stripCount = u32( strips.size() );
+    ParallelFor( stripCount, [&]( u32 index )
+    {
+        EncodeStrip( strips[index], width, height, pBuffer,
+            ( index == 0 ) ? pPrevRow : nullptr, last && index + 1 == stripCount );
+    } );
+
+    {
+        auto size = stream.size();
+        for( auto& strip : strips )
+        { size += strip.Data.size(); }
+        stream.reserve( size + 4 );
+    }
+
+    for( auto& strip : strips )
+    {
+        adler = CombineAdler32( adler, strip.Adler, strip.Size );
+        stream.insert( stream.end(), strip.Data.begin(), strip.Data.end() );
+        std::vector<u8>().swap( strip.Data );
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      シグネチャと IHDR チャンクを追加します.
+//-------------------------------------------------------------------------------------------------
+void AppendHeader( std::vector<u8>& data, u32 width, u32 height )
+{
+    static constexpr u8 SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    data.insert( data.end(), SIGNATURE, SIGNATURE + 8 );
+
+    u8 header[13];
+    header[0]  = u8( width  >> 24 ); header[1] = u8( width  >> 16 ); header[2] = u8( width  >> 8 ); header[3] = u8( width );
+    header[4]  = u8( height >> 24 ); header[5] = u8( height >> 16 ); header[6] = u8( height >> 8 ); header[7] = u8( height );
+    header[8]  = 8;     // ビット深度.
+    header[9]  = 6;     // RGBA.
+    header[10] = 0;     // 圧縮方式.
+    header[11] = 0;     // フィルタ方式.
+    header[12] = 0;     // インターレース無し.
+
+    AppendChunk( data, "IHDR", header, sizeof(header) );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      チャンクをファイルに書き込みます.
+//-------------------------------------------------------------------------------------------------
+bool WriteChunk( FILE* pFile, const char* type, const u8* pPayload, size_t size )
+{
+    std::vector<u8> data;
+    data.reserve( size + 12 );
+    AppendChunk( data, type, pPayload, size );
+    return fwrite( data.data(), 1, data.size(), pFile ) == data.size();
+}
+
+} // namespace /* anonymous */
+
+
+//-------------------------------------------------------------------------------------------------
+//      PNGファイルに保存します.
+//-------------------------------------------------------------------------------------------------
+bool SaveToPng( const char16* filename, u32 width, u32 height, const u8* pBuffer )
+{
+    if ( filename == nullptr || pBuffer == nullptr || width == 0 || height == 0 )
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    // zlib ストリームを組み立てる. Adler-32 の初期値は空のデータの値.
+    std::vector<u8> stream;
+    stream.push_back( 0x78 );   // 32K 窓の DEFLATE.
+    stream.push_back( 0x01 );   // 最速の圧縮レベル.
+
+    u32 adler = 1;
+    EncodeRows( width, height, pBuffer, nullptr, true, stream, adler );
+    AppendU32BE( stream, adler );
+
+    // PNG ファイルを組み立てる.
+    std::vector<u8> data;
+    data.reserve( stream.size() + 64 );
+
+    AppendHeader( data, width, height );
+    AppendChunk( data, "IDAT", stream.data(), stream.size() );
+    AppendChunk( data, "IEND", nullptr, 0 );
+
+    return WriteImageFile( filename, data.data(), data.size() );
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// PngWriter class
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------------------------------
+//      コンストラクタです.
+//-------------------------------------------------------------------------------------------------
+PngWriter::PngWriter()
+: m_pFile   ( nullptr )
+, m_Width   ( 0 )
+, m_Height  ( 0 )
+, m_RowCount( 0 )
+, m_Adler   ( 1 )
+, m_Failed  ( false )
+{ /* DO_NOTHING */ }
+
+//-------------------------------------------------------------------------------------------------
+//      デストラクタです.
+//-------------------------------------------------------------------------------------------------
+PngWriter::~PngWriter()
+{ Close(); }
+
+//-------------------------------------------------------------------------------------------------
+//      PNGファイルを開いてヘッダを書き込みます.
+//-------------------------------------------------------------------------------------------------
+bool PngWriter::Open( const char16* filename, u32 width, u32 height )
+{
+    if ( filename == nullptr || width == 0 || height == 0 )
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    Close();
+
+    m_pFile = OpenImageFile( filename );
+    if ( m_pFile == nullptr )
+    {
+        ELOG( "Error : File Open Failed." );
+        return false;
+    }
+
+    m_Width    = width;
+    m_Height   = height;
+    m_RowCount = 0;
+    m_Adler    = 1;
+    m_Failed   = false;
+    m_PrevRow.clear();
+
+    std::vector<u8> data;
+    AppendHeader( data, width, height );
+
+    if ( fwrite( data.data(), 1, data.size(), m_pFile ) != data.size() )
+    {
+        ELOG( "Error : File Write Failed." );
+        m_Failed = true;
+        return false;
+    }
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      帯状の行を圧縮して書き込みます.
+//-------------------------------------------------------------------------------------------------
+bool PngWriter::WriteRows( const u8* pBuffer, u32 rowCount )
+{
+    if ( m_pFile == nullptr || pBuffer == nullptr || rowCount == 0 || m_RowCount + rowCount > m_Height )
+    {
+        ELOG( "Error : Invalid Argument." );
+        return false;
+    }
+
+    if ( m_Failed )
+    { return false; }
+
+    // 先頭の帯には zlib ヘッダを付ける.
+    std::vector<u8> stream;
+    if ( m_RowCount == 0 )
+    {
+        stream.push_back( 0x78 );   // 32K 窓の DEFLATE.
+        stream.push_back( 0x01 );   // 最速の圧縮レベル.
+    }
+
+    // 最後の DEFLATE ブロックは Close() で書き込むので, 帯は常に同期フラッシュで終える.
+    auto pPrevRow = m_PrevRow.empty() ? nullptr : m_PrevRow.data();
+    EncodeRows( m_Width, rowCount, pBuffer, pPrevRow, false, stream, m_Adler );
+
+    // 帯の下端の行が, 次の帯の上端の行の 1 つ上の行になる.
+    m_PrevRow.assign( pBuffer, pBuffer + size_t( m_Width ) * 4 );
+    m_RowCount += rowCount;
+
+    if ( !WriteChunk( m_pFile, "IDAT", stream.data(), stream.size() ) )
+    {
+        ELOG( "Error : File Write Failed." );
+        m_Failed = true;
+        return false;
+    }
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      ストリームを終端してファイルを閉じます.
+//-------------------------------------------------------------------------------------------------
+bool PngWriter::Close()
+{
+    if ( m_pFile == nullptr )
+    { return false; }
+
+    auto result = !m_Failed;
+    if ( m_RowCount != m_Height )
+    {
+        ELOG( "Error : Missing Rows. written = %u, height = %u", m_RowCount, m_Height );
+        result = false;
+    }
+
+    if ( result )
+    {
+        // 空の最終無圧縮ブロックで DEFLATE を終端し, Adler-32 を付ける.
+        std::vector<u8> stream = { 0x01, 0x00, 0x00, 0xff, 0xff };
+        AppendU32BE( stream, m_Adler );
+
+        result = WriteChunk( m_pFile, "IDAT", stream.data(), stream.size() )
+              && WriteChunk( m_pFile, "IEND", nullptr, 0 );
+        if ( !result )
+        { ELOG( "Error : File Write Failed." ); }
+    }
+
+    if ( fclose( m_pFile ) != 0 )
+    {
+        ELOG( "Error : File Close Failed." );
+        result = false;
+    }
+
+    m_pFile = nullptr;
+    m_PrevRow.clear();
+
+    return result;
+}
@@ -0,0 +1,292 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : Rasterizer.cpp
+// Desc : Software Rasterizer Module.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <Rasterizer.h>
+
+
+//-------------------------------------------------------------------------------------------------
+// Using Statements
+//-------------------------------------------------------------------------------------------------
+using namespace asdx;
+
+
+namespace /* anonymous */ {
+
+//-------------------------------------------------------------------------------------------------
+//      スクリーン空間の y 座標を対数変換します.
+//-------------------------------------------------------------------------------------------------
+f32 WarpY( const RasterState& state, f32 y )
+{
+    // 画面上端より外側の頂点は log の引数が負になるので, 境界矩形が保守的になるよう下限を設ける.
+    return state.C0 * log( Max( state.C1 * y + 1.0f, F32_MIN ) );
+}
+
+} // namespace /* anonymous */
+
+
+//-------------------------------------------------------------------------------------------------
+//      2次元ベクトルに変換します.
+//-------------------------------------------------------------------------------------------------
+Vector2 ToVector2( const Vector4& value )
+{ return Vector2( value.x, value.y ); }
+
+
+//-------------------------------------------------------------------------------------------------
+//      3次元ベクトルに変換します.
+//-------------------------------------------------------------------------------------------------
+Vector3 ToVector3( const Vector4& value )
+{ return Vector3( value.x, value.y, value.z ); }
+
+
+//-------------------------------------------------------------------------------------------------
+//      正規化デバイス座標系に変換します。[-1, 1]の範囲です.
+//-------------------------------------------------------------------------------------------------
+Vector4 ToNDC( const Vector4& value )
+{
+    return Vector4( 
+        value.x / value.w,
+        value.y / value.w,
+        value.z / value.w,
+        1.0f / value.w );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      スクリーン空間座標系に変換します. [0, 1]の範囲です.
+//-------------------------------------------------------------------------------------------------
+Vector4 ToSS( const Vector4& value )
+{
+    return Vector4( 
+        value.x * 0.5f + 0.5f,
+        value.y * 0.5f + 0.5f,
+        value.z,
+        value.w ); 
+}
+
+//-------------------------------------------------------------------------------------------------
+//      デバイス座標系に変換します. (ビューポートサイズの範囲内).
+//-------------------------------------------------------------------------------------------------
+Vector4 ToDC( const Vector4& value, f32 w, f32 h )
+{
+    return Vector4(
+        value.x * w,
+        value.y * h,
+        value.z,
+        value.w );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      対数変換を行います.
+//-------------------------------------------------------------------------------------------------
+Vector4 LogTransform( const Vector4& value, f32 n, f32 f )
+{
+    // Logarithmic Perspective Shadow Map, 
+    // Chapter 7 Logarithmic rasterization hardware, p.149, Equation 7.1
+
+    auto c0 = -1.0f / log(f / n);
+    auto c1 = (1.0f - (f / n)) / (f / n);
+
+    return Vector4(
+        value.x,
+        c0 * log(c1 * value.y + 1.0f),
+        value.z,
+        value.w);
+}
+
+//-------------------------------------------------------------------------------------------------
+//      逆対数変換を行います.
+//-------------------------------------------------------------------------------------------------
+Vector2 InvLogTransform( const Vector2& value, f32 n, f32 f, f32 h )
+{
+    // Logarithmic Perspective Shadow Map, 
+    // Chapter 7 Logarithmic rasterization hardware, p.152, Equation 7.4
+
+    auto y = value.y / h;       // [0, 1] の範囲に戻します.
+    auto c0 = -1.0f / log(f / n);
+    auto c1 = (1.0f - (f / n)) / (f / n);
+
+    return Vector2(
+        value.x,
+        ((exp(y / c0) - 1.0f) / c1) * h);   // 逆変換してから, [0, h] の範囲に戻します.
+}
+
+//-------------------------------------------------------------------------------------------------
+//      2次元ベクトルの外積を求めます.
+//-------------------------------------------------------------------------------------------------
+f32 CrossProduct( const Vector2& a, const Vector2& b )
+{ return a.x * b.y - b.x * a.y; }
+
+//-------------------------------------------------------------------------------------------------
+//      クリップ平面に合わせてラスタライズ設定を更新します.
+//-------------------------------------------------------------------------------------------------
+void UpdateRasterState( RasterState& state, f32 nearClip, f32 farClip, u32 height )
+{
+    state.NearClip = nearClip;
+    state.FarClip  = farClip;
+    state.C0       = -1.0f / log(farClip / nearClip);
+    state.C1       = (1.0f - (farClip / nearClip)) / (farClip / nearClip);
+
+    // 逆対数変換は y のみに依存するので, 行ごとに一度だけ計算しておく.
+    auto h = f32(height);
+    state.InvLogTable.resize( height );
+    for( u32 i=0; i<height; ++i )
+    {
+        auto y = ( f32(i) + 0.5f ) / h;
+        state.InvLogTable[i] = ((exp(y / state.C0) - 1.0f) / state.C1) * h;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      レンダーターゲットをクリアします.
+//-------------------------------------------------------------------------------------------------
+void ClearRenderTarget( RenderTarget& target )
+{
+    for( u32 i=0; i<target.Height; ++i )
+    {
+        for( u32 j=0; j<target.Width; ++j )
+        {
+            if ( target.pColor != nullptr )
+            {
+                auto idx = i * target.Width * 4 + j * 4;
+                target.pColor[idx + 0] = 255;
+                target.pColor[idx + 1] = 255;
+                target.pColor[idx + 2] = 255;
+                target.pColor[idx + 3] = 255;
+            }
+
+            auto idx = i * target.Width + j;
+            target.pDepth[idx] = F32_MAX;
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      三角形をラスタライズします.
+//-------------------------------------------------------------------------------------------------
+void DrawTriangle
+(
+    const RasterState&  state,
+    RenderTarget&       target,
+    const Vector4&      P0,
+    const Vector4&      P1,
+    const Vector4&      P2,
+    const Vector4*      pColors
+)
+{
+    auto w = f32(target.Width);
+    auto h = f32(target.Height);
+
+    // 視点の後方にかかる三角形は処理しない.
+    if ( P0.w <= 0.0f || P1.w <= 0.0f || P2.w <= 0.0f )
+    { return; }
+
+    auto isLog = ( state.Mode == RasterMode::Logarithmic );
+
+    // 正規化デバイス座標系に変換.
+    auto P0p = ToNDC( P0 );
+    auto P1p = ToNDC( P1 );
+    auto P2p = ToNDC( P2 );
+
+    // スクリーン空間座標系に変換.
+    auto P0s = ToSS( P0p );
+    auto P1s = ToSS( P1p );
+    auto P2s = ToSS( P2p );
+
+    if ( isLog )
+    {
+        assert( state.InvLogTable.size() == target.Height );
+
+        P0p = Vector4( P0s.x, WarpY( state, P0s.y ), P0s.z, P0s.w );
+        P1p = Vector4( P1s.x, WarpY( state, P1s.y ), P1s.z, P1s.w );
+        P2p = Vector4( P2s.x, WarpY( state, P2s.y ), P2s.z, P2s.w );
+    }
+    else
+    {
+        P0p = P0s;
+        P1p = P1s;
+        P2p = P2s;
+    }
+
+    // デバイス座標系に変換.
+    P0p = ToDC( P0p, w, h );
+    P1p = ToDC( P1p, w, h );
+    P2p = ToDC( P2p, w, h );
+
+    P0s = ToDC( P0s, w, h );
+    P1s = ToDC( P1s, w, h );
+    P2s = ToDC( P2s, w, h );
+
+    auto mini = Vector2::Min(ToVector2(P0p), Vector2::Min(ToVector2(P1p), ToVector2(P2p)));
+    auto maxi = Vector2::Max(ToVector2(P0p), Vector2::Max(ToVector2(P1p), ToVector2(P2p)));
+
+    // ビューポートでクリッピング.
+    mini = Vector2::Max( mini, Vector2(0.0f, 0.0f) );
+    maxi = Vector2::Min( maxi, Vector2(w, h) );
+
+    // 三角形の外側は処理しない.
+    if ( mini.x > maxi.x || mini.y > maxi.y )
+    { return; }
+
+    auto vs1 = ToVector2(P1s) - ToVector2(P0s);
+    auto vs2 = ToVector2(P2s) - ToVector2(P0s);
+
+    float div = CrossProduct( vs1, vs2 );
+    if ( div == 0.0f )
+    { return; }
+
+    // ピクセルサイズに合わせる.
+    auto TriMin = Vector2(floor(mini.x), floor(mini.y));
+    auto TriMax = Vector2(ceil(maxi.x), ceil(maxi.y));
+
+    // ピクセル中心まで移動.
+    TriMin += Vector2(0.5f, 0.5f);
+    TriMax += Vector2(0.5f, 0.5f);
+
+    Vector2 vPos;
+    for( vPos.y = TriMin.y; vPos.y < TriMax.y; vPos.y++ )
+    {
+        // 対数ラスタライズの場合は逆対数変換をかけて線形な値を取ってくる.
+        auto y = ( isLog ) ? state.InvLogTable[ u32(vPos.y) ] : vPos.y;
+
+        for( vPos.x = TriMin.x; vPos.x < TriMax.x; vPos.x++ )
+        {
+            auto p = Vector2( vPos.x, y ) - ToVector2( P0s );
+
+            // p = s * vs1 + t * vs2 となる重みを求める.
+            auto s = CrossProduct( p, vs2 ) / div;
+            auto t = CrossProduct( vs1, p ) / div;
+            auto u = 1.0f - s - t;
+
+            if ( s < 0.0f || t < 0.0f || u < 0.0f )
+            { continue; }
+
+            auto z = P0p.z * u + P1p.z * s + P2p.z * t;
+            auto q = P0p.w * u + P1p.w * s + P2p.w * t;
+            auto depth = (z / q);
+
+            auto idxD = s32(vPos.y) * target.Width + s32(vPos.x);
+
+            // 深度値を比較.
+            if ( target.pDepth[idxD] < depth )
+            { continue; }
+
+            target.pDepth[idxD] = depth;
+
+            if ( pColors != nullptr && target.pColor != nullptr )
+            {
+                auto col  = pColors[0] * u + pColors[1] * s + pColors[2] * t;
+                auto idxC = idxD * 4;
+
+                target.pColor[idxC + 0] = asdx::Clamp( int(col.x * 255.0f), 0, 255 );
+                target.pColor[idxC + 1] = asdx::Clamp( int(col.y * 255.0f), 0, 255 );
+                target.pColor[idxC + 2] = asdx::Clamp( int(col.z * 255.0f), 0, 255 );
+                target.pColor[idxC + 3] = asdx::Clamp( int(col.w * 255.0f), 0, 255 );
+            }
+        }
+    }
+}
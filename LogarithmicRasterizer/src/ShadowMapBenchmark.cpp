@@ -0,0 +1,783 @@
+﻿//-------------------------------------------------------------------------------------------------
+// File : ShadowMapBenchmark.cpp
+// Desc : Shadow Map Error vs Memory Benchmark.
+// Copyright(c) Project Asura. All right reserved.
+//-------------------------------------------------------------------------------------------------
+
+//-------------------------------------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------------------------------------
+#include <asdxMath.h>
+#include <asdxLogger.h>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <MeshCache.h>
+#include <Rasterizer.h>
+#include <Bounds.h>
+
+
+//-------------------------------------------------------------------------------------------------
+// Using Statements
+//-------------------------------------------------------------------------------------------------
+using namespace asdx;
+
+
+namespace /* anonymous */ {
+
+//-------------------------------------------------------------------------------------------------
+// Constant Values.
+//-------------------------------------------------------------------------------------------------
+static constexpr u32    CASCADE_COUNT   = 4;        //!< カスケード数です.
+static constexpr u32    REPEAT_COUNT    = 3;        //!< 計測の繰り返し回数です.
+static constexpr u32    SCREEN_WIDTH    = 960;      //!< 評価に用いる画面の横幅です.
+static constexpr u32    SCREEN_HEIGHT   = 540;      //!< 評価に用いる画面の縦幅です.
+static constexpr f32    SPLIT_LAMBDA    = 0.75f;    //!< カスケード分割の対数分割の割合です.
+static constexpr f32    DEPTH_GAP       = 0.05f;    //!< 隣接ピクセルを同一面とみなす深度差の割合です.
+static constexpr u32    GROUND_DIVISION = 64;       //!< 地面の分割数です.
+static constexpr f32    NEAR_RATIO      = 0.0005f;  //!< ファークリップに対するニアクリップの最小比率です.
+static const u32        DEFAULT_RESOLUTIONS[] = { 256, 512, 1024, 2048, 4096 };
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// ShadowTechnique enum
+///////////////////////////////////////////////////////////////////////////////////////////////////
+enum class ShadowTechnique : u32
+{
+    Linear = 0,         //!< 線形シャドウマップ.
+    Logarithmic,        //!< 対数シャドウマップ.
+    Cascaded,           //!< カスケードシャドウマップ.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Camera structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct Camera
+{
+    Vector3     Position;       //!< 位置座標です.
+    Vector3     Forward;        //!< 視線方向です.
+    Matrix      View;           //!< ビュー行列です.
+    Matrix      InvView;        //!< ビュー行列の逆行列です.
+    Matrix      Proj;           //!< 射影行列です.
+    Matrix      ViewProj;       //!< ビュー射影行列です.
+    f32         FieldOfView;    //!< 垂直画角です.
+    f32         AspectRatio;    //!< アスペクト比です.
+    f32         NearClip;       //!< ニアクリップ平面までの距離です.
+    f32         FarClip;        //!< ファークリップ平面までの距離です.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// ShadowConfig structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct ShadowConfig
+{
+    ShadowTechnique     Technique;                      //!< 手法です.
+    RasterState         State;                          //!< ラスタライズ設定です.
+    u32                 MapCount;                       //!< シャドウマップ枚数です.
+    Matrix              ViewProj[CASCADE_COUNT];        //!< ライトのビュー射影行列です.
+    f32                 SplitFar[CASCADE_COUNT];        //!< 各カスケードが受け持つ最大ビュー深度です.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// BenchResult structure
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct BenchResult
+{
+    const char*     Technique;      //!< 手法名です.
+    u32             Resolution;     //!< シャドウマップ1枚あたりの解像度です.
+    u32             MapCount;       //!< シャドウマップ枚数です.
+    u64             MemoryBytes;    //!< 深度バッファのメモリ使用量です.
+    f64             RenderTimeMs;   //!< 描画時間(ミリ秒)です.
+    f32             ErrorMean;      //!< エイリアシング誤差の平均値です.
+    f32             ErrorP50;       //!< エイリアシング誤差の中央値です.
+    f32             ErrorP95;       //!< エイリアシング誤差の95パーセンタイル値です.
+    f32             ErrorMax;       //!< エイリアシング誤差の最大値です.
+    u32             SampleCount;    //!< 評価したピクセル数です.
+};
+
+
+//-------------------------------------------------------------------------------------------------
+//      手法名を取得します.
+//-------------------------------------------------------------------------------------------------
+const char* GetTechniqueName( ShadowTechnique technique )
+{
+    switch( technique )
+    {
+    case ShadowTechnique::Linear:       return "linear";
+    case ShadowTechnique::Logarithmic:  return "logarithmic";
+    case ShadowTechnique::Cascaded:     return "cascaded";
+    }
+
+    return "unknown";
+}
+
+//-------------------------------------------------------------------------------------------------
+//      ファイルを開きます.
+//-------------------------------------------------------------------------------------------------
+FILE* OpenFile( const char* filename, const char* mode )
+{
+#if ASDX_IS_WIN
+    FILE* pFile = nullptr;
+    if ( fopen_s( &pFile, filename, mode ) != 0 )
+    { return nullptr; }
+    return pFile;
+#else
+    return fopen( filename, mode );
+#endif
+}
+
+//-------------------------------------------------------------------------------------------------
+//      三角形を追加します.
+//-------------------------------------------------------------------------------------------------
+void AddTriangle( std::vector<Vector3>& triangles, const Vector3& a, const Vector3& b, const Vector3& c )
+{
+    triangles.push_back( a );
+    triangles.push_back( b );
+    triangles.push_back( c );
+}
+
+//-------------------------------------------------------------------------------------------------
+//      軸平行な箱を追加します.
+//-------------------------------------------------------------------------------------------------
+void AddBox( std::vector<Vector3>& triangles, const Vector3& mini, const Vector3& maxi )
+{
+    Vector3 p[8] = {
+        Vector3( mini.x, mini.y, mini.z ), Vector3( maxi.x, mini.y, mini.z ),
+        Vector3( maxi.x, maxi.y, mini.z ), Vector3( mini.x, maxi.y, mini.z ),
+        Vector3( mini.x, mini.y, maxi.z ), Vector3( maxi.x, mini.y, maxi.z ),
+        Vector3( maxi.x, maxi.y, maxi.z ), Vector3( mini.x, maxi.y, maxi.z ),
+    };
+
+    const u32 faces[6][4] = {
+        { 0, 3, 2, 1 }, { 4, 5, 6, 7 }, { 0, 4, 7, 3 },
+        { 1, 2, 6, 5 }, { 3, 7, 6, 2 }, { 0, 1, 5, 4 },
+    };
+
+    for( auto i=0; i<6; ++i )
+    {
+        AddTriangle( triangles, p[faces[i][0]], p[faces[i][1]], p[faces[i][2]] );
+        AddTriangle( triangles, p[faces[i][0]], p[faces[i][2]], p[faces[i][3]] );
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      シーンを構築します.
+//-------------------------------------------------------------------------------------------------
+void BuildScene( const char* filename, std::vector<Vector3>& triangles, Vector3& modelMini, Vector3& modelMaxi )
+{
+    MeshCache model;
+    if ( model.Load( filename ) && model.GetIndexCount() > 0 )
+    {
+        auto pPositions = model.GetPositions();
+        auto pIndices   = model.GetIndices();
+
+        for( u32 i=0; i + 2 < model.GetIndexCount(); i += 3 )
+        {
+            AddTriangle( triangles,
+                pPositions[ pIndices[i + 0] ],
+                pPositions[ pIndices[i + 1] ],
+                pPositions[ pIndices[i + 2] ] );
+        }
+        ILOG( "Info : Loaded %s (%u triangles).", filename, u32(triangles.size() / 3) );
+    }
+    else
+    {
+        // モデルが無い場合でも計測できるように, 箱を並べたシーンで代用する.
+        ILOG( "Info : %s is not available, use built-in box scene.", filename );
+        for( auto i=-2; i<=2; ++i )
+        {
+            for( auto j=-2; j<=2; ++j )
+            {
+                auto height = 20.0f + 15.0f * f32( (i + 2) * 5 + (j + 2) ) / 24.0f;
+                auto center = Vector3( f32(i) * 40.0f, 0.0f, f32(j) * 40.0f );
+                AddBox( triangles, center + Vector3( -10.0f, 0.0f, -10.0f ), center + Vector3( 10.0f, height, 10.0f ) );
+            }
+        }
+    }
+
+    for( auto& p : triangles )
+    {
+        modelMini = Vector3::Min( modelMini, p );
+        modelMaxi = Vector3::Max( modelMaxi, p );
+    }
+
+    // 地面を追加. 近平面のクリッピングを行わないので, 細かく分割しておく.
+    auto center = ( modelMini + modelMaxi ) * 0.5f;
+    auto extent = ( modelMaxi - modelMini ).Length() * 4.0f;
+    auto step   = ( extent * 2.0f ) / f32(GROUND_DIVISION);
+
+    for( u32 i=0; i<GROUND_DIVISION; ++i )
+    {
+        for( u32 j=0; j<GROUND_DIVISION; ++j )
+        {
+            auto x0 = center.x - extent + step * f32(j);
+            auto z0 = center.z - extent + step * f32(i);
+            auto x1 = x0 + step;
+            auto z1 = z0 + step;
+
+            AddTriangle( triangles, Vector3( x0, modelMini.y, z0 ), Vector3( x1, modelMini.y, z1 ), Vector3( x1, modelMini.y, z0 ) );
+            AddTriangle( triangles, Vector3( x0, modelMini.y, z0 ), Vector3( x0, modelMini.y, z1 ), Vector3( x1, modelMini.y, z1 ) );
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      視錐台の断面の角を求めます.
+//-------------------------------------------------------------------------------------------------
+void GetFrustumCorners( const Camera& camera, f32 nearDist, f32 farDist, Vector3* pCorners )
+{
+    auto tanY = tanf( camera.FieldOfView * 0.5f );
+    auto tanX = tanY * camera.AspectRatio;
+
+    auto idx = 0;
+    for( auto dist : { nearDist, farDist } )
+    {
+        for( auto sy : { -1.0f, 1.0f } )
+        {
+            for( auto sx : { -1.0f, 1.0f } )
+            {
+                auto p = Vector4( sx * tanX * dist, sy * tanY * dist, -dist, 1.0f );
+                p = Vector4::Transform( p, camera.InvView );
+                pCorners[idx++] = Vector3( p.x, p.y, p.z );
+            }
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      点群を囲むライトのビュー射影行列を求めます.
+//-------------------------------------------------------------------------------------------------
+Matrix FitLightViewProj
+(
+    const Vector3&              lightDir,
+    const Vector3&              lightUp,
+    const Vector3*              pPoints,
+    u32                         count,
+    const std::vector<Vector3>& casters
+)
+{
+    auto view = Matrix::CreateLookAt( Vector3( 0.0f, 0.0f, 0.0f ), lightDir, lightUp );
+
+    // 受光側の点群で XY 範囲を決める.
+    auto mini = Vector3( F32_MAX, F32_MAX, F32_MAX );
+    auto maxi = Vector3(-F32_MAX,-F32_MAX,-F32_MAX );
+    for( u32 i=0; i<count; ++i )
+    {
+        auto p = Vector4::Transform( Vector4( pPoints[i], 1.0f ), view );
+        mini = Vector3::Min( mini, Vector3( p.x, p.y, p.z ) );
+        maxi = Vector3::Max( maxi, Vector3( p.x, p.y, p.z ) );
+    }
+
+    // 遮蔽物を取りこぼさないように Z 範囲はシーン全体から決める.
+    auto minZ =  F32_MAX;
+    auto maxZ = -F32_MAX;
+    for( auto& c : casters )
+    {
+        auto p = Vector4::Transform( Vector4( c, 1.0f ), view );
+        minZ = Min( minZ, p.z );
+        maxZ = Max( maxZ, p.z );
+    }
+
+    auto width  = Max( maxi.x - mini.x, F32_EPSILON );
+    auto height = Max( maxi.y - mini.y, F32_EPSILON );
+
+    // 中心を原点に移動して正射影する.
+    auto offset = Matrix::CreateTranslation(
+        -( mini.x + maxi.x ) * 0.5f,
+        -( mini.y + maxi.y ) * 0.5f,
+        -maxZ );
+    auto depth = Max( maxZ - minZ, F32_EPSILON );
+    auto proj  = Matrix::CreateOrthographic( width, height, 0.0f, depth );
+
+    return view * offset * proj;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      点群を囲む対数透視シャドウマップ (LogPSM) のビュー射影行列を求めます.
+//-------------------------------------------------------------------------------------------------
+//  ライト空間で視線方向を軸とし, 受光側の手前に投影中心を置いた透視錐台 (ワープ錐台) を作る.
+//  透視変換後のスクリーン空間 y は (f / (f - n)) * (1 - n / z) となるので,
+//  ワープ錐台の n, f で対数変換すると y = log(z / n) / log(f / n) となり, 投影中心からの距離に対して対数的に分布する.
+//  ライトの光線は z が一定の平面に含まれるので, 透視変換後も平行光源のまま扱える.
+//-------------------------------------------------------------------------------------------------
+Matrix FitLightLogViewProj
+(
+    const Vector3&              lightDir,
+    const Camera&               camera,
+    const Vector3*              pPoints,
+    u32                         count,
+    const std::vector<Vector3>& casters,
+    f32&                        nearClip,
+    f32&                        farClip
+)
+{
+    // 視線方向をライトの投影面に射影したものをワープ軸 (ライト空間の y 軸) にする.
+    auto axis = camera.Forward - lightDir * Vector3::Dot( camera.Forward, lightDir );
+    if ( axis.LengthSq() < F32_EPSILON )
+    { axis = Vector3( 0.0f, 0.0f, 1.0f ) - lightDir * lightDir.z; }
+    axis = Vector3::Normalize( axis );
+
+    auto view = Matrix::CreateLookAt( Vector3( 0.0f, 0.0f, 0.0f ), lightDir, axis );
+    auto eye  = Vector4::Transform( Vector4( camera.Position, 1.0f ), view );
+
+    // 受光側の点群でワープ軸方向の範囲を決める.
+    auto minY =  F32_MAX;
+    auto maxY = -F32_MAX;
+    for( u32 i=0; i<count; ++i )
+    {
+        auto p = Vector4::Transform( Vector4( pPoints[i], 1.0f ), view );
+        minY = Min( minY, p.y );
+        maxY = Max( maxY, p.y );
+    }
+
+    // 視点から受光側の手前までの距離 zn と奥までの距離 zf から, LiSPSM と同じく n = zn + sqrt(zn * zf) とする.
+    // 受光側が視点の後方にも広がる場合に投影中心が受光側に近づきすぎて, 横方向の画角が広がるのを防ぐ.
+    auto zn = Max( minY - eye.y, camera.NearClip );
+    auto zf = zn + Max( maxY - minY, F32_EPSILON );
+    nearClip = zn + sqrt( zn * zf );
+    farClip  = nearClip + Max( maxY - minY, F32_EPSILON );
+    auto offset = nearClip - minY;
+
+    // 投影中心から見て受光側が収まる横方向の画角を求める.
+    auto scale = F32_EPSILON;
+    for( u32 i=0; i<count; ++i )
+    {
+        auto p = Vector4::Transform( Vector4( pPoints[i], 1.0f ), view );
+        scale = Max( scale, f32( fabs( p.x - eye.x ) ) / ( p.y + offset ) );
+    }
+
+    // 遮蔽物を取りこぼさないように深度範囲はシーン全体から決める.
+    // 光線上では w が一定なので, z を w で割っても深度の大小関係は保たれる.
+    auto minZ =  F32_MAX;
+    auto maxZ = -F32_MAX;
+    for( auto& c : casters )
+    {
+        auto p = Vector4::Transform( Vector4( c, 1.0f ), view );
+        minZ = Min( minZ, p.z );
+        maxZ = Max( maxZ, p.z );
+    }
+    auto depth = Max( maxZ - minZ, F32_EPSILON );
+
+    auto n = nearClip;
+    auto f = farClip;
+    auto warp = Matrix(
+        1.0f / scale,   0.0f,                                               0.0f,           0.0f,
+        0.0f,           ( f + n ) / ( f - n ),                              0.0f,           1.0f,
+        0.0f,           0.0f,                                               -1.0f / depth,  0.0f,
+        -eye.x / scale, ( ( f + n ) * offset - 2.0f * f * n ) / ( f - n ),  maxZ / depth,   offset );
+
+    return view * warp;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      ワールド座標をシャドウマップのテクセル座標に変換します.
+//-------------------------------------------------------------------------------------------------
+bool ToShadowTexel( const ShadowConfig& config, u32 cascade, const Vector3& position, f32 resolution, Vector2& result )
+{
+    auto p = Vector4::Transform( Vector4( position, 1.0f ), config.ViewProj[cascade] );
+    p = ToSS( ToNDC( p ) );
+
+    if ( p.x < 0.0f || p.x > 1.0f || p.y < 0.0f || p.y > 1.0f )
+    { return false; }
+
+    if ( config.State.Mode == RasterMode::Logarithmic )
+    { p = LogTransform( p, config.State.NearClip, config.State.FarClip ); }
+
+    result = Vector2( p.x * resolution, p.y * resolution );
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//      シャドウマップを描画します.
+//-------------------------------------------------------------------------------------------------
+void RenderShadowMaps( const ShadowConfig& config, std::vector<RenderTarget>& targets, const std::vector<Vector3>& triangles )
+{
+    for( u32 c=0; c<config.MapCount; ++c )
+    {
+        auto& target = targets[c];
+        ClearRenderTarget( target );
+
+        for( size_t i=0; i<triangles.size(); i += 3 )
+        {
+            auto P0 = Vector4::Transform( Vector4( triangles[i + 0], 1.0f ), config.ViewProj[c] );
+            auto P1 = Vector4::Transform( Vector4( triangles[i + 1], 1.0f ), config.ViewProj[c] );
+            auto P2 = Vector4::Transform( Vector4( triangles[i + 2], 1.0f ), config.ViewProj[c] );
+
+            DrawTriangle( config.State, target, P0, P1, P2, nullptr );
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      エイリアシング誤差を計測します.
+//-------------------------------------------------------------------------------------------------
+//  画面上の隣接ピクセルをシャドウマップへ投影し, ヤコビアン J = d(texel)/d(pixel) を差分で求める.
+//  誤差は 1 / sqrt(|det J|) で, シャドウマップ1テクセルが画面上で何ピクセル分に広がるかを表す.
+//  1 を超えるとテクセルが拡大されてジャギーが見えることになる.
+//-------------------------------------------------------------------------------------------------
+void MeasureError
+(
+    const ShadowConfig&         config,
+    const std::vector<Vector3>& worldPos,
+    const std::vector<f32>&     viewDepth,
+    f32                         resolution,
+    BenchResult&                result
+)
+{
+    std::vector<f32> errors;
+    errors.reserve( worldPos.size() );
+
+    for( u32 y=0; y + 1 < SCREEN_HEIGHT; ++y )
+    {
+        for( u32 x=0; x + 1 < SCREEN_WIDTH; ++x )
+        {
+            auto idx  = y * SCREEN_WIDTH + x;
+            auto idxX = idx + 1;
+            auto idxY = idx + SCREEN_WIDTH;
+
+            auto d = viewDepth[idx];
+            if ( d <= 0.0f )
+            { continue; }
+
+            // シルエットを跨ぐ差分は除外.
+            if ( viewDepth[idxX] <= 0.0f || fabs( viewDepth[idxX] - d ) > d * DEPTH_GAP )
+            { continue; }
+            if ( viewDepth[idxY] <= 0.0f || fabs( viewDepth[idxY] - d ) > d * DEPTH_GAP )
+            { continue; }
+
+            u32 cascade = 0;
+            while( cascade + 1 < config.MapCount && d > config.SplitFar[cascade] )
+            { cascade++; }
+
+            Vector2 t, tx, ty;
+            if ( !ToShadowTexel( config, cascade, worldPos[idx],  resolution, t ) )
+            { continue; }
+            if ( !ToShadowTexel( config, cascade, worldPos[idxX], resolution, tx ) )
+            { continue; }
+            if ( !ToShadowTexel( config, cascade, worldPos[idxY], resolution, ty ) )
+            { continue; }
+
+            auto det = fabs( CrossProduct( tx - t, ty - t ) );
+            if ( det <= F32_EPSILON )
+            { continue; }
+
+            errors.push_back( 1.0f / sqrt( det ) );
+        }
+    }
+
+    result.SampleCount = u32( errors.size() );
+    if ( errors.empty() )
+    { return; }
+
+    std::sort( errors.begin(), errors.end() );
+
+    f64 sum = 0.0;
+    for( auto e : errors )
+    { sum += e; }
+
+    result.ErrorMean = f32( sum / f64( errors.size() ) );
+    result.ErrorP50  = errors[ errors.size() / 2 ];
+    result.ErrorP95  = errors[ Min( errors.size() - 1, ( errors.size() * 95 ) / 100 ) ];
+    result.ErrorMax  = errors.back();
+}
+
+//-------------------------------------------------------------------------------------------------
+//      計測結果をCSV形式で出力します.
+//-------------------------------------------------------------------------------------------------
+void WriteCSV( FILE* pFile, const std::vector<BenchResult>& results )
+{
+    fprintf( pFile, "technique,resolution,maps,memory_bytes,render_ms,error_mean,error_p50,error_p95,error_max,samples\n" );
+    for( auto& r : results )
+    {
+        fprintf( pFile, "%s,%u,%u,%llu,%.3f,%.4f,%.4f,%.4f,%.4f,%u\n",
+            r.Technique,
+            r.Resolution,
+            r.MapCount,
+            static_cast<unsigned long long>( r.MemoryBytes ),
+            r.RenderTimeMs,
+            r.ErrorMean,
+            r.ErrorP50,
+            r.ErrorP95,
+            r.ErrorMax,
+            r.SampleCount );
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+//      計測結果をJSON形式で出力します.
+//-------------------------------------------------------------------------------------------------
+void WriteJSON( FILE* pFile, const std::vector<BenchResult>& results )
+{
+    fprintf( pFile, "[\n" );
+    for( size_t i=0; i<results.size(); ++i )
+    {
+        auto& r = results[i];
+        fprintf( pFile,
+            "  { \"technique\": \"%s\", \"resolution\": %u, \"maps\": %u, \"memory_bytes\": %llu, "
+            "\"render_ms\": %.3f, \"error_mean\": %.4f, \"error_p50\": %.4f, \"error_p95\": %.4f, "
+            "\"error_max\": %.4f, \"samples\": %u }%s\n",
+            r.Technique,
+            r.Resolution,
+            r.MapCount,
+            static_cast<unsigned long long>( r.MemoryBytes ),
+            r.RenderTimeMs,
+            r.ErrorMean,
+            r.ErrorP50,
+            r.ErrorP95,
+            r.ErrorMax,
+            r.SampleCount,
+            ( i + 1 < results.size() ) ? "," : "" );
+    }
+    fprintf( pFile, "]\n" );
+}
+
+} // namespace /* anonymous */
+
+
+//-------------------------------------------------------------------------------------------------
+//      メインエントリーポイントです.
+//-------------------------------------------------------------------------------------------------
+//  usage : ShadowMapBenchmark [model.obj] [resolution ...]
+//  計測結果は shadow_benchmark.csv と shadow_benchmark.json に出力します.
+//-------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    const char* modelPath = ( argc > 1 ) ? argv[1] : "../res/dosei.obj";
+
+    std::vector<u32> resolutions;
+    for( auto i=2; i<argc; ++i )
+    {
+        auto res = u32( atoi( argv[i] ) );
+        if ( res > 0 )
+        { resolutions.push_back( res ); }
+    }
+    if ( resolutions.empty() )
+    { resolutions.assign( std::begin(DEFAULT_RESOLUTIONS), std::end(DEFAULT_RESOLUTIONS) ); }
+
+    // シーン構築.
+    std::vector<Vector3> triangles;
+    auto modelMini = Vector3( F32_MAX, F32_MAX, F32_MAX );
+    auto modelMaxi = Vector3(-F32_MAX,-F32_MAX,-F32_MAX );
+    BuildScene( modelPath, triangles, modelMini, modelMaxi );
+
+    auto mini = Vector3( F32_MAX, F32_MAX, F32_MAX );
+    auto maxi = Vector3(-F32_MAX,-F32_MAX,-F32_MAX );
+    for( auto& p : triangles )
+    {
+        mini = Vector3::Min( mini, p );
+        maxi = Vector3::Max( maxi, p );
+    }
+
+    auto modelCenter = ( modelMini + modelMaxi ) * 0.5f;
+    auto modelRadius = ( modelMaxi - modelMini ).Length() * 0.5f;
+
+    // カメラ設定.
+    Camera camera;
+    camera.Position    = modelCenter + Vector3( 0.0f, modelRadius * 0.8f, modelRadius * 2.5f );
+    camera.Forward     = Vector3::Normalize( Vector3( modelCenter.x, modelMini.y, modelCenter.z - modelRadius ) - camera.Position );
+    camera.FieldOfView = F_PIDIV4;
+    camera.AspectRatio = f32(SCREEN_WIDTH) / f32(SCREEN_HEIGHT);
+    camera.FarClip     = ( maxi - mini ).Length();
+    camera.NearClip    = camera.FarClip * NEAR_RATIO;
+    camera.View        = Matrix::CreateLookAt( camera.Position, camera.Position + camera.Forward, Vector3( 0.0f, 1.0f, 0.0f ) );
+    camera.InvView     = Matrix::Invert( camera.View );
+
+    // 可視範囲に合わせてクリップ平面を決定.
+    {
+        BoundingBox boxes[2];
+        boxes[0].Mini = modelMini;
+        boxes[0].Maxi = modelMaxi;
+        boxes[1].Mini = mini;
+        boxes[1].Maxi = Vector3( maxi.x, mini.y, maxi.z );
+
+        FitClipPlanes( camera.View, camera.FieldOfView, camera.AspectRatio, boxes, 2, NEAR_RATIO, camera.NearClip, camera.FarClip );
+    }
+
+    camera.Proj        = Matrix::CreatePerspectiveFieldOfView( camera.FieldOfView, camera.AspectRatio, camera.NearClip, camera.FarClip );
+    camera.ViewProj    = camera.View * camera.Proj;
+
+    // 視点からの深度を描画して, 各ピクセルのワールド座標を復元する.
+    std::vector<Vector3> worldPos ( SCREEN_WIDTH * SCREEN_HEIGHT );
+    std::vector<f32>     viewDepth( SCREEN_WIDTH * SCREEN_HEIGHT, 0.0f );
+    {
+        std::vector<f32> depthBuffer( SCREEN_WIDTH * SCREEN_HEIGHT );
+
+        RenderTarget eye = {};
+        eye.Width  = SCREEN_WIDTH;
+        eye.Height = SCREEN_HEIGHT;
+        eye.pColor = nullptr;
+        eye.pDepth = depthBuffer.data();
+        ClearRenderTarget( eye );
+
+        RasterState state = {};
+        state.Mode     = RasterMode::Linear;
+        state.NearClip = camera.NearClip;
+        state.FarClip  = camera.FarClip;
+
+        for( size_t i=0; i<triangles.size(); i += 3 )
+        {
+            auto P0 = Vector4::Transform( Vector4( triangles[i + 0], 1.0f ), camera.ViewProj );
+            auto P1 = Vector4::Transform( Vector4( triangles[i + 1], 1.0f ), camera.ViewProj );
+            auto P2 = Vector4::Transform( Vector4( triangles[i + 2], 1.0f ), camera.ViewProj );
+
+            // 近平面の手前にかかる三角形は除外.
+            if ( P0.w < camera.NearClip || P1.w < camera.NearClip || P2.w < camera.NearClip )
+            { continue; }
+
+            DrawTriangle( state, eye, P0, P1, P2, nullptr );
+        }
+
+        // 深度バッファにはクリップ空間の z が格納されているので, ビュー空間に戻す.
+        for( u32 y=0; y<SCREEN_HEIGHT; ++y )
+        {
+            for( u32 x=0; x<SCREEN_WIDTH; ++x )
+            {
+                auto idx = y * SCREEN_WIDTH + x;
+                auto d   = depthBuffer[idx];
+                if ( d == F32_MAX )
+                { continue; }
+
+                auto zv = ( d - camera.Proj._43 ) / camera.Proj._33;
+                auto nx = ( ( f32(x) + 0.5f ) / f32(SCREEN_WIDTH)  ) * 2.0f - 1.0f;
+                auto ny = ( ( f32(y) + 0.5f ) / f32(SCREEN_HEIGHT) ) * 2.0f - 1.0f;
+
+                auto pv = Vector4( nx * -zv / camera.Proj._11, ny * -zv / camera.Proj._22, zv, 1.0f );
+                auto pw = Vector4::Transform( pv, camera.InvView );
+
+                worldPos [idx] = Vector3( pw.x, pw.y, pw.z );
+                viewDepth[idx] = -zv;
+            }
+        }
+    }
+
+    // ライト設定. 線形とカスケードでは, 視線方向の逆向きをライトの投影面に射影したものを上方向とする.
+    auto lightDir = Vector3::Normalize( Vector3( 0.3f, -1.0f, -0.4f ) );
+    auto lightUp  = -camera.Forward;
+    lightUp = lightUp - lightDir * Vector3::Dot( lightUp, lightDir );
+    if ( lightUp.LengthSq() < F32_EPSILON )
+    { lightUp = Vector3( 0.0f, 0.0f, 1.0f ); }
+    lightUp = Vector3::Normalize( lightUp );
+
+    Vector3 frustum[8];
+    GetFrustumCorners( camera, camera.NearClip, camera.FarClip, frustum );
+
+    // 視錐台とシーンが重なる範囲に合わせる.
+    std::vector<Vector3> receivers;
+    for( auto& p : frustum )
+    { receivers.push_back( Vector3::Clamp( p, mini, maxi ) ); }
+
+    ShadowConfig configs[3] = {};
+
+    // 線形シャドウマップ.
+    configs[0].Technique      = ShadowTechnique::Linear;
+    configs[0].State.Mode     = RasterMode::Linear;
+    configs[0].MapCount       = 1;
+    configs[0].ViewProj[0]    = FitLightViewProj( lightDir, lightUp, receivers.data(), u32(receivers.size()), triangles );
+    configs[0].SplitFar[0]    = camera.FarClip;
+
+    // 対数透視シャドウマップ. 対数変換にはカメラではなくワープ錐台のクリップ平面を用いる.
+    configs[1].Technique      = ShadowTechnique::Logarithmic;
+    configs[1].State.Mode     = RasterMode::Logarithmic;
+    configs[1].MapCount       = 1;
+    configs[1].ViewProj[0]    = FitLightLogViewProj( lightDir, camera, receivers.data(), u32(receivers.size()), triangles, configs[1].State.NearClip, configs[1].State.FarClip );
+    configs[1].SplitFar[0]    = camera.FarClip;
+
+    // カスケードシャドウマップ (対数分割と均等分割の混合).
+    configs[2].Technique      = ShadowTechnique::Cascaded;
+    configs[2].State.Mode     = RasterMode::Linear;
+    configs[2].MapCount       = CASCADE_COUNT;
+    {
+        auto n = camera.NearClip;
+        auto f = camera.FarClip;
+        auto prevSplit = n;
+        for( u32 i=0; i<CASCADE_COUNT; ++i )
+        {
+            auto ratio   = f32(i + 1) / f32(CASCADE_COUNT);
+            auto logD    = n * pow( f / n, ratio );
+            auto linearD = n + ( f - n ) * ratio;
+            auto split   = SPLIT_LAMBDA * logD + ( 1.0f - SPLIT_LAMBDA ) * linearD;
+
+            Vector3 corners[8];
+            GetFrustumCorners( camera, prevSplit, split, corners );
+            for( auto& p : corners )
+            { p = Vector3::Clamp( p, mini, maxi ); }
+
+            configs[2].ViewProj[i] = FitLightViewProj( lightDir, lightUp, corners, 8, triangles );
+            configs[2].SplitFar[i] = split;
+
+            prevSplit = split;
+        }
+    }
+
+    // 計測.
+    std::vector<BenchResult> results;
+    for( auto res : resolutions )
+    {
+        for( auto& config : configs )
+        {
+            if ( config.State.Mode == RasterMode::Logarithmic )
+            { UpdateRasterState( config.State, config.State.NearClip, config.State.FarClip, res ); }
+            else
+            { UpdateRasterState( config.State, camera.NearClip, camera.FarClip, res ); }
+
+            std::vector<std::vector<f32>> buffers( config.MapCount );
+            std::vector<RenderTarget>     targets( config.MapCount );
+            for( u32 c=0; c<config.MapCount; ++c )
+            {
+                buffers[c].resize( size_t(res) * size_t(res) );
+                targets[c].Width  = res;
+                targets[c].Height = res;
+                targets[c].pColor = nullptr;
+                targets[c].pDepth = buffers[c].data();
+            }
+
+            auto best = F64_MAX;
+            for( u32 r=0; r<REPEAT_COUNT; ++r )
+            {
+                auto begin = std::chrono::high_resolution_clock::now();
+                RenderShadowMaps( config, targets, triangles );
+                auto end = std::chrono::high_resolution_clock::now();
+
+                auto ms = std::chrono::duration<f64, std::milli>( end - begin ).count();
+                best = Min( best, ms );
+            }
+
+            BenchResult result = {};
+            result.Technique    = GetTechniqueName( config.Technique );
+            result.Resolution   = res;
+            result.MapCount     = config.MapCount;
+            result.MemoryBytes  = u64(config.MapCount) * u64(res) * u64(res) * sizeof(f32);
+            result.RenderTimeMs = best;
+
+            MeasureError( config, worldPos, viewDepth, f32(res), result );
+
+            ILOG( "%-12s %5u x %u : %8.2f ms, error(p95) = %.3f",
+                result.Technique, res, config.MapCount, result.RenderTimeMs, result.ErrorP95 );
+
+            results.push_back( result );
+        }
+    }
+
+    // 結果を出力.
+    WriteCSV( stdout, results );
+
+    auto pFile = OpenFile( "shadow_benchmark.csv", "w" );
+    if ( pFile != nullptr )
+    {
+        WriteCSV( pFile, results );
+        fclose( pFile );
+    }
+
+    pFile = OpenFile( "shadow_benchmark.json", "w" );
+    if ( pFile != nullptr )
+    {
+        WriteJSON( pFile, results );
+        fclose( pFile );
+    }
+
+    triangles.clear();
+
+    return 0;
+}
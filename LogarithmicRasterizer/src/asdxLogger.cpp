@@ -21,9 +21,8 @@ static CONSOLE_SCREEN_BUFFER_INFO  g_ScreenBuffer;
 //-------------------------------------------------------------------------------------------------
 //      カラーを設定します.
 //-------------------------------------------------------------------------------------------------
-void BindColor( asdx::LogLevel level )
+void BindColor( HANDLE handle, asdx::LogLevel level )
 {
-    HANDLE handle = GetStdHandle( STD_OUTPUT_HANDLE );
     GetConsoleScreenBufferInfo( handle, &g_ScreenBuffer );
 
     WORD attribute = g_ScreenBuffer.wAttributes;
@@ -56,9 +55,8 @@ void BindColor( asdx::LogLevel level )
 //-------------------------------------------------------------------------------------------------
 //      カラー設定を解除します.
 //-------------------------------------------------------------------------------------------------
-void UnBindColor()
+void UnBindColor( HANDLE handle )
 {
-    HANDLE handle = GetStdHandle( STD_OUTPUT_HANDLE );
     SetConsoleTextAttribute( handle, g_ScreenBuffer.wAttributes );
 }
 
@@ -77,6 +75,7 @@ SystemLogger SystemLogger::s_Instance;
 //-------------------------------------------------------------------------------------------------
 SystemLogger::SystemLogger()
 : m_Filter( LogLevel::Verbose )
+, m_StdErr( false )
 { /* DO_NOTHING */ }
 
 //-------------------------------------------------------------------------------------------------
@@ -92,8 +91,11 @@ void SystemLogger::LogA( const LogLevel level, const char8* format, ... )
 {
     if ( level >= m_Filter )
     {
+        auto pFile  = ( m_StdErr ) ? stderr : stdout;
+        auto handle = GetStdHandle( ( m_StdErr ) ? STD_ERROR_HANDLE : STD_OUTPUT_HANDLE );
+
         // カラーを設定.
-        BindColor( level );
+        BindColor( handle, level );
 
         // ログ出力.
         {
@@ -104,13 +106,13 @@ void SystemLogger::LogA( const LogLevel level, const char8* format, ... )
             vsprintf_s( msg, format, arg );
             va_end( arg );
 
-            printf_s( "%s", msg );
+            fprintf_s( pFile, "%s", msg );
 
             OutputDebugStringA( msg );
         }
 
         // カラー設定解除.
-        UnBindColor();
+        UnBindColor( handle );
     }
 }
 
@@ -122,8 +124,11 @@ void SystemLogger::LogW( const LogLevel level, const char16* format, ... )
 {
     if ( level >= m_Filter )
     {
+        auto pFile  = ( m_StdErr ) ? stderr : stdout;
+        auto handle = GetStdHandle( ( m_StdErr ) ? STD_ERROR_HANDLE : STD_OUTPUT_HANDLE );
+
         // カラーを設定.
-        BindColor( level );
+        BindColor( handle, level );
 
         // ログ出力.
         {
@@ -134,13 +139,13 @@ void SystemLogger::LogW( const LogLevel level, const char16* format, ... )
             vswprintf_s( msg, format, arg );
             va_end( arg );
 
-            wprintf_s( L"%s", msg );
+            fwprintf_s( pFile, L"%s", msg );
 
             OutputDebugStringW( msg );
         }
 
         // カラー設定解除.
-        UnBindColor();
+        UnBindColor( handle );
     }
 }
 
@@ -156,4 +161,10 @@ void SystemLogger::SetFilter( const LogLevel filter )
 LogLevel SystemLogger::GetFilter()
 { return m_Filter; }
 
+//-------------------------------------------------------------------------------------------------
+//      ログの出力先を標準エラー出力にするかどうかを設定します.
+//-------------------------------------------------------------------------------------------------
+void SystemLogger::SetStdErr( bool enable )
+{ m_StdErr = enable; }
+
 } // namespace asdx